@@ -37,6 +37,75 @@ bool duReadContourSet(struct rcContourSet& cset, duFileIO* io);
 bool duDumpCompactHeightfield(struct rcCompactHeightfield& chf, duFileIO* io);
 bool duReadCompactHeightfield(struct rcCompactHeightfield& chf, duFileIO* io);
 
+/// How a captured tile is built when it is replayed.
+enum duTileCaptureMode
+{
+	DU_TILECAPTURE_LAYERS = 0,			///< Stop at heightfield layers (tile cache).
+	DU_TILECAPTURE_WATERSHED,			///< Watershed regions down to detail mesh.
+	DU_TILECAPTURE_MONOTONE,			///< Monotone regions down to detail mesh.
+	DU_TILECAPTURE_LAYER_REGIONS,		///< Layer regions down to detail mesh.
+	DU_TILECAPTURE_ADAPTIVE,			///< Regions partitioned by rcBuildRegionsAdaptive down to detail mesh.
+};
+
+/// Optional span filters that were enabled when the tile was captured.
+enum duTileCaptureFlags
+{
+	DU_TILECAPTURE_FILTER_LOW_HANGING = 1 << 0,
+	DU_TILECAPTURE_FILTER_LEDGE_SPANS = 1 << 1,
+	DU_TILECAPTURE_FILTER_LOW_HEIGHT = 1 << 2,
+};
+
+static const int DU_TILECAPTURE_MAX_VOLUME_VERTS = 12;
+
+/// Convex volume that was marked into the captured tile.
+struct duTileCaptureVolume
+{
+	float verts[DU_TILECAPTURE_MAX_VOLUME_VERTS*3];
+	int nverts;
+	float hmin, hmax;
+	int area;
+};
+
+/// Everything needed to rebuild a single tile without the source level.
+/// The triangles are the ones overlapping the tile (border included), with
+/// vertices remapped into a tile local array.
+struct duTileCapture
+{
+	rcConfig cfg;					///< Tile config, bounds already expanded by the border.
+	int tx, ty;						///< Tile location the capture was made for.
+	int mode;						///< Build mode. (See: #duTileCaptureMode)
+	int flags;						///< Enabled filters. (See: #duTileCaptureFlags)
+	int compactHeight;				///< Walkable height passed to rcBuildCompactHeightfield.
+	float* verts;					///< Vertices. [(x, y, z) * #nverts]
+	int nverts;
+	int* tris;						///< Triangles. [(vertA, vertB, vertC) * #ntris]
+	int* surfTypes;					///< Surface type per triangle. [Size: #ntris]
+	int ntris;
+	duTileCaptureVolume* vols;		///< Convex volumes. [Size: #nvols]
+	int nvols;
+};
+
+/// Resets the capture to an empty state. Does not free any memory.
+void duInitTileCapture(duTileCapture& capture);
+/// Frees the arrays owned by the capture.
+void duFreeTileCapture(duTileCapture& capture);
+
+/// Appends triangles to the capture. @p surfTypes is indexed like @p tris
+/// and may be null, in which case the slope-only marking is baked in.
+bool duAppendTileCaptureTris(duTileCapture& capture, const float* verts, const int* tris,
+							 const int* surfTypes, const int ntris);
+bool duAppendTileCaptureVolume(duTileCapture& capture, const float* verts, const int nverts,
+							   const float hmin, const float hmax, const int area);
+
+bool duDumpTileCapture(const duTileCapture& capture, duFileIO* io);
+bool duReadTileCapture(duTileCapture& capture, duFileIO* io);
+
+/// Rebuilds a captured tile. In #DU_TILECAPTURE_LAYERS mode @p lset receives
+/// the layers, otherwise @p pmesh and (optionally) @p dmesh receive the meshes.
+bool duReplayTileCapture(rcContext* ctx, const duTileCapture& capture,
+						 struct rcHeightfieldLayerSet* lset,
+						 struct rcPolyMesh* pmesh, struct rcPolyMeshDetail* dmesh);
+
 void duLogBuildTimes(rcContext& ctx, const int totalTileUsec);
 
 #endif // RECAST_DUMP_H
@@ -38,7 +38,7 @@ static float distancePtLine2d(const float* pt, const float* p, const float* q)
 	return dx*dx + dz*dz;
 }
 
-static void drawPolyBoundaries(duDebugDraw* dd, const dtMeshTile* tile,
+static void drawPolyBoundaries(duDebugDraw* dd, const dtNavMesh& mesh, const dtMeshTile* tile,
 							   const unsigned int col, const float linew,
 							   bool inner)
 {
@@ -63,9 +63,9 @@ static void drawPolyBoundaries(duDebugDraw* dd, const dtMeshTile* tile,
 				if (p->neis[j] & DT_EXT_LINK)
 				{
 					bool con = false;
-					for (unsigned int k = p->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+					for (unsigned int k = p->firstLink; k != DT_NULL_LINK; k = mesh.getLink(tile, k)->next)
 					{
-						if (tile->links[k].edge == j)
+						if (mesh.getLink(tile, k)->edge == j)
 						{
 							con = true;
 							break;
@@ -176,10 +176,10 @@ static void drawMeshTile(duDebugDraw* dd, const dtNavMesh& mesh, const dtNavMesh
 	dd->end();
 	
 	// Draw inter poly boundaries
-	drawPolyBoundaries(dd, tile, duRGBA(0,48,64,32), 1.5f, true);
+	drawPolyBoundaries(dd, mesh, tile, duRGBA(0,48,64,32), 1.5f, true);
 	
 	// Draw outer poly boundaries
-	drawPolyBoundaries(dd, tile, duRGBA(0,48,64,220), 2.5f, false);
+	drawPolyBoundaries(dd, mesh, tile, duRGBA(0,48,64,220), 2.5f, false);
 	
 	const unsigned int vcol = duRGBA(0,0,0,196);
 	dd->begin(DU_DRAW_POINTS, 3.0f);
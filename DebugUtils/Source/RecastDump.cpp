@@ -407,6 +407,365 @@ bool duReadCompactHeightfield(struct rcCompactHeightfield& chf, duFileIO* io)
 }
 
 
+static const int TCAP_MAGIC = ('t' << 24) | ('c' << 16) | ('a' << 8) | 'p';
+static const int TCAP_VERSION = 1;
+
+void duInitTileCapture(duTileCapture& capture)
+{
+	memset(&capture, 0, sizeof(capture));
+}
+
+void duFreeTileCapture(duTileCapture& capture)
+{
+	rcFree(capture.verts);
+	rcFree(capture.tris);
+	rcFree(capture.surfTypes);
+	rcFree(capture.vols);
+	capture.verts = 0;
+	capture.tris = 0;
+	capture.surfTypes = 0;
+	capture.vols = 0;
+	capture.nverts = 0;
+	capture.ntris = 0;
+	capture.nvols = 0;
+}
+
+template<class T>
+static bool growArray(T*& arr, const int n, const int count)
+{
+	T* tmp = (T*)rcAlloc(sizeof(T)*(n + count), RC_ALLOC_PERM);
+	if (!tmp)
+		return false;
+	if (n)
+		memcpy(tmp, arr, sizeof(T)*n);
+	rcFree(arr);
+	arr = tmp;
+	return true;
+}
+
+bool duAppendTileCaptureTris(duTileCapture& capture, const float* verts, const int* tris,
+							 const int* surfTypes, const int ntris)
+{
+	if (ntris <= 0)
+		return true;
+
+	// Map source vertex indices to capture indices with a small open addressed table,
+	// so that vertices shared between the appended triangles are only stored once.
+	int tableSize = 1;
+	while (tableSize < ntris*3*2)
+		tableSize <<= 1;
+	int* table = (int*)rcAlloc(sizeof(int)*tableSize*2, RC_ALLOC_TEMP);
+	if (!table)
+	{
+		printf("duAppendTileCaptureTris: Could not alloc vertex map (%d)\n", tableSize);
+		return false;
+	}
+	memset(table, 0xff, sizeof(int)*tableSize*2);
+
+	// Without surface types the slope marking is baked in, allocated up front so a
+	// failure leaves the capture untouched.
+	unsigned char* areas = 0;
+	if (!surfTypes)
+	{
+		areas = (unsigned char*)rcAlloc(sizeof(unsigned char)*ntris, RC_ALLOC_TEMP);
+		if (!areas)
+		{
+			printf("duAppendTileCaptureTris: Could not alloc areas (%d)\n", ntris);
+			rcFree(table);
+			return false;
+		}
+		memset(areas, 0, sizeof(unsigned char)*ntris);
+	}
+
+	// Make room for the worst case, every triangle using unique vertices.
+	if (!growArray(capture.verts, capture.nverts*3, ntris*3*3) ||
+		!growArray(capture.tris, capture.ntris*3, ntris*3) ||
+		!growArray(capture.surfTypes, capture.ntris, ntris))
+	{
+		printf("duAppendTileCaptureTris: Could not alloc triangles (%d)\n", capture.ntris + ntris);
+		rcFree(table);
+		rcFree(areas);
+		return false;
+	}
+
+	for (int i = 0; i < ntris*3; ++i)
+	{
+		const int src = tris[i];
+		int h = (int)(((unsigned int)src * 2654435761u) & (unsigned int)(tableSize-1));
+		while (table[h*2] != -1 && table[h*2] != src)
+			h = (h+1) & (tableSize-1);
+		if (table[h*2] == -1)
+		{
+			table[h*2] = src;
+			table[h*2+1] = capture.nverts;
+			rcVcopy(&capture.verts[capture.nverts*3], &verts[src*3]);
+			capture.nverts++;
+		}
+		capture.tris[capture.ntris*3 + i] = table[h*2+1];
+	}
+	rcFree(table);
+
+	int* dstTypes = &capture.surfTypes[capture.ntris];
+	if (surfTypes)
+	{
+		memcpy(dstTypes, surfTypes, sizeof(int)*ntris);
+	}
+	else
+	{
+		// Bake the slope-only marking into explicit surface types so that the
+		// replay sees exactly the same triangle areas.
+		rcMarkWalkableTriangles(0, capture.cfg.walkableSlopeAngle, capture.verts, capture.nverts,
+								&capture.tris[capture.ntris*3], ntris, areas, 0);
+		for (int i = 0; i < ntris; ++i)
+			dstTypes[i] = areas[i];
+		rcFree(areas);
+	}
+
+	capture.ntris += ntris;
+
+	return true;
+}
+
+bool duAppendTileCaptureVolume(duTileCapture& capture, const float* verts, const int nverts,
+							   const float hmin, const float hmax, const int area)
+{
+	if (nverts > DU_TILECAPTURE_MAX_VOLUME_VERTS)
+	{
+		printf("duAppendTileCaptureVolume: Too many vertices (%d)\n", nverts);
+		return false;
+	}
+	if (!growArray(capture.vols, capture.nvols, 1))
+	{
+		printf("duAppendTileCaptureVolume: Could not alloc volumes (%d)\n", capture.nvols+1);
+		return false;
+	}
+
+	duTileCaptureVolume& vol = capture.vols[capture.nvols++];
+	memset(&vol, 0, sizeof(vol));
+	memcpy(vol.verts, verts, sizeof(float)*3*nverts);
+	vol.nverts = nverts;
+	vol.hmin = hmin;
+	vol.hmax = hmax;
+	vol.area = area;
+
+	return true;
+}
+
+bool duDumpTileCapture(const duTileCapture& capture, duFileIO* io)
+{
+	if (!io)
+	{
+		printf("duDumpTileCapture: input IO is null.\n"); 
+		return false;
+	}
+	if (!io->isWriting())
+	{
+		printf("duDumpTileCapture: input IO not writing.\n"); 
+		return false;
+	}
+
+	io->write(&TCAP_MAGIC, sizeof(TCAP_MAGIC));
+	io->write(&TCAP_VERSION, sizeof(TCAP_VERSION));
+
+	io->write(&capture.cfg, sizeof(capture.cfg));
+	io->write(&capture.tx, sizeof(capture.tx));
+	io->write(&capture.ty, sizeof(capture.ty));
+	io->write(&capture.mode, sizeof(capture.mode));
+	io->write(&capture.flags, sizeof(capture.flags));
+	io->write(&capture.compactHeight, sizeof(capture.compactHeight));
+
+	io->write(&capture.nverts, sizeof(capture.nverts));
+	io->write(&capture.ntris, sizeof(capture.ntris));
+	io->write(&capture.nvols, sizeof(capture.nvols));
+
+	io->write(capture.verts, sizeof(float)*3*capture.nverts);
+	io->write(capture.tris, sizeof(int)*3*capture.ntris);
+	io->write(capture.surfTypes, sizeof(int)*capture.ntris);
+	io->write(capture.vols, sizeof(duTileCaptureVolume)*capture.nvols);
+
+	return true;
+}
+
+bool duReadTileCapture(duTileCapture& capture, duFileIO* io)
+{
+	if (!io)
+	{
+		printf("duReadTileCapture: input IO is null.\n"); 
+		return false;
+	}
+	if (!io->isReading())
+	{
+		printf("duReadTileCapture: input IO not reading.\n"); 
+		return false;
+	}
+
+	int magic = 0;
+	int version = 0;
+	
+	io->read(&magic, sizeof(magic));
+	io->read(&version, sizeof(version));
+	
+	if (magic != TCAP_MAGIC)
+	{
+		printf("duReadTileCapture: Bad voodoo.\n");
+		return false;
+	}
+	if (version != TCAP_VERSION)
+	{
+		printf("duReadTileCapture: Bad version.\n");
+		return false;
+	}
+
+	duInitTileCapture(capture);
+
+	io->read(&capture.cfg, sizeof(capture.cfg));
+	io->read(&capture.tx, sizeof(capture.tx));
+	io->read(&capture.ty, sizeof(capture.ty));
+	io->read(&capture.mode, sizeof(capture.mode));
+	io->read(&capture.flags, sizeof(capture.flags));
+	io->read(&capture.compactHeight, sizeof(capture.compactHeight));
+
+	int nverts = 0, ntris = 0, nvols = 0;
+	io->read(&nverts, sizeof(nverts));
+	io->read(&ntris, sizeof(ntris));
+	io->read(&nvols, sizeof(nvols));
+	if (nverts < 0 || ntris < 0 || nvols < 0)
+	{
+		printf("duReadTileCapture: Bad counts.\n");
+		return false;
+	}
+
+	capture.verts = (float*)rcAlloc(sizeof(float)*3*(nverts+1), RC_ALLOC_PERM);
+	capture.tris = (int*)rcAlloc(sizeof(int)*3*(ntris+1), RC_ALLOC_PERM);
+	capture.surfTypes = (int*)rcAlloc(sizeof(int)*(ntris+1), RC_ALLOC_PERM);
+	capture.vols = (duTileCaptureVolume*)rcAlloc(sizeof(duTileCaptureVolume)*(nvols+1), RC_ALLOC_PERM);
+	if (!capture.verts || !capture.tris || !capture.surfTypes || !capture.vols)
+	{
+		printf("duReadTileCapture: Could not alloc capture (%d verts, %d tris)\n", nverts, ntris);
+		duFreeTileCapture(capture);
+		return false;
+	}
+	capture.nverts = nverts;
+	capture.ntris = ntris;
+	capture.nvols = nvols;
+
+	io->read(capture.verts, sizeof(float)*3*nverts);
+	io->read(capture.tris, sizeof(int)*3*ntris);
+	io->read(capture.surfTypes, sizeof(int)*ntris);
+	io->read(capture.vols, sizeof(duTileCaptureVolume)*nvols);
+
+	return true;
+}
+
+// Owns the intermediate results of a replay so that every early out releases them.
+struct ReplayContext
+{
+	ReplayContext() : triareas(0), solid(0), chf(0), cset(0) {}
+	~ReplayContext()
+	{
+		rcFree(triareas);
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(chf);
+		rcFreeContourSet(cset);
+	}
+
+	unsigned char* triareas;
+	rcHeightfield* solid;
+	rcCompactHeightfield* chf;
+	rcContourSet* cset;
+};
+
+bool duReplayTileCapture(rcContext* ctx, const duTileCapture& capture,
+						 rcHeightfieldLayerSet* lset, rcPolyMesh* pmesh, rcPolyMeshDetail* dmesh)
+{
+	const rcConfig& cfg = capture.cfg;
+	const bool buildLayers = capture.mode == DU_TILECAPTURE_LAYERS;
+	if ((buildLayers && !lset) || (!buildLayers && !pmesh))
+	{
+		ctx->log(RC_LOG_ERROR, "duReplayTileCapture: Missing output for mode %d.", capture.mode);
+		return false;
+	}
+
+	ReplayContext rc;
+
+	rc.solid = rcAllocHeightfield();
+	if (!rc.solid)
+		return false;
+	if (!rcCreateHeightfield(ctx, *rc.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+		return false;
+
+	rc.triareas = (unsigned char*)rcAlloc(sizeof(unsigned char)*(capture.ntris+1), RC_ALLOC_TEMP);
+	if (!rc.triareas)
+		return false;
+	memset(rc.triareas, 0, sizeof(unsigned char)*capture.ntris);
+
+	rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle, capture.verts, capture.nverts,
+							capture.tris, capture.ntris, rc.triareas, capture.surfTypes);
+	if (!rcRasterizeTriangles(ctx, capture.verts, capture.nverts, capture.tris, rc.triareas, capture.ntris,
+							  *rc.solid, cfg.walkableClimb))
+		return false;
+
+	if (capture.flags & DU_TILECAPTURE_FILTER_LOW_HANGING)
+		rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, *rc.solid);
+	if (capture.flags & DU_TILECAPTURE_FILTER_LEDGE_SPANS)
+		rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, *rc.solid);
+	if (capture.flags & DU_TILECAPTURE_FILTER_LOW_HEIGHT)
+		rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, cfg.crouchHeight, *rc.solid);
+
+	rc.chf = rcAllocCompactHeightfield();
+	if (!rc.chf)
+		return false;
+	if (!rcBuildCompactHeightfield(ctx, capture.compactHeight, cfg.walkableClimb, *rc.solid, *rc.chf))
+		return false;
+	if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *rc.chf))
+		return false;
+
+	for (int i = 0; i < capture.nvols; ++i)
+	{
+		const duTileCaptureVolume& vol = capture.vols[i];
+		rcMarkConvexPolyArea(ctx, vol.verts, vol.nverts, vol.hmin, vol.hmax, (unsigned char)vol.area, *rc.chf);
+	}
+
+	if (buildLayers)
+		return rcBuildHeightfieldLayers(ctx, *rc.chf, cfg.borderSize, cfg.crouchHeight, *lset);
+
+	if (capture.mode == DU_TILECAPTURE_WATERSHED)
+	{
+		if (!rcBuildDistanceField(ctx, *rc.chf))
+			return false;
+		if (!rcBuildRegions(ctx, *rc.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+			return false;
+	}
+	else if (capture.mode == DU_TILECAPTURE_MONOTONE)
+	{
+		if (!rcBuildRegionsMonotone(ctx, *rc.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+			return false;
+	}
+	else if (capture.mode == DU_TILECAPTURE_ADAPTIVE)
+	{
+		// Picks the same partitioning as the captured build, the inputs are identical.
+		if (!rcBuildRegionsAdaptive(ctx, *rc.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+			return false;
+	}
+	else
+	{
+		if (!rcBuildLayerRegions(ctx, *rc.chf, cfg.borderSize, cfg.minRegionArea))
+			return false;
+	}
+
+	rc.cset = rcAllocContourSet();
+	if (!rc.cset)
+		return false;
+	if (!rcBuildContours(ctx, *rc.chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *rc.cset))
+		return false;
+	if (!rcBuildPolyMesh(ctx, *rc.cset, cfg.maxVertsPerPoly, *pmesh))
+		return false;
+	if (dmesh && !rcBuildPolyMeshDetail(ctx, *pmesh, *rc.chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *dmesh))
+		return false;
+
+	return true;
+}
+
 static void logLine(rcContext& ctx, rcTimerLabel label, const char* name, const float pc)
 {
 	const int t = ctx.getAccumulatedTime(label);
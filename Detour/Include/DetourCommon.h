@@ -432,6 +432,52 @@ void dtCalcPolyCenter(float* tc, const unsigned short* idx, int nidx, const floa
 bool dtOverlapPolyPoly2D(const float* polya, const int npolya,
 						 const float* polyb, const int npolyb);
 
+/// @}
+/// @name Gathered polygon functions.
+/// The polygon tests above, working on vertices gathered into separate coordinate
+/// arrays so that several edges are processed at once. The results are exactly
+/// the same as the ones of the per-vertex versions.
+/// @{
+
+/// The maximum number of vertices in a gathered polygon.
+static const int DT_SOA_MAX_VERTS = 8;
+
+/// Polygon vertices split by coordinate. The lanes from @p nverts on repeat the first
+/// vertex, so the edge starting at vertex i always ends at vertex i+1.
+struct dtPolySoA
+{
+	float x[DT_SOA_MAX_VERTS+1];
+	float y[DT_SOA_MAX_VERTS+1];
+	float z[DT_SOA_MAX_VERTS+1];
+	int nverts;
+};
+
+/// Gathers polygon vertices.
+///  @param[out]	soa		The gathered polygon.
+///  @param[in]		verts	The polygon vertices. [(x, y, z) * @p nverts]
+///  @param[in]		nverts	The number of vertices. [Limits: 1 <= value <= #DT_SOA_MAX_VERTS]
+void dtGatherPolySoA(dtPolySoA& soa, const float* verts, const int nverts);
+
+/// Gathers polygon vertices through an index list.
+///  @param[out]	soa		The gathered polygon.
+///  @param[in]		idx		The polygon indices. [(vertIndex) * @p nidx]
+///  @param[in]		nidx	The number of indices. [Limits: 1 <= value <= #DT_SOA_MAX_VERTS]
+///  @param[in]		verts	The vertices the indices refer to. [(x, y, z) * vertCount]
+void dtGatherPolySoAIndexed(dtPolySoA& soa, const unsigned short* idx, const int nidx, const float* verts);
+
+/// @see dtIntersectSegmentPoly2D
+bool dtIntersectSegmentPoly2DSoA(const float* p0, const float* p1, const dtPolySoA& poly,
+								 float& tmin, float& tmax, int& segMin, int& segMax);
+
+/// @see dtPointInPolygon
+bool dtPointInPolygonSoA(const float* pt, const dtPolySoA& poly);
+
+/// @see dtDistancePtPolyEdgesSqr
+bool dtDistancePtPolyEdgesSqrSoA(const float* pt, const dtPolySoA& poly, float* ed, float* et);
+
+/// @see dtOverlapPolyPoly2D
+bool dtOverlapPolyPoly2DSoA(const dtPolySoA& polya, const dtPolySoA& polyb);
+
 /// @}
 /// @name Miscellanious functions.
 /// @{
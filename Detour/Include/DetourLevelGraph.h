@@ -0,0 +1,208 @@
+#ifndef DETOURLEVELGRAPH_H
+#define DETOURLEVELGRAPH_H
+
+#include "DetourStatus.h"
+#include "DetourNavMesh.h"
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+
+/// Loads and frees the nav meshes of levels on demand, for example from their tile cache files.
+/// @see dtLevelGraph
+struct dtLevelMeshLoader
+{
+	virtual ~dtLevelMeshLoader();
+
+	/// Loads the nav mesh of a level. Only the tiles overlapping the bounds need to be loaded.
+	///  @param[in]		level	The level index.
+	///  @param[in]		bmin	The minimum bounds of the area to load. [(x, y, z)]
+	///  @param[in]		bmax	The maximum bounds of the area to load. [(x, y, z)]
+	/// @returns The nav mesh, or null if the level could not be loaded.
+	virtual dtNavMesh* loadLevelMesh(const int level, const float* bmin, const float* bmax) = 0;
+
+	/// Frees a nav mesh returned by loadLevelMesh.
+	virtual void freeLevelMesh(const int level, dtNavMesh* mesh) = 0;
+};
+
+/// Configuration parameters for a level graph.
+/// @see dtLevelGraph::init
+struct dtLevelGraphParams
+{
+	int maxLevels;			///< The maximum number of levels.
+	int maxLandmarks;		///< The maximum number of landmarks over all levels.
+	int maxPortals;			///< The maximum number of portals over all levels.
+	int maxLoadedLevels;	///< The maximum number of level nav meshes kept loaded at once.
+	int maxNodes;			///< The number of search nodes used for the path searches within a level.
+	float loadPadding;		///< How far around a leg the nav mesh of its level is loaded. [Units: wu]
+};
+
+/// One leg of a route across levels, walked within a single level.
+/// @see dtLevelGraph::findRoute
+struct dtLevelLeg
+{
+	int level;				///< The level the leg is in.
+	int entryPortal;		///< The portal the leg enters the level through, or -1 on the first leg.
+	int exitPortal;			///< The portal the leg leaves the level through, or -1 on the last leg.
+	float startPos[3];		///< The start of the leg, in the coordinates of its level. [(x, y, z)]
+	float endPos[3];		///< The end of the leg, in the coordinates of its level. [(x, y, z)]
+};
+
+/// Hashes the name of a landmark to the id passed to dtLevelGraph.
+unsigned int dtHashLandmarkName(const char* name);
+
+/// Plans routes across levels that are connected by level transitions, like the
+/// trigger_changelevel and info_landmark entities of GoldSrc campaigns.
+///
+/// Every level has its own coordinates. A portal leads from a level to a target level
+/// through a landmark that both levels have, and positions are carried across it by
+/// the offset between the two landmark positions.
+///
+/// Routes are planned over the portals alone, the nav meshes of the levels are only
+/// loaded when the path of a leg is searched, and only around the leg. At most
+/// dtLevelGraphParams::maxLoadedLevels are kept loaded, the least recently used one
+/// is freed to make room. The costs of the legs between portals that have been searched
+/// replace the straight line estimates in later routes.
+/// @ingroup detour
+class dtLevelGraph
+{
+public:
+	dtLevelGraph();
+	~dtLevelGraph();
+
+	/// Initializes the level graph.
+	///  @param[in]		params	The graph parameters.
+	///  @param[in]		loader	The loader for the level nav meshes.
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtLevelGraphParams* params, dtLevelMeshLoader* loader);
+
+	/// Adds a level.
+	///  @param[in]		bmin	The minimum bounds of the level. [(x, y, z)]
+	///  @param[in]		bmax	The maximum bounds of the level. [(x, y, z)]
+	///  @param[out]	result	The level index.
+	/// @returns The status flags for the operation.
+	dtStatus addLevel(const float* bmin, const float* bmax, int* result);
+
+	/// Adds a landmark to a level.
+	///  @param[in]		level		The level index.
+	///  @param[in]		landmark	The landmark id, see dtHashLandmarkName.
+	///  @param[in]		pos			The landmark position in the level. [(x, y, z)]
+	/// @returns The status flags for the operation.
+	dtStatus addLandmark(const int level, const unsigned int landmark, const float* pos);
+
+	/// Adds a portal from a level to another one.
+	///  @param[in]		level		The level the portal is in.
+	///  @param[in]		targetLevel	The level the portal leads to.
+	///  @param[in]		landmark	The landmark both levels have.
+	///  @param[in]		bmin		The minimum bounds of the portal volume. [(x, y, z)]
+	///  @param[in]		bmax		The maximum bounds of the portal volume. [(x, y, z)]
+	///  @param[out]	result		The portal index. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus addPortal(const int level, const int targetLevel, const unsigned int landmark,
+					   const float* bmin, const float* bmax, int* result = 0);
+
+	/// Finds the levels and portals to pass through to get from one position to another.
+	///  @param[in]		startLevel	The level of the start position.
+	///  @param[in]		startPos	The start position. [(x, y, z)]
+	///  @param[in]		endLevel	The level of the end position.
+	///  @param[in]		endPos		The end position. [(x, y, z)]
+	///  @param[out]	legs		The legs of the route, in order.
+	///  @param[out]	legCount	The number of legs.
+	///  @param[in]		maxLegs		The maximum number of legs the buffer can hold.
+	/// @returns The status flags for the operation. DT_BUFFER_TOO_SMALL is set if the route was cut short.
+	dtStatus findRoute(const int startLevel, const float* startPos, const int endLevel, const float* endPos,
+					   dtLevelLeg* legs, int* legCount, const int maxLegs) const;
+
+	/// Finds the polygon path of a leg, loading the nav mesh of its level if needed.
+	/// The path refers to the nav mesh returned by getLevelMesh, which stays valid until
+	/// another level has to be loaded.
+	///  @param[in]		leg			The leg to search.
+	///  @param[in]		halfExtents	The search distance along each axis for the leg end points. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	path		The polygon path.
+	///  @param[out]	pathCount	The number of polygons in the path.
+	///  @param[in]		maxPath		The maximum number of polygons the path can hold.
+	/// @returns The status flags for the operation.
+	dtStatus findLegPath(const dtLevelLeg& leg, const float* halfExtents, const dtQueryFilter* filter,
+						 dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Gets the loaded nav mesh of a level.
+	/// @returns The nav mesh, or null if the level is not loaded.
+	const dtNavMesh* getLevelMesh(const int level) const;
+
+	/// Gets the number of levels with a loaded nav mesh.
+	int getLoadedLevelCount() const;
+
+	/// Frees the nav meshes of all levels.
+	void unloadAllLevels();
+
+	/// Gets the position a portal is left at, in the coordinates of its level.
+	/// @returns True if the portal is valid.
+	bool getPortalExit(const int portal, float* pos) const;
+
+	/// Gets the position a portal is entered at, in the coordinates of its target level.
+	/// @returns True if the portal is valid and both levels have its landmark.
+	bool getPortalEntry(const int portal, float* pos) const;
+
+	int getLevelCount() const { return m_nlevels; }
+	int getPortalCount() const { return m_nportals; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtLevelGraph(const dtLevelGraph&);
+	dtLevelGraph& operator=(const dtLevelGraph&);
+
+	struct Level
+	{
+		float bmin[3];
+		float bmax[3];
+	};
+
+	struct Landmark
+	{
+		int level;
+		unsigned int id;
+		float pos[3];
+	};
+
+	struct Portal
+	{
+		int level;
+		int targetLevel;
+		unsigned int landmark;
+		float bmin[3];
+		float bmax[3];
+	};
+
+	struct LoadedLevel
+	{
+		int level;					///< The level index, or -1 if the slot is free.
+		dtNavMesh* mesh;
+		float bmin[3];				///< The bounds the mesh was loaded for.
+		float bmax[3];
+		unsigned int lastUse;
+	};
+
+	const Landmark* findLandmark(const int level, const unsigned int id) const;
+	/// Gets the estimated or searched cost of walking from the entry of one portal to the exit of another.
+	float getLegCost(const int entryPortal, const int exitPortal) const;
+	/// Loads the nav mesh of a level so it covers the bounds.
+	LoadedLevel* acquireLevel(const int level, const float* bmin, const float* bmax);
+	void freeLoadedLevel(LoadedLevel& loaded);
+
+	dtLevelGraphParams m_params;
+	dtLevelMeshLoader* m_loader;
+
+	Level* m_levels;
+	int m_nlevels;
+	Landmark* m_landmarks;
+	int m_nlandmarks;
+	Portal* m_portals;
+	int m_nportals;
+
+	float* m_legCosts;			///< Searched cost from the entry of a portal to the exit of another, negative if not searched.
+	LoadedLevel* m_loaded;
+	unsigned int m_useCounter;
+	dtNavMeshQuery* m_query;
+};
+
+#endif // DETOURLEVELGRAPH_H
@@ -21,6 +21,7 @@
 
 #include "DetourAlloc.h"
 #include "DetourStatus.h"
+#include "DetourTileLookup.h"
 
 // Undefine (or define in a build config) the following line to use 64bit polyref.
 // Generally not needed, useful for very large worlds.
@@ -87,6 +88,10 @@ static const unsigned short DT_EXT_LINK = 0x8000;
 /// A value that indicates the entity does not link to anything.
 static const unsigned int DT_NULL_LINK = 0xffffffff;
 
+/// A flag that indicates a link index refers to the navigation mesh's shared overflow link pool
+/// rather than the tile's own link array. (See: dtNavMesh::getLink)
+static const unsigned int DT_OVERFLOW_LINK = 0x80000000;
+
 /// A flag that indicates that an off-mesh connection can be traversed in both directions. (Is bidirectional.)
 static const unsigned int DT_OFFMESH_CON_BIDIR = 1;
 
@@ -136,6 +141,10 @@ enum dtDetailTriEdgeFlags
 };
 
 
+/// The number of tile replacements a navigation mesh remembers for polygon remapping.
+/// @see dtNavMesh::replaceTile, dtNavMesh::remapPolyRef
+static const int DT_MAX_TILE_REMAPS = 32;
+
 /// Limit raycasting during any angle pahfinding
 /// The limit is given as a multiple of the character radius
 static const float DT_RAY_CAST_LIMIT_PROPORTIONS = 50.0f;
@@ -307,6 +316,20 @@ struct dtMeshHeader
 	float bvQuantFactor;
 };
 
+/// Point location grid of a tile. Splits the tile bounds into cells and lists the
+/// polygons overlapping each cell, so that the polygon under a point can be found
+/// without walking the bounding volume tree.
+/// @see dtNavMesh::setPolyGridResolution
+struct dtPolyGrid
+{
+	int width, height;				///< The number of cells along the x- and z-axis.
+	float invCellSize[2];			///< Inverse of the cell size along the x- and z-axis.
+	int* cells;						///< The first entry of each cell. [Size: width * height + 1]
+	unsigned short* polys;			///< The polygon indices of all cells, cell by cell. [Size: cells[width * height]]
+	float* polyHeights;				///< The height range of each polygon, detail mesh included. [(min, max) * dtMeshHeader::polyCount]
+	int dataSize;					///< Size of the grid allocation, in bytes.
+};
+
 /// Defines a navigation mesh tile.
 /// @ingroup detour
 struct dtMeshTile
@@ -332,6 +355,9 @@ struct dtMeshTile
 	dtBVNode* bvTree;
 
 	dtOffMeshConnection** offMeshCons;		///< The tile off-mesh connections. [Size: dtMeshHeader::offMeshConCount]
+	
+	/// The point location grid. (Null unless enabled with dtNavMesh::setPolyGridResolution.)
+	dtPolyGrid* polyGrid;
 		
 	unsigned char* data;					///< The tile data. (Not directly accessed under normal situations.)
 	int dataSize;							///< Size of the tile data.
@@ -364,6 +390,27 @@ struct dtNavMeshParams
 	int maxPolys;					///< The maximum number of polygons each tile can contain. This and maxTiles are used to calculate how many bits are needed to identify tiles and polygons uniquely.
 };
 
+/// Memory used by a navigation mesh, split by the kind of data. All sizes are in bytes.
+/// The tile data fields include the alignment padding of each section.
+/// @see dtNavMesh::getMemoryUsage, dtNavMesh::getTileMemoryUsage
+/// @ingroup detour
+struct dtNavMeshMemoryUsage
+{
+	size_t tileTable;				///< The mesh object, the tile array and the tile lookups.
+	size_t headers;					///< Tile headers.
+	size_t verts;					///< Polygon vertices.
+	size_t polys;					///< Polygons.
+	size_t links;					///< Links reserved in the tile data.
+	size_t overflowLinks;			///< Shared overflow link pool. (Links in use when reported per tile.)
+	size_t detailMeshes;			///< Detail sub-meshes.
+	size_t detailVerts;				///< Detail mesh vertices.
+	size_t detailTris;				///< Detail mesh triangles.
+	size_t bvTree;					///< Bounding volume tree nodes.
+	size_t offMeshCons;				///< Off-mesh connections.
+	size_t polyGrids;				///< Point location grids, allocated outside the tile data.
+	size_t total;					///< Sum of all of the above.
+};
+
 /// A navigation mesh based on tiles of convex polygons.
 /// @ingroup detour
 class dtNavMesh
@@ -407,6 +454,23 @@ public:
 	/// @return The status flags for the operation.
 	dtStatus removeTile(dtTileRef ref, unsigned char** data, int* dataSize);
 
+	/// Replaces the tile at the location of the new tile, or adds the tile if the location is
+	/// empty. The polygon of the new tile covering each polygon of the replaced tile is
+	/// remembered, so that references into the replaced tile can be carried over with #remapPolyRef.
+	///  @param[in]		data		Data for the new tile mesh. (See: #dtCreateNavMeshData)
+	///  @param[in]		dataSize	Data size of the new tile mesh.
+	///  @param[in]		flags		Tile flags. (See: #dtTileFlags)
+	///  @param[out]	result		The tile reference. (If the tile was succesfully added.) [opt]
+	/// @return The status flags for the operation.
+	dtStatus replaceTile(unsigned char* data, int dataSize, int flags, dtTileRef* result);
+
+	/// Finds the polygon that took over from a polygon of a tile replaced by #replaceTile.
+	/// Only the last #DT_MAX_TILE_REMAPS replacements are remembered.
+	///  @param[in]		ref		The polygon reference to remap.
+	/// @return The reference itself if it is still valid, the polygon covering it in the
+	/// replacing tile, or zero if there is none.
+	dtPolyRef remapPolyRef(dtPolyRef ref) const;
+
 	/// @}
 
 	/// @{
@@ -548,6 +612,41 @@ public:
 	
 	/// @}
 
+	/// @{
+	/// @name Memory Accounting
+
+	/// Gets the memory used by the navigation mesh.
+	///  @param[out]	usage	The memory breakdown.
+	void getMemoryUsage(dtNavMeshMemoryUsage* usage) const;
+
+	/// Gets the memory used by a single tile. The tile table is not included.
+	///  @param[in]		tile	The tile.
+	///  @param[out]	usage	The memory breakdown.
+	void getTileMemoryUsage(const dtMeshTile* tile, dtNavMeshMemoryUsage* usage) const;
+
+	/// Sets the most tile data the mesh may hold, in bytes, point location grids included.
+	/// #addTile fails with #DT_OUT_OF_MEMORY while adding a tile would exceed it, and skips
+	/// the grid of a tile that fits only without it. Zero disables the budget.
+	///  @param[in]	bytes	The budget.
+	void setMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+
+	/// The tile data budget in bytes, or zero if there is none.
+	size_t getMemoryBudget() const { return m_memoryBudget; }
+
+	/// The tile data and point location grids currently held by the mesh, in bytes.
+	size_t getTileDataSize() const { return m_tileDataSize; }
+
+	/// Sets the number of point location grid cells along each side of the tiles added
+	/// from now on. Zero, the default, builds no grids. Each grid costs about
+	/// 4 bytes per cell, 2 bytes per polygon in each cell it overlaps and 8 bytes per polygon.
+	///  @param[in]	cellsPerSide	The grid resolution. [Limit: 0 <= value <= 256]
+	void setPolyGridResolution(const int cellsPerSide);
+
+	/// The point location grid resolution of new tiles, zero if they get no grid.
+	int getPolyGridResolution() const { return m_polyGridResolution; }
+
+	/// @}
+
 	/// @{
 	/// @name Encoding and Decoding
 	/// These functions are generally meant for internal use only.
@@ -637,6 +736,32 @@ public:
 #endif
 	}
 
+	/// Gets the link at the specified index of a tile's link list.
+	///  @note Link lists may continue into the shared overflow pool, so always resolve
+	///  link indices through this function instead of indexing dtMeshTile::links directly.
+	///  @param[in]	tile	The tile owning the link list.
+	///  @param[in]	idx		The link index. [Limit: != #DT_NULL_LINK]
+	/// @return The link.
+	inline const dtLink* getLink(const dtMeshTile* tile, unsigned int idx) const
+	{
+		return (idx & DT_OVERFLOW_LINK) ? &m_overflowLinks[idx & ~DT_OVERFLOW_LINK] : &tile->links[idx];
+	}
+
+	/// @copydoc getLink
+	inline dtLink* getLink(dtMeshTile* tile, unsigned int idx)
+	{
+		return (idx & DT_OVERFLOW_LINK) ? &m_overflowLinks[idx & ~DT_OVERFLOW_LINK] : &tile->links[idx];
+	}
+
+	/// The number of links currently allocated from the shared overflow pool.
+	int getOverflowLinkCount() const { return m_overflowLinkCount; }
+
+	/// The current capacity of the shared overflow pool.
+	int getOverflowLinkCapacity() const { return m_maxOverflowLinks; }
+
+	/// True while tiles are looked up through the dense tile grid instead of the hash.
+	bool hasTileGrid() const { return m_tileLookup.hasGrid(); }
+
 	void unconnectOffMeshLink(const dtOffMeshConnection* con);
 	void baseOffMeshLinks(dtOffMeshConnection* Connection);
 	void GlobalOffMeshLinks(dtOffMeshConnection* con);
@@ -651,6 +776,15 @@ private:
 	/// Returns pointer to tile in the tile array.
 	dtMeshTile* getTile(int i);
 
+	/// Allocates a link for the tile, falling back to the shared overflow pool when the tile's own links are exhausted.
+	unsigned int allocLink(dtMeshTile* tile);
+
+	/// Returns a link to the tile's free list or the shared overflow pool.
+	void freeLink(dtMeshTile* tile, unsigned int link);
+
+	/// Returns all overflow links owned by the tile's polygons to the shared overflow pool.
+	void freeOverflowLinks(dtMeshTile* tile);
+
 	/// Returns neighbour tile based on side.
 	int getTilesAt(const int x, const int y,
 				   dtMeshTile** tiles, const int maxTiles) const;
@@ -666,6 +800,10 @@ private:
 	
 	/// Builds internal polygons links for a tile.
 	void connectIntLinks(dtMeshTile* tile);
+	/// Builds the point location grid of the tile, if enabled.
+	void buildPolyGrid(dtMeshTile* tile);
+	/// Finds the polygon of the new tile data covering each polygon of the tile.
+	void buildTileRemap(const dtMeshTile* tile, const unsigned char* data, unsigned short* polys) const;
 	/// Builds internal polygons links for a tile.
 	void baseOffMeshLinks(dtMeshTile* tile);
 
@@ -695,12 +833,30 @@ private:
 	float m_orig[3];					///< Origin of the tile (0,0)
 	float m_tileWidth, m_tileHeight;	///< Dimensions of each tile.
 	int m_maxTiles;						///< Max number of tiles.
-	int m_tileLutSize;					///< Tile hash lookup size (must be pot).
-	int m_tileLutMask;					///< Tile hash lookup mask.
 
-	dtMeshTile** m_posLookup;			///< Tile hash lookup.
+	dtTileLookup<dtMeshTile> m_tileLookup;	///< Tile lookup by location.
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
 	dtMeshTile* m_tiles;				///< List of tiles.
+
+	dtLink* m_overflowLinks;			///< Shared link pool used when a tile runs out of links.
+	int m_maxOverflowLinks;				///< Capacity of the overflow link pool.
+	int m_overflowLinkCount;			///< Number of overflow links in use.
+	unsigned int m_overflowFreeList;	///< Index to the next free overflow link.
+
+	size_t m_tileDataSize;				///< Total data size of the tiles in the mesh, grids included.
+	size_t m_memoryBudget;				///< Tile data budget, zero when unlimited.
+	int m_polyGridResolution;			///< Point location grid cells per tile side, zero when disabled.
+
+	/// The polygons of a replaced tile mapped to the tile that replaced it.
+	struct TileRemap
+	{
+		dtTileRef oldRef;				///< The replaced tile.
+		dtTileRef newRef;				///< The replacing tile.
+		unsigned short* polys;			///< The new polygon index of each old polygon, 0xffff if none.
+		int polyCount;					///< The number of polygons in the replaced tile.
+	};
+	TileRemap m_remaps[DT_MAX_TILE_REMAPS];	///< Ring of the latest tile replacements.
+	int m_nextRemap;					///< The ring entry to overwrite next.
 		
 #ifndef DT_POLYREF64
 	unsigned int m_saltBits;			///< Number of salt bits in the tile ID.
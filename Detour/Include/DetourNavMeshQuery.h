@@ -146,6 +146,48 @@ struct dtRaycastHit
 	float pathCost;
 };
 
+/// A batch of raycasts, with the results stored in parallel arrays.
+/// Ray @p i starts at startPos[i*3] in startRefs[i] and is cast toward endPos[i*3].
+/// Used by dtNavMeshQuery::raycastBatch
+/// @ingroup detour
+struct dtRaycastBatch
+{
+	int count;						///< The number of rays in the batch.
+	const dtPolyRef* startRefs;		///< The start polygon of each ray. [Size: #count]
+	const float* startPos;			///< The start position of each ray. [(x, y, z) * #count]
+	const float* endPos;			///< The end position of each ray. [(x, y, z) * #count]
+	const int* order;				///< The order to cast the rays in, see dtNavMeshQuery::sortRaycastBatch. [opt] [Size: #count]
+	
+	float* t;						///< Out: The hit parameter of each ray. (FLT_MAX if no wall hit.) [Size: #count]
+	float* hitNormals;				///< Out: The normal of the nearest wall hit. [opt] [(x, y, z) * #count]
+	int* hitEdgeIndices;			///< Out: The index of the edge on the final polygon where the wall was hit. [opt] [Size: #count]
+	int* pathCounts;				///< Out: The number of visited polygons. [opt] [Size: #count]
+	dtStatus* status;				///< Out: The status of each ray. [opt] [Size: #count]
+};
+
+/// The polygon an agent was last found on. Kept by the caller between updates,
+/// so that short moves are tracked by walking the mesh instead of searching it.
+/// Set @p ref to zero to start tracking.
+/// @see dtNavMeshQuery::updatePolyTracker
+/// @ingroup detour
+struct dtPolyTracker
+{
+	dtPolyRef ref;					///< The polygon the agent stands on, zero if it is not on the mesh.
+	float pos[3];					///< The agent position on the polygon. [(x, y, z)]
+};
+
+/// Memory used by a navigation mesh query, in bytes.
+/// @see dtNavMeshQuery::getMemoryUsage
+/// @ingroup detour
+struct dtNavMeshQueryMemoryUsage
+{
+	size_t query;			///< The query object itself.
+	size_t nodePool;		///< Search nodes used by pathfinding.
+	size_t tinyNodePool;	///< Search nodes used by local queries.
+	size_t openList;		///< Open list of the search.
+	size_t total;			///< Sum of all of the above.
+};
+
 /// Provides custom polygon query behavior.
 /// Used by dtNavMeshQuery::queryPolygons.
 /// @ingroup detour
@@ -159,6 +201,20 @@ public:
 	virtual void process(const dtMeshTile* tile, dtPoly** polys, dtPolyRef* refs, int count) = 0;
 };
 
+/// Provides the time source for time budgeted queries.
+/// Detour has no clock of its own, the ticks can be in any unit as long as
+/// the budgets and deadlines passed to the queries use the same unit.
+/// Used by dtNavMeshQuery::updateSlicedFindPathTimed
+/// @ingroup detour
+class dtQueryClock
+{
+public:
+	virtual ~dtQueryClock();
+
+	/// Returns the current time in ticks. Must not go backwards.
+	virtual long long getTicks() const = 0;
+};
+
 /// Provides the ability to perform pathfinding related queries against
 /// a navigation mesh.
 /// @ingroup detour
@@ -235,6 +291,15 @@ public:
 	/// @returns The status flags for the query.
 	dtStatus updateSlicedFindPath(const int maxIter, int* doneIters);
 
+	/// Updates an in-progress sliced path query until it completes or the deadline passes.
+	///  @param[in]		clock		The clock to check the deadline against.
+	///  @param[in]		deadline	The time to stop at, in clock ticks.
+	///  @param[in]		checkIters	The number of iterations between clock checks. [Limit: > 0]
+	///  @param[out]	doneIters	The actual number of iterations completed. [opt]
+	/// @returns The status flags for the query.
+	dtStatus updateSlicedFindPathTimed(const dtQueryClock* clock, const long long deadline,
+									   const int checkIters, int* doneIters);
+
 	/// Finalizes and returns the results of a sliced path query.
 	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.) 
 	///  							[(polyRef) * @p pathCount]
@@ -422,6 +487,46 @@ public:
 					 const dtQueryFilter* filter, const unsigned int options,
 					 dtRaycastHit* hit, dtPolyRef prevRef = 0) const;
 
+	/// Sorts a batch of rays so that rays starting in the same polygon are cast together.
+	///  @param[in]		startRefs	The start polygon of each ray. [Size: @p count]
+	///  @param[in]		count		The number of rays.
+	///  @param[out]	order		The sorted ray indices. [Size: @p count]
+	/// @returns The status flags for the query.
+	dtStatus sortRaycastBatch(const dtPolyRef* startRefs, const int count, int* order) const;
+	
+	/// Casts a range of the rays in a batch. See #raycast for how each ray is cast.
+	///  @param[in,out]	batch		The rays to cast, and where to store the results.
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[in]		options		govern how the raycast behaves. See dtRaycastOptions
+	///  @param[in]		first		The first position in the batch order to cast.
+	///  @param[in]		last		One past the last position in the batch order to cast.
+	/// @returns The status flags for the query.
+	dtStatus raycastBatch(const dtRaycastBatch& batch, const dtQueryFilter* filter,
+						  const unsigned int options, const int first, const int last) const;
+
+	/// Finds the polygon an agent stands on after it moved. Short moves are followed
+	/// from the previous polygon across its neighbours, longer moves and stale
+	/// polygon references fall back to #findNearestPoly.
+	///  @param[in,out]	tracker		The agent polygon, updated to the new position.
+	///  @param[in]		pos			The new agent position. [(x, y, z)]
+	///  @param[in]		halfExtents	The search distance along each axis. Moves longer than
+	///  							this along x or z are not walked. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	/// @returns The status flags for the query.
+	dtStatus updatePolyTracker(dtPolyTracker* tracker, const float* pos, const float* halfExtents,
+							   const dtQueryFilter* filter) const;
+
+	/// Updates the polygons of many agents at once. See #updatePolyTracker.
+	///  @param[in,out]	trackers	The agent polygons. [Size: @p count]
+	///  @param[in]		positions	The new agent positions. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of agents.
+	///  @param[in]		halfExtents	The search distance along each axis. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	searchCount	The number of agents that needed a #findNearestPoly search. [opt]
+	/// @returns The status flags for the query.
+	dtStatus updatePolyTrackers(dtPolyTracker* trackers, const float* positions, const int count,
+								const float* halfExtents, const dtQueryFilter* filter,
+								int* searchCount = 0) const;
 
 	/// Finds the distance from the specified position to the nearest polygon wall.
 	///  @param[in]		startRef		The reference id of the polygon containing @p centerPos.
@@ -525,6 +630,10 @@ public:
 	/// @return The navigation mesh the query object is using.
 	const dtNavMesh* getAttachedNavMesh() const { return m_nav; }
 
+	/// Gets the memory used by the query object. The attached navigation mesh is not included.
+	///  @param[out]	usage	The memory breakdown.
+	void getMemoryUsage(dtNavMeshQueryMemoryUsage* usage) const;
+
 	/// @}
 	
 private:
@@ -532,6 +641,20 @@ private:
 	dtNavMeshQuery(const dtNavMeshQuery&);
 	dtNavMeshQuery& operator=(const dtNavMeshQuery&);
 	
+	/// Finds a polygon directly under or over the point, within climb height, through
+	/// the point location grids of the tiles. Returns false if the grids can not tell.
+	/// Picks the same polygon as the bounding volume tree search, except for points
+	/// exactly on a tile border, which are only looked up in the tile #dtNavMesh::calcTileLoc gives.
+	bool findPolyInGrid(const float* center, const float* halfExtents, const dtQueryFilter* filter,
+						dtPolyRef* ref, float* height) const;
+
+	/// Walks from the tracked polygon to the one under the new position.
+	bool walkPolyTracker(const dtPolyTracker* tracker, const float* pos, const float* halfExtents,
+						 const dtQueryFilter* filter, dtPolyRef* ref, float* height) const;
+	/// Updates one tracker, the parameters have been checked. Returns true if it had to search.
+	bool trackPoly(dtPolyTracker* tracker, const float* pos, const float* halfExtents,
+				   const dtQueryFilter* filter) const;
+
 	/// Queries polygons within a tile.
 	void queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 							 const dtQueryFilter* filter, dtPolyQuery* query) const;
@@ -549,6 +672,12 @@ private:
 							 dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile,
 							 float* mid) const;
 	
+	/// Casts a ray from an already validated start polygon.
+	dtStatus raycastFromPoly(dtPolyRef startRef, const dtMeshTile* startTile, const dtPoly* startPoly,
+							 const float* startPos, const float* endPos,
+							 const dtQueryFilter* filter, const unsigned int options,
+							 dtRaycastHit* hit, dtPolyRef prevRef) const;
+	
 	// Appends vertex to a straight path
 	dtStatus appendVertex(const float* pos, const unsigned char flags, const dtPolyRef ref,
 						  float* straightPath, unsigned char* straightPathFlags, dtPolyRef* straightPathRefs,
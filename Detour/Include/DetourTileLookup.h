@@ -0,0 +1,170 @@
+#ifndef DETOURTILELOOKUP_H
+#define DETOURTILELOOKUP_H
+
+#include <string.h>
+
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+
+/// The largest tile grid, in columns, before a tile lookup falls back to its hash.
+static const int DT_MAX_TILE_GRID_COLUMNS = 1 << 16;
+
+/// Finds the tiles at a tile location, for dtNavMesh and dtTileCache.
+///
+/// The tiles of a location are chained through their @p next member. The chains live in
+/// a dense grid spanning the tile locations seen so far, so that finding one is a single
+/// indexed load. Once the grid would need more than #DT_MAX_TILE_GRID_COLUMNS columns,
+/// or fails to allocate, the chains move to a hash table for good.
+template<class T>
+class dtTileLookup
+{
+public:
+	dtTileLookup() :
+		m_lutSize(0),
+		m_lutMask(0),
+		m_posLookup(0),
+		m_grid(0),
+		m_gridDisabled(false)
+	{
+		m_gridMin[0] = 0;
+		m_gridMin[1] = 0;
+		m_gridSize[0] = 0;
+		m_gridSize[1] = 0;
+	}
+
+	~dtTileLookup()
+	{
+		dtFree(m_posLookup);
+		dtFree(m_grid);
+	}
+
+	/// Allocates the hash table, sized for the number of tiles.
+	///  @param[in]	maxTiles	The maximum number of tiles.
+	/// @returns False if out of memory.
+	bool init(const int maxTiles)
+	{
+		m_lutSize = dtNextPow2((unsigned int)(maxTiles/4));
+		if (!m_lutSize) m_lutSize = 1;
+		m_lutMask = m_lutSize-1;
+		m_posLookup = (T**)dtAlloc(sizeof(T*)*m_lutSize, DT_ALLOC_PERM);
+		if (!m_posLookup)
+			return false;
+		memset(m_posLookup, 0, sizeof(T*)*m_lutSize);
+		return true;
+	}
+
+	/// Returns the head of the tile chain for the location, or null if the location is
+	/// outside the tile grid.
+	T** getColumn(const int x, const int y) const
+	{
+		if (m_grid)
+		{
+			const int gx = x - m_gridMin[0];
+			const int gy = y - m_gridMin[1];
+			if (gx < 0 || gy < 0 || gx >= m_gridSize[0] || gy >= m_gridSize[1])
+				return 0;
+			return &m_grid[gx + gy*m_gridSize[0]];
+		}
+		return &m_posLookup[computeHash(x, y)];
+	}
+
+	/// Grows the tile grid to cover the location, or moves all tiles to the hash when
+	/// it would get too large.
+	void grow(const int x, const int y)
+	{
+		if (m_gridDisabled)
+			return;
+		if (m_grid && getColumn(x, y))
+			return;
+
+		int minx = x, miny = y, maxx = x, maxy = y;
+		if (m_grid)
+		{
+			minx = dtMin(minx, m_gridMin[0]);
+			miny = dtMin(miny, m_gridMin[1]);
+			maxx = dtMax(maxx, m_gridMin[0] + m_gridSize[0] - 1);
+			maxy = dtMax(maxy, m_gridMin[1] + m_gridSize[1] - 1);
+		}
+		const int width = maxx - minx + 1;
+		const int height = maxy - miny + 1;
+
+		T** grid = 0;
+		if (width > 0 && height > 0 && width <= DT_MAX_TILE_GRID_COLUMNS / height)
+			grid = (T**)dtAlloc(sizeof(T*)*width*height, DT_ALLOC_PERM);
+
+		if (!grid)
+		{
+			// Too large (or out of memory), move the existing columns over to the hash for good.
+			m_gridDisabled = true;
+			if (!m_grid)
+				return;
+			for (int gy = 0; gy < m_gridSize[1]; ++gy)
+			{
+				for (int gx = 0; gx < m_gridSize[0]; ++gx)
+				{
+					const int h = computeHash(gx + m_gridMin[0], gy + m_gridMin[1]);
+					T* tile = m_grid[gx + gy*m_gridSize[0]];
+					while (tile)
+					{
+						T* next = tile->next;
+						tile->next = m_posLookup[h];
+						m_posLookup[h] = tile;
+						tile = next;
+					}
+				}
+			}
+			dtFree(m_grid);
+			m_grid = 0;
+			return;
+		}
+
+		memset(grid, 0, sizeof(T*)*width*height);
+		for (int gy = 0; gy < m_gridSize[1]; ++gy)
+		{
+			for (int gx = 0; gx < m_gridSize[0]; ++gx)
+			{
+				const int nx = gx + m_gridMin[0] - minx;
+				const int ny = gy + m_gridMin[1] - miny;
+				grid[nx + ny*width] = m_grid[gx + gy*m_gridSize[0]];
+			}
+		}
+		dtFree(m_grid);
+		m_grid = grid;
+		m_gridMin[0] = minx;
+		m_gridMin[1] = miny;
+		m_gridSize[0] = width;
+		m_gridSize[1] = height;
+	}
+
+	/// True while tiles are looked up through the dense tile grid instead of the hash.
+	bool hasGrid() const { return m_grid != 0; }
+
+	/// The memory used by the hash table and the tile grid, in bytes.
+	size_t getMemoryUsage() const
+	{
+		return sizeof(T*)*m_lutSize + sizeof(T*)*m_gridSize[0]*m_gridSize[1];
+	}
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtTileLookup(const dtTileLookup&);
+	dtTileLookup& operator=(const dtTileLookup&);
+
+	int computeHash(const int x, const int y) const
+	{
+		const unsigned int h1 = 0x8da6b343; // Large multiplicative constants;
+		const unsigned int h2 = 0xd8163841; // here arbitrarily chosen primes
+		unsigned int n = h1 * x + h2 * y;
+		return (int)(n & m_lutMask);
+	}
+
+	int m_lutSize;				///< Tile hash lookup size (must be pot).
+	int m_lutMask;				///< Tile hash lookup mask.
+	T** m_posLookup;			///< Tile hash lookup.
+	T** m_grid;					///< Dense tile lookup, one chain per tile column. Null when the hash is used.
+	int m_gridMin[2];			///< Tile coordinates of the first grid column.
+	int m_gridSize[2];			///< Grid dimensions in tiles.
+	bool m_gridDisabled;		///< Set once the tile bounds outgrew the grid.
+};
+
+#endif // DETOURTILELOOKUP_H
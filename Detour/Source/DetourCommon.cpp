@@ -18,6 +18,12 @@
 
 #include "DetourCommon.h"
 #include "DetourMath.h"
+#include "DetourAssert.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DT_COMMON_SSE2
+#include <emmintrin.h>
+#endif
 
 //////////////////////////////////////////////////////////////////////////////////////////
 
@@ -327,6 +333,278 @@ bool dtOverlapPolyPoly2D(const float* polya, const int npolya,
 	return true;
 }
 
+// Repeats the first vertex in the remaining lanes, which closes the polygon and makes
+// the padding edges degenerate.
+static void finishPolySoA(dtPolySoA& soa, const int nverts)
+{
+	for (int i = nverts; i <= DT_SOA_MAX_VERTS; ++i)
+	{
+		soa.x[i] = soa.x[0];
+		soa.y[i] = soa.y[0];
+		soa.z[i] = soa.z[0];
+	}
+	soa.nverts = nverts;
+}
+
+void dtGatherPolySoA(dtPolySoA& soa, const float* verts, const int nverts)
+{
+	dtAssert(nverts > 0 && nverts <= DT_SOA_MAX_VERTS);
+	for (int i = 0; i < nverts; ++i)
+	{
+		soa.x[i] = verts[i*3+0];
+		soa.y[i] = verts[i*3+1];
+		soa.z[i] = verts[i*3+2];
+	}
+	finishPolySoA(soa, nverts);
+}
+
+void dtGatherPolySoAIndexed(dtPolySoA& soa, const unsigned short* idx, const int nidx, const float* verts)
+{
+	dtAssert(nidx > 0 && nidx <= DT_SOA_MAX_VERTS);
+	for (int i = 0; i < nidx; ++i)
+	{
+		const float* v = &verts[idx[i]*3];
+		soa.x[i] = v[0];
+		soa.y[i] = v[1];
+		soa.z[i] = v[2];
+	}
+	finishPolySoA(soa, nidx);
+}
+
+// The gathered versions evaluate every expression in the same order as the per-vertex
+// versions and only use exactly rounded operations, so they give bit identical results.
+// Lane j holds the edge from vertex j to vertex j+1, which the per-vertex loops visit
+// as the edge (i, j) with i = j+1. Loading the arrays one lane later gives vertex j+1.
+
+bool dtIntersectSegmentPoly2DSoA(const float* p0, const float* p1, const dtPolySoA& poly,
+								 float& tmin, float& tmax, int& segMin, int& segMax)
+{
+	static const float EPS = 0.000001f;
+	
+	tmin = 0;
+	tmax = 1;
+	segMin = -1;
+	segMax = -1;
+	
+	float dir[3];
+	dtVsub(dir, p1, p0);
+	
+	float num[DT_SOA_MAX_VERTS], den[DT_SOA_MAX_VERTS], param[DT_SOA_MAX_VERTS];
+#ifdef DT_COMMON_SSE2
+	const __m128 p0x = _mm_set1_ps(p0[0]), p0z = _mm_set1_ps(p0[2]);
+	const __m128 dirx = _mm_set1_ps(dir[0]), dirz = _mm_set1_ps(dir[2]);
+	for (int k = 0; k < DT_SOA_MAX_VERTS; k += 4)
+	{
+		const __m128 x = _mm_loadu_ps(&poly.x[k]), z = _mm_loadu_ps(&poly.z[k]);
+		const __m128 edgex = _mm_sub_ps(_mm_loadu_ps(&poly.x[k+1]), x);
+		const __m128 edgez = _mm_sub_ps(_mm_loadu_ps(&poly.z[k+1]), z);
+		const __m128 diffx = _mm_sub_ps(p0x, x);
+		const __m128 diffz = _mm_sub_ps(p0z, z);
+		const __m128 n = _mm_sub_ps(_mm_mul_ps(edgez, diffx), _mm_mul_ps(edgex, diffz));
+		const __m128 d = _mm_sub_ps(_mm_mul_ps(dirz, edgex), _mm_mul_ps(dirx, edgez));
+		_mm_storeu_ps(&num[k], n);
+		_mm_storeu_ps(&den[k], d);
+		_mm_storeu_ps(&param[k], _mm_div_ps(n, d));
+	}
+#else
+	for (int k = 0; k < DT_SOA_MAX_VERTS; ++k)
+	{
+		const float edgex = poly.x[k+1] - poly.x[k], edgez = poly.z[k+1] - poly.z[k];
+		const float diffx = p0[0] - poly.x[k], diffz = p0[2] - poly.z[k];
+		num[k] = edgez*diffx - edgex*diffz;
+		den[k] = dir[2]*edgex - dir[0]*edgez;
+		param[k] = num[k] / den[k];
+	}
+#endif
+	
+	// Clip in the same edge order as dtIntersectSegmentPoly2D, the result depends on it.
+	const int nverts = poly.nverts;
+	for (int i = 0, j = nverts-1; i < nverts; j=i++)
+	{
+		const float n = num[j];
+		const float d = den[j];
+		if (fabsf(d) < EPS)
+		{
+			// S is nearly parallel to this edge
+			if (n < 0)
+				return false;
+			else
+				continue;
+		}
+		const float t = param[j];
+		if (d < 0)
+		{
+			// segment S is entering across this edge
+			if (t > tmin)
+			{
+				tmin = t;
+				segMin = j;
+				// S enters after leaving polygon
+				if (tmin > tmax)
+					return false;
+			}
+		}
+		else
+		{
+			// segment S is leaving across this edge
+			if (t < tmax)
+			{
+				tmax = t;
+				segMax = j;
+				// S leaves before entering polygon
+				if (tmax < tmin)
+					return false;
+			}
+		}
+	}
+	
+	return true;
+}
+
+bool dtPointInPolygonSoA(const float* pt, const dtPolySoA& poly)
+{
+	unsigned int crossings = 0;
+#ifdef DT_COMMON_SSE2
+	const __m128 ptx = _mm_set1_ps(pt[0]), ptz = _mm_set1_ps(pt[2]);
+	for (int k = 0; k < DT_SOA_MAX_VERTS; k += 4)
+	{
+		const __m128 vjx = _mm_loadu_ps(&poly.x[k]), vjz = _mm_loadu_ps(&poly.z[k]);
+		const __m128 vix = _mm_loadu_ps(&poly.x[k+1]), viz = _mm_loadu_ps(&poly.z[k+1]);
+		const __m128 straddles = _mm_xor_ps(_mm_cmpgt_ps(viz, ptz), _mm_cmpgt_ps(vjz, ptz));
+		const __m128 xint = _mm_add_ps(_mm_div_ps(_mm_mul_ps(_mm_sub_ps(vjx, vix), _mm_sub_ps(ptz, viz)),
+												  _mm_sub_ps(vjz, viz)), vix);
+		crossings |= (unsigned int)_mm_movemask_ps(_mm_and_ps(straddles, _mm_cmplt_ps(ptx, xint))) << k;
+	}
+#else
+	for (int k = 0; k < DT_SOA_MAX_VERTS; ++k)
+	{
+		if (((poly.z[k+1] > pt[2]) != (poly.z[k] > pt[2])) &&
+			(pt[0] < (poly.x[k]-poly.x[k+1]) * (pt[2]-poly.z[k+1]) / (poly.z[k]-poly.z[k+1]) + poly.x[k+1]))
+			crossings |= 1u << k;
+	}
+#endif
+	crossings &= (1u << poly.nverts) - 1;
+	
+	// Inside when the ray crosses an odd number of edges.
+	crossings ^= crossings >> 4;
+	crossings ^= crossings >> 2;
+	crossings ^= crossings >> 1;
+	return (crossings & 1) != 0;
+}
+
+bool dtDistancePtPolyEdgesSqrSoA(const float* pt, const dtPolySoA& poly, float* ed, float* et)
+{
+	float dist[DT_SOA_MAX_VERTS], param[DT_SOA_MAX_VERTS];
+#ifdef DT_COMMON_SSE2
+	const __m128 ptx = _mm_set1_ps(pt[0]), ptz = _mm_set1_ps(pt[2]);
+	const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	for (int k = 0; k < DT_SOA_MAX_VERTS; k += 4)
+	{
+		const __m128 px = _mm_loadu_ps(&poly.x[k]), pz = _mm_loadu_ps(&poly.z[k]);
+		const __m128 pqx = _mm_sub_ps(_mm_loadu_ps(&poly.x[k+1]), px);
+		const __m128 pqz = _mm_sub_ps(_mm_loadu_ps(&poly.z[k+1]), pz);
+		__m128 dx = _mm_sub_ps(ptx, px);
+		__m128 dz = _mm_sub_ps(ptz, pz);
+		const __m128 d = _mm_add_ps(_mm_mul_ps(pqx, pqx), _mm_mul_ps(pqz, pqz));
+		__m128 t = _mm_add_ps(_mm_mul_ps(pqx, dx), _mm_mul_ps(pqz, dz));
+		const __m128 positive = _mm_cmpgt_ps(d, zero);
+		t = _mm_or_ps(_mm_and_ps(positive, _mm_div_ps(t, d)), _mm_andnot_ps(positive, t));
+		// With t as the second operand ties keep t, like the branches of the scalar clamp.
+		t = _mm_min_ps(one, _mm_max_ps(zero, t));
+		dx = _mm_sub_ps(_mm_add_ps(px, _mm_mul_ps(t, pqx)), ptx);
+		dz = _mm_sub_ps(_mm_add_ps(pz, _mm_mul_ps(t, pqz)), ptz);
+		_mm_storeu_ps(&dist[k], _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz)));
+		_mm_storeu_ps(&param[k], t);
+	}
+#else
+	for (int k = 0; k < DT_SOA_MAX_VERTS; ++k)
+	{
+		const float p[3] = { poly.x[k], 0.0f, poly.z[k] };
+		const float q[3] = { poly.x[k+1], 0.0f, poly.z[k+1] };
+		dist[k] = dtDistancePtSegSqr2D(pt, p, q, param[k]);
+	}
+#endif
+	for (int j = 0; j < poly.nverts; ++j)
+	{
+		ed[j] = dist[j];
+		et[j] = param[j];
+	}
+	return dtPointInPolygonSoA(pt, poly);
+}
+
+#ifdef DT_COMMON_SSE2
+// Projects the polygon on four axes at once. Walking the vertices keeps every axis in its
+// own lane, so no horizontal min or max is needed.
+static inline void projectPolySoA4(const __m128 ax, const __m128 az, const dtPolySoA& poly,
+								   __m128& rmin, __m128& rmax)
+{
+	rmin = rmax = _mm_add_ps(_mm_mul_ps(ax, _mm_set1_ps(poly.x[0])), _mm_mul_ps(az, _mm_set1_ps(poly.z[0])));
+	for (int i = 1; i < poly.nverts; ++i)
+	{
+		const __m128 d = _mm_add_ps(_mm_mul_ps(ax, _mm_set1_ps(poly.x[i])), _mm_mul_ps(az, _mm_set1_ps(poly.z[i])));
+		rmin = _mm_min_ps(rmin, d);
+		rmax = _mm_max_ps(rmax, d);
+	}
+}
+#endif
+
+// Returns true if one of the edge normals of @p edges separates the polygons.
+static bool hasSeparatingAxisSoA(const dtPolySoA& edges, const dtPolySoA& polya, const dtPolySoA& polyb)
+{
+	const float eps = 1e-4f;
+	
+#ifdef DT_COMMON_SSE2
+	const __m128 veps = _mm_set1_ps(eps);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	for (int k = 0; k < edges.nverts; k += 4)
+	{
+		const __m128 ax = _mm_sub_ps(_mm_loadu_ps(&edges.z[k+1]), _mm_loadu_ps(&edges.z[k]));
+		const __m128 az = _mm_xor_ps(_mm_sub_ps(_mm_loadu_ps(&edges.x[k+1]), _mm_loadu_ps(&edges.x[k])), signMask);
+		__m128 amin, amax, bmin, bmax;
+		projectPolySoA4(ax, az, polya, amin, amax);
+		projectPolySoA4(ax, az, polyb, bmin, bmax);
+		const __m128 separated = _mm_or_ps(_mm_cmpgt_ps(_mm_add_ps(amin, veps), bmax),
+										   _mm_cmplt_ps(_mm_sub_ps(amax, veps), bmin));
+		// Lanes past the last edge hold degenerate axes.
+		const int lanes = (1 << dtMin(edges.nverts - k, 4)) - 1;
+		if (_mm_movemask_ps(separated) & lanes)
+			return true;
+	}
+#else
+	for (int j = 0; j < edges.nverts; ++j)
+	{
+		const float n[3] = { edges.z[j+1] - edges.z[j], 0, -(edges.x[j+1] - edges.x[j]) };
+		float amin,amax,bmin,bmax;
+		amin = amax = n[0]*polya.x[0] + n[2]*polya.z[0];
+		for (int i = 1; i < polya.nverts; ++i)
+		{
+			const float d = n[0]*polya.x[i] + n[2]*polya.z[i];
+			amin = dtMin(amin, d);
+			amax = dtMax(amax, d);
+		}
+		bmin = bmax = n[0]*polyb.x[0] + n[2]*polyb.z[0];
+		for (int i = 1; i < polyb.nverts; ++i)
+		{
+			const float d = n[0]*polyb.x[i] + n[2]*polyb.z[i];
+			bmin = dtMin(bmin, d);
+			bmax = dtMax(bmax, d);
+		}
+		if (!overlapRange(amin,amax, bmin,bmax, eps))
+			return true;
+	}
+#endif
+	return false;
+}
+
+bool dtOverlapPolyPoly2DSoA(const dtPolySoA& polya, const dtPolySoA& polyb)
+{
+	if (hasSeparatingAxisSoA(polya, polya, polyb))
+		return false;
+	if (hasSeparatingAxisSoA(polyb, polya, polyb))
+		return false;
+	return true;
+}
+
 // Returns a random point in a convex polygon.
 // Adapted from Graphics Gems article.
 void dtRandomPointInConvexPoly(const float* pts, const int npts, float* areas,
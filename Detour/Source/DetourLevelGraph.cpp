@@ -0,0 +1,526 @@
+#include "DetourLevelGraph.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <float.h>
+#include <string.h>
+
+dtLevelMeshLoader::~dtLevelMeshLoader()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+unsigned int dtHashLandmarkName(const char* name)
+{
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	for (const unsigned char* s = (const unsigned char*)name; *s; ++s)
+	{
+		h ^= *s;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+dtLevelGraph::dtLevelGraph() :
+	m_loader(0),
+	m_levels(0),
+	m_nlevels(0),
+	m_landmarks(0),
+	m_nlandmarks(0),
+	m_portals(0),
+	m_nportals(0),
+	m_legCosts(0),
+	m_loaded(0),
+	m_useCounter(0),
+	m_query(0)
+{
+	memset(&m_params, 0, sizeof(m_params));
+}
+
+dtLevelGraph::~dtLevelGraph()
+{
+	unloadAllLevels();
+	dtFree(m_levels);
+	dtFree(m_landmarks);
+	dtFree(m_portals);
+	dtFree(m_legCosts);
+	dtFree(m_loaded);
+	dtFreeNavMeshQuery(m_query);
+}
+
+dtStatus dtLevelGraph::init(const dtLevelGraphParams* params, dtLevelMeshLoader* loader)
+{
+	if (!params || !loader || params->maxLevels <= 0 || params->maxLandmarks <= 0 || params->maxPortals <= 0 ||
+		params->maxLoadedLevels <= 0 || params->maxNodes <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	unloadAllLevels();
+	dtFree(m_levels);
+	dtFree(m_landmarks);
+	dtFree(m_portals);
+	dtFree(m_legCosts);
+	dtFree(m_loaded);
+	m_levels = 0;
+	m_landmarks = 0;
+	m_portals = 0;
+	m_legCosts = 0;
+	m_loaded = 0;
+	m_nlevels = 0;
+	m_nlandmarks = 0;
+	m_nportals = 0;
+
+	memcpy(&m_params, params, sizeof(m_params));
+	m_loader = loader;
+
+	m_levels = (Level*)dtAlloc(sizeof(Level)*m_params.maxLevels, DT_ALLOC_PERM);
+	m_landmarks = (Landmark*)dtAlloc(sizeof(Landmark)*m_params.maxLandmarks, DT_ALLOC_PERM);
+	m_portals = (Portal*)dtAlloc(sizeof(Portal)*m_params.maxPortals, DT_ALLOC_PERM);
+	m_legCosts = (float*)dtAlloc(sizeof(float)*m_params.maxPortals*m_params.maxPortals, DT_ALLOC_PERM);
+	m_loaded = (LoadedLevel*)dtAlloc(sizeof(LoadedLevel)*m_params.maxLoadedLevels, DT_ALLOC_PERM);
+	if (!m_levels || !m_landmarks || !m_portals || !m_legCosts || !m_loaded)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+
+	for (int i = 0; i < m_params.maxPortals*m_params.maxPortals; ++i)
+		m_legCosts[i] = -1.0f;
+	memset(m_loaded, 0, sizeof(LoadedLevel)*m_params.maxLoadedLevels);
+	for (int i = 0; i < m_params.maxLoadedLevels; ++i)
+		m_loaded[i].level = -1;
+	m_useCounter = 0;
+
+	if (!m_query)
+	{
+		m_query = dtAllocNavMeshQuery();
+		if (!m_query)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtLevelGraph::addLevel(const float* bmin, const float* bmax, int* result)
+{
+	if (!m_levels || !bmin || !bmax || !result)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (m_nlevels >= m_params.maxLevels)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	Level& level = m_levels[m_nlevels];
+	dtVcopy(level.bmin, bmin);
+	dtVcopy(level.bmax, bmax);
+	*result = m_nlevels++;
+	return DT_SUCCESS;
+}
+
+dtStatus dtLevelGraph::addLandmark(const int level, const unsigned int landmark, const float* pos)
+{
+	if (level < 0 || level >= m_nlevels || !pos)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (findLandmark(level, landmark))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (m_nlandmarks >= m_params.maxLandmarks)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	Landmark& lm = m_landmarks[m_nlandmarks++];
+	lm.level = level;
+	lm.id = landmark;
+	dtVcopy(lm.pos, pos);
+	return DT_SUCCESS;
+}
+
+dtStatus dtLevelGraph::addPortal(const int level, const int targetLevel, const unsigned int landmark,
+								 const float* bmin, const float* bmax, int* result)
+{
+	if (level < 0 || level >= m_nlevels || targetLevel < 0 || targetLevel >= m_nlevels || level == targetLevel ||
+		!bmin || !bmax)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (m_nportals >= m_params.maxPortals)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	Portal& portal = m_portals[m_nportals];
+	portal.level = level;
+	portal.targetLevel = targetLevel;
+	portal.landmark = landmark;
+	dtVcopy(portal.bmin, bmin);
+	dtVcopy(portal.bmax, bmax);
+	if (result)
+		*result = m_nportals;
+	m_nportals++;
+	return DT_SUCCESS;
+}
+
+const dtLevelGraph::Landmark* dtLevelGraph::findLandmark(const int level, const unsigned int id) const
+{
+	for (int i = 0; i < m_nlandmarks; ++i)
+	{
+		if (m_landmarks[i].level == level && m_landmarks[i].id == id)
+			return &m_landmarks[i];
+	}
+	return 0;
+}
+
+bool dtLevelGraph::getPortalExit(const int portal, float* pos) const
+{
+	if (portal < 0 || portal >= m_nportals)
+		return false;
+
+	// The middle of the bottom of the portal volume, where an agent walks into it.
+	const Portal& p = m_portals[portal];
+	pos[0] = (p.bmin[0] + p.bmax[0]) * 0.5f;
+	pos[1] = p.bmin[1];
+	pos[2] = (p.bmin[2] + p.bmax[2]) * 0.5f;
+	return true;
+}
+
+bool dtLevelGraph::getPortalEntry(const int portal, float* pos) const
+{
+	if (portal < 0 || portal >= m_nportals)
+		return false;
+
+	const Portal& p = m_portals[portal];
+	const Landmark* from = findLandmark(p.level, p.landmark);
+	const Landmark* to = findLandmark(p.targetLevel, p.landmark);
+	if (!from || !to)
+		return false;
+
+	float exit[3];
+	if (!getPortalExit(portal, exit))
+		return false;
+	dtVsub(pos, exit, from->pos);
+	dtVadd(pos, pos, to->pos);
+	return true;
+}
+
+float dtLevelGraph::getLegCost(const int entryPortal, const int exitPortal) const
+{
+	const float cost = m_legCosts[entryPortal*m_params.maxPortals + exitPortal];
+	if (cost >= 0.0f)
+		return cost;
+
+	float entry[3], exit[3];
+	if (!getPortalEntry(entryPortal, entry) || !getPortalExit(exitPortal, exit))
+		return FLT_MAX;
+	return dtVdist(entry, exit);
+}
+
+/// @par
+///
+/// The route is searched over the portals with Dijkstra's algorithm. The cost of a leg
+/// between two portals is the cost found by an earlier findLegPath, or the straight line
+/// distance if the leg has not been searched. Legs that were found to be blocked are not used.
+dtStatus dtLevelGraph::findRoute(const int startLevel, const float* startPos, const int endLevel, const float* endPos,
+								 dtLevelLeg* legs, int* legCount, const int maxLegs) const
+{
+	if (!legCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	*legCount = 0;
+	if (startLevel < 0 || startLevel >= m_nlevels || endLevel < 0 || endLevel >= m_nlevels ||
+		!startPos || !endPos || !legs || maxLegs <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// One node per portal, arriving in its target level, and the end position as the last node.
+	const int nnodes = m_nportals + 1;
+	const int goal = m_nportals;
+	float* dist = (float*)dtAlloc(sizeof(float)*nnodes, DT_ALLOC_TEMP);
+	int* parent = (int*)dtAlloc(sizeof(int)*nnodes, DT_ALLOC_TEMP);
+	unsigned char* closed = (unsigned char*)dtAlloc(sizeof(unsigned char)*nnodes, DT_ALLOC_TEMP);
+	if (!dist || !parent || !closed)
+	{
+		dtFree(dist);
+		dtFree(parent);
+		dtFree(closed);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	for (int i = 0; i < nnodes; ++i)
+	{
+		dist[i] = FLT_MAX;
+		parent[i] = -1;
+		closed[i] = 0;
+	}
+
+	float entry[3], exit[3];
+	if (startLevel == endLevel)
+		dist[goal] = dtVdist(startPos, endPos);
+	for (int i = 0; i < m_nportals; ++i)
+	{
+		if (m_portals[i].level != startLevel || !getPortalEntry(i, entry))
+			continue;
+		getPortalExit(i, exit);
+		dist[i] = dtVdist(startPos, exit);
+	}
+
+	for (;;)
+	{
+		int best = -1;
+		for (int i = 0; i < nnodes; ++i)
+		{
+			if (!closed[i] && dist[i] < FLT_MAX && (best == -1 || dist[i] < dist[best]))
+				best = i;
+		}
+		if (best == -1 || best == goal)
+			break;
+		closed[best] = 1;
+
+		const int level = m_portals[best].targetLevel;
+		getPortalEntry(best, entry);
+
+		if (level == endLevel)
+		{
+			const float d = dist[best] + dtVdist(entry, endPos);
+			if (d < dist[goal])
+			{
+				dist[goal] = d;
+				parent[goal] = best;
+			}
+		}
+
+		for (int i = 0; i < m_nportals; ++i)
+		{
+			if (closed[i] || m_portals[i].level != level || !getPortalEntry(i, exit))
+				continue;
+			const float cost = getLegCost(best, i);
+			if (cost == FLT_MAX)
+				continue;
+			const float d = dist[best] + cost;
+			if (d < dist[i])
+			{
+				dist[i] = d;
+				parent[i] = best;
+			}
+		}
+	}
+
+	const bool found = dist[goal] < FLT_MAX;
+
+	dtStatus status = DT_SUCCESS;
+	if (found)
+	{
+		// Count the legs, then fill them in from the end.
+		int nlegs = 1;
+		for (int n = parent[goal]; n != -1; n = parent[n])
+			nlegs++;
+		if (nlegs > maxLegs)
+			status |= DT_BUFFER_TOO_SMALL;
+
+		int node = goal;
+		for (int i = nlegs - 1; i >= 0; --i)
+		{
+			const int entryPortal = parent[node];
+			if (i < maxLegs)
+			{
+				dtLevelLeg& leg = legs[i];
+				leg.entryPortal = entryPortal;
+				leg.exitPortal = node == goal ? -1 : node;
+				leg.level = entryPortal == -1 ? startLevel : m_portals[entryPortal].targetLevel;
+				if (entryPortal == -1)
+					dtVcopy(leg.startPos, startPos);
+				else
+					getPortalEntry(entryPortal, leg.startPos);
+				if (node == goal)
+					dtVcopy(leg.endPos, endPos);
+				else
+					getPortalExit(node, leg.endPos);
+			}
+			node = entryPortal;
+		}
+		*legCount = dtMin(nlegs, maxLegs);
+	}
+
+	dtFree(dist);
+	dtFree(parent);
+	dtFree(closed);
+
+	if (!found)
+		return DT_FAILURE;
+	return status;
+}
+
+void dtLevelGraph::freeLoadedLevel(LoadedLevel& loaded)
+{
+	if (loaded.level != -1 && loaded.mesh)
+		m_loader->freeLevelMesh(loaded.level, loaded.mesh);
+	loaded.level = -1;
+	loaded.mesh = 0;
+}
+
+dtLevelGraph::LoadedLevel* dtLevelGraph::acquireLevel(const int level, const float* bmin, const float* bmax)
+{
+	LoadedLevel* slot = 0;
+	for (int i = 0; i < m_params.maxLoadedLevels; ++i)
+	{
+		if (m_loaded[i].level == level)
+		{
+			slot = &m_loaded[i];
+			break;
+		}
+	}
+
+	float lmin[3], lmax[3];
+	dtVcopy(lmin, bmin);
+	dtVcopy(lmax, bmax);
+
+	if (slot)
+	{
+		if (slot->bmin[0] <= bmin[0] && slot->bmin[1] <= bmin[1] && slot->bmin[2] <= bmin[2] &&
+			slot->bmax[0] >= bmax[0] && slot->bmax[1] >= bmax[1] && slot->bmax[2] >= bmax[2])
+		{
+			slot->lastUse = ++m_useCounter;
+			return slot;
+		}
+
+		// Reload the level over the old and the new area.
+		dtVmin(lmin, slot->bmin);
+		dtVmax(lmax, slot->bmax);
+		freeLoadedLevel(*slot);
+	}
+	else
+	{
+		// Take a free slot, or the least recently used one.
+		for (int i = 0; i < m_params.maxLoadedLevels; ++i)
+		{
+			LoadedLevel& loaded = m_loaded[i];
+			if (loaded.level == -1)
+			{
+				slot = &loaded;
+				break;
+			}
+			if (!slot || loaded.lastUse < slot->lastUse)
+				slot = &loaded;
+		}
+		freeLoadedLevel(*slot);
+	}
+
+	slot->mesh = m_loader->loadLevelMesh(level, lmin, lmax);
+	if (!slot->mesh)
+		return 0;
+	slot->level = level;
+	dtVcopy(slot->bmin, lmin);
+	dtVcopy(slot->bmax, lmax);
+	slot->lastUse = ++m_useCounter;
+	return slot;
+}
+
+/// @par
+///
+/// The nav mesh of the level is loaded around the leg, padded by dtLevelGraphParams::loadPadding.
+/// If the path can not be completed in that area, the whole level is loaded and the search
+/// is repeated. Searches between two portals store their cost for findRoute, or mark the
+/// leg blocked if the search of the whole level proves no path exists. A search that runs
+/// out of nodes, fills @p maxPath or can not find polys near the leg ends leaves the leg
+/// at its estimated cost.
+dtStatus dtLevelGraph::findLegPath(const dtLevelLeg& leg, const float* halfExtents, const dtQueryFilter* filter,
+								   dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	*pathCount = 0;
+	if (!m_loader || leg.level < 0 || leg.level >= m_nlevels || !halfExtents || !filter || !path || maxPath <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const Level& level = m_levels[leg.level];
+	float bmin[3], bmax[3];
+	dtVcopy(bmin, leg.startPos);
+	dtVcopy(bmax, leg.startPos);
+	dtVmin(bmin, leg.endPos);
+	dtVmax(bmax, leg.endPos);
+	for (int i = 0; i < 3; ++i)
+	{
+		bmin[i] = dtMax(bmin[i] - m_params.loadPadding, level.bmin[i]);
+		bmax[i] = dtMin(bmax[i] + m_params.loadPadding, level.bmax[i]);
+	}
+
+	dtStatus status = DT_FAILURE;
+	float endPos[3];
+	for (int attempt = 0; attempt < 2; ++attempt)
+	{
+		LoadedLevel* loaded = acquireLevel(leg.level, bmin, bmax);
+		if (!loaded)
+			return DT_FAILURE;
+
+		status = m_query->init(loaded->mesh, m_params.maxNodes);
+		if (dtStatusFailed(status))
+			return status;
+
+		dtPolyRef startRef = 0, endRef = 0;
+		float startPos[3];
+		m_query->findNearestPoly(leg.startPos, halfExtents, filter, &startRef, startPos);
+		m_query->findNearestPoly(leg.endPos, halfExtents, filter, &endRef, endPos);
+
+		*pathCount = 0;
+		status = DT_FAILURE;
+		if (startRef && endRef)
+			status = m_query->findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+
+		const bool complete = dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT);
+		const bool wholeLevel = dtVequal(loaded->bmin, level.bmin) && dtVequal(loaded->bmax, level.bmax);
+		if (complete || wholeLevel)
+		{
+			if (leg.entryPortal >= 0 && leg.entryPortal < m_nportals && leg.exitPortal >= 0 && leg.exitPortal < m_nportals)
+			{
+				// Only a search that ran out of open nodes proves the leg blocked. Missing polys,
+				// an exhausted node pool or a truncated path leave the leg estimated.
+				float& cost = m_legCosts[leg.entryPortal*m_params.maxPortals + leg.exitPortal];
+				const bool exhausted = dtStatusDetail(status, DT_OUT_OF_NODES);
+				const bool truncated = dtStatusDetail(status, DT_BUFFER_TOO_SMALL);
+				if (!complete)
+				{
+					if (startRef && endRef && dtStatusSucceed(status) && !exhausted)
+						cost = FLT_MAX;
+				}
+				else if (!truncated)
+				{
+					// Measure the leg along its straight path. A straight path that does
+					// not fit would measure short, so the leg keeps its estimate.
+					static const int MAX_STRAIGHT = 64;
+					float straight[MAX_STRAIGHT*3];
+					int nstraight = 0;
+					const dtStatus straightStatus = m_query->findStraightPath(startPos, endPos, path, *pathCount,
+																			  straight, 0, 0, &nstraight, MAX_STRAIGHT);
+					if (dtStatusSucceed(straightStatus) && !dtStatusDetail(straightStatus, DT_BUFFER_TOO_SMALL))
+					{
+						cost = 0.0f;
+						for (int i = 1; i < nstraight; ++i)
+							cost += dtVdist(&straight[(i-1)*3], &straight[i*3]);
+					}
+				}
+			}
+			break;
+		}
+
+		dtVcopy(bmin, level.bmin);
+		dtVcopy(bmax, level.bmax);
+	}
+
+	return status;
+}
+
+const dtNavMesh* dtLevelGraph::getLevelMesh(const int level) const
+{
+	for (int i = 0; i < m_params.maxLoadedLevels; ++i)
+	{
+		if (m_loaded[i].level == level)
+			return m_loaded[i].mesh;
+	}
+	return 0;
+}
+
+int dtLevelGraph::getLoadedLevelCount() const
+{
+	int n = 0;
+	for (int i = 0; i < m_params.maxLoadedLevels; ++i)
+	{
+		if (m_loaded[i].level != -1)
+			n++;
+	}
+	return n;
+}
+
+void dtLevelGraph::unloadAllLevels()
+{
+	if (!m_loaded)
+		return;
+	for (int i = 0; i < m_params.maxLoadedLevels; ++i)
+		freeLoadedLevel(m_loaded[i]);
+}
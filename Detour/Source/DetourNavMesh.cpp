@@ -111,28 +111,6 @@ static void calcSlabEndPoints(const float* va, const float* vb, float* bmin, flo
 	}
 }
 
-inline int computeTileHash(int x, int y, const int mask)
-{
-	const unsigned int h1 = 0x8da6b343; // Large multiplicative constants;
-	const unsigned int h2 = 0xd8163841; // here arbitrarily chosen primes
-	unsigned int n = h1 * x + h2 * y;
-	return (int)(n & mask);
-}
-
-inline unsigned int allocLink(dtMeshTile* tile)
-{
-	if (tile->linksFreeList == DT_NULL_LINK)
-		return DT_NULL_LINK;
-	unsigned int link = tile->linksFreeList;
-	tile->linksFreeList = tile->links[link].next;
-	return link;
-}
-
-inline void freeLink(dtMeshTile* tile, unsigned int link)
-{
-	tile->links[link].next = tile->linksFreeList;
-	tile->linksFreeList = link;
-}
 
 
 dtNavMesh* dtAllocNavMesh()
@@ -189,11 +167,16 @@ dtNavMesh::dtNavMesh() :
 	m_tileWidth(0),
 	m_tileHeight(0),
 	m_maxTiles(0),
-	m_tileLutSize(0),
-	m_tileLutMask(0),
-	m_posLookup(0),
 	m_nextFree(0),
-	m_tiles(0)
+	m_tiles(0),
+	m_overflowLinks(0),
+	m_maxOverflowLinks(0),
+	m_overflowLinkCount(0),
+	m_overflowFreeList(DT_NULL_LINK),
+	m_tileDataSize(0),
+	m_memoryBudget(0),
+	m_polyGridResolution(0),
+	m_nextRemap(0)
 {
 #ifndef DT_POLYREF64
 	m_saltBits = 0;
@@ -204,6 +187,7 @@ dtNavMesh::dtNavMesh() :
 	m_orig[0] = 0;
 	m_orig[1] = 0;
 	m_orig[2] = 0;
+	memset(m_remaps, 0, sizeof(m_remaps));
 }
 
 dtNavMesh::~dtNavMesh()
@@ -216,9 +200,13 @@ dtNavMesh::~dtNavMesh()
 			m_tiles[i].data = 0;
 			m_tiles[i].dataSize = 0;
 		}
+		dtFree(m_tiles[i].polyGrid);
+		m_tiles[i].polyGrid = 0;
 	}
-	dtFree(m_posLookup);
 	dtFree(m_tiles);
+	dtFree(m_overflowLinks);
+	for (int i = 0; i < DT_MAX_TILE_REMAPS; ++i)
+		dtFree(m_remaps[i].polys);
 }
 		
 dtStatus dtNavMesh::init(const dtNavMeshParams* params)
@@ -230,18 +218,13 @@ dtStatus dtNavMesh::init(const dtNavMeshParams* params)
 	
 	// Init tiles
 	m_maxTiles = params->maxTiles;
-	m_tileLutSize = dtNextPow2(params->maxTiles/4);
-	if (!m_tileLutSize) m_tileLutSize = 1;
-	m_tileLutMask = m_tileLutSize-1;
 	
 	m_tiles = (dtMeshTile*)dtAlloc(sizeof(dtMeshTile)*m_maxTiles, DT_ALLOC_PERM);
 	if (!m_tiles)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	m_posLookup = (dtMeshTile**)dtAlloc(sizeof(dtMeshTile*)*m_tileLutSize, DT_ALLOC_PERM);
-	if (!m_posLookup)
+	if (!m_tileLookup.init(m_maxTiles))
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(m_tiles, 0, sizeof(dtMeshTile)*m_maxTiles);
-	memset(m_posLookup, 0, sizeof(dtMeshTile*)*m_tileLutSize);
 	m_nextFree = 0;
 	for (int i = m_maxTiles-1; i >= 0; --i)
 	{
@@ -296,6 +279,85 @@ const dtNavMeshParams* dtNavMesh::getParams() const
 	return &m_params;
 }
 
+/// @par
+///
+/// Tiles only reserve links for the connections known when the tile data was created. Off-mesh
+/// connections added at runtime (see dtTileCache::addOffMeshConnection) may land more links in a
+/// tile than it has room for, so once the tile's free list is exhausted links are taken from a pool
+/// shared by all tiles. The pool grows on demand, so allocation only fails if memory runs out.
+unsigned int dtNavMesh::allocLink(dtMeshTile* tile)
+{
+	if (tile->linksFreeList != DT_NULL_LINK)
+	{
+		unsigned int link = tile->linksFreeList;
+		tile->linksFreeList = tile->links[link].next;
+		return link;
+	}
+
+	if (m_overflowFreeList == DT_NULL_LINK)
+	{
+		const int newMax = m_maxOverflowLinks ? m_maxOverflowLinks*2 : 64;
+		if (newMax <= m_maxOverflowLinks || (unsigned int)newMax > (DT_OVERFLOW_LINK-1))
+			return DT_NULL_LINK;
+		dtLink* newLinks = (dtLink*)dtAlloc(sizeof(dtLink)*newMax, DT_ALLOC_PERM);
+		if (!newLinks)
+			return DT_NULL_LINK;
+		if (m_maxOverflowLinks)
+			memcpy(newLinks, m_overflowLinks, sizeof(dtLink)*m_maxOverflowLinks);
+		dtFree(m_overflowLinks);
+		m_overflowLinks = newLinks;
+
+		// Chain the new links into the free list.
+		for (int i = newMax-1; i >= m_maxOverflowLinks; --i)
+		{
+			new(&m_overflowLinks[i]) dtLink;
+			m_overflowLinks[i].next = m_overflowFreeList;
+			m_overflowFreeList = (unsigned int)i;
+		}
+		m_maxOverflowLinks = newMax;
+	}
+
+	unsigned int link = m_overflowFreeList;
+	m_overflowFreeList = m_overflowLinks[link].next;
+	m_overflowLinkCount++;
+	return link | DT_OVERFLOW_LINK;
+}
+
+void dtNavMesh::freeLink(dtMeshTile* tile, unsigned int link)
+{
+	if (link & DT_OVERFLOW_LINK)
+	{
+		const unsigned int idx = link & ~DT_OVERFLOW_LINK;
+		m_overflowLinks[idx].next = m_overflowFreeList;
+		m_overflowLinks[idx].OffMeshID = -1;
+		m_overflowFreeList = idx;
+		m_overflowLinkCount--;
+		return;
+	}
+	tile->links[link].next = tile->linksFreeList;
+	tile->linksFreeList = link;
+}
+
+void dtNavMesh::freeOverflowLinks(dtMeshTile* tile)
+{
+	if (!m_overflowLinkCount)
+		return;
+
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		dtPoly* poly = &tile->polys[i];
+		unsigned int j = poly->firstLink;
+		while (j != DT_NULL_LINK)
+		{
+			const unsigned int nj = getLink(tile, j)->next;
+			if (j & DT_OVERFLOW_LINK)
+				freeLink(tile, j);
+			j = nj;
+		}
+		poly->firstLink = DT_NULL_LINK;
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 int dtNavMesh::findConnectingPolys(const float* va, const float* vb,
 								   const dtMeshTile* tile, int side,
@@ -363,14 +425,14 @@ void dtNavMesh::unconnectLinks(dtMeshTile* tile, dtMeshTile* target)
 		unsigned int pj = DT_NULL_LINK;
 		while (j != DT_NULL_LINK)
 		{
-			if (decodePolyIdTile(tile->links[j].ref) == targetNum)
+			if (decodePolyIdTile(getLink(tile, j)->ref) == targetNum)
 			{
 				// Remove link.
-				unsigned int nj = tile->links[j].next;
+				unsigned int nj = getLink(tile, j)->next;
 				if (pj == DT_NULL_LINK)
 					poly->firstLink = nj;
 				else
-					tile->links[pj].next = nj;
+					getLink(tile, pj)->next = nj;
 				freeLink(tile, j);
 				j = nj;
 			}
@@ -378,7 +440,7 @@ void dtNavMesh::unconnectLinks(dtMeshTile* tile, dtMeshTile* target)
 			{
 				// Advance
 				pj = j;
-				j = tile->links[j].next;
+				j = getLink(tile, j)->next;
 			}
 		}
 	}
@@ -418,7 +480,7 @@ void dtNavMesh::connectExtLinks(dtMeshTile* tile, dtMeshTile* target, int side)
 				unsigned int idx = allocLink(tile);
 				if (idx != DT_NULL_LINK)
 				{
-					dtLink* link = &tile->links[idx];
+					dtLink* link = getLink(tile, idx);
 					link->ref = nei[k];
 					link->edge = (unsigned char)j;
 					link->side = (unsigned char)dir;
@@ -489,7 +551,7 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 		unsigned int idx = allocLink(target);
 		if (idx != DT_NULL_LINK)
 		{
-			dtLink* link = &target->links[idx];
+			dtLink* link = getLink(target, idx);
 			link->ref = ref;
 			link->edge = (unsigned char)1;
 			link->side = oppositeSide;
@@ -507,7 +569,7 @@ void dtNavMesh::connectExtOffMeshLinks(dtMeshTile* tile, dtMeshTile* target, int
 			{
 				const unsigned short landPolyIdx = (unsigned short)decodePolyIdPoly(ref);
 				dtPoly* landPoly = &tile->polys[landPolyIdx];
-				dtLink* link = &tile->links[tidx];
+				dtLink* link = getLink(tile, tidx);
 				link->ref = getPolyRefBase(target) | (dtPolyRef)(targetCon->poly);
 				link->edge = 0xff;
 				link->side = (unsigned char)(side == -1 ? 0xff : side);
@@ -545,7 +607,7 @@ void dtNavMesh::connectIntLinks(dtMeshTile* tile)
 			unsigned int idx = allocLink(tile);
 			if (idx != DT_NULL_LINK)
 			{
-				dtLink* link = &tile->links[idx];
+				dtLink* link = getLink(tile, idx);
 				link->ref = base | (dtPolyRef)(poly->neis[j]-1);
 				link->edge = (unsigned char)j;
 				link->side = 0xff;
@@ -588,7 +650,7 @@ void dtNavMesh::baseOffMeshLinks(dtOffMeshConnection* con)
 	unsigned int idx = allocLink(tile);
 	if (idx != DT_NULL_LINK)
 	{
-		dtLink* link = &tile->links[idx];
+		dtLink* link = getLink(tile, idx);
 		link->OffMeshID = con->userId;
 		link->ref = ref;
 		link->edge = (unsigned char)0;
@@ -605,7 +667,7 @@ void dtNavMesh::baseOffMeshLinks(dtOffMeshConnection* con)
 	{
 		const unsigned short landPolyIdx = (unsigned short)decodePolyIdPoly(ref);
 		dtPoly* landPoly = &tile->polys[landPolyIdx];
-		dtLink* link = &tile->links[tidx];
+		dtLink* link = getLink(tile, tidx);
 		link->OffMeshID = con->userId;
 		link->ref = base | (dtPolyRef)(con->poly);
 		link->edge = 0xff;
@@ -649,7 +711,7 @@ void dtNavMesh::baseOffMeshLinks(dtMeshTile* tile)
 		unsigned int idx = allocLink(tile);
 		if (idx != DT_NULL_LINK)
 		{
-			dtLink* link = &tile->links[idx];
+			dtLink* link = getLink(tile, idx);
 			link->ref = ref;
 			link->edge = (unsigned char)0;
 			link->side = 0xff;
@@ -665,7 +727,7 @@ void dtNavMesh::baseOffMeshLinks(dtMeshTile* tile)
 		{
 			const unsigned short landPolyIdx = (unsigned short)decodePolyIdPoly(ref);
 			dtPoly* landPoly = &tile->polys[landPolyIdx];
-			dtLink* link = &tile->links[tidx];
+			dtLink* link = getLink(tile, tidx);
 			link->ref = base | (dtPolyRef)(con->poly);
 			link->edge = 0xff;
 			link->side = 0xff;
@@ -745,12 +807,10 @@ bool dtNavMesh::getPolyHeight(const dtMeshTile* tile, const dtPoly* poly, const
 	const unsigned int ip = (unsigned int)(poly - tile->polys);
 	const dtPolyDetail* pd = &tile->detailMeshes[ip];
 	
-	float verts[DT_VERTS_PER_POLYGON*3];	
-	const int nv = poly->vertCount;
-	for (int i = 0; i < nv; ++i)
-		dtVcopy(&verts[i*3], &tile->verts[poly->verts[i]*3]);
+	dtPolySoA verts;
+	dtGatherPolySoAIndexed(verts, poly->verts, poly->vertCount, tile->verts);
 	
-	if (!dtPointInPolygon(pos, verts, nv))
+	if (!dtPointInPolygonSoA(pos, verts))
 		return false;
 
 	if (!height)
@@ -986,6 +1046,10 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	// Make sure the location is free.
 	if (getTileAt(header->x, header->y, header->layer))
 		return DT_FAILURE | DT_ALREADY_OCCUPIED;
+	
+	// Make sure the tile fits in the memory budget.
+	if (m_memoryBudget && m_tileDataSize + (size_t)dataSize > m_memoryBudget)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 		
 	// Allocate a tile.
 	dtMeshTile* tile = 0;
@@ -1031,9 +1095,10 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
 	// Insert tile into the position lut.
-	int h = computeTileHash(header->x, header->y, m_tileLutMask);
-	tile->next = m_posLookup[h];
-	m_posLookup[h] = tile;
+	m_tileLookup.grow(header->x, header->y);
+	dtMeshTile** column = m_tileLookup.getColumn(header->x, header->y);
+	tile->next = *column;
+	*column = tile;
 	
 	// Patch header pointers.
 	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
@@ -1061,18 +1126,27 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 		tile->bvTree = 0;
 
 	// Build links freelist
-	tile->linksFreeList = 0;
-	tile->links[header->maxLinkCount-1].next = DT_NULL_LINK;
-	for (int i = 0; i < header->maxLinkCount-1; ++i)
-		tile->links[i].next = i+1;
+	if (header->maxLinkCount > 0)
+	{
+		tile->linksFreeList = 0;
+		tile->links[header->maxLinkCount-1].next = DT_NULL_LINK;
+		for (int i = 0; i < header->maxLinkCount-1; ++i)
+			tile->links[i].next = i+1;
+	}
+	else
+	{
+		tile->linksFreeList = DT_NULL_LINK;
+	}
 
 	// Init tile.
 	tile->header = header;
 	tile->data = data;
 	tile->dataSize = dataSize;
+	m_tileDataSize += (size_t)dataSize;
 	tile->flags = flags;
 
 	connectIntLinks(tile);
+	buildPolyGrid(tile);
 
 	// Base off-mesh connections to their starting polygons and connect connections inside the tile.
 	//baseOffMeshLinks(tile);
@@ -1115,11 +1189,169 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 	return DT_SUCCESS;
 }
 
+void dtNavMesh::setPolyGridResolution(const int cellsPerSide)
+{
+	m_polyGridResolution = dtClamp(cellsPerSide, 0, 256);
+}
+
+/// @par
+///
+/// The grid is stored compressed row style: each cell points to its first entry in
+/// one shared polygon index array. A polygon is listed in every cell its outline
+/// overlaps, so a point inside a polygon always finds it in the cell of the point.
+/// Off-mesh connections are left out. The grid counts against the memory budget, tiles
+/// whose grid does not fit or fails to allocate keep working through the bounding volume tree.
+///
+/// Each cell lists its polygons in the order the bounding volume tree visits them, so
+/// when several polygons are within climb height of a point, the grid and the tree
+/// pick the same one.
+void dtNavMesh::buildPolyGrid(dtMeshTile* tile)
+{
+	const dtMeshHeader* header = tile->header;
+	const int res = m_polyGridResolution;
+	if (!res || header->polyCount == 0)
+		return;
+
+	const float cellw = (header->bmax[0] - header->bmin[0]) / res;
+	const float cellh = (header->bmax[2] - header->bmin[2]) / res;
+	if (cellw <= 0.0f || cellh <= 0.0f)
+		return;
+	const float ics[2] = { 1.0f / cellw, 1.0f / cellh };
+	// Cells are grown a little, points on a cell border may go to either side.
+	const float pad = 0.001f * dtMin(cellw, cellh);
+	const int ncells = res*res;
+
+	// Count the entries of each cell, then lay them out and fill them.
+	int* counts = (int*)dtAlloc(sizeof(int)*(ncells+1), DT_ALLOC_TEMP);
+	if (!counts)
+		return;
+	memset(counts, 0, sizeof(int)*(ncells+1));
+
+	dtPolyGrid* grid = 0;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		const int nitems = tile->bvTree ? header->bvNodeCount : header->polyCount;
+		for (int k = 0; k < nitems; ++k)
+		{
+			// Leaf nodes hold a polygon index, internal nodes a negative escape index.
+			const int i = tile->bvTree ? tile->bvTree[k].i : k;
+			if (i < 0)
+				continue;
+			const dtPoly* poly = &tile->polys[i];
+			if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+
+			float verts[DT_VERTS_PER_POLYGON*3];
+			const int nv = poly->vertCount;
+			float bmin[3], bmax[3];
+			for (int j = 0; j < nv; ++j)
+				dtVcopy(&verts[j*3], &tile->verts[poly->verts[j]*3]);
+			dtVcopy(bmin, verts);
+			dtVcopy(bmax, verts);
+			for (int j = 1; j < nv; ++j)
+			{
+				dtVmin(bmin, &verts[j*3]);
+				dtVmax(bmax, &verts[j*3]);
+			}
+
+			if (pass == 1)
+			{
+				// Height range, with the detail vertices that may lie above or below the polygon.
+				float* h = &grid->polyHeights[i*2];
+				h[0] = bmin[1];
+				h[1] = bmax[1];
+				if (tile->detailMeshes)
+				{
+					const dtPolyDetail* pd = &tile->detailMeshes[i];
+					for (unsigned int j = 0; j < pd->vertCount; ++j)
+					{
+						const float y = tile->detailVerts[(pd->vertBase+j)*3+1];
+						h[0] = dtMin(h[0], y);
+						h[1] = dtMax(h[1], y);
+					}
+				}
+			}
+
+			const int x0 = dtClamp((int)dtMathFloorf((bmin[0] - pad - header->bmin[0]) * ics[0]), 0, res-1);
+			const int x1 = dtClamp((int)dtMathFloorf((bmax[0] + pad - header->bmin[0]) * ics[0]), 0, res-1);
+			const int z0 = dtClamp((int)dtMathFloorf((bmin[2] - pad - header->bmin[2]) * ics[1]), 0, res-1);
+			const int z1 = dtClamp((int)dtMathFloorf((bmax[2] + pad - header->bmin[2]) * ics[1]), 0, res-1);
+			for (int z = z0; z <= z1; ++z)
+			{
+				for (int x = x0; x <= x1; ++x)
+				{
+					const float cx0 = header->bmin[0] + x*cellw - pad;
+					const float cx1 = header->bmin[0] + (x+1)*cellw + pad;
+					const float cz0 = header->bmin[2] + z*cellh - pad;
+					const float cz1 = header->bmin[2] + (z+1)*cellh + pad;
+					const float cell[4*3] = { cx0,0,cz0, cx0,0,cz1, cx1,0,cz1, cx1,0,cz0 };
+					if (!dtOverlapPolyPoly2D(cell, 4, verts, nv))
+						continue;
+					const int c = x + z*res;
+					if (pass == 0)
+						counts[c]++;
+					else
+						grid->polys[grid->cells[c] + counts[c]++] = (unsigned short)i;
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			int nentries = 0;
+			for (int c = 0; c < ncells; ++c)
+				nentries += counts[c];
+
+			const int gridSize = dtAlign4(sizeof(dtPolyGrid));
+			const int cellsSize = dtAlign4(sizeof(int)*(ncells+1));
+			const int polysSize = dtAlign4(sizeof(unsigned short)*nentries);
+			const int heightsSize = dtAlign4(sizeof(float)*2*header->polyCount);
+			const int dataSize = gridSize + cellsSize + polysSize + heightsSize;
+			if (m_memoryBudget && m_tileDataSize + (size_t)dataSize > m_memoryBudget)
+			{
+				dtFree(counts);
+				return;
+			}
+			unsigned char* data = (unsigned char*)dtAlloc(dataSize, DT_ALLOC_PERM);
+			if (!data)
+			{
+				dtFree(counts);
+				return;
+			}
+			memset(data, 0, dataSize);
+
+			unsigned char* d = data;
+			grid = dtGetThenAdvanceBufferPointer<dtPolyGrid>(d, gridSize);
+			grid->cells = dtGetThenAdvanceBufferPointer<int>(d, cellsSize);
+			grid->polys = dtGetThenAdvanceBufferPointer<unsigned short>(d, polysSize);
+			grid->polyHeights = dtGetThenAdvanceBufferPointer<float>(d, heightsSize);
+			grid->width = res;
+			grid->height = res;
+			grid->invCellSize[0] = ics[0];
+			grid->invCellSize[1] = ics[1];
+			grid->dataSize = dataSize;
+
+			int start = 0;
+			for (int c = 0; c < ncells; ++c)
+			{
+				grid->cells[c] = start;
+				start += counts[c];
+				counts[c] = 0;
+			}
+			grid->cells[ncells] = start;
+		}
+	}
+
+	dtFree(counts);
+	tile->polyGrid = grid;
+	m_tileDataSize += (size_t)grid->dataSize;
+}
+
 dtMeshTile* dtNavMesh::getTileAt(const int x, const int y, const int layer) const
 {
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
-	dtMeshTile* tile = m_posLookup[h];
+	// Find tile based on the grid or hash.
+	dtMeshTile** column = m_tileLookup.getColumn(x, y);
+	dtMeshTile* tile = column ? *column : 0;
 	while (tile)
 	{
 		if (tile->header &&
@@ -1156,9 +1388,9 @@ int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile** tiles, const in
 {
 	int n = 0;
 	
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
-	dtMeshTile* tile = m_posLookup[h];
+	// Find tile based on the grid or hash.
+	dtMeshTile** column = m_tileLookup.getColumn(x, y);
+	dtMeshTile* tile = column ? *column : 0;
 	while (tile)
 	{
 		if (tile->header &&
@@ -1182,9 +1414,9 @@ int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile const** tiles, co
 {
 	int n = 0;
 	
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
-	dtMeshTile* tile = m_posLookup[h];
+	// Find tile based on the grid or hash.
+	dtMeshTile** column = m_tileLookup.getColumn(x, y);
+	dtMeshTile* tile = column ? *column : 0;
 	while (tile)
 	{
 		if (tile->header &&
@@ -1203,9 +1435,9 @@ int dtNavMesh::getTilesAt(const int x, const int y, dtMeshTile const** tiles, co
 
 dtTileRef dtNavMesh::getTileRefAt(const int x, const int y, const int layer) const
 {
-	// Find tile based on hash.
-	int h = computeTileHash(x,y,m_tileLutMask);
-	dtMeshTile* tile = m_posLookup[h];
+	// Find tile based on the grid or hash.
+	dtMeshTile** column = m_tileLookup.getColumn(x, y);
+	dtMeshTile* tile = column ? *column : 0;
 	while (tile)
 	{
 		if (tile->header &&
@@ -1310,10 +1542,10 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	if (tile->salt != tileSalt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	// Remove tile from hash lookup.
-	int h = computeTileHash(tile->header->x,tile->header->y,m_tileLutMask);
+	// Remove tile from the position lookup.
+	dtMeshTile** column = m_tileLookup.getColumn(tile->header->x, tile->header->y);
 	dtMeshTile* prev = 0;
-	dtMeshTile* cur = m_posLookup[h];
+	dtMeshTile* cur = column ? *column : 0;
 	while (cur)
 	{
 		if (cur == tile)
@@ -1321,7 +1553,7 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 			if (prev)
 				prev->next = cur->next;
 			else
-				m_posLookup[h] = cur->next;
+				*column = cur->next;
 			break;
 		}
 		prev = cur;
@@ -1348,6 +1580,16 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 		for (int j = 0; j < nneis; ++j)
 			unconnectLinks(neis[j], tile);
 	}
+
+	// Return links that spilled into the overflow pool.
+	freeOverflowLinks(tile);
+
+	if (tile->polyGrid)
+		m_tileDataSize -= (size_t)tile->polyGrid->dataSize;
+	dtFree(tile->polyGrid);
+	tile->polyGrid = 0;
+	
+	m_tileDataSize -= (size_t)tile->dataSize;
 		
 	// Reset tile.
 	if (tile->flags & DT_TILE_FREE_DATA)
@@ -1393,6 +1635,154 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	return DT_SUCCESS;
 }
 
+/// @par
+///
+/// Each polygon of the replaced tile is sampled at its center and halfway to each
+/// vertex, and maps to the new polygon that covers the most samples within climb height.
+/// Polygons whose area is no longer walkable map to nothing.
+///
+/// If the remap table can not be allocated the tile is still replaced, its
+/// references just can not be remapped.
+dtStatus dtNavMesh::replaceTile(unsigned char* data, int dataSize, int flags, dtTileRef* result)
+{
+	const dtMeshHeader* header = (const dtMeshHeader*)data;
+	if (!header || header->magic != DT_NAVMESH_MAGIC)
+		return DT_FAILURE | DT_WRONG_MAGIC;
+	if (header->version != DT_NAVMESH_VERSION)
+		return DT_FAILURE | DT_WRONG_VERSION;
+
+	const dtMeshTile* oldTile = getTileAt(header->x, header->y, header->layer);
+	if (!oldTile)
+		return addTile(data, dataSize, flags, 0, result);
+
+	const dtTileRef oldRef = getTileRef(oldTile);
+	const int oldPolyCount = oldTile->header->polyCount;
+	unsigned short* polys = (unsigned short*)dtAlloc(sizeof(unsigned short)*dtMax(oldPolyCount, 1), DT_ALLOC_PERM);
+	if (polys)
+		buildTileRemap(oldTile, data, polys);
+
+	dtStatus status = removeTile(oldRef, 0, 0);
+	if (dtStatusSucceed(status))
+	{
+		dtTileRef newRef = 0;
+		status = addTile(data, dataSize, flags, 0, &newRef);
+		if (dtStatusSucceed(status) && polys)
+		{
+			TileRemap& remap = m_remaps[m_nextRemap];
+			m_nextRemap = (m_nextRemap + 1) % DT_MAX_TILE_REMAPS;
+			dtFree(remap.polys);
+			remap.oldRef = oldRef;
+			remap.newRef = newRef;
+			remap.polys = polys;
+			remap.polyCount = oldPolyCount;
+			polys = 0;
+		}
+		if (result)
+			*result = newRef;
+	}
+	dtFree(polys);
+
+	return status;
+}
+
+void dtNavMesh::buildTileRemap(const dtMeshTile* tile, const unsigned char* data, unsigned short* polys) const
+{
+	static const unsigned short NO_POLY = 0xffff;
+	static const int MAX_SAMPLES = DT_VERTS_PER_POLYGON+1;
+
+	const dtMeshHeader* header = (const dtMeshHeader*)data;
+	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
+	const int vertsSize = dtAlign4(sizeof(float)*3*header->vertCount);
+	const float* newVerts = (const float*)(data + headerSize);
+	const dtPoly* newPolys = (const dtPoly*)(data + headerSize + vertsSize);
+	const float climb = dtMax(tile->header->walkableClimb, header->walkableClimb);
+
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		polys[i] = NO_POLY;
+		const dtPoly* poly = &tile->polys[i];
+		if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION || poly->vertCount < 3)
+			continue;
+
+		float samples[MAX_SAMPLES*3];
+		const int nsamples = poly->vertCount + 1;
+		dtVset(samples, 0, 0, 0);
+		for (int j = 0; j < poly->vertCount; ++j)
+			dtVadd(samples, samples, &tile->verts[poly->verts[j]*3]);
+		dtVscale(samples, samples, 1.0f / poly->vertCount);
+		for (int j = 0; j < poly->vertCount; ++j)
+			dtVlerp(&samples[(j+1)*3], samples, &tile->verts[poly->verts[j]*3], 0.5f);
+
+		int bestCount = 0;
+		for (int j = 0; j < header->polyCount; ++j)
+		{
+			const dtPoly* np = &newPolys[j];
+			if (np->getType() == DT_POLYTYPE_OFFMESH_CONNECTION || np->vertCount < 3)
+				continue;
+			float verts[DT_VERTS_PER_POLYGON*3];
+			float bmin[3], bmax[3];
+			for (int k = 0; k < np->vertCount; ++k)
+				dtVcopy(&verts[k*3], &newVerts[np->verts[k]*3]);
+			dtVcopy(bmin, verts);
+			dtVcopy(bmax, verts);
+			for (int k = 1; k < np->vertCount; ++k)
+			{
+				dtVmin(bmin, &verts[k*3]);
+				dtVmax(bmax, &verts[k*3]);
+			}
+
+			int count = 0;
+			for (int k = 0; k < nsamples; ++k)
+			{
+				const float* pt = &samples[k*3];
+				if (pt[0] < bmin[0] || pt[0] > bmax[0] || pt[2] < bmin[2] || pt[2] > bmax[2] ||
+					pt[1] < bmin[1] - climb || pt[1] > bmax[1] + climb)
+					continue;
+				if (dtPointInPolygon(pt, verts, np->vertCount))
+					count++;
+			}
+			if (count > bestCount)
+			{
+				bestCount = count;
+				polys[i] = (unsigned short)j;
+				if (count == nsamples)
+					break;
+			}
+		}
+	}
+}
+
+/// @par
+///
+/// A reference replaced several times in a row is followed through each replacement.
+dtPolyRef dtNavMesh::remapPolyRef(dtPolyRef ref) const
+{
+	for (int iter = 0; iter < DT_MAX_TILE_REMAPS && ref; ++iter)
+	{
+		if (isValidPolyRef(ref))
+			return ref;
+
+		unsigned int salt, it, ip;
+		decodePolyId(ref, salt, it, ip);
+		const dtTileRef tileRef = (dtTileRef)encodePolyId(salt, it, 0);
+
+		// Newest replacements first.
+		const TileRemap* found = 0;
+		for (int i = 0; i < DT_MAX_TILE_REMAPS && !found; ++i)
+		{
+			const TileRemap& remap = m_remaps[(m_nextRemap + DT_MAX_TILE_REMAPS - 1 - i) % DT_MAX_TILE_REMAPS];
+			if (remap.polys && remap.oldRef == tileRef)
+				found = &remap;
+		}
+		if (!found || (int)ip >= found->polyCount || found->polys[ip] == 0xffff)
+			return 0;
+
+		ref = (dtPolyRef)found->newRef | (dtPolyRef)found->polys[ip];
+	}
+
+	return 0;
+}
+
 dtTileRef dtNavMesh::getTileRef(const dtMeshTile* tile) const
 {
 	if (!tile) return 0;
@@ -1510,6 +1900,85 @@ dtStatus dtNavMesh::restoreTileState(dtMeshTile* tile, const unsigned char* data
 	return DT_SUCCESS;
 }
 
+/// @par
+///
+/// The tile table covers memory that is allocated up front by #init, so it
+/// does not shrink as tiles are removed.
+void dtNavMesh::getMemoryUsage(dtNavMeshMemoryUsage* usage) const
+{
+	dtAssert(usage);
+	memset(usage, 0, sizeof(dtNavMeshMemoryUsage));
+	
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = &m_tiles[i];
+		if (!tile->header) continue;
+		
+		dtNavMeshMemoryUsage tileUsage;
+		getTileMemoryUsage(tile, &tileUsage);
+		usage->headers += tileUsage.headers;
+		usage->verts += tileUsage.verts;
+		usage->polys += tileUsage.polys;
+		usage->links += tileUsage.links;
+		usage->detailMeshes += tileUsage.detailMeshes;
+		usage->detailVerts += tileUsage.detailVerts;
+		usage->detailTris += tileUsage.detailTris;
+		usage->bvTree += tileUsage.bvTree;
+		usage->offMeshCons += tileUsage.offMeshCons;
+		usage->polyGrids += tileUsage.polyGrids;
+	}
+	
+	usage->tileTable = sizeof(dtNavMesh) +
+		sizeof(dtMeshTile)*m_maxTiles +
+		m_tileLookup.getMemoryUsage();
+	for (int i = 0; i < DT_MAX_TILE_REMAPS; ++i)
+		usage->tileTable += sizeof(unsigned short)*m_remaps[i].polyCount;
+	usage->overflowLinks = sizeof(dtLink)*m_maxOverflowLinks;
+	
+	usage->total = usage->tileTable + usage->headers + usage->verts + usage->polys + usage->links +
+		usage->overflowLinks + usage->detailMeshes + usage->detailVerts + usage->detailTris +
+		usage->bvTree + usage->offMeshCons + usage->polyGrids;
+}
+
+/// @par
+///
+/// The overflow links of a tile are the links its polygons currently use from the
+/// shared overflow pool.
+void dtNavMesh::getTileMemoryUsage(const dtMeshTile* tile, dtNavMeshMemoryUsage* usage) const
+{
+	dtAssert(usage);
+	memset(usage, 0, sizeof(dtNavMeshMemoryUsage));
+	if (!tile || !tile->header)
+		return;
+	
+	const dtMeshHeader* header = tile->header;
+	usage->headers = dtAlign4(sizeof(dtMeshHeader));
+	usage->verts = dtAlign4(sizeof(float)*3*header->vertCount);
+	usage->polys = dtAlign4(sizeof(dtPoly)*header->polyCount);
+	usage->links = dtAlign4(sizeof(dtLink)*header->maxLinkCount);
+	usage->detailMeshes = dtAlign4(sizeof(dtPolyDetail)*header->detailMeshCount);
+	usage->detailVerts = dtAlign4(sizeof(float)*3*header->detailVertCount);
+	usage->detailTris = dtAlign4(sizeof(unsigned char)*4*header->detailTriCount);
+	usage->bvTree = dtAlign4(sizeof(dtBVNode)*header->bvNodeCount);
+	usage->offMeshCons = dtAlign4(sizeof(dtOffMeshConnection)*header->offMeshConCount);
+	usage->polyGrids = tile->polyGrid ? (size_t)tile->polyGrid->dataSize : 0;
+	
+	int overflowLinks = 0;
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		for (unsigned int k = tile->polys[i].firstLink; k != DT_NULL_LINK; k = getLink(tile, k)->next)
+		{
+			if (k & DT_OVERFLOW_LINK)
+				overflowLinks++;
+		}
+	}
+	usage->overflowLinks = sizeof(dtLink)*overflowLinks;
+	
+	usage->total = usage->headers + usage->verts + usage->polys + usage->links + usage->overflowLinks +
+		usage->detailMeshes + usage->detailVerts + usage->detailTris + usage->bvTree + usage->offMeshCons +
+		usage->polyGrids;
+}
+
 /// @par
 ///
 /// Off-mesh connections are stored in the navigation mesh as special 2-vertex 
@@ -1540,11 +2009,11 @@ dtStatus dtNavMesh::getOffMeshConnectionPolyEndPoints(dtPolyRef prevRef, dtPolyR
 	int idx0 = 0, idx1 = 1;
 	
 	// Find link that points to first vertex.
-	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = getLink(tile, i)->next)
 	{
-		if (tile->links[i].edge == 0)
+		if (getLink(tile, i)->edge == 0)
 		{
-			if (tile->links[i].ref != prevRef)
+			if (getLink(tile, i)->ref != prevRef)
 			{
 				idx0 = 1;
 				idx1 = 0;
@@ -1669,14 +2138,14 @@ void dtNavMesh::unconnectOffMeshLink(const dtOffMeshConnection* con)
 		unsigned int pj = DT_NULL_LINK;
 		while (j != DT_NULL_LINK)
 		{
-			if (decodePolyIdTile(tile->links[j].ref) == targetNum && tile->links[j].OffMeshID == con->userId)
+			if (decodePolyIdTile(getLink(tile, j)->ref) == targetNum && getLink(tile, j)->OffMeshID == con->userId)
 			{
 				// Remove link.
-				unsigned int nj = tile->links[j].next;
+				unsigned int nj = getLink(tile, j)->next;
 				if (pj == DT_NULL_LINK)
 					poly->firstLink = nj;
 				else
-					tile->links[pj].next = nj;
+					getLink(tile, pj)->next = nj;
 				freeLink(tile, j);
 				j = nj;
 			}
@@ -1684,7 +2153,7 @@ void dtNavMesh::unconnectOffMeshLink(const dtOffMeshConnection* con)
 			{
 				// Advance
 				pj = j;
-				j = tile->links[j].next;
+				j = getLink(tile, j)->next;
 			}
 		}
 	}
@@ -1698,14 +2167,14 @@ void dtNavMesh::unconnectOffMeshLink(const dtOffMeshConnection* con)
 		unsigned int pj = DT_NULL_LINK;
 		while (j != DT_NULL_LINK)
 		{
-			if (decodePolyIdTile(target->links[j].ref) == sourceNum && target->links[j].OffMeshID == con->userId)
+			if (decodePolyIdTile(getLink(target, j)->ref) == sourceNum && getLink(target, j)->OffMeshID == con->userId)
 			{
 				// Remove link.
-				unsigned int nj = target->links[j].next;
+				unsigned int nj = getLink(target, j)->next;
 				if (pj == DT_NULL_LINK)
 					poly->firstLink = nj;
 				else
-					target->links[pj].next = nj;
+					getLink(target, pj)->next = nj;
 				freeLink(target, j);
 				j = nj;
 			}
@@ -1713,7 +2182,7 @@ void dtNavMesh::unconnectOffMeshLink(const dtOffMeshConnection* con)
 			{
 				// Advance
 				pj = j;
-				j = target->links[j].next;
+				j = getLink(target, j)->next;
 			}
 		}
 	}
@@ -1756,7 +2225,7 @@ void dtNavMesh::GlobalOffMeshLinks(dtOffMeshConnection* con)
 	unsigned int idx = allocLink(tile);
 	if (idx != DT_NULL_LINK)
 	{
-		dtLink* link = &tile->links[idx];
+		dtLink* link = getLink(tile, idx);
 		link->ref = ref;
 		link->edge = (unsigned char)1;
 		link->side = (unsigned char)0xff;
@@ -1775,7 +2244,7 @@ void dtNavMesh::GlobalOffMeshLinks(dtOffMeshConnection* con)
 		{
 			const unsigned short landPolyIdx = (unsigned short)decodePolyIdPoly(ref);
 			dtPoly* landPoly = &TargetTile->polys[landPolyIdx];
-			dtLink* link = &TargetTile->links[tidx];
+			dtLink* link = getLink(TargetTile, tidx);
 			link->ref = getPolyRefBase(tile) | (dtPolyRef)(con->poly);
 			link->edge = (unsigned char)0xff;
 			link->side = (unsigned char)(0xff);
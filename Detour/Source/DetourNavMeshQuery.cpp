@@ -27,6 +27,9 @@
 #include "DetourAssert.h"
 #include <new>
 
+// Polygons are gathered with dtGatherPolySoAIndexed, which must fit any polygon.
+typedef char dtPolySoAFitsPolygon[DT_VERTS_PER_POLYGON <= DT_SOA_MAX_VERTS ? 1 : -1];
+
 /// @class dtQueryFilter
 ///
 /// <b>The Default Implementation</b>
@@ -122,6 +125,11 @@ dtPolyQuery::~dtPolyQuery()
 	// Defined out of line to fix the weak v-tables warning
 }
 
+dtQueryClock::~dtQueryClock()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 
 /// @class dtNavMeshQuery
@@ -162,6 +170,16 @@ dtNavMeshQuery::~dtNavMeshQuery()
 	dtFree(m_openList);
 }
 
+void dtNavMeshQuery::getMemoryUsage(dtNavMeshQueryMemoryUsage* usage) const
+{
+	dtAssert(usage);
+	usage->query = sizeof(dtNavMeshQuery);
+	usage->nodePool = m_nodePool ? m_nodePool->getMemUsed() : 0;
+	usage->tinyNodePool = m_tinyNodePool ? m_tinyNodePool->getMemUsed() : 0;
+	usage->openList = m_openList ? m_openList->getMemUsed() : 0;
+	usage->total = usage->query + usage->nodePool + usage->tinyNodePool + usage->openList;
+}
+
 /// @par 
 ///
 /// Must be the first function called after construction, before other
@@ -404,9 +422,9 @@ dtStatus dtNavMeshQuery::findRandomPointAroundCircle(dtPolyRef startRef, const f
 		if (parentRef)
 			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
 		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(bestTile, i)->next)
 		{
-			const dtLink* link = &bestTile->links[i];
+			const dtLink* link = m_nav->getLink(bestTile, i);
 			dtPolyRef neighbourRef = link->ref;
 			// Skip invalid neighbours and do not follow back to parent.
 			if (!neighbourRef || neighbourRef == parentRef)
@@ -665,17 +683,13 @@ dtStatus dtNavMeshQuery::closestPointOnPolyBoundary(dtPolyRef ref, const float*
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
 	// Collect vertices.
-	float verts[DT_VERTS_PER_POLYGON*3];	
+	dtPolySoA verts;
 	float edged[DT_VERTS_PER_POLYGON];
 	float edget[DT_VERTS_PER_POLYGON];
-	int nv = 0;
-	for (int i = 0; i < (int)poly->vertCount; ++i)
-	{
-		dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
-		nv++;
-	}		
+	const int nv = (int)poly->vertCount;
+	dtGatherPolySoAIndexed(verts, poly->verts, nv, tile->verts);
 	
-	bool inside = dtDistancePtPolyEdgesSqr(pos, verts, nv, edged, edget);
+	bool inside = dtDistancePtPolyEdgesSqrSoA(pos, verts, edged, edget);
 	if (inside)
 	{
 		// Point is inside the polygon, return the point.
@@ -694,8 +708,8 @@ dtStatus dtNavMeshQuery::closestPointOnPolyBoundary(dtPolyRef ref, const float*
 				imin = i;
 			}
 		}
-		const float* va = &verts[imin*3];
-		const float* vb = &verts[((imin+1)%nv)*3];
+		const float* va = &tile->verts[poly->verts[imin]*3];
+		const float* vb = &tile->verts[poly->verts[(imin+1)%nv]*3];
 		dtVlerp(closest, va, vb, edget[imin]);
 	}
 	
@@ -829,6 +843,24 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 
 	// queryPolygons below will check rest of params
 	
+	// A polygon right under the point within climb height is as near as a polygon
+	// can get, the tile grids find one without visiting the bounding volume tree.
+	if (center && dtVisfinite(center) && halfExtents && dtVisfinite(halfExtents) && filter)
+	{
+		float h;
+		if (findPolyInGrid(center, halfExtents, filter, nearestRef, &h))
+		{
+			if (nearestPt)
+			{
+				dtVcopy(nearestPt, center);
+				nearestPt[1] = h;
+				if (isOverPoly)
+					*isOverPoly = true;
+			}
+			return DT_SUCCESS;
+		}
+	}
+
 	dtFindNearestPolyQuery query(this, center);
 
 	dtStatus status = queryPolygons(center, halfExtents, filter, &query);
@@ -848,6 +880,61 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	return DT_SUCCESS;
 }
 
+bool dtNavMeshQuery::findPolyInGrid(const float* center, const float* halfExtents, const dtQueryFilter* filter,
+									dtPolyRef* ref, float* height) const
+{
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* tiles[MAX_NEIS];
+	int tx, ty;
+	m_nav->calcTileLoc(center, &tx, &ty);
+	const int ntiles = m_nav->getTilesAt(tx, ty, tiles, MAX_NEIS);
+
+	const float ymin = center[1] - halfExtents[1];
+	const float ymax = center[1] + halfExtents[1];
+
+	for (int i = 0; i < ntiles; ++i)
+	{
+		const dtMeshTile* tile = tiles[i];
+		const dtPolyGrid* grid = tile->polyGrid;
+		if (!grid)
+			return false;
+		const dtMeshHeader* header = tile->header;
+		if (center[0] < header->bmin[0] || center[0] > header->bmax[0] ||
+			center[2] < header->bmin[2] || center[2] > header->bmax[2])
+			return false;
+		if (header->bmin[1] > ymax || header->bmax[1] < ymin)
+			continue;
+
+		const int x = dtMin((int)((center[0] - header->bmin[0]) * grid->invCellSize[0]), grid->width-1);
+		const int z = dtMin((int)((center[2] - header->bmin[2]) * grid->invCellSize[1]), grid->height-1);
+		const int c = x + z*grid->width;
+		const dtPolyRef base = m_nav->getPolyRefBase(tile);
+		for (int j = grid->cells[c]; j < grid->cells[c+1]; ++j)
+		{
+			const int ip = grid->polys[j];
+			const float* hr = &grid->polyHeights[ip*2];
+			if (hr[0] > ymax || hr[1] < ymin)
+				continue;
+			const dtPoly* poly = &tile->polys[ip];
+			const dtPolyRef pref = base | (dtPolyRef)ip;
+			if (!filter->passFilter(pref, tile, poly))
+				continue;
+			float h;
+			if (!m_nav->getPolyHeight(tile, poly, center, &h))
+				continue;
+			// Same test as dtFindNearestPolyQuery, which keeps the first polygon it
+			// sees within climb height.
+			if (dtAbs(center[1] - h) > header->walkableClimb)
+				continue;
+			*ref = pref;
+			*height = h;
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 										 const dtQueryFilter* filter, dtPolyQuery* query) const
 {
@@ -1166,9 +1253,9 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 		if (parentRef)
 			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
 		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(bestTile, i)->next)
 		{
-			dtPolyRef neighbourRef = bestTile->links[i].ref;
+			dtPolyRef neighbourRef = m_nav->getLink(bestTile, i)->ref;
 			
 			// Skip invalid ids and do not expand back to where we came from.
 			if (!neighbourRef || neighbourRef == parentRef)
@@ -1185,8 +1272,8 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 
 			// deal explicitly with crossing tile boundaries
 			unsigned char crossSide = 0;
-			if (bestTile->links[i].side != 0xff)
-				crossSide = bestTile->links[i].side >> 1;
+			if (m_nav->getLink(bestTile, i)->side != 0xff)
+				crossSide = m_nav->getLink(bestTile, i)->side >> 1;
 
 			// get the node
 			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, crossSide);
@@ -1479,9 +1566,9 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 				tryLOS = true;
 		}
 		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(bestTile, i)->next)
 		{
-			dtPolyRef neighbourRef = bestTile->links[i].ref;
+			dtPolyRef neighbourRef = m_nav->getLink(bestTile, i)->ref;
 			
 			// Skip invalid ids and do not expand back to where we came from.
 			if (!neighbourRef || neighbourRef == parentRef)
@@ -1613,6 +1700,39 @@ dtStatus dtNavMeshQuery::updateSlicedFindPath(const int maxIter, int* doneIters)
 	return m_query.status;
 }
 
+/// @par
+///
+/// The cost of an iteration depends on the number of links, the filter and the
+/// off-mesh connections of the polygon being expanded, so an iteration count is
+/// a poor predictor of the time spent. This runs the search in steps of
+/// @p checkIters iterations and reads the clock between the steps, so the
+/// deadline can be overshot by at most one step.
+///
+/// The search is always advanced by at least one step, even if the deadline
+/// has already passed, so a query can not be starved completely.
+dtStatus dtNavMeshQuery::updateSlicedFindPathTimed(const dtQueryClock* clock, const long long deadline,
+												   const int checkIters, int* doneIters)
+{
+	if (!clock || checkIters <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	int totalIters = 0;
+	dtStatus status;
+	for (;;)
+	{
+		int iters = 0;
+		status = updateSlicedFindPath(checkIters, &iters);
+		totalIters += iters;
+		if (!dtStatusInProgress(status) || clock->getTicks() >= deadline)
+			break;
+	}
+	
+	if (doneIters)
+		*doneIters = totalIters;
+	
+	return status;
+}
+
 dtStatus dtNavMeshQuery::finalizeSlicedFindPath(dtPolyRef* path, int* pathCount, const int maxPath)
 {
 	if (!pathCount)
@@ -2207,7 +2327,7 @@ dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* start
 	dtVlerp(searchPos, startPos, endPos, 0.5f);
 	searchRadSqr = dtSqr(dtVdist(startPos, endPos)/2.0f + 0.001f);
 	
-	float verts[DT_VERTS_PER_POLYGON*3];
+	dtPolySoA verts;
 	
 	while (nstack)
 	{
@@ -2226,11 +2346,10 @@ dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* start
 		
 		// Collect vertices.
 		const int nverts = curPoly->vertCount;
-		for (int i = 0; i < nverts; ++i)
-			dtVcopy(&verts[i*3], &curTile->verts[curPoly->verts[i]*3]);
+		dtGatherPolySoAIndexed(verts, curPoly->verts, nverts, curTile->verts);
 		
 		// If target is inside the poly, stop search.
-		if (dtPointInPolygon(endPos, verts, nverts))
+		if (dtPointInPolygonSoA(endPos, verts))
 		{
 			bestNode = curNode;
 			dtVcopy(bestPos, endPos);
@@ -2248,9 +2367,9 @@ dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* start
 			if (curPoly->neis[j] & DT_EXT_LINK)
 			{
 				// Tile border.
-				for (unsigned int k = curPoly->firstLink; k != DT_NULL_LINK; k = curTile->links[k].next)
+				for (unsigned int k = curPoly->firstLink; k != DT_NULL_LINK; k = m_nav->getLink(curTile, k)->next)
 				{
-					const dtLink* link = &curTile->links[k];
+					const dtLink* link = m_nav->getLink(curTile, k);
 					if (link->edge == j)
 					{
 						if (link->ref != 0)
@@ -2281,8 +2400,8 @@ dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* start
 			if (!nneis)
 			{
 				// Wall edge, calc distance.
-				const float* vj = &verts[j*3];
-				const float* vi = &verts[i*3];
+				const float* vj = &curTile->verts[curPoly->verts[j]*3];
+				const float* vi = &curTile->verts[curPoly->verts[i]*3];
 				float tseg;
 				const float distSqr = dtDistancePtSegSqr2D(endPos, vj, vi, tseg);
 				if (distSqr < bestDist)
@@ -2307,8 +2426,8 @@ dtStatus dtNavMeshQuery::moveAlongSurface(dtPolyRef startRef, const float* start
 					
 					// Skip the link if it is too far from search constraint.
 					// TODO: Maybe should use getPortalPoints(), but this one is way faster.
-					const float* vj = &verts[j*3];
-					const float* vi = &verts[i*3];
+					const float* vj = &curTile->verts[curPoly->verts[j]*3];
+					const float* vi = &curTile->verts[curPoly->verts[i]*3];
 					float tseg;
 					float distSqr = dtDistancePtSegSqr2D(searchPos, vj, vi, tseg);
 					if (distSqr > searchRadSqr)
@@ -2391,11 +2510,11 @@ dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly,
 {
 	// Find the link that points to the 'to' polygon.
 	const dtLink* link = 0;
-	for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
+	for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(fromTile, i)->next)
 	{
-		if (fromTile->links[i].ref == to)
+		if (m_nav->getLink(fromTile, i)->ref == to)
 		{
-			link = &fromTile->links[i];
+			link = m_nav->getLink(fromTile, i);
 			break;
 		}
 	}
@@ -2406,11 +2525,11 @@ dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly,
 	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
 	{
 		// Find link that points to first vertex.
-		for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
+		for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(fromTile, i)->next)
 		{
-			if (fromTile->links[i].ref == to)
+			if (m_nav->getLink(fromTile, i)->ref == to)
 			{
-				const int v = fromTile->links[i].edge;
+				const int v = m_nav->getLink(fromTile, i)->edge;
 				dtVcopy(left, &fromTile->verts[fromPoly->verts[v]*3]);
 				dtVcopy(right, &fromTile->verts[fromPoly->verts[v]*3]);
 				return DT_SUCCESS;
@@ -2421,11 +2540,11 @@ dtStatus dtNavMeshQuery::getPortalPoints(dtPolyRef from, const dtPoly* fromPoly,
 	
 	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
 	{
-		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(toTile, i)->next)
 		{
-			if (toTile->links[i].ref == from)
+			if (m_nav->getLink(toTile, i)->ref == from)
 			{
-				const int v = toTile->links[i].edge;
+				const int v = m_nav->getLink(toTile, i)->edge;
 				dtVcopy(left, &toTile->verts[toPoly->verts[v]*3]);
 				dtVcopy(right, &toTile->verts[toPoly->verts[v]*3]);
 				return DT_SUCCESS;
@@ -2605,8 +2724,21 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 		return DT_FAILURE | DT_INVALID_PARAM;
 	}
 	
+	// The API input has been checked already, skip checking internal data.
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(startRef, &tile, &poly);
+	
+	return raycastFromPoly(startRef, tile, poly, startPos, endPos, filter, options, hit, prevRef);
+}
+
+dtStatus dtNavMeshQuery::raycastFromPoly(dtPolyRef startRef, const dtMeshTile* startTile, const dtPoly* startPoly,
+										 const float* startPos, const float* endPos,
+										 const dtQueryFilter* filter, const unsigned int options,
+										 dtRaycastHit* hit, dtPolyRef prevRef) const
+{
 	float dir[3], curPos[3], lastPos[3];
-	float verts[DT_VERTS_PER_POLYGON*3+3];	
+	dtPolySoA verts;
 	int n = 0;
 
 	dtVcopy(curPos, startPos);
@@ -2619,11 +2751,9 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 	const dtPoly* prevPoly, *poly, *nextPoly;
 	dtPolyRef curRef;
 
-	// The API input has been checked already, skip checking internal data.
 	curRef = startRef;
-	tile = 0;
-	poly = 0;
-	m_nav->getTileAndPolyByRefUnsafe(curRef, &tile, &poly);
+	tile = startTile;
+	poly = startPoly;
 	nextTile = prevTile = tile;
 	nextPoly = prevPoly = poly;
 	if (prevRef)
@@ -2634,16 +2764,12 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 		// Cast ray against current polygon.
 		
 		// Collect vertices.
-		int nv = 0;
-		for (int i = 0; i < (int)poly->vertCount; ++i)
-		{
-			dtVcopy(&verts[nv*3], &tile->verts[poly->verts[i]*3]);
-			nv++;
-		}
+		const int nv = (int)poly->vertCount;
+		dtGatherPolySoAIndexed(verts, poly->verts, nv, tile->verts);
 		
 		float tmin, tmax;
 		int segMin, segMax;
-		if (!dtIntersectSegmentPoly2D(startPos, endPos, verts, nv, tmin, tmax, segMin, segMax))
+		if (!dtIntersectSegmentPoly2DSoA(startPos, endPos, verts, tmin, tmax, segMin, segMax))
 		{
 			// Could not hit the polygon, keep the old t and report hit.
 			hit->pathCount = n;
@@ -2677,9 +2803,9 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 		// Follow neighbours.
 		dtPolyRef nextRef = 0;
 		
-		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(tile, i)->next)
 		{
-			const dtLink* link = &tile->links[i];
+			const dtLink* link = m_nav->getLink(tile, i);
 			
 			// Find link which contains this edge.
 			if ((int)link->edge != segMax)
@@ -2762,8 +2888,8 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 			// and correct the height (since the raycast moves in 2d)
 			dtVcopy(lastPos, curPos);
 			dtVmad(curPos, startPos, dir, hit->t);
-			float* e1 = &verts[segMax*3];
-			float* e2 = &verts[((segMax+1)%nv)*3];
+			const float* e1 = &tile->verts[poly->verts[segMax]*3];
+			const float* e2 = &tile->verts[poly->verts[(segMax+1)%nv]*3];
 			float eDir[3], diff[3];
 			dtVsub(eDir, e2, e1);
 			dtVsub(diff, curPos, e1);
@@ -2780,8 +2906,8 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 			// Calculate hit normal.
 			const int a = segMax;
 			const int b = segMax+1 < nv ? segMax+1 : 0;
-			const float* va = &verts[a*3];
-			const float* vb = &verts[b*3];
+			const float* va = &tile->verts[poly->verts[a]*3];
+			const float* vb = &tile->verts[poly->verts[b]*3];
 			const float dx = vb[0] - va[0];
 			const float dz = vb[2] - va[2];
 			hit->hitNormal[0] = dz;
@@ -2807,6 +2933,330 @@ dtStatus dtNavMeshQuery::raycast(dtPolyRef startRef, const float* startPos, cons
 	return status;
 }
 
+/// @par
+///
+/// Sorting by reference groups the rays by start tile, and rays starting in the
+/// same polygon end up next to each other. Ties keep the input order.
+dtStatus dtNavMeshQuery::sortRaycastBatch(const dtPolyRef* startRefs, const int count, int* order) const
+{
+	if (!startRefs || !order || count < 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	
+	for (int i = 0; i < count; ++i)
+		order[i] = i;
+	
+	// Heap sort, so no scratch memory is needed.
+	struct RayLess
+	{
+		const dtPolyRef* refs;
+		bool operator()(const int a, const int b) const
+		{
+			return refs[a] < refs[b] || (refs[a] == refs[b] && a < b);
+		}
+	};
+	RayLess less = { startRefs };
+	
+	for (int start = count/2 - 1; start >= 0; --start)
+	{
+		for (int root = start; root*2+1 < count; )
+		{
+			int child = root*2+1;
+			if (child+1 < count && less(order[child], order[child+1]))
+				child++;
+			if (!less(order[root], order[child]))
+				break;
+			dtSwap(order[root], order[child]);
+			root = child;
+		}
+	}
+	for (int end = count-1; end > 0; --end)
+	{
+		dtSwap(order[0], order[end]);
+		for (int root = 0; root*2+1 < end; )
+		{
+			int child = root*2+1;
+			if (child+1 < end && less(order[child], order[child+1]))
+				child++;
+			if (!less(order[root], order[child]))
+				break;
+			dtSwap(order[root], order[child]);
+			root = child;
+		}
+	}
+	
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// Casts the rays at positions [@p first, @p last) of the batch order. Each ray is
+/// cast like #raycast, and the results are written to the output arrays at the
+/// index of the ray. Consecutive rays that start in the same polygon share its
+/// validation and lookup, so sort the batch with #sortRaycastBatch first.
+///
+/// The query does not keep state between raycasts, so a large batch can be split
+/// into ranges that are cast by several threads, each using its own query object.
+///
+/// The returned status carries the detail flags of all rays. Use dtRaycastBatch::status
+/// to see which rays failed.
+dtStatus dtNavMeshQuery::raycastBatch(const dtRaycastBatch& batch, const dtQueryFilter* filter,
+									  const unsigned int options, const int first, const int last) const
+{
+	dtAssert(m_nav);
+	
+	if (!batch.startRefs || !batch.startPos || !batch.endPos || !batch.t || !filter ||
+		first < 0 || last > batch.count || first > last)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	
+	// Visited polygons are only counted, the path itself is thrown away.
+	static const int MAX_BATCH_PATH = 256;
+	dtPolyRef path[MAX_BATCH_PATH];
+	
+	dtRaycastHit hit;
+	hit.path = batch.pathCounts ? path : 0;
+	hit.maxPath = batch.pathCounts ? MAX_BATCH_PATH : 0;
+	
+	dtStatus result = DT_SUCCESS;
+	dtPolyRef lastRef = 0;
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	
+	for (int i = first; i < last; ++i)
+	{
+		const int ray = batch.order ? batch.order[i] : i;
+		const dtPolyRef ref = batch.startRefs[ray];
+		const float* startPos = &batch.startPos[ray*3];
+		const float* endPos = &batch.endPos[ray*3];
+		
+		dtStatus status;
+		if (!ref || (ref != lastRef && !m_nav->isValidPolyRef(ref)))
+		{
+			status = DT_FAILURE | DT_INVALID_PARAM;
+		}
+		else if (!dtVisfinite(startPos) || !dtVisfinite(endPos))
+		{
+			status = DT_FAILURE | DT_INVALID_PARAM;
+		}
+		else
+		{
+			if (ref != lastRef)
+			{
+				m_nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+				lastRef = ref;
+			}
+			hit.t = 0;
+			hit.pathCount = 0;
+			hit.pathCost = 0;
+			status = raycastFromPoly(ref, tile, poly, startPos, endPos, filter, options, &hit, 0);
+			if (!batch.pathCounts)
+				status &= ~DT_BUFFER_TOO_SMALL;
+		}
+		
+		if (dtStatusFailed(status))
+		{
+			hit.t = 0;
+			hit.pathCount = 0;
+			hit.hitEdgeIndex = -1;
+			dtVset(hit.hitNormal, 0, 0, 0);
+		}
+		
+		batch.t[ray] = hit.t;
+		if (batch.hitNormals)
+			dtVcopy(&batch.hitNormals[ray*3], hit.hitNormal);
+		if (batch.hitEdgeIndices)
+			batch.hitEdgeIndices[ray] = hit.hitEdgeIndex;
+		if (batch.pathCounts)
+			batch.pathCounts[ray] = hit.pathCount;
+		if (batch.status)
+			batch.status[ray] = status;
+		
+		result |= status & DT_STATUS_DETAIL_MASK;
+	}
+	
+	return result;
+}
+
+/// @par
+///
+/// The walk visits the neighbours of the tracked polygon breadth first, within the
+/// circle through the old and new position, until it finds a polygon under the new
+/// position within walkable climb. Such a polygon is the one #findNearestPoly would
+/// return. Moves blocked by walls, drops to another floor and moves across polygons
+/// the filter rejects end the walk early and are searched instead.
+dtStatus dtNavMeshQuery::updatePolyTracker(dtPolyTracker* tracker, const float* pos, const float* halfExtents,
+										   const dtQueryFilter* filter) const
+{
+	dtAssert(m_nav);
+
+	if (!tracker || !pos || !dtVisfinite(pos) ||
+		!halfExtents || !dtVisfinite(halfExtents) || !filter)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	trackPoly(tracker, pos, halfExtents, filter);
+	return DT_SUCCESS;
+}
+
+/// @par
+///
+/// Agents with non-finite positions are left unchanged. Like #raycastBatch, the query
+/// keeps no state between agents, so the agents can be split into ranges that are
+/// updated by several threads, each using its own query object.
+dtStatus dtNavMeshQuery::updatePolyTrackers(dtPolyTracker* trackers, const float* positions, const int count,
+											const float* halfExtents, const dtQueryFilter* filter,
+											int* searchCount) const
+{
+	dtAssert(m_nav);
+
+	if (searchCount)
+		*searchCount = 0;
+
+	if (!trackers || !positions || count < 0 ||
+		!halfExtents || !dtVisfinite(halfExtents) || !filter)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	dtStatus status = DT_SUCCESS;
+	int nsearch = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const float* pos = &positions[i*3];
+		if (!dtVisfinite(pos))
+		{
+			status |= DT_INVALID_PARAM;
+			continue;
+		}
+		if (trackPoly(&trackers[i], pos, halfExtents, filter))
+			nsearch++;
+	}
+
+	if (searchCount)
+		*searchCount = nsearch;
+
+	return status;
+}
+
+bool dtNavMeshQuery::trackPoly(dtPolyTracker* tracker, const float* pos, const float* halfExtents,
+							   const dtQueryFilter* filter) const
+{
+	dtPolyRef ref = 0;
+	float h;
+	if (walkPolyTracker(tracker, pos, halfExtents, filter, &ref, &h))
+	{
+		tracker->ref = ref;
+		dtVcopy(tracker->pos, pos);
+		tracker->pos[1] = h;
+		return false;
+	}
+
+	float nearest[3];
+	findNearestPoly(pos, halfExtents, filter, &ref, nearest);
+	tracker->ref = ref;
+	dtVcopy(tracker->pos, ref ? nearest : pos);
+	return true;
+}
+
+bool dtNavMeshQuery::walkPolyTracker(const dtPolyTracker* tracker, const float* pos, const float* halfExtents,
+									 const dtQueryFilter* filter, dtPolyRef* ref, float* height) const
+{
+	dtAssert(m_tinyNodePool);
+
+	const dtPolyRef startRef = tracker->ref;
+	const float* startPos = tracker->pos;
+	if (!startRef || !dtVisfinite(startPos) ||
+		dtAbs(pos[0] - startPos[0]) > halfExtents[0] ||
+		dtAbs(pos[2] - startPos[2]) > halfExtents[2])
+	{
+		return false;
+	}
+
+	const dtMeshTile* startTile = 0;
+	const dtPoly* startPoly = 0;
+	if (dtStatusFailed(m_nav->getTileAndPolyByRef(startRef, &startTile, &startPoly)) ||
+		!filter->passFilter(startRef, startTile, startPoly))
+	{
+		return false;
+	}
+
+	const float ymin = pos[1] - halfExtents[1];
+	const float ymax = pos[1] + halfExtents[1];
+
+	static const int MAX_STACK = 48;
+	dtNode* stack[MAX_STACK];
+	int head = 0, nstack = 0;
+
+	m_tinyNodePool->clear();
+	dtNode* startNode = m_tinyNodePool->getNode(startRef);
+	startNode->flags = DT_NODE_CLOSED;
+	stack[nstack++] = startNode;
+
+	// Search constraints
+	float searchPos[3], searchRadSqr;
+	dtVlerp(searchPos, startPos, pos, 0.5f);
+	searchRadSqr = dtSqr(dtVdist2D(startPos, pos)/2.0f + 0.001f);
+
+	dtPolySoA verts;
+
+	while (head < nstack)
+	{
+		const dtPolyRef curRef = stack[head++]->id;
+		const dtMeshTile* curTile = 0;
+		const dtPoly* curPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(curRef, &curTile, &curPoly);
+
+		dtGatherPolySoAIndexed(verts, curPoly->verts, curPoly->vertCount, curTile->verts);
+		if (dtPointInPolygonSoA(pos, verts))
+		{
+			float h;
+			if (m_nav->getPolyHeight(curTile, curPoly, pos, &h) &&
+				h >= ymin && h <= ymax && dtAbs(pos[1] - h) <= curTile->header->walkableClimb)
+			{
+				*ref = curRef;
+				*height = h;
+				return true;
+			}
+		}
+
+		for (unsigned int k = curPoly->firstLink; k != DT_NULL_LINK; k = m_nav->getLink(curTile, k)->next)
+		{
+			const dtLink* link = m_nav->getLink(curTile, k);
+			if (!link->ref)
+				continue;
+			const dtMeshTile* neiTile = 0;
+			const dtPoly* neiPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(link->ref, &neiTile, &neiPoly);
+			if (neiPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+			if (!filter->passFilter(link->ref, neiTile, neiPoly))
+				continue;
+
+			dtNode* neighbourNode = m_tinyNodePool->getNode(link->ref);
+			if (!neighbourNode || (neighbourNode->flags & DT_NODE_CLOSED))
+				continue;
+
+			// Skip the link if it is too far from search constraint.
+			const float* vj = &curTile->verts[curPoly->verts[link->edge]*3];
+			const float* vi = &curTile->verts[curPoly->verts[(link->edge+1) % curPoly->vertCount]*3];
+			float tseg;
+			if (dtDistancePtSegSqr2D(searchPos, vj, vi, tseg) > searchRadSqr)
+				continue;
+
+			if (nstack < MAX_STACK)
+			{
+				neighbourNode->flags |= DT_NODE_CLOSED;
+				stack[nstack++] = neighbourNode;
+			}
+		}
+	}
+
+	return false;
+}
+
+
 /// @par
 ///
 /// At least one result array must be provided.
@@ -2913,9 +3363,9 @@ dtStatus dtNavMeshQuery::findPolysAroundCircle(dtPolyRef startRef, const float*
 			status |= DT_BUFFER_TOO_SMALL;
 		}
 		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(bestTile, i)->next)
 		{
-			const dtLink* link = &bestTile->links[i];
+			const dtLink* link = m_nav->getLink(bestTile, i);
 			dtPolyRef neighbourRef = link->ref;
 			// Skip invalid neighbours and do not follow back to parent.
 			if (!neighbourRef || neighbourRef == parentRef)
@@ -3043,6 +3493,12 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 		dtVadd(centerPos,centerPos,&verts[i*3]);
 	dtVscale(centerPos,centerPos,1.0f/nverts);
 
+	// Shapes small enough are gathered once for the edge tests.
+	dtPolySoA shape;
+	const bool gathered = nverts <= DT_SOA_MAX_VERTS;
+	if (gathered)
+		dtGatherPolySoA(shape, verts, nverts);
+
 	dtNode* startNode = m_nodePool->getNode(startRef);
 	dtVcopy(startNode->pos, centerPos);
 	startNode->pidx = 0;
@@ -3094,9 +3550,9 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 			status |= DT_BUFFER_TOO_SMALL;
 		}
 		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(bestTile, i)->next)
 		{
-			const dtLink* link = &bestTile->links[i];
+			const dtLink* link = m_nav->getLink(bestTile, i);
 			dtPolyRef neighbourRef = link->ref;
 			// Skip invalid neighbours and do not follow back to parent.
 			if (!neighbourRef || neighbourRef == parentRef)
@@ -3119,7 +3575,10 @@ dtStatus dtNavMeshQuery::findPolysAroundShape(dtPolyRef startRef, const float* v
 			// If the poly is not touching the edge to the next polygon, skip the connection it.
 			float tmin, tmax;
 			int segMin, segMax;
-			if (!dtIntersectSegmentPoly2D(va, vb, verts, nverts, tmin, tmax, segMin, segMax))
+			const bool intersects = gathered ?
+				dtIntersectSegmentPoly2DSoA(va, vb, shape, tmin, tmax, segMin, segMax) :
+				dtIntersectSegmentPoly2D(va, vb, verts, nverts, tmin, tmax, segMin, segMax);
+			if (!intersects)
 				continue;
 			if (tmin > 1.0f || tmax < 0.0f)
 				continue;
@@ -3243,8 +3702,8 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 	
 	const float radiusSqr = dtSqr(radius);
 	
-	float pa[DT_VERTS_PER_POLYGON*3];
-	float pb[DT_VERTS_PER_POLYGON*3];
+	dtPolySoA pa;
+	dtPolySoA pb;
 	
 	dtStatus status = DT_SUCCESS;
 	
@@ -3276,9 +3735,9 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 		const dtPoly* curPoly = 0;
 		m_nav->getTileAndPolyByRefUnsafe(curRef, &curTile, &curPoly);
 		
-		for (unsigned int i = curPoly->firstLink; i != DT_NULL_LINK; i = curTile->links[i].next)
+		for (unsigned int i = curPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(curTile, i)->next)
 		{
-			const dtLink* link = &curTile->links[i];
+			const dtLink* link = m_nav->getLink(curTile, i);
 			dtPolyRef neighbourRef = link->ref;
 			// Skip invalid neighbours.
 			if (!neighbourRef)
@@ -3324,9 +3783,7 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 			// Check that the polygon does not collide with existing polygons.
 			
 			// Collect vertices of the neighbour poly.
-			const int npa = neighbourPoly->vertCount;
-			for (int k = 0; k < npa; ++k)
-				dtVcopy(&pa[k*3], &neighbourTile->verts[neighbourPoly->verts[k]*3]);
+			dtGatherPolySoAIndexed(pa, neighbourPoly->verts, neighbourPoly->vertCount, neighbourTile->verts);
 			
 			bool overlap = false;
 			for (int j = 0; j < n; ++j)
@@ -3335,9 +3792,9 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 				
 				// Connected polys do not overlap.
 				bool connected = false;
-				for (unsigned int k = curPoly->firstLink; k != DT_NULL_LINK; k = curTile->links[k].next)
+				for (unsigned int k = curPoly->firstLink; k != DT_NULL_LINK; k = m_nav->getLink(curTile, k)->next)
 				{
-					if (curTile->links[k].ref == pastRef)
+					if (m_nav->getLink(curTile, k)->ref == pastRef)
 					{
 						connected = true;
 						break;
@@ -3352,11 +3809,9 @@ dtStatus dtNavMeshQuery::findLocalNeighbourhood(dtPolyRef startRef, const float*
 				m_nav->getTileAndPolyByRefUnsafe(pastRef, &pastTile, &pastPoly);
 				
 				// Get vertices and test overlap
-				const int npb = pastPoly->vertCount;
-				for (int k = 0; k < npb; ++k)
-					dtVcopy(&pb[k*3], &pastTile->verts[pastPoly->verts[k]*3]);
+				dtGatherPolySoAIndexed(pb, pastPoly->verts, pastPoly->vertCount, pastTile->verts);
 				
-				if (dtOverlapPolyPoly2D(pa,npa, pb,npb))
+				if (dtOverlapPolyPoly2DSoA(pa, pb))
 				{
 					overlap = true;
 					break;
@@ -3465,9 +3920,9 @@ dtStatus dtNavMeshQuery::getPolyWallSegments(dtPolyRef ref, const dtQueryFilter*
 		if (poly->neis[j] & DT_EXT_LINK)
 		{
 			// Tile border.
-			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = m_nav->getLink(tile, k)->next)
 			{
-				const dtLink* link = &tile->links[k];
+				const dtLink* link = m_nav->getLink(tile, k);
 				if (link->edge == j)
 				{
 					if (link->ref != 0)
@@ -3649,9 +4104,9 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 			{
 				// Tile border.
 				bool solid = true;
-				for (unsigned int k = bestPoly->firstLink; k != DT_NULL_LINK; k = bestTile->links[k].next)
+				for (unsigned int k = bestPoly->firstLink; k != DT_NULL_LINK; k = m_nav->getLink(bestTile, k)->next)
 				{
-					const dtLink* link = &bestTile->links[k];
+					const dtLink* link = m_nav->getLink(bestTile, k);
 					if (link->edge == j)
 					{
 						if (link->ref != 0)
@@ -3694,9 +4149,9 @@ dtStatus dtNavMeshQuery::findDistanceToWall(dtPolyRef startRef, const float* cen
 			hitPos[2] = vj[2] + (vi[2] - vj[2])*tseg;
 		}
 		
-		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = m_nav->getLink(bestTile, i)->next)
 		{
-			const dtLink* link = &bestTile->links[i];
+			const dtLink* link = m_nav->getLink(bestTile, i);
 			dtPolyRef neighbourRef = link->ref;
 			// Skip invalid neighbours and do not follow back to parent.
 			if (!neighbourRef || neighbourRef == parentRef)
@@ -179,6 +179,22 @@ struct dtCrowdAgentAnimation
 	float t, tmax;
 };
 
+/// Memory used by a crowd, in bytes.
+/// @see dtCrowd::getMemoryUsage
+/// @ingroup crowd
+struct dtCrowdMemoryUsage
+{
+	size_t crowd;			///< The crowd object, including its embedded path queue.
+	size_t agents;			///< Agent pool, active agent list and off-mesh animations.
+	size_t corridors;		///< Path buffers of the agent corridors.
+	size_t pathQueue;		///< Path buffers and search nodes of the path request queue.
+	size_t navQuery;		///< The crowd's own query object.
+	size_t obstacleQuery;	///< Obstacle avoidance query.
+	size_t grid;			///< Proximity grid.
+	size_t pathResult;		///< Scratch path buffer.
+	size_t total;			///< Sum of all of the above.
+};
+
 /// Crowd agent update flags.
 /// @ingroup crowd
 /// @see dtCrowdAgentParams::updateFlags
@@ -216,6 +232,7 @@ class dtCrowd
 	
 	dtPolyRef* m_pathResult;
 	int m_maxPathResult;
+	int m_pathQueueIters;
 	
 	float m_agentPlacementHalfExtents[3];
 
@@ -345,9 +362,25 @@ public:
 	/// @return The crowd's path request queue.
 	const dtPathQueue* getPathQueue() const { return &m_pathq; }
 
+	/// Gets the crowd's path request queue, for example to add it to a dtPathScheduler.
+	/// @return The crowd's path request queue.
+	dtPathQueue* getEditablePathQueue() { return &m_pathq; }
+
+	/// Sets the number of search iterations the crowd spends on its path queue each update.
+	/// Set to zero when the queue is updated by a dtPathScheduler instead.
+	///  @param[in]		maxIters	The number of search iterations. [Limit: >= 0]
+	inline void setPathQueueIterations(const int maxIters) { m_pathQueueIters = maxIters > 0 ? maxIters : 0; }
+
+	/// Gets the number of search iterations the crowd spends on its path queue each update.
+	inline int getPathQueueIterations() const { return m_pathQueueIters; }
+
 	/// Gets the query object used by the crowd.
 	const dtNavMeshQuery* getNavMeshQuery() const { return m_navquery; }
 
+	/// Gets the memory used by the crowd. The navigation mesh is not included.
+	///  @param[out]	usage	The memory breakdown.
+	void getMemoryUsage(dtCrowdMemoryUsage* usage) const;
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtCrowd(const dtCrowd&);
@@ -86,6 +86,14 @@ public:
 	///  @param[in]		navquery		The query object used to build the corridor.
 	///  @param[in]		filter			The filter to apply to the operation.	
 	bool isValid(const int maxLookAhead, dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+
+	/// Repairs a corridor that runs through tiles replaced with dtNavMesh::replaceTile.
+	/// Stale polygons are swapped for the polygons that replaced them, and polygons that
+	/// are no longer adjacent are reconnected with a short local search.
+	///  @param[in]		navquery		The query object used to build the corridor.
+	///  @param[in]		filter			The filter to apply to the operation.
+	/// @return True if the corridor is valid, false if it could not be repaired and needs to be replanned.
+	bool repairPath(dtNavMeshQuery* navquery, const dtQueryFilter* filter);
 	
 	/// Moves the position from the current location to the desired location, adjusting the corridor 
 	/// as needed to reflect the change.
@@ -133,6 +141,9 @@ public:
 	/// @return The number of polygons in the current corridor path.
 	inline int getPathCount() const { return m_npath; }
 
+	/// The heap memory used by the corridor's path buffer, in bytes.
+	inline int getMemUsed() const { return (int)sizeof(dtPolyRef)*m_maxPath; }
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	dtPathCorridor(const dtPathCorridor&);
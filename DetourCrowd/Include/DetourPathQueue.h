@@ -24,6 +24,9 @@
 
 static const unsigned int DT_PATHQ_INVALID = 0;
 
+/// The default number of search iterations between clock checks in timed updates.
+static const int DT_PATHQ_CLOCK_CHECK_ITERS = 16;
+
 typedef unsigned int dtPathQueueRef;
 
 class dtPathQueue
@@ -51,6 +54,7 @@ class dtPathQueue
 	dtNavMeshQuery* m_navquery;
 	
 	void purge();
+	void updateRequests(const int maxIters, const dtQueryClock* clock, const long long deadline, const int checkIters);
 	
 public:
 	dtPathQueue();
@@ -60,6 +64,17 @@ public:
 	
 	void update(const int maxIters);
 	
+	/// Updates the pending requests until they are done or the deadline passes.
+	/// The request in progress carries over to the next update.
+	///  @param[in]		clock		The clock to check the deadline against.
+	///  @param[in]		deadline	The time to stop at, in clock ticks.
+	///  @param[in]		checkIters	The number of search iterations between clock checks.
+	void updateTimed(const dtQueryClock* clock, const long long deadline,
+					 const int checkIters = DT_PATHQ_CLOCK_CHECK_ITERS);
+	
+	/// Returns true if there are requests waiting for or in the middle of a search.
+	bool hasPendingRequests() const;
+	
 	dtPathQueueRef request(dtPolyRef startRef, dtPolyRef endRef,
 						   const float* startPos, const float* endPos, 
 						   const dtQueryFilter* filter);
@@ -69,6 +84,9 @@ public:
 	dtStatus getPathResult(dtPathQueueRef ref, dtPolyRef* path, int* pathSize, const int maxPath);
 	
 	inline const dtNavMeshQuery* getNavQuery() const { return m_navquery; }
+	
+	/// The heap memory used by the queue's path buffers and query, in bytes.
+	int getMemUsed() const;
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
@@ -76,4 +94,41 @@ private:
 	dtPathQueue& operator=(const dtPathQueue&);
 };
 
+/// Shares one time budget between several path queues, for example the queues
+/// of crowds using different navigation meshes or agent profiles.
+class dtPathScheduler
+{
+	static const int MAX_QUEUES = 16;
+	dtPathQueue* m_queues[MAX_QUEUES];
+	int m_nqueues;
+	int m_next;
+	
+public:
+	dtPathScheduler();
+	
+	/// Adds a queue to the scheduler.
+	/// @return False if the queue is already scheduled or there is no room for it.
+	bool addQueue(dtPathQueue* queue);
+	
+	/// Removes a queue from the scheduler.
+	void removeQueue(dtPathQueue* queue);
+	
+	/// Gets the number of scheduled queues.
+	inline int getQueueCount() const { return m_nqueues; }
+	
+	/// Updates all scheduled queues within the budget. Queues with pending requests
+	/// share the budget evenly, time left over by a queue goes to the ones after it,
+	/// and the first queue rotates every update.
+	///  @param[in]		clock		The clock to measure the budget with.
+	///  @param[in]		budget		The time to spend, in clock ticks.
+	///  @param[in]		checkIters	The number of search iterations between clock checks.
+	void update(const dtQueryClock* clock, const long long budget,
+				const int checkIters = DT_PATHQ_CLOCK_CHECK_ITERS);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPathScheduler(const dtPathScheduler&);
+	dtPathScheduler& operator=(const dtPathScheduler&);
+};
+
 #endif // DETOURPATHQUEUE_H
@@ -59,6 +59,13 @@ public:
 	
 	inline const int* getBounds() const { return m_bounds; }
 	inline float getCellSize() const { return m_cellSize; }
+	
+	inline int getMemUsed() const
+	{
+		return sizeof(*this) +
+			sizeof(Item)*m_poolSize +
+			sizeof(unsigned short)*m_bucketsSize;
+	}
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
@@ -337,6 +337,7 @@ dtCrowd::dtCrowd() :
 	m_grid(0),
 	m_pathResult(0),
 	m_maxPathResult(0),
+	m_pathQueueIters(MAX_ITERS_PER_UPDATE),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
 	m_navquery(0)
@@ -479,6 +480,30 @@ int dtCrowd::getAgentCount() const
 	return m_maxAgents;
 }
 
+void dtCrowd::getMemoryUsage(dtCrowdMemoryUsage* usage) const
+{
+	dtAssert(usage);
+	memset(usage, 0, sizeof(dtCrowdMemoryUsage));
+	
+	usage->crowd = sizeof(dtCrowd);
+	usage->agents = (sizeof(dtCrowdAgent) + sizeof(dtCrowdAgent*) + sizeof(dtCrowdAgentAnimation))*m_maxAgents;
+	for (int i = 0; i < m_maxAgents; ++i)
+		usage->corridors += m_agents[i].corridor.getMemUsed();
+	usage->pathQueue = m_pathq.getMemUsed();
+	if (m_navquery)
+	{
+		dtNavMeshQueryMemoryUsage queryUsage;
+		m_navquery->getMemoryUsage(&queryUsage);
+		usage->navQuery = queryUsage.total;
+	}
+	usage->obstacleQuery = m_obstacleQuery ? m_obstacleQuery->getMemUsed() : 0;
+	usage->grid = m_grid ? m_grid->getMemUsed() : 0;
+	usage->pathResult = sizeof(dtPolyRef)*m_maxPathResult;
+	
+	usage->total = usage->crowd + usage->agents + usage->corridors + usage->pathQueue + usage->navQuery +
+		usage->obstacleQuery + usage->grid + usage->pathResult;
+}
+
 /// @par
 /// 
 /// Agents in the pool may not be in use.  Check #dtCrowdAgent.active before using the returned object.
@@ -778,8 +803,9 @@ void dtCrowd::updateMoveRequest(const float /*dt*/)
 	}
 
 	
-	// Update requests.
-	m_pathq.update(MAX_ITERS_PER_UPDATE);
+	// Update requests, unless the queue is updated by a dtPathScheduler.
+	if (m_pathQueueIters > 0)
+		m_pathq.update(m_pathQueueIters);
 
 	dtStatus status;
 
@@ -952,6 +978,15 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 		ag->targetReplanTime += dt;
 
 		bool replan = false;
+		const dtQueryFilter* filter = &m_filters[ag->params.queryFilterType];
+
+		// Carry the corridor over tiles rebuilt since the last update, so that agents
+		// crossing a rebuilt area only replan when the local repair fails.
+		if (!ag->corridor.isValid(CHECK_LOOKAHEAD, m_navquery, filter) &&
+			ag->corridor.repairPath(m_navquery, filter))
+		{
+			ag->boundary.reset();
+		}
 
 		// First check that the current location is valid.
 		const int idx = getAgentIndex(ag);
@@ -995,7 +1030,19 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 		// Try to recover move request position.
 		if (ag->targetState != DT_CROWDAGENT_TARGET_NONE && ag->targetState != DT_CROWDAGENT_TARGET_FAILED)
 		{
-			if (!m_navquery->isValidPolyRef(ag->targetRef, &m_filters[ag->params.queryFilterType]))
+			if (!m_navquery->isValidPolyRef(ag->targetRef, filter))
+			{
+				// Keep the target in the polygon that replaced its polygon, if it is still over it.
+				const dtPolyRef remapped = m_navquery->getAttachedNavMesh()->remapPolyRef(ag->targetRef);
+				bool overPoly = false;
+				float nearest[3];
+				if (remapped && m_navquery->isValidPolyRef(remapped, filter) &&
+					dtStatusSucceed(m_navquery->closestPointOnPoly(remapped, ag->targetPos, nearest, &overPoly)) && overPoly)
+				{
+					ag->targetRef = remapped;
+				}
+			}
+			if (!m_navquery->isValidPolyRef(ag->targetRef, filter))
 			{
 				// Current target is not valid, try to reposition.
 				float nearest[3];
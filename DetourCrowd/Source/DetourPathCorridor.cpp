@@ -595,3 +595,124 @@ bool dtPathCorridor::isValid(const int maxLookAhead, dtNavMeshQuery* navquery, c
 
 	return true;
 }
+
+static bool isLinked(const dtNavMesh* nav, const dtPolyRef from, const dtPolyRef to)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(from, &tile, &poly);
+	for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = nav->getLink(tile, k)->next)
+	{
+		if (nav->getLink(tile, k)->ref == to)
+			return true;
+	}
+	return false;
+}
+
+/// @par
+///
+/// Each stale polygon is remapped with dtNavMesh::remapPolyRef, repeated polygons are
+/// merged, and a polygon that does not link to the previous one is reached with a
+/// bounded search between the two. If the new last polygon does not contain the target,
+/// the corridor is extended to the polygon that does. The corridor is left unchanged if
+/// a polygon can not be remapped, a gap can not be bridged or the repaired path does not fit.
+bool dtPathCorridor::repairPath(dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	dtAssert(navquery);
+	dtAssert(filter);
+	dtAssert(m_path);
+
+	if (isValid(m_npath, navquery, filter))
+		return true;
+
+	static const int MAX_ITER = 64;
+	static const int MAX_RES = 32;
+
+	const dtNavMesh* nav = navquery->getAttachedNavMesh();
+	dtPolyRef* path = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*m_maxPath, DT_ALLOC_TEMP);
+	if (!path)
+		return false;
+
+	int npath = 0;
+	bool ok = true;
+	for (int i = 0; i < m_npath && ok; ++i)
+	{
+		const dtPolyRef ref = nav->remapPolyRef(m_path[i]);
+		if (!ref || !navquery->isValidPolyRef(ref, filter))
+		{
+			ok = false;
+			break;
+		}
+		if (npath > 0 && path[npath-1] == ref)
+			continue;
+
+		if (npath == 0 || isLinked(nav, path[npath-1], ref))
+		{
+			if (npath >= m_maxPath)
+			{
+				ok = false;
+				break;
+			}
+			path[npath++] = ref;
+			continue;
+		}
+
+		// Bridge the gap, the first result is the previous polygon.
+		const dtPolyRef prevRef = path[npath-1];
+		float startPos[3], endPos[3];
+		if (npath == 1)
+			dtVcopy(startPos, m_pos);
+		else
+			navquery->closestPointOnPoly(prevRef, m_target, startPos, 0);
+		navquery->closestPointOnPoly(ref, m_target, endPos, 0);
+
+		dtPolyRef res[MAX_RES];
+		int nres = 0;
+		navquery->initSlicedFindPath(prevRef, ref, startPos, endPos, filter);
+		const bool reached = dtStatusSucceed(navquery->updateSlicedFindPath(MAX_ITER, 0));
+		const dtStatus status = navquery->finalizeSlicedFindPath(res, &nres, MAX_RES);
+		if (!reached || dtStatusFailed(status) || dtStatusDetail(status, DT_PARTIAL_RESULT) ||
+			nres < 2 || res[nres-1] != ref || npath + nres-1 > m_maxPath)
+		{
+			ok = false;
+			break;
+		}
+		for (int j = 1; j < nres; ++j)
+			path[npath++] = res[j];
+	}
+
+	// The polygon that replaced the last polygon may not contain the target, walk to the one that does.
+	if (ok && npath > 0 && path[npath-1] != m_path[m_npath-1])
+	{
+		float closest[3];
+		bool overPoly = false;
+		navquery->closestPointOnPoly(path[npath-1], m_target, closest, &overPoly);
+		if (!overPoly)
+		{
+			dtPolyRef visited[MAX_RES];
+			int nvisited = 0;
+			float result[3];
+			const dtStatus status = navquery->moveAlongSurface(path[npath-1], closest, m_target, filter,
+															   result, visited, &nvisited, MAX_RES);
+			if (dtStatusFailed(status) || nvisited < 1 || dtVdist2DSqr(result, m_target) > 1e-6f ||
+				npath + nvisited-1 > m_maxPath)
+			{
+				ok = false;
+			}
+			else
+			{
+				for (int j = 1; j < nvisited; ++j)
+					path[npath++] = visited[j];
+			}
+		}
+	}
+
+	if (ok && npath > 0)
+	{
+		memcpy(m_path, path, sizeof(dtPolyRef)*npath);
+		m_npath = npath;
+	}
+	dtFree(path);
+
+	return ok && npath > 0;
+}
@@ -50,6 +50,18 @@ void dtPathQueue::purge()
 	}
 }
 
+int dtPathQueue::getMemUsed() const
+{
+	int mem = (int)sizeof(dtPolyRef)*m_maxPathSize*MAX_QUEUE;
+	if (m_navquery)
+	{
+		dtNavMeshQueryMemoryUsage usage;
+		m_navquery->getMemoryUsage(&usage);
+		mem += (int)usage.total;
+	}
+	return mem;
+}
+
 bool dtPathQueue::init(const int maxPathSize, const int maxSearchNodeCount, dtNavMesh* nav)
 {
 	purge();
@@ -75,11 +87,35 @@ bool dtPathQueue::init(const int maxPathSize, const int maxSearchNodeCount, dtNa
 }
 
 void dtPathQueue::update(const int maxIters)
+{
+	updateRequests(maxIters, 0, 0, 0);
+}
+
+void dtPathQueue::updateTimed(const dtQueryClock* clock, const long long deadline, const int checkIters)
+{
+	if (!clock || checkIters <= 0)
+		return;
+	updateRequests(0, clock, deadline, checkIters);
+}
+
+bool dtPathQueue::hasPendingRequests() const
+{
+	for (int i = 0; i < MAX_QUEUE; ++i)
+	{
+		const PathQuery& q = m_queue[i];
+		if (q.ref != DT_PATHQ_INVALID && (q.status == 0 || dtStatusInProgress(q.status)))
+			return true;
+	}
+	return false;
+}
+
+void dtPathQueue::updateRequests(const int maxIters, const dtQueryClock* clock, const long long deadline, const int checkIters)
 {
 	static const int MAX_KEEP_ALIVE = 2; // in update ticks.
 
 	// Update path request until there is nothing to update
-	// or upto maxIters pathfinder iterations has been consumed.
+	// or upto maxIters pathfinder iterations has been consumed,
+	// or the deadline has passed when a clock is given.
 	int iterCount = maxIters;
 	
 	for (int i = 0; i < MAX_QUEUE; ++i)
@@ -117,7 +153,10 @@ void dtPathQueue::update(const int maxIters)
 		if (dtStatusInProgress(q.status))
 		{
 			int iters = 0;
-			q.status = m_navquery->updateSlicedFindPath(iterCount, &iters);
+			if (clock)
+				q.status = m_navquery->updateSlicedFindPathTimed(clock, deadline, checkIters, &iters);
+			else
+				q.status = m_navquery->updateSlicedFindPath(iterCount, &iters);
 			iterCount -= iters;
 		}
 		if (dtStatusSucceed(q.status))
@@ -125,7 +164,7 @@ void dtPathQueue::update(const int maxIters)
 			q.status = m_navquery->finalizeSlicedFindPath(q.path, &q.npath, m_maxPathSize);
 		}
 
-		if (iterCount <= 0)
+		if (clock ? clock->getTicks() >= deadline : iterCount <= 0)
 			break;
 
 		m_queueHead++;
@@ -198,3 +237,72 @@ dtStatus dtPathQueue::getPathResult(dtPathQueueRef ref, dtPolyRef* path, int* pa
 	}
 	return DT_FAILURE;
 }
+
+dtPathScheduler::dtPathScheduler() :
+	m_nqueues(0),
+	m_next(0)
+{
+}
+
+bool dtPathScheduler::addQueue(dtPathQueue* queue)
+{
+	if (!queue || m_nqueues >= MAX_QUEUES)
+		return false;
+	for (int i = 0; i < m_nqueues; ++i)
+	{
+		if (m_queues[i] == queue)
+			return false;
+	}
+	m_queues[m_nqueues++] = queue;
+	return true;
+}
+
+void dtPathScheduler::removeQueue(dtPathQueue* queue)
+{
+	for (int i = 0; i < m_nqueues; ++i)
+	{
+		if (m_queues[i] == queue)
+		{
+			m_queues[i] = m_queues[m_nqueues-1];
+			m_nqueues--;
+			return;
+		}
+	}
+}
+
+void dtPathScheduler::update(const dtQueryClock* clock, const long long budget, const int checkIters)
+{
+	if (!clock || !m_nqueues)
+		return;
+	
+	const long long deadline = clock->getTicks() + budget;
+	
+	int npending = 0;
+	for (int i = 0; i < m_nqueues; ++i)
+	{
+		if (m_queues[i]->hasPendingRequests())
+			npending++;
+	}
+	
+	// Every queue is updated exactly once per call, so completed results age at the same rate as with update().
+	const int first = m_next % m_nqueues;
+	m_next = first + 1;
+	
+	for (int i = 0; i < m_nqueues; ++i)
+	{
+		dtPathQueue* queue = m_queues[(first + i) % m_nqueues];
+		if (!queue->hasPendingRequests())
+		{
+			// Only ages the completed requests.
+			queue->update(0);
+			continue;
+		}
+		
+		// Split what is left evenly between the pending queues not yet updated.
+		const long long now = clock->getTicks();
+		const long long remaining = deadline > now ? deadline - now : 0;
+		const long long slice = npending > 0 ? remaining / npending : remaining;
+		queue->updateTimed(clock, now + slice, checkIters);
+		npending--;
+	}
+}
@@ -0,0 +1,135 @@
+#ifndef DETOUROBSTACLEREGISTRY_H
+#define DETOUROBSTACLEREGISTRY_H
+
+#include "DetourStatus.h"
+#include "DetourTileCache.h"
+
+class dtQueryClock;
+
+typedef unsigned int dtSharedObstacleRef;
+
+/// The maximum number of tile caches a registry can fan obstacles out to.
+static const int DT_OBSTACLE_REGISTRY_MAX_CACHES = 8;
+
+/// Keeps one handle per obstacle for a set of tile caches, for example one per
+/// nav mesh profile, and forwards every obstacle to all of them.
+///
+/// The footprint of an obstacle is calculated once for every distinct tile grid,
+/// and the tile rebuilds of all caches share one time budget in update().
+/// Obstacles that can not be added to or removed from a cache right away, because
+/// its request queue or obstacle pool is full, are retried on the next update.
+class dtObstacleRegistry
+{
+public:
+	dtObstacleRegistry();
+	~dtObstacleRegistry();
+
+	/// Initializes the registry.
+	///  @param[in]		maxObstacles	The maximum number of shared obstacles. [Limit: < 65536]
+	/// @returns The status flags for the operation.
+	dtStatus init(const int maxObstacles);
+
+	/// Adds a tile cache and the nav mesh it rebuilds. The obstacles already in
+	/// the registry are added to the new cache.
+	/// @returns The status flags for the operation.
+	dtStatus addTileCache(dtTileCache* tc, dtNavMesh* navmesh);
+
+	/// Removes a tile cache. Its obstacles are left in the cache.
+	void removeTileCache(const dtTileCache* tc);
+
+	/// Gets the number of registered tile caches.
+	int getTileCacheCount() const;
+
+	/// Adds an obstacle to all registered tile caches.
+	///  @param[in]		desc	The obstacle shape.
+	///  @param[out]	result	The shared obstacle handle. [opt]
+	/// @returns The status flags for the operation. DT_BUFFER_TOO_SMALL is set if some
+	/// cache could not take the obstacle yet.
+	dtStatus addObstacle(const dtObstacleDesc* desc, dtSharedObstacleRef* result);
+
+	/// Moves an obstacle to a new shape in all registered tile caches.
+	/// See dtTileCache::moveObstacle.
+	/// @returns The status flags for the operation. DT_BUFFER_TOO_SMALL is set if some
+	/// cache could not take the move yet.
+	dtStatus moveObstacle(const dtSharedObstacleRef ref, const dtObstacleDesc* desc);
+
+	/// Removes an obstacle from all registered tile caches.
+	/// @returns The status flags for the operation.
+	dtStatus removeObstacle(const dtSharedObstacleRef ref);
+
+	/// Removes all obstacles.
+	void removeAllObstacles();
+
+	/// Finds the shared handle of an obstacle in one of the registered tile caches.
+	/// @returns The shared handle, or zero if the obstacle does not belong to the registry.
+	dtSharedObstacleRef findObstacle(const dtTileCache* tc, const dtObstacleRef ref) const;
+
+	/// Gets the obstacle a shared obstacle created in one of the registered tile caches.
+	/// @returns The obstacle reference, or zero if it has not been added to the cache.
+	dtObstacleRef getTileCacheObstacle(const dtSharedObstacleRef ref, const dtTileCache* tc) const;
+
+	/// Gets the shape of a shared obstacle.
+	const dtObstacleDesc* getObstacleDesc(const dtSharedObstacleRef ref) const;
+
+	/// Updates all registered tile caches, rebuilding the tiles touched by obstacle changes.
+	/// The caches take turns rebuilding one tile at a time until the budget is spent,
+	/// and the first cache rotates every update. Without a clock every cache rebuilds
+	/// one tile, like dtTileCache::update.
+	///  @param[in]		clock		The clock to measure the budget with. [opt]
+	///  @param[in]		budget		The time to spend, in clock ticks.
+	///  @param[out]	upToDate	Whether all caches are up to date with the obstacles. [opt]
+	/// @returns The status flags for the operation.
+	dtStatus update(const dtQueryClock* clock, const long long budget, bool* upToDate = 0);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtObstacleRegistry(const dtObstacleRegistry&);
+	dtObstacleRegistry& operator=(const dtObstacleRegistry&);
+
+	enum SharedObstacleState
+	{
+		SHARED_OBSTACLE_EMPTY,
+		SHARED_OBSTACLE_ACTIVE,
+		SHARED_OBSTACLE_REMOVING
+	};
+
+	struct SharedObstacle
+	{
+		dtObstacleDesc desc;
+		dtObstacleRef refs[DT_OBSTACLE_REGISTRY_MAX_CACHES];	///< The obstacle in each cache, zero if not added.
+		unsigned short salt;
+		unsigned char state;
+		unsigned char moved;		///< One bit per cache that has not taken the latest shape yet.
+		SharedObstacle* next;
+	};
+
+	struct CacheEntry
+	{
+		dtTileCache* tc;
+		dtNavMesh* navmesh;
+		int grid;			///< Index of the first cache with the same tile grid.
+		bool upToDate;		///< Whether the last update of the cache left it up to date.
+	};
+
+	dtSharedObstacleRef getObstacleRef(const SharedObstacle* ob) const;
+	SharedObstacle* getObstacleByRef(const dtSharedObstacleRef ref) const;
+	void updateGrids();
+
+	/// Adds the obstacle to the caches it is missing from. Returns false if some cache was full.
+	bool addToCaches(SharedObstacle* ob);
+	/// Moves the obstacle in the caches that have an older shape. Returns false if some cache was full.
+	bool moveInCaches(SharedObstacle* ob);
+	/// Removes the obstacle from the caches it is in. Returns false if some cache was full.
+	bool removeFromCaches(SharedObstacle* ob);
+	void freeObstacle(SharedObstacle* ob);
+
+	CacheEntry m_caches[DT_OBSTACLE_REGISTRY_MAX_CACHES];
+	int m_next;							///< The cache to update first on the next update.
+	bool m_dirty;						///< Set when some obstacle change is waiting for room in a cache.
+
+	SharedObstacle* m_obstacles;
+	SharedObstacle* m_nextFreeObstacle;
+	int m_maxObstacles;
+};
+
+#endif // DETOUROBSTACLEREGISTRY_H
@@ -38,9 +38,13 @@ enum ObstacleType
 {
 	DT_OBSTACLE_CYLINDER,
 	DT_OBSTACLE_BOX, // AABB
-	DT_OBSTACLE_ORIENTED_BOX // OBB
+	DT_OBSTACLE_ORIENTED_BOX, // OBB
+	DT_OBSTACLE_CONVEX_PRISM // Convex polygon extruded along Y
 };
 
+/// The maximum number of vertices in the polygon of a convex prism obstacle.
+static const int DT_MAX_PRISM_VERTS = 8;
+
 struct dtObstacleCylinder
 {
 	float pos[ 3 ];
@@ -53,6 +57,7 @@ struct dtObstacleBox
 {
 	float bmin[ 3 ];
 	float bmax[ 3 ];
+	int area;
 };
 
 struct dtObstacleOrientedBox
@@ -60,6 +65,16 @@ struct dtObstacleOrientedBox
 	float center[ 3 ];
 	float halfExtents[ 3 ];
 	float rotAux[ 2 ]; //{ cos(0.5f*angle)*sin(-0.5f*angle); cos(0.5f*angle)*cos(0.5f*angle) - 0.5 }
+	int area;
+};
+
+struct dtObstacleConvexPrism
+{
+	float verts[ DT_MAX_PRISM_VERTS*3 ];	///< Convex polygon, the y coordinates are ignored. [(x, y, z) * nverts]
+	int nverts;
+	float hmin;
+	float hmax;
+	int area;
 };
 
 static const int DT_MAX_TOUCHED_TILES = 8;
@@ -70,6 +85,7 @@ struct dtTileCacheObstacle
 		dtObstacleCylinder cylinder;
 		dtObstacleBox box;
 		dtObstacleOrientedBox orientedBox;
+		dtObstacleConvexPrism prism;
 	};
 
 	dtCompressedTileRef touched[DT_MAX_TOUCHED_TILES];
@@ -82,6 +98,34 @@ struct dtTileCacheObstacle
 	dtTileCacheObstacle* next;
 };
 
+/// Describes an obstacle shape, independent of any tile cache.
+/// Used to add the same obstacle to several tile caches.
+struct dtObstacleDesc
+{
+	unsigned char type;		///< The shape, see #ObstacleType.
+	union
+	{
+		dtObstacleCylinder cylinder;
+		dtObstacleBox box;
+		dtObstacleOrientedBox orientedBox;
+		dtObstacleConvexPrism prism;
+	};
+};
+
+/// True if the obstacle shape is of a known type and, for prisms, has a valid vertex count.
+bool dtIsObstacleDescValid(const dtObstacleDesc* desc);
+
+/// Calculates the axis aligned bounds of an obstacle shape.
+void dtCalcObstacleBounds(const dtObstacleDesc* desc, float* bmin, float* bmax);
+
+/// The range of tile columns overlapped by an obstacle. Tile caches with the same
+/// tile grid (see dtTileCache::hasSameTileGrid) share the footprint of an obstacle.
+struct dtTileCacheFootprint
+{
+	int tx0, ty0;	///< The first tile column, inclusive.
+	int tx1, ty1;	///< The last tile column, inclusive.
+};
+
 struct dtTileCacheParams
 {
 	float orig[3];
@@ -97,6 +141,16 @@ struct dtTileCacheParams
 	int maxOffMeshConnections;
 };
 
+/// Memory held by a tile cache, in bytes.
+struct dtTileCacheMemoryUsage
+{
+	size_t tileTable;			///< The cache object, the compressed tile array and the tile lookups.
+	size_t compressedLayers;	///< Compressed layer data, layer headers included.
+	size_t obstacles;			///< Obstacle pool.
+	size_t offMeshCons;			///< Off-mesh connection pool.
+	size_t total;				///< Sum of all of the above.
+};
+
 struct dtTileCacheMeshProcess
 {
 	virtual ~dtTileCacheMeshProcess();
@@ -134,6 +188,9 @@ public:
 	int getTilesAt(const int tx, const int ty, dtCompressedTileRef* tiles, const int maxTiles) const ;
 	
 	dtCompressedTile* getTileAt(const int tx, const int ty, const int tlayer);
+
+	/// True while tiles are looked up through the dense tile grid instead of the hash.
+	bool hasTileGrid() const { return m_tileLookup.hasGrid(); }
 	dtCompressedTileRef getTileRef(const dtCompressedTile* tile) const;
 	const dtCompressedTile* getTileByRef(dtCompressedTileRef ref) const;
 	
@@ -150,7 +207,22 @@ public:
 	// Box obstacle: can be rotated in Y.
 	dtStatus addBoxObstacle(const float* center, const float* halfExtents, const float yRadians, dtObstacleRef* result);
 	
+	// Convex prism obstacle: a convex polygon between two heights.
+	dtStatus addConvexObstacle(const float* verts, const int nverts, const float hmin, const float hmax,
+							   const int area, dtObstacleRef* result);
+	
+	/// Adds an obstacle of any shape. The footprint is calculated from the obstacle
+	/// bounds when not given; pass one from calcFootprint() to skip that.
+	dtStatus addObstacle(const dtObstacleDesc* desc, const dtTileCacheFootprint* footprint, dtObstacleRef* result);
+	
 	dtStatus removeObstacle(const dtObstacleRef ref);
+	
+	/// Moves an obstacle to a new shape, which may be of another type. The tiles under the
+	/// old and the new shape are rebuilt in one go, skipping tiles where the obstacle marks
+	/// the same walkable cells as before. Moving the obstacle again before the move has
+	/// been processed replaces the pending shape instead of queuing another request.
+	dtStatus moveObstacle(const dtObstacleRef ref, const dtObstacleDesc* desc);
+	
 	dtStatus removeOffMeshConnection(const dtOffMeshConnectionRef ref);
 
 	dtStatus addOffMeshConnection(const float* spos, const float* epos, const float radius, const unsigned char area, const unsigned int flags, const bool bBiDirectional, dtOffMeshConnectionRef* result);
@@ -158,6 +230,12 @@ public:
 	dtStatus queryTiles(const float* bmin, const float* bmax,
 						dtCompressedTileRef* results, int* resultCount, const int maxResults) const;
 	
+	/// Calculates the range of tile columns overlapped by the bounds.
+	void calcFootprint(const float* bmin, const float* bmax, dtTileCacheFootprint* footprint) const;
+	
+	/// True if both caches split the world into the same tile columns.
+	bool hasSameTileGrid(const dtTileCache* other) const;
+	
 	/// Updates the tile cache by rebuilding tiles touched by unfinished obstacle requests.
 	///  @param[in]		dt			The time step size. Currently not used.
 	///  @param[in]		navmesh		The mesh to affect when rebuilding tiles.
@@ -170,10 +248,39 @@ public:
 	
 	dtStatus buildNavMeshTile(const dtCompressedTileRef ref, class dtNavMesh* navmesh);
 	
+	/// Builds the nav mesh tile data of a compressed tile without adding it to a nav mesh.
+	/// Builds can run on several threads at once when each thread passes its own allocator
+	/// and compressor, as long as the obstacles and off-mesh connections of the cache do
+	/// not change meanwhile.
+	///  @param[in]		ref			The compressed tile to build.
+	///  @param[in]		talloc		The allocator for the scratch memory of the build.
+	///  @param[in]		tcomp		The compressor to decompress the tile layer with.
+	///  @param[out]	outData		The tile data, owned by the caller. Null if the tile has no polygons.
+	///  @param[out]	outDataSize	The size of the tile data.
+	/// @returns The status flags for the operation.
+	dtStatus buildNavMeshTileData(const dtCompressedTileRef ref, dtTileCacheAlloc* talloc, dtTileCacheCompressor* tcomp,
+								  unsigned char** outData, int* outDataSize);
+	
 	void calcTightTileBounds(const struct dtTileCacheLayerHeader* header, float* bmin, float* bmax) const;
 	
 	void getObstacleBounds(const struct dtTileCacheObstacle* ob, float* bmin, float* bmax) const;
 	
+	/// Gets the memory held by the tile cache. Scratch memory used while building
+	/// tiles belongs to the dtTileCacheAlloc and is not included.
+	void getMemoryUsage(dtTileCacheMemoryUsage* usage) const;
+	
+	/// Sets the most compressed layer data the cache may hold, in bytes. addTile fails with
+	/// DT_OUT_OF_MEMORY while adding a tile would exceed it. Zero disables the budget.
+	void setMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+	size_t getMemoryBudget() const { return m_memoryBudget; }
+	
+	/// The compressed layer data currently held by the cache, in bytes.
+	size_t getTileDataSize() const { return m_tileDataSize; }
+	
+	/// The number of tile rebuilds skipped so far because an obstacle change did not
+	/// mark or unmark any walkable cell of the tile.
+	unsigned int getSkippedRebuildCount() const { return m_nskippedRebuilds; }
+	
 
 	/// Encodes a tile id.
 	inline dtCompressedTileRef encodeTileId(unsigned int salt, unsigned int it) const
@@ -242,7 +349,8 @@ private:
 	enum ObstacleRequestAction
 	{
 		REQUEST_ADD,
-		REQUEST_REMOVE
+		REQUEST_REMOVE,
+		REQUEST_MOVE
 	};
 
 	enum OffMeshRequestAction
@@ -256,6 +364,9 @@ private:
 	{
 		int action;
 		dtObstacleRef ref;
+		dtTileCacheFootprint footprint;		///< Precalculated footprint, valid if hasFootprint is set.
+		bool hasFootprint;
+		dtObstacleDesc desc;				///< The new shape of a moved obstacle.
 	};
 
 	struct OffMeshRequest
@@ -263,14 +374,21 @@ private:
 		int action;
 		dtOffMeshConnectionRef ref;
 	};
-	
-	int m_tileLutSize;						///< Tile hash lookup size (must be pot).
-	int m_tileLutMask;						///< Tile hash lookup mask.
-	
-	dtCompressedTile** m_posLookup;			///< Tile hash lookup.
+
+	/// Finds the tiles overlapping the bounds within the footprint.
+	dtStatus queryFootprintTiles(const dtTileCacheFootprint& footprint, const float* bmin, const float* bmax,
+								 dtCompressedTileRef* results, int* resultCount, const int maxResults) const;
+
+	/// True if the shapes mark different walkable cells of the tile. Either shape may be null.
+	bool obstacleMarksDiffer(const dtCompressedTileRef ref, const dtObstacleDesc* a, const dtObstacleDesc* b);
+
+	dtTileLookup<dtCompressedTile> m_tileLookup;	///< Tile lookup by location.
 	dtCompressedTile* m_nextFreeTile;		///< Freelist of tiles.
 	dtCompressedTile* m_tiles;				///< List of tiles.
 	
+	size_t m_tileDataSize;					///< Total data size of the compressed tiles.
+	size_t m_memoryBudget;					///< Compressed data budget, zero when unlimited.
+	
 	unsigned int m_saltBits;				///< Number of salt bits in the tile ID.
 	unsigned int m_tileBits;				///< Number of tile bits in the tile ID.
 	
@@ -296,6 +414,8 @@ private:
 	static const int MAX_UPDATE = 64;
 	dtCompressedTileRef m_update[MAX_UPDATE];
 	int m_nupdate;
+	
+	unsigned int m_nskippedRebuilds;		///< Tile rebuilds skipped by obstacle changes that marked no walkable cells.
 };
 
 dtTileCache* dtAllocTileCache();
@@ -0,0 +1,427 @@
+#include "DetourObstacleRegistry.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <string.h>
+
+dtObstacleRegistry::dtObstacleRegistry() :
+	m_next(0),
+	m_dirty(false),
+	m_obstacles(0),
+	m_nextFreeObstacle(0),
+	m_maxObstacles(0)
+{
+	memset(m_caches, 0, sizeof(m_caches));
+}
+
+dtObstacleRegistry::~dtObstacleRegistry()
+{
+	dtFree(m_obstacles);
+	m_obstacles = 0;
+}
+
+dtStatus dtObstacleRegistry::init(const int maxObstacles)
+{
+	if (maxObstacles <= 0 || maxObstacles >= (1<<16))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtFree(m_obstacles);
+	m_obstacles = (SharedObstacle*)dtAlloc(sizeof(SharedObstacle)*maxObstacles, DT_ALLOC_PERM);
+	if (!m_obstacles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_obstacles, 0, sizeof(SharedObstacle)*maxObstacles);
+	m_maxObstacles = maxObstacles;
+
+	m_nextFreeObstacle = 0;
+	for (int i = maxObstacles-1; i >= 0; --i)
+	{
+		m_obstacles[i].salt = 1;
+		m_obstacles[i].next = m_nextFreeObstacle;
+		m_nextFreeObstacle = &m_obstacles[i];
+	}
+	m_dirty = false;
+
+	return DT_SUCCESS;
+}
+
+dtSharedObstacleRef dtObstacleRegistry::getObstacleRef(const SharedObstacle* ob) const
+{
+	const unsigned int idx = (unsigned int)(ob - m_obstacles);
+	return ((dtSharedObstacleRef)ob->salt << 16) | (dtSharedObstacleRef)idx;
+}
+
+dtObstacleRegistry::SharedObstacle* dtObstacleRegistry::getObstacleByRef(const dtSharedObstacleRef ref) const
+{
+	if (!ref || !m_obstacles)
+		return 0;
+	const unsigned int idx = ref & 0xffff;
+	if ((int)idx >= m_maxObstacles)
+		return 0;
+	SharedObstacle* ob = &m_obstacles[idx];
+	if (ob->salt != (ref >> 16) || ob->state != SHARED_OBSTACLE_ACTIVE)
+		return 0;
+	return ob;
+}
+
+void dtObstacleRegistry::updateGrids()
+{
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		CacheEntry& entry = m_caches[i];
+		entry.grid = i;
+		if (!entry.tc)
+			continue;
+		for (int j = 0; j < i; ++j)
+		{
+			if (m_caches[j].tc && m_caches[j].tc->hasSameTileGrid(entry.tc))
+			{
+				entry.grid = m_caches[j].grid;
+				break;
+			}
+		}
+	}
+}
+
+dtStatus dtObstacleRegistry::addTileCache(dtTileCache* tc, dtNavMesh* navmesh)
+{
+	if (!tc || !navmesh)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	int slot = -1;
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		if (m_caches[i].tc == tc)
+			return DT_FAILURE | DT_INVALID_PARAM;
+		if (slot == -1 && !m_caches[i].tc)
+			slot = i;
+	}
+	if (slot == -1)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	m_caches[slot].tc = tc;
+	m_caches[slot].navmesh = navmesh;
+	m_caches[slot].upToDate = false;
+	updateGrids();
+
+	// Bring the new cache up to date with the existing obstacles.
+	for (int i = 0; i < m_maxObstacles; ++i)
+	{
+		SharedObstacle* ob = &m_obstacles[i];
+		ob->refs[slot] = 0;
+		ob->moved &= (unsigned char)~(1 << slot);
+		if (ob->state == SHARED_OBSTACLE_ACTIVE && !addToCaches(ob))
+			m_dirty = true;
+	}
+
+	return m_dirty ? (DT_SUCCESS | DT_BUFFER_TOO_SMALL) : DT_SUCCESS;
+}
+
+void dtObstacleRegistry::removeTileCache(const dtTileCache* tc)
+{
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		if (m_caches[i].tc != tc)
+			continue;
+		m_caches[i].tc = 0;
+		m_caches[i].navmesh = 0;
+		for (int j = 0; j < m_maxObstacles; ++j)
+		{
+			SharedObstacle* ob = &m_obstacles[j];
+			ob->refs[i] = 0;
+			ob->moved &= (unsigned char)~(1 << i);
+			if (ob->state == SHARED_OBSTACLE_REMOVING)
+				removeFromCaches(ob);
+		}
+	}
+	updateGrids();
+}
+
+int dtObstacleRegistry::getTileCacheCount() const
+{
+	int n = 0;
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		if (m_caches[i].tc)
+			n++;
+	}
+	return n;
+}
+
+bool dtObstacleRegistry::addToCaches(SharedObstacle* ob)
+{
+	float bmin[3], bmax[3];
+	dtCalcObstacleBounds(&ob->desc, bmin, bmax);
+
+	// One footprint per distinct tile grid.
+	dtTileCacheFootprint footprints[DT_OBSTACLE_REGISTRY_MAX_CACHES];
+	bool hasFootprint[DT_OBSTACLE_REGISTRY_MAX_CACHES];
+	memset(hasFootprint, 0, sizeof(hasFootprint));
+
+	bool done = true;
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		CacheEntry& entry = m_caches[i];
+		if (!entry.tc || ob->refs[i])
+			continue;
+		entry.upToDate = false;
+
+		if (!hasFootprint[entry.grid])
+		{
+			entry.tc->calcFootprint(bmin, bmax, &footprints[entry.grid]);
+			hasFootprint[entry.grid] = true;
+		}
+
+		if (dtStatusFailed(entry.tc->addObstacle(&ob->desc, &footprints[entry.grid], &ob->refs[i])))
+		{
+			ob->refs[i] = 0;
+			done = false;
+		}
+	}
+	return done;
+}
+
+bool dtObstacleRegistry::moveInCaches(SharedObstacle* ob)
+{
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		CacheEntry& entry = m_caches[i];
+		if (!entry.tc || !ob->refs[i] || !(ob->moved & (1 << i)))
+			continue;
+		entry.upToDate = false;
+		if (dtStatusSucceed(entry.tc->moveObstacle(ob->refs[i], &ob->desc)))
+			ob->moved &= (unsigned char)~(1 << i);
+	}
+	return ob->moved == 0;
+}
+
+bool dtObstacleRegistry::removeFromCaches(SharedObstacle* ob)
+{
+	bool done = true;
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		CacheEntry& entry = m_caches[i];
+		if (!entry.tc || !ob->refs[i])
+			continue;
+		entry.upToDate = false;
+		if (dtStatusFailed(entry.tc->removeObstacle(ob->refs[i])))
+			done = false;
+		else
+			ob->refs[i] = 0;
+	}
+
+	if (done)
+		freeObstacle(ob);
+	return done;
+}
+
+void dtObstacleRegistry::freeObstacle(SharedObstacle* ob)
+{
+	memset(ob->refs, 0, sizeof(ob->refs));
+	ob->moved = 0;
+	ob->state = SHARED_OBSTACLE_EMPTY;
+	// Update salt, salt should never be zero.
+	ob->salt = (ob->salt+1) & ((1<<16)-1);
+	if (ob->salt == 0)
+		ob->salt++;
+	ob->next = m_nextFreeObstacle;
+	m_nextFreeObstacle = ob;
+}
+
+dtStatus dtObstacleRegistry::addObstacle(const dtObstacleDesc* desc, dtSharedObstacleRef* result)
+{
+	if (!dtIsObstacleDescValid(desc))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	SharedObstacle* ob = m_nextFreeObstacle;
+	if (!ob)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_nextFreeObstacle = ob->next;
+	ob->next = 0;
+
+	ob->desc = *desc;
+	memset(ob->refs, 0, sizeof(ob->refs));
+	ob->moved = 0;
+	ob->state = SHARED_OBSTACLE_ACTIVE;
+
+	if (result)
+		*result = getObstacleRef(ob);
+
+	if (!addToCaches(ob))
+	{
+		m_dirty = true;
+		return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
+	}
+	return DT_SUCCESS;
+}
+
+dtStatus dtObstacleRegistry::moveObstacle(const dtSharedObstacleRef ref, const dtObstacleDesc* desc)
+{
+	if (!dtIsObstacleDescValid(desc))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	SharedObstacle* ob = getObstacleByRef(ref);
+	if (!ob)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Caches the obstacle has not been added to yet get the new shape when it is.
+	ob->desc = *desc;
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		if (m_caches[i].tc && ob->refs[i])
+			ob->moved |= (unsigned char)(1 << i);
+	}
+
+	if (!moveInCaches(ob))
+	{
+		m_dirty = true;
+		return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
+	}
+	return DT_SUCCESS;
+}
+
+dtStatus dtObstacleRegistry::removeObstacle(const dtSharedObstacleRef ref)
+{
+	SharedObstacle* ob = getObstacleByRef(ref);
+	if (!ob)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	ob->state = SHARED_OBSTACLE_REMOVING;
+	if (!removeFromCaches(ob))
+		m_dirty = true;
+
+	return DT_SUCCESS;
+}
+
+void dtObstacleRegistry::removeAllObstacles()
+{
+	for (int i = 0; i < m_maxObstacles; ++i)
+	{
+		SharedObstacle* ob = &m_obstacles[i];
+		if (ob->state == SHARED_OBSTACLE_ACTIVE)
+			removeObstacle(getObstacleRef(ob));
+	}
+}
+
+dtSharedObstacleRef dtObstacleRegistry::findObstacle(const dtTileCache* tc, const dtObstacleRef ref) const
+{
+	if (!ref)
+		return 0;
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		if (m_caches[i].tc != tc)
+			continue;
+		for (int j = 0; j < m_maxObstacles; ++j)
+		{
+			const SharedObstacle* ob = &m_obstacles[j];
+			if (ob->state == SHARED_OBSTACLE_ACTIVE && ob->refs[i] == ref)
+				return getObstacleRef(ob);
+		}
+	}
+	return 0;
+}
+
+dtObstacleRef dtObstacleRegistry::getTileCacheObstacle(const dtSharedObstacleRef ref, const dtTileCache* tc) const
+{
+	const SharedObstacle* ob = getObstacleByRef(ref);
+	if (!ob)
+		return 0;
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		if (m_caches[i].tc == tc)
+			return ob->refs[i];
+	}
+	return 0;
+}
+
+const dtObstacleDesc* dtObstacleRegistry::getObstacleDesc(const dtSharedObstacleRef ref) const
+{
+	const SharedObstacle* ob = getObstacleByRef(ref);
+	return ob ? &ob->desc : 0;
+}
+
+dtStatus dtObstacleRegistry::update(const dtQueryClock* clock, const long long budget, bool* upToDate)
+{
+	const long long deadline = clock ? clock->getTicks() + budget : 0;
+
+	// Retry the changes that did not fit in some cache.
+	if (m_dirty)
+	{
+		m_dirty = false;
+		for (int i = 0; i < m_maxObstacles; ++i)
+		{
+			SharedObstacle* ob = &m_obstacles[i];
+			if (ob->state == SHARED_OBSTACLE_ACTIVE)
+			{
+				const bool added = addToCaches(ob);
+				if (!moveInCaches(ob) || !added)
+					m_dirty = true;
+			}
+			else if (ob->state == SHARED_OBSTACLE_REMOVING && !removeFromCaches(ob))
+				m_dirty = true;
+		}
+	}
+
+	// Caches are updated even when known to be up to date, they may have been changed directly.
+	bool cacheDone[DT_OBSTACLE_REGISTRY_MAX_CACHES];
+	int npending = 0;
+	int first = -1;
+	for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+	{
+		const int idx = (m_next + i) % DT_OBSTACLE_REGISTRY_MAX_CACHES;
+		cacheDone[idx] = m_caches[idx].tc == 0;
+		if (cacheDone[idx])
+			continue;
+		npending++;
+		if (first == -1)
+			first = idx;
+	}
+
+	dtStatus status = DT_SUCCESS;
+	if (first != -1)
+		m_next = (first + 1) % DT_OBSTACLE_REGISTRY_MAX_CACHES;
+
+	// Take turns one tile at a time, so every cache gets a share of the budget.
+	bool outOfTime = false;
+	while (npending > 0 && !outOfTime)
+	{
+		for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+		{
+			const int idx = (first + i) % DT_OBSTACLE_REGISTRY_MAX_CACHES;
+			if (cacheDone[idx])
+				continue;
+
+			CacheEntry& entry = m_caches[idx];
+			const dtStatus cacheStatus = entry.tc->update(0, entry.navmesh, &entry.upToDate);
+			if (dtStatusFailed(cacheStatus))
+				status = cacheStatus;
+			if (entry.upToDate)
+			{
+				cacheDone[idx] = true;
+				npending--;
+			}
+
+			if (clock && clock->getTicks() >= deadline)
+			{
+				outOfTime = true;
+				break;
+			}
+		}
+
+		// Without a clock each cache is updated once.
+		if (!clock)
+			break;
+	}
+
+	if (upToDate)
+	{
+		bool allUpToDate = !m_dirty;
+		for (int i = 0; i < DT_OBSTACLE_REGISTRY_MAX_CACHES; ++i)
+		{
+			if (m_caches[i].tc && !m_caches[i].upToDate)
+				allUpToDate = false;
+		}
+		*upToDate = allUpToDate;
+	}
+
+	return status;
+}
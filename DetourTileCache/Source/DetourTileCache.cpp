@@ -31,14 +31,81 @@ static bool contains(const dtCompressedTileRef* a, const int n, const dtCompress
 	return false;
 }
 
-inline int computeTileHash(int x, int y, const int mask)
+static void setObstacleShape(dtTileCacheObstacle* ob, const dtObstacleDesc* desc)
 {
-	const unsigned int h1 = 0x8da6b343; // Large multiplicative constants;
-	const unsigned int h2 = 0xd8163841; // here arbitrarily chosen primes
-	unsigned int n = h1 * x + h2 * y;
-	return (int)(n & mask);
+	ob->type = desc->type;
+	if (desc->type == DT_OBSTACLE_CYLINDER)
+		ob->cylinder = desc->cylinder;
+	else if (desc->type == DT_OBSTACLE_BOX)
+		ob->box = desc->box;
+	else if (desc->type == DT_OBSTACLE_ORIENTED_BOX)
+		ob->orientedBox = desc->orientedBox;
+	else
+		ob->prism = desc->prism;
+}
+
+static void getObstacleShape(const dtTileCacheObstacle* ob, dtObstacleDesc* desc)
+{
+	desc->type = ob->type;
+	if (ob->type == DT_OBSTACLE_CYLINDER)
+		desc->cylinder = ob->cylinder;
+	else if (ob->type == DT_OBSTACLE_BOX)
+		desc->box = ob->box;
+	else if (ob->type == DT_OBSTACLE_ORIENTED_BOX)
+		desc->orientedBox = ob->orientedBox;
+	else
+		desc->prism = ob->prism;
 }
 
+// Area id the obstacle marks its cells with.
+static unsigned char getObstacleArea(const dtObstacleDesc* desc)
+{
+	if (desc->type == DT_OBSTACLE_CYLINDER)
+		return (unsigned char)desc->cylinder.area;
+	if (desc->type == DT_OBSTACLE_BOX)
+		return (unsigned char)desc->box.area;
+	if (desc->type == DT_OBSTACLE_ORIENTED_BOX)
+		return (unsigned char)desc->orientedBox.area;
+	return (unsigned char)desc->prism.area;
+}
+
+// False if the shape is null or lies above or below every cell of the layer.
+static bool overlapsLayerHeights(const dtTileCacheLayerHeader* header, const float ch, const dtObstacleDesc* desc)
+{
+	if (!desc)
+		return false;
+	float bmin[3], bmax[3];
+	dtCalcObstacleBounds(desc, bmin, bmax);
+	// Same expression as the marking functions, layer heights are relative to the header bounds.
+	const float ich = 1.0f/ch;
+	const int miny = (int)dtMathFloorf((bmin[1]-header->bmin[1])*ich);
+	const int maxy = (int)dtMathFloorf((bmax[1]-header->bmin[1])*ich);
+	return maxy >= 0 && miny <= (int)header->hmax - (int)header->hmin;
+}
+
+static void markObstacle(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+						 const dtObstacleDesc* desc, const unsigned char areaId)
+{
+	if (desc->type == DT_OBSTACLE_CYLINDER)
+	{
+		dtMarkCylinderArea(layer, orig, cs, ch,
+						   desc->cylinder.pos, desc->cylinder.radius, desc->cylinder.height, areaId);
+	}
+	else if (desc->type == DT_OBSTACLE_BOX)
+	{
+		dtMarkBoxArea(layer, orig, cs, ch, desc->box.bmin, desc->box.bmax, areaId);
+	}
+	else if (desc->type == DT_OBSTACLE_ORIENTED_BOX)
+	{
+		dtMarkBoxArea(layer, orig, cs, ch,
+					  desc->orientedBox.center, desc->orientedBox.halfExtents, desc->orientedBox.rotAux, areaId);
+	}
+	else if (desc->type == DT_OBSTACLE_CONVEX_PRISM)
+	{
+		dtMarkConvexArea(layer, orig, cs, ch,
+						 desc->prism.verts, desc->prism.nverts, desc->prism.hmin, desc->prism.hmax, areaId);
+	}
+}
 
 struct NavMeshTileBuildContext
 {
@@ -61,11 +128,10 @@ struct NavMeshTileBuildContext
 
 
 dtTileCache::dtTileCache() :
-	m_tileLutSize(0),
-	m_tileLutMask(0),
-	m_posLookup(0),
 	m_nextFreeTile(0),	
 	m_tiles(0),	
+	m_tileDataSize(0),
+	m_memoryBudget(0),
 	m_saltBits(0),
 	m_tileBits(0),
 	m_talloc(0),
@@ -75,7 +141,8 @@ dtTileCache::dtTileCache() :
 	m_nextFreeObstacle(0),
 	m_nreqs(0),
 	m_nOffMeshReqs(0),
-	m_nupdate(0)
+	m_nupdate(0),
+	m_nskippedRebuilds(0)
 {
 	memset(&m_params, 0, sizeof(m_params));
 	memset(m_reqs, 0, sizeof(ObstacleRequest) * MAX_REQUESTS);
@@ -93,8 +160,6 @@ dtTileCache::~dtTileCache()
 	}
 	dtFree(m_obstacles);
 	m_obstacles = 0;
-	dtFree(m_posLookup);
-	m_posLookup = 0;
 	dtFree(m_tiles);
 	m_tiles = 0;
 	m_nreqs = 0;
@@ -156,18 +221,12 @@ dtStatus dtTileCache::init(const dtTileCacheParams* params,
 	}
 	
 	// Init tiles
-	m_tileLutSize = dtNextPow2(m_params.maxTiles/4);
-	if (!m_tileLutSize) m_tileLutSize = 1;
-	m_tileLutMask = m_tileLutSize-1;
-	
 	m_tiles = (dtCompressedTile*)dtAlloc(sizeof(dtCompressedTile)*m_params.maxTiles, DT_ALLOC_PERM);
 	if (!m_tiles)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	m_posLookup = (dtCompressedTile**)dtAlloc(sizeof(dtCompressedTile*)*m_tileLutSize, DT_ALLOC_PERM);
-	if (!m_posLookup)
+	if (!m_tileLookup.init(m_params.maxTiles))
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(m_tiles, 0, sizeof(dtCompressedTile)*m_params.maxTiles);
-	memset(m_posLookup, 0, sizeof(dtCompressedTile*)*m_tileLutSize);
 	m_nextFreeTile = 0;
 	for (int i = m_params.maxTiles-1; i >= 0; --i)
 	{
@@ -190,9 +249,9 @@ int dtTileCache::getTilesAt(const int tx, const int ty, dtCompressedTileRef* til
 {
 	int n = 0;
 	
-	// Find tile based on hash.
-	int h = computeTileHash(tx,ty,m_tileLutMask);
-	dtCompressedTile* tile = m_posLookup[h];
+	// Find tile based on the grid or hash.
+	dtCompressedTile** column = m_tileLookup.getColumn(tx, ty);
+	dtCompressedTile* tile = column ? *column : 0;
 	while (tile)
 	{
 		if (tile->header &&
@@ -210,9 +269,9 @@ int dtTileCache::getTilesAt(const int tx, const int ty, dtCompressedTileRef* til
 
 dtCompressedTile* dtTileCache::getTileAt(const int tx, const int ty, const int tlayer)
 {
-	// Find tile based on hash.
-	int h = computeTileHash(tx,ty,m_tileLutMask);
-	dtCompressedTile* tile = m_posLookup[h];
+	// Find tile based on the grid or hash.
+	dtCompressedTile** column = m_tileLookup.getColumn(tx, ty);
+	dtCompressedTile* tile = column ? *column : 0;
 	while (tile)
 	{
 		if (tile->header &&
@@ -281,6 +340,10 @@ dtStatus dtTileCache::addTile(unsigned char* data, const int dataSize, unsigned
 	if (getTileAt(header->tx, header->ty, header->tlayer))
 		return DT_FAILURE;
 	
+	// Make sure the tile fits in the memory budget.
+	if (m_memoryBudget && m_tileDataSize + (size_t)dataSize > m_memoryBudget)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	
 	// Allocate a tile.
 	dtCompressedTile* tile = 0;
 	if (m_nextFreeTile)
@@ -295,15 +358,17 @@ dtStatus dtTileCache::addTile(unsigned char* data, const int dataSize, unsigned
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	
 	// Insert tile into the position lut.
-	int h = computeTileHash(header->tx, header->ty, m_tileLutMask);
-	tile->next = m_posLookup[h];
-	m_posLookup[h] = tile;
+	m_tileLookup.grow(header->tx, header->ty);
+	dtCompressedTile** column = m_tileLookup.getColumn(header->tx, header->ty);
+	tile->next = *column;
+	*column = tile;
 	
 	// Init tile.
 	const int headerSize = dtAlign4(sizeof(dtTileCacheLayerHeader));
 	tile->header = (dtTileCacheLayerHeader*)data;
 	tile->data = data;
 	tile->dataSize = dataSize;
+	m_tileDataSize += (size_t)dataSize;
 	tile->compressed = tile->data + headerSize;
 	tile->compressedSize = tile->dataSize - headerSize;
 	tile->flags = flags;
@@ -326,10 +391,10 @@ dtStatus dtTileCache::removeTile(dtCompressedTileRef ref, unsigned char** data,
 	if (tile->salt != tileSalt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	// Remove tile from hash lookup.
-	const int h = computeTileHash(tile->header->tx,tile->header->ty,m_tileLutMask);
+	// Remove tile from the position lookup.
+	dtCompressedTile** column = m_tileLookup.getColumn(tile->header->tx, tile->header->ty);
 	dtCompressedTile* prev = 0;
-	dtCompressedTile* cur = m_posLookup[h];
+	dtCompressedTile* cur = column ? *column : 0;
 	while (cur)
 	{
 		if (cur == tile)
@@ -337,13 +402,15 @@ dtStatus dtTileCache::removeTile(dtCompressedTileRef ref, unsigned char** data,
 			if (prev)
 				prev->next = cur->next;
 			else
-				m_posLookup[h] = cur->next;
+				*column = cur->next;
 			break;
 		}
 		prev = cur;
 		cur = cur->next;
 	}
 	
+	m_tileDataSize -= (size_t)tile->dataSize;
+	
 	// Reset tile.
 	if (tile->flags & DT_COMPRESSEDTILE_FREE_DATA)
 	{
@@ -382,76 +449,63 @@ dtStatus dtTileCache::removeTile(dtCompressedTileRef ref, unsigned char** data,
 
 dtStatus dtTileCache::addObstacle(const float* pos, const float radius, const float height, const int area, dtObstacleRef* result)
 {
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
-
-	dtTileCacheObstacle* ob = 0;
-	if (m_nextFreeObstacle)
-	{
-		ob = m_nextFreeObstacle;
-		m_nextFreeObstacle = ob->next;
-		ob->next = 0;
-	}
-	if (!ob)
-		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	dtObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_CYLINDER;
+	dtVcopy(desc.cylinder.pos, pos);
+	desc.cylinder.radius = radius;
+	desc.cylinder.height = height;
+	desc.cylinder.area = area;
+	return addObstacle(&desc, 0, result);
+}
 
-	unsigned short salt = ob->salt;
-	memset(ob, 0, sizeof(dtTileCacheObstacle));
-	ob->salt = salt;
-	ob->state = DT_OBSTACLE_PROCESSING;
-	ob->type = DT_OBSTACLE_CYLINDER;
-	dtVcopy(ob->cylinder.pos, pos);
-	ob->cylinder.radius = radius;
-	ob->cylinder.height = height;
-	ob->cylinder.area = area;
+dtStatus dtTileCache::addBoxObstacle(const float* bmin, const float* bmax, dtObstacleRef* result)
+{
+	dtObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_BOX;
+	dtVcopy(desc.box.bmin, bmin);
+	dtVcopy(desc.box.bmax, bmax);
+	return addObstacle(&desc, 0, result);
+}
 
-	ObstacleRequest* req = &m_reqs[m_nreqs++];
-	memset(req, 0, sizeof(ObstacleRequest));
-	req->action = REQUEST_ADD;
-	req->ref = getObstacleRef(ob);
+dtStatus dtTileCache::addBoxObstacle(const float* center, const float* halfExtents, const float yRadians, dtObstacleRef* result)
+{
+	dtObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_ORIENTED_BOX;
+	dtVcopy(desc.orientedBox.center, center);
+	dtVcopy(desc.orientedBox.halfExtents, halfExtents);
 
-	if (result)
-		*result = req->ref;
+	float coshalf= cosf(0.5f*yRadians);
+	float sinhalf = sinf(-0.5f*yRadians);
+	desc.orientedBox.rotAux[0] = coshalf*sinhalf;
+	desc.orientedBox.rotAux[1] = coshalf*coshalf - 0.5f;
 
-	return DT_SUCCESS;
+	return addObstacle(&desc, 0, result);
 }
 
-dtStatus dtTileCache::addBoxObstacle(const float* bmin, const float* bmax, dtObstacleRef* result)
+dtStatus dtTileCache::addConvexObstacle(const float* verts, const int nverts, const float hmin, const float hmax,
+										const int area, dtObstacleRef* result)
 {
-	if (m_nreqs >= MAX_REQUESTS)
-		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
-	
-	dtTileCacheObstacle* ob = 0;
-	if (m_nextFreeObstacle)
-	{
-		ob = m_nextFreeObstacle;
-		m_nextFreeObstacle = ob->next;
-		ob->next = 0;
-	}
-	if (!ob)
-		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	
-	unsigned short salt = ob->salt;
-	memset(ob, 0, sizeof(dtTileCacheObstacle));
-	ob->salt = salt;
-	ob->state = DT_OBSTACLE_PROCESSING;
-	ob->type = DT_OBSTACLE_BOX;
-	dtVcopy(ob->box.bmin, bmin);
-	dtVcopy(ob->box.bmax, bmax);
-	
-	ObstacleRequest* req = &m_reqs[m_nreqs++];
-	memset(req, 0, sizeof(ObstacleRequest));
-	req->action = REQUEST_ADD;
-	req->ref = getObstacleRef(ob);
-	
-	if (result)
-		*result = req->ref;
-	
-	return DT_SUCCESS;
+	if (!verts || nverts < 3 || nverts > DT_MAX_PRISM_VERTS)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	dtObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_CONVEX_PRISM;
+	memcpy(desc.prism.verts, verts, sizeof(float)*3*nverts);
+	desc.prism.nverts = nverts;
+	desc.prism.hmin = hmin;
+	desc.prism.hmax = hmax;
+	desc.prism.area = area;
+	return addObstacle(&desc, 0, result);
 }
 
-dtStatus dtTileCache::addBoxObstacle(const float* center, const float* halfExtents, const float yRadians, dtObstacleRef* result)
+dtStatus dtTileCache::addObstacle(const dtObstacleDesc* desc, const dtTileCacheFootprint* footprint, dtObstacleRef* result)
 {
+	if (!dtIsObstacleDescValid(desc))
+		return DT_FAILURE | DT_INVALID_PARAM;
 	if (m_nreqs >= MAX_REQUESTS)
 		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
 
@@ -469,19 +523,17 @@ dtStatus dtTileCache::addBoxObstacle(const float* center, const float* halfExten
 	memset(ob, 0, sizeof(dtTileCacheObstacle));
 	ob->salt = salt;
 	ob->state = DT_OBSTACLE_PROCESSING;
-	ob->type = DT_OBSTACLE_ORIENTED_BOX;
-	dtVcopy(ob->orientedBox.center, center);
-	dtVcopy(ob->orientedBox.halfExtents, halfExtents);
-
-	float coshalf= cosf(0.5f*yRadians);
-	float sinhalf = sinf(-0.5f*yRadians);
-	ob->orientedBox.rotAux[0] = coshalf*sinhalf;
-	ob->orientedBox.rotAux[1] = coshalf*coshalf - 0.5f;
+	setObstacleShape(ob, desc);
 
 	ObstacleRequest* req = &m_reqs[m_nreqs++];
 	memset(req, 0, sizeof(ObstacleRequest));
 	req->action = REQUEST_ADD;
 	req->ref = getObstacleRef(ob);
+	if (footprint)
+	{
+		req->footprint = *footprint;
+		req->hasFootprint = true;
+	}
 
 	if (result)
 		*result = req->ref;
@@ -504,6 +556,53 @@ dtStatus dtTileCache::removeObstacle(const dtObstacleRef ref)
 	return DT_SUCCESS;
 }
 
+dtStatus dtTileCache::moveObstacle(const dtObstacleRef ref, const dtObstacleDesc* desc)
+{
+	if (!dtIsObstacleDescValid(desc))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const unsigned int idx = decodeObstacleIdObstacle(ref);
+	if (!ref || (int)idx >= m_params.maxObstacles)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	dtTileCacheObstacle* ob = &m_obstacles[idx];
+	if (ob->salt != decodeObstacleIdSalt(ref) ||
+		ob->state == DT_OBSTACLE_EMPTY || ob->state == DT_OBSTACLE_REMOVING)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Fold the move into the latest request for the obstacle that has not been processed yet.
+	for (int i = m_nreqs-1; i >= 0; --i)
+	{
+		ObstacleRequest* req = &m_reqs[i];
+		if (req->ref != ref)
+			continue;
+		if (req->action == REQUEST_REMOVE)
+			return DT_FAILURE | DT_INVALID_PARAM;
+		if (req->action == REQUEST_MOVE)
+		{
+			req->desc = *desc;
+			return DT_SUCCESS;
+		}
+		if (req->action == REQUEST_ADD)
+		{
+			// Not marked in any tile yet, the add picks up the new shape.
+			setObstacleShape(ob, desc);
+			req->hasFootprint = false;
+			return DT_SUCCESS;
+		}
+	}
+
+	if (m_nreqs >= MAX_REQUESTS)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+
+	ObstacleRequest* req = &m_reqs[m_nreqs++];
+	memset(req, 0, sizeof(ObstacleRequest));
+	req->action = REQUEST_MOVE;
+	req->ref = ref;
+	req->desc = *desc;
+
+	return DT_SUCCESS;
+}
+
 dtStatus dtTileCache::addOffMeshConnection(const float* spos, const float* epos, const float radius, const unsigned char area, const unsigned int flags, const bool bBiDirectional, dtOffMeshConnectionRef* result)
 {
 	if (m_nOffMeshReqs >= MAX_REQUESTS)
@@ -543,24 +642,43 @@ dtStatus dtTileCache::addOffMeshConnection(const float* spos, const float* epos,
 	return DT_SUCCESS;
 }
 
+void dtTileCache::calcFootprint(const float* bmin, const float* bmax, dtTileCacheFootprint* footprint) const
+{
+	const float tw = m_params.width * m_params.cs;
+	const float th = m_params.height * m_params.cs;
+	footprint->tx0 = (int)dtMathFloorf((bmin[0]-m_params.orig[0]) / tw);
+	footprint->tx1 = (int)dtMathFloorf((bmax[0]-m_params.orig[0]) / tw);
+	footprint->ty0 = (int)dtMathFloorf((bmin[2]-m_params.orig[2]) / th);
+	footprint->ty1 = (int)dtMathFloorf((bmax[2]-m_params.orig[2]) / th);
+}
+
+bool dtTileCache::hasSameTileGrid(const dtTileCache* other) const
+{
+	const dtTileCacheParams& op = other->m_params;
+	return m_params.orig[0] == op.orig[0] && m_params.orig[2] == op.orig[2] &&
+		m_params.width * m_params.cs == op.width * op.cs &&
+		m_params.height * m_params.cs == op.height * op.cs;
+}
+
 dtStatus dtTileCache::queryTiles(const float* bmin, const float* bmax,
 								 dtCompressedTileRef* results, int* resultCount, const int maxResults) const 
+{
+	dtTileCacheFootprint footprint;
+	calcFootprint(bmin, bmax, &footprint);
+	return queryFootprintTiles(footprint, bmin, bmax, results, resultCount, maxResults);
+}
+
+dtStatus dtTileCache::queryFootprintTiles(const dtTileCacheFootprint& footprint, const float* bmin, const float* bmax,
+										  dtCompressedTileRef* results, int* resultCount, const int maxResults) const
 {
 	const int MAX_TILES = 32;
 	dtCompressedTileRef tiles[MAX_TILES];
 	
 	int n = 0;
 	
-	const float tw = m_params.width * m_params.cs;
-	const float th = m_params.height * m_params.cs;
-	const int tx0 = (int)dtMathFloorf((bmin[0]-m_params.orig[0]) / tw);
-	const int tx1 = (int)dtMathFloorf((bmax[0]-m_params.orig[0]) / tw);
-	const int ty0 = (int)dtMathFloorf((bmin[2]-m_params.orig[2]) / th);
-	const int ty1 = (int)dtMathFloorf((bmax[2]-m_params.orig[2]) / th);
-	
-	for (int ty = ty0; ty <= ty1; ++ty)
+	for (int ty = footprint.ty0; ty <= footprint.ty1; ++ty)
 	{
-		for (int tx = tx0; tx <= tx1; ++tx)
+		for (int tx = footprint.tx0; tx <= footprint.tx1; ++tx)
 		{
 			const int ntiles = getTilesAt(tx,ty,tiles,MAX_TILES);
 			
@@ -587,9 +705,11 @@ dtStatus dtTileCache::queryTiles(const float* bmin, const float* bmax,
 dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 							 bool* upToDate)
 {
+	bool processedRequests = false;
 	if (m_nupdate == 0)
 	{
 		// Process requests.
+		processedRequests = m_nreqs > 0;
 		for (int i = 0; i < m_nreqs; ++i)
 		{
 			ObstacleRequest* req = &m_reqs[i];
@@ -609,12 +729,22 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 				getObstacleBounds(ob, bmin, bmax);
 
 				int ntouched = 0;
-				queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
+				if (req->hasFootprint)
+					queryFootprintTiles(req->footprint, bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
+				else
+					queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
 				ob->ntouched = (unsigned char)ntouched;
-				// Add tiles to update list.
+				// Add tiles to update list, unless the obstacle marks none of their walkable cells.
+				dtObstacleDesc shape;
+				getObstacleShape(ob, &shape);
 				ob->npending = 0;
 				for (int j = 0; j < ob->ntouched; ++j)
 				{
+					if (!obstacleMarksDiffer(ob->touched[j], 0, &shape))
+					{
+						m_nskippedRebuilds++;
+						continue;
+					}
 					if (m_nupdate < MAX_UPDATE)
 					{
 						if (!contains(m_update, m_nupdate, ob->touched[j]))
@@ -623,14 +753,66 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 					}
 				}
 			}
+			else if (req->action == REQUEST_MOVE)
+			{
+				if (ob->state == DT_OBSTACLE_REMOVING)
+					continue;
+
+				dtObstacleDesc oldShape;
+				getObstacleShape(ob, &oldShape);
+				dtCompressedTileRef oldTouched[DT_MAX_TOUCHED_TILES];
+				const int noldTouched = (int)ob->ntouched;
+				memcpy(oldTouched, ob->touched, sizeof(dtCompressedTileRef)*noldTouched);
+
+				// Find touched tiles of the new shape.
+				setObstacleShape(ob, &req->desc);
+				float bmin[3], bmax[3];
+				getObstacleBounds(ob, bmin, bmax);
+				int ntouched = 0;
+				queryTiles(bmin, bmax, ob->touched, &ntouched, DT_MAX_TOUCHED_TILES);
+				ob->ntouched = (unsigned char)ntouched;
+				ob->state = DT_OBSTACLE_PROCESSING;
+
+				// Add the tiles under either shape to the update list, unless the
+				// obstacle marks the same cells in them as before.
+				ob->npending = 0;
+				for (int j = 0; j < noldTouched + ntouched; ++j)
+				{
+					const bool isOld = j < noldTouched;
+					const dtCompressedTileRef tileRef = isOld ? oldTouched[j] : ob->touched[j - noldTouched];
+					const bool inOld = isOld || contains(oldTouched, noldTouched, tileRef);
+					const bool inNew = !isOld || contains(ob->touched, ntouched, tileRef);
+					if (!isOld && inOld)
+						continue;
+					if (!obstacleMarksDiffer(tileRef, inOld ? &oldShape : 0, inNew ? &req->desc : 0))
+					{
+						m_nskippedRebuilds++;
+						continue;
+					}
+					if (m_nupdate < MAX_UPDATE)
+					{
+						if (!contains(m_update, m_nupdate, tileRef))
+							m_update[m_nupdate++] = tileRef;
+						if (ob->npending < DT_MAX_TOUCHED_TILES)
+							ob->pending[ob->npending++] = tileRef;
+					}
+				}
+			}
 			else if (req->action == REQUEST_REMOVE)
 			{
 				// Prepare to remove obstacle.
 				ob->state = DT_OBSTACLE_REMOVING;
-				// Add tiles to update list.
+				// Add tiles to update list, unless the obstacle marks none of their walkable cells.
+				dtObstacleDesc shape;
+				getObstacleShape(ob, &shape);
 				ob->npending = 0;
 				for (int j = 0; j < ob->ntouched; ++j)
 				{
+					if (!obstacleMarksDiffer(ob->touched[j], 0, &shape))
+					{
+						m_nskippedRebuilds++;
+						continue;
+					}
 					if (m_nupdate < MAX_UPDATE)
 					{
 						if (!contains(m_update, m_nupdate, ob->touched[j]))
@@ -735,17 +917,21 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 	}
 	
 	dtStatus status = DT_SUCCESS;
+	dtCompressedTileRef ref = 0;
 	// Process updates
 	if (m_nupdate)
 	{
 		// Build mesh
-		const dtCompressedTileRef ref = m_update[0];
+		ref = m_update[0];
 		status = buildNavMeshTile(ref, navmesh);
 		m_nupdate--;
 		if (m_nupdate > 0)
 			memmove(m_update, m_update+1, m_nupdate*sizeof(dtCompressedTileRef));
+	}
 
-		// Update obstacle states.
+	// Update obstacle states. Obstacles with no tile left to rebuild settle right away.
+	if (ref || processedRequests)
+	{
 		for (int i = 0; i < m_params.maxObstacles; ++i)
 		{
 			dtTileCacheObstacle* ob = &m_obstacles[i];
@@ -839,6 +1025,42 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	dtAssert(m_talloc);
 	dtAssert(m_tcomp);
 	
+	unsigned char* navData = 0;
+	int navDataSize = 0;
+	dtStatus status = buildNavMeshTileData(ref, m_talloc, m_tcomp, &navData, &navDataSize);
+	if (dtStatusFailed(status))
+		return status;
+	
+	// Replace the existing tile, so that references to its polygons can be remapped.
+	if (navData)
+	{
+		// Let the navmesh own the data.
+		status = navmesh->replaceTile(navData,navDataSize,DT_TILE_FREE_DATA,0);
+		if (dtStatusFailed(status))
+		{
+			dtFree(navData);
+			return status;
+		}
+	}
+	else
+	{
+		// Leave the location empty.
+		const dtCompressedTile* tile = getTileByRef(ref);
+		navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
+	}
+	
+	return DT_SUCCESS;
+}
+
+dtStatus dtTileCache::buildNavMeshTileData(const dtCompressedTileRef ref, dtTileCacheAlloc* talloc, dtTileCacheCompressor* tcomp,
+										   unsigned char** outData, int* outDataSize)
+{
+	dtAssert(talloc);
+	dtAssert(tcomp);
+	
+	*outData = 0;
+	*outDataSize = 0;
+	
 	unsigned int idx = decodeTileIdTile(ref);
 	if (idx > (unsigned int)m_params.maxTiles)
 		return DT_FAILURE | DT_INVALID_PARAM;
@@ -847,14 +1069,14 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	if (tile->salt != salt)
 		return DT_FAILURE | DT_INVALID_PARAM;
 	
-	m_talloc->reset();
+	talloc->reset();
 	
-	NavMeshTileBuildContext bc(m_talloc);
+	NavMeshTileBuildContext bc(talloc);
 	const int walkableClimbVx = (int)(m_params.walkableClimb / m_params.ch);
 	dtStatus status;
 	
 	// Decompress tile layer data. 
-	status = dtDecompressTileCacheLayer(m_talloc, m_tcomp, tile->data, tile->dataSize, &bc.layer);
+	status = dtDecompressTileCacheLayer(talloc, tcomp, tile->data, tile->dataSize, &bc.layer);
 	if (dtStatusFailed(status))
 		return status;
 	
@@ -866,51 +1088,35 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 			continue;
 		if (contains(ob->touched, ob->ntouched, ref))
 		{
-			if (ob->type == DT_OBSTACLE_CYLINDER)
-			{
-				dtMarkCylinderArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
-							    ob->cylinder.pos, ob->cylinder.radius, ob->cylinder.height, ob->cylinder.area);
-			}
-			else if (ob->type == DT_OBSTACLE_BOX)
-			{
-				dtMarkBoxArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
-					ob->box.bmin, ob->box.bmax, 0);
-			}
-			else if (ob->type == DT_OBSTACLE_ORIENTED_BOX)
-			{
-				dtMarkBoxArea(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch,
-					ob->orientedBox.center, ob->orientedBox.halfExtents, ob->orientedBox.rotAux, 0);
-			}
+			dtObstacleDesc desc;
+			getObstacleShape(ob, &desc);
+			markObstacle(*bc.layer, tile->header->bmin, m_params.cs, m_params.ch, &desc, getObstacleArea(&desc));
 		}
 	}
 	
 	// Build navmesh
-	status = dtBuildTileCacheRegions(m_talloc, *bc.layer, walkableClimbVx);
+	status = dtBuildTileCacheRegions(talloc, *bc.layer, walkableClimbVx);
 	if (dtStatusFailed(status))
 		return status;
 	
-	bc.lcset = dtAllocTileCacheContourSet(m_talloc);
+	bc.lcset = dtAllocTileCacheContourSet(talloc);
 	if (!bc.lcset)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	status = dtBuildTileCacheContours(m_talloc, *bc.layer, walkableClimbVx,
+	status = dtBuildTileCacheContours(talloc, *bc.layer, walkableClimbVx,
 									  m_params.maxSimplificationError, *bc.lcset);
 	if (dtStatusFailed(status))
 		return status;
 	
-	bc.lmesh = dtAllocTileCachePolyMesh(m_talloc);
+	bc.lmesh = dtAllocTileCachePolyMesh(talloc);
 	if (!bc.lmesh)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
-	status = dtBuildTileCachePolyMesh(m_talloc, *bc.lcset, *bc.lmesh);
+	status = dtBuildTileCachePolyMesh(talloc, *bc.lcset, *bc.lmesh);
 	if (dtStatusFailed(status))
 		return status;
 	
 	// Early out if the mesh tile is empty.
 	if (!bc.lmesh->npolys)
-	{
-		// Remove existing tile.
-		navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
 		return DT_SUCCESS;
-	}
 	
 	dtNavMeshCreateParams params;
 	memset(&params, 0, sizeof(params));
@@ -941,25 +1147,8 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	params.GlobalOffMeshConnections = m_offMeshConnections;
 	params.NumOffMeshConnections = getOffMeshCount();
 	
-	unsigned char* navData = 0;
-	int navDataSize = 0;
-	if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+	if (!dtCreateNavMeshData(&params, outData, outDataSize))
 		return DT_FAILURE;
-
-	// Remove existing tile.
-	navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
-
-	// Add new tile, or leave the location empty.
-	if (navData)
-	{
-		// Let the navmesh own the data.
-		status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
-		if (dtStatusFailed(status))
-		{
-			dtFree(navData);
-			return status;
-		}
-	}
 	
 	return DT_SUCCESS;
 }
@@ -975,11 +1164,81 @@ void dtTileCache::calcTightTileBounds(const dtTileCacheLayerHeader* header, floa
 	bmax[2] = header->bmin[2] + (header->maxy+1)*cs;
 }
 
+bool dtTileCache::obstacleMarksDiffer(const dtCompressedTileRef ref, const dtObstacleDesc* a, const dtObstacleDesc* b)
+{
+	dtAssert(m_talloc);
+	dtAssert(m_tcomp);
+
+	if (a && b && getObstacleArea(a) != getObstacleArea(b))
+		return true;
+
+	const dtCompressedTile* tile = getTileByRef(ref);
+	if (!tile || !tile->header)
+		return true;
+
+	// The header is enough to rule out shapes outside the height range of the layer.
+	if (!overlapsLayerHeights(tile->header, m_params.ch, a) && !overlapsLayerHeights(tile->header, m_params.ch, b))
+		return false;
+
+	m_talloc->reset();
+
+	dtTileCacheLayer* layer = 0;
+	if (dtStatusFailed(dtDecompressTileCacheLayer(m_talloc, m_tcomp, tile->data, tile->dataSize, &layer)))
+		return true;
+
+	// Rasterize both shapes into masks with the same functions the tile build uses.
+	const int ncells = (int)layer->header->width * (int)layer->header->height;
+	unsigned char* marks = (unsigned char*)m_talloc->alloc(ncells*2);
+	if (!marks)
+	{
+		dtFreeTileCacheLayer(m_talloc, layer);
+		return true;
+	}
+	memset(marks, 0, ncells*2);
+
+	unsigned char* areas = layer->areas;
+	layer->areas = marks;
+	if (a)
+		markObstacle(*layer, tile->header->bmin, m_params.cs, m_params.ch, a, 1);
+	layer->areas = marks + ncells;
+	if (b)
+		markObstacle(*layer, tile->header->bmin, m_params.cs, m_params.ch, b, 1);
+	layer->areas = areas;
+
+	// Only walkable cells matter to the build.
+	bool differ = false;
+	for (int i = 0; i < ncells && !differ; ++i)
+	{
+		if (areas[i] != DT_TILECACHE_NULL_AREA && marks[i] != marks[ncells + i])
+			differ = true;
+	}
+
+	m_talloc->free(marks);
+	dtFreeTileCacheLayer(m_talloc, layer);
+	return differ;
+}
+
 void dtTileCache::getObstacleBounds(const struct dtTileCacheObstacle* ob, float* bmin, float* bmax) const
 {
-	if (ob->type == DT_OBSTACLE_CYLINDER)
+	dtObstacleDesc desc;
+	getObstacleShape(ob, &desc);
+	dtCalcObstacleBounds(&desc, bmin, bmax);
+}
+
+bool dtIsObstacleDescValid(const dtObstacleDesc* desc)
+{
+	if (!desc || desc->type > DT_OBSTACLE_CONVEX_PRISM)
+		return false;
+	if (desc->type == DT_OBSTACLE_CONVEX_PRISM)
+		return desc->prism.nverts >= 3 && desc->prism.nverts <= DT_MAX_PRISM_VERTS;
+	return true;
+}
+
+void dtCalcObstacleBounds(const dtObstacleDesc* desc, float* bmin, float* bmax)
+{
+	if (desc->type == DT_OBSTACLE_CYLINDER)
 	{
-		const dtObstacleCylinder &cl = ob->cylinder;
+		const dtObstacleCylinder &cl = desc->cylinder;
 
 		bmin[0] = cl.pos[0] - cl.radius;
 		bmin[1] = cl.pos[1];
@@ -988,14 +1247,14 @@ void dtTileCache::getObstacleBounds(const struct dtTileCacheObstacle* ob, float*
 		bmax[1] = cl.pos[1] + cl.height;
 		bmax[2] = cl.pos[2] + cl.radius;
 	}
-	else if (ob->type == DT_OBSTACLE_BOX)
+	else if (desc->type == DT_OBSTACLE_BOX)
 	{
-		dtVcopy(bmin, ob->box.bmin);
-		dtVcopy(bmax, ob->box.bmax);
+		dtVcopy(bmin, desc->box.bmin);
+		dtVcopy(bmax, desc->box.bmax);
 	}
-	else if (ob->type == DT_OBSTACLE_ORIENTED_BOX)
+	else if (desc->type == DT_OBSTACLE_ORIENTED_BOX)
 	{
-		const dtObstacleOrientedBox &orientedBox = ob->orientedBox;
+		const dtObstacleOrientedBox &orientedBox = desc->orientedBox;
 
 		float maxr = 1.41f*dtMax(orientedBox.halfExtents[0], orientedBox.halfExtents[2]);
 		bmin[0] = orientedBox.center[0] - maxr;
@@ -1005,6 +1264,32 @@ void dtTileCache::getObstacleBounds(const struct dtTileCacheObstacle* ob, float*
 		bmin[2] = orientedBox.center[2] - maxr;
 		bmax[2] = orientedBox.center[2] + maxr;
 	}
+	else if (desc->type == DT_OBSTACLE_CONVEX_PRISM)
+	{
+		const dtObstacleConvexPrism &prism = desc->prism;
+
+		dtVcopy(bmin, prism.verts);
+		dtVcopy(bmax, prism.verts);
+		for (int i = 1; i < prism.nverts; ++i)
+		{
+			dtVmin(bmin, &prism.verts[i*3]);
+			dtVmax(bmax, &prism.verts[i*3]);
+		}
+		bmin[1] = prism.hmin;
+		bmax[1] = prism.hmax;
+	}
+}
+
+void dtTileCache::getMemoryUsage(dtTileCacheMemoryUsage* usage) const
+{
+	dtAssert(usage);
+	usage->tileTable = sizeof(dtTileCache) +
+		sizeof(dtCompressedTile)*m_params.maxTiles +
+		m_tileLookup.getMemoryUsage();
+	usage->compressedLayers = m_tileDataSize;
+	usage->obstacles = sizeof(dtTileCacheObstacle)*m_params.maxObstacles;
+	usage->offMeshCons = sizeof(dtOffMeshConnection)*m_params.maxOffMeshConnections;
+	usage->total = usage->tileTable + usage->compressedLayers + usage->obstacles + usage->offMeshCons;
 }
 
 dtStatus dtTileCache::removeOffMeshConnection(const dtOffMeshConnectionRef ref)
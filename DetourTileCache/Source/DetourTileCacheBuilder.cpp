@@ -23,6 +23,11 @@
 #include "DetourTileCacheBuilder.h"
 #include <string.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DT_TILECACHE_SSE2
+#include <emmintrin.h>
+#endif
+
 dtTileCacheAlloc::~dtTileCacheAlloc()
 {
 	// Defined out of line to fix the weak v-tables warning
@@ -114,6 +119,7 @@ struct dtLayerSweepSpan
 };
 
 static const int DT_LAYER_MAX_NEIS = 16;
+static const int DT_LAYER_MAX_ROW_WORDS = (255+31)/32;	// Bitmask words for the widest layer row.
 
 struct dtLayerMonotoneRegion
 {
@@ -157,14 +163,6 @@ static void addUniqueLast(unsigned char* a, unsigned char& an, unsigned char v)
 	an++;
 }
 
-inline bool isConnected(const dtTileCacheLayer& layer,
-						const int ia, const int ib, const int walkableClimb)
-{
-	if (layer.areas[ia] != layer.areas[ib]) return false;
-	if (dtAbs((int)layer.heights[ia] - (int)layer.heights[ib]) > walkableClimb) return false;
-	return true;
-}
-
 static bool canMerge(unsigned char oldRegId, unsigned char newRegId, const dtLayerMonotoneRegion* regs, const int nregs)
 {
 	int count = 0;
@@ -183,6 +181,89 @@ static bool canMerge(unsigned char oldRegId, unsigned char newRegId, const dtLay
 }
 
 
+// Index of the lowest set bit, v must not be zero.
+inline int lowestBit(const unsigned int v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctz(v);
+#else
+	static const int debruijn[32] = {
+		0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+		31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+	};
+	return debruijn[((v & (0u - v)) * 0x077CB531u) >> 27];
+#endif
+}
+
+#ifdef DT_TILECACHE_SSE2
+// Lanes where |a-b| <= climb, as 0xff bytes.
+inline __m128i heightsConnected(const __m128i a, const __m128i b, const __m128i climb)
+{
+	const __m128i d = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+	return _mm_cmpeq_epi8(_mm_subs_epu8(d, climb), _mm_setzero_si128());
+}
+#endif
+
+// Packs the walkable cells of row y into bitmasks, along with which of them are
+// connected to their -x and -y neighbours. Bit x of word x/32 belongs to cell x.
+static void buildRowMasks(const dtTileCacheLayer& layer, const int y, const int walkableClimb,
+						  unsigned int* walk, unsigned int* xcon, unsigned int* ycon)
+{
+	const int w = (int)layer.header->width;
+	const int nwords = (w+31)/32;
+	memset(walk, 0, sizeof(unsigned int)*nwords);
+	memset(xcon, 0, sizeof(unsigned int)*nwords);
+	memset(ycon, 0, sizeof(unsigned int)*nwords);
+	
+	const unsigned char* areas = &layer.areas[y*w];
+	const unsigned char* heights = &layer.heights[y*w];
+	
+	// The row above is only read when there is one, point it at this row otherwise and mask the result.
+	const unsigned char* pareas = y > 0 ? areas - w : areas;
+	const unsigned char* pheights = y > 0 ? heights - w : heights;
+	
+	int x0 = 0;
+#ifdef DT_TILECACHE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i climb = _mm_set1_epi8((char)(unsigned char)dtClamp(walkableClimb, 0, 255));
+	for (; x0 + 16 <= w; x0 += 16)
+	{
+		const __m128i a = _mm_loadu_si128((const __m128i*)(areas + x0));
+		const __m128i ha = _mm_loadu_si128((const __m128i*)(heights + x0));
+		const __m128i ax = x0 > 0 ? _mm_loadu_si128((const __m128i*)(areas + x0 - 1)) : _mm_slli_si128(a, 1);
+		const __m128i hx = x0 > 0 ? _mm_loadu_si128((const __m128i*)(heights + x0 - 1)) : _mm_slli_si128(ha, 1);
+		const __m128i ay = _mm_loadu_si128((const __m128i*)(pareas + x0));
+		const __m128i hy = _mm_loadu_si128((const __m128i*)(pheights + x0));
+		
+		const unsigned int wm = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)) & 0xffff;
+		const unsigned int xm = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, ax), heightsConnected(ha, hx, climb)));
+		const unsigned int ym = (unsigned int)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, ay), heightsConnected(ha, hy, climb)));
+		
+		const int shift = x0 & 31;
+		walk[x0>>5] |= wm << shift;
+		xcon[x0>>5] |= xm << shift;
+		ycon[x0>>5] |= ym << shift;
+	}
+#endif
+	for (int x = x0; x < w; ++x)
+	{
+		const int px = x > 0 ? x-1 : x;
+		const bool xc = areas[x] == areas[px] && dtAbs((int)heights[x] - (int)heights[px]) <= walkableClimb;
+		const bool yc = areas[x] == pareas[x] && dtAbs((int)heights[x] - (int)pheights[x]) <= walkableClimb;
+		walk[x>>5] |= (unsigned int)(areas[x] != DT_TILECACHE_NULL_AREA) << (x&31);
+		xcon[x>>5] |= (unsigned int)xc << (x&31);
+		ycon[x>>5] |= (unsigned int)yc << (x&31);
+	}
+	
+	// A connected neighbour shares the area, so it is walkable as well.
+	xcon[0] &= ~1u;
+	for (int i = 0; i < nwords; ++i)
+	{
+		xcon[i] &= walk[i];
+		ycon[i] &= y > 0 ? walk[i] : 0;
+	}
+}
+
 dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 								 dtTileCacheLayer& layer,
 								 const int walkableClimb)
@@ -200,6 +281,18 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(sweeps,0,sizeof(dtLayerSweepSpan)*nsweeps);
 	
+	// Regions are collected while sweeping, so allocate for the most ids the sweep can hand out.
+	dtFixedArray<dtLayerMonotoneRegion> regs(alloc, 256);
+	if (!regs)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(regs, 0, sizeof(dtLayerMonotoneRegion)*256);
+	
+	// Connectivity of the current row, packed into bits so that only walkable cells are visited.
+	const int nwords = (w+31)/32;
+	unsigned int walk[DT_LAYER_MAX_ROW_WORDS];
+	unsigned int xcon[DT_LAYER_MAX_ROW_WORDS];
+	unsigned int ycon[DT_LAYER_MAX_ROW_WORDS];
+	
 	// Partition walkable area into monotone regions.
 	unsigned char prevCount[256];
 	unsigned char regId = 0;
@@ -210,35 +303,34 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 			memset(prevCount,0,sizeof(unsigned char)*regId);
 		unsigned char sweepId = 0;
 		
-		for (int x = 0; x < w; ++x)
+		buildRowMasks(layer, y, walkableClimb, walk, xcon, ycon);
+		
+		for (int i = 0; i < nwords; ++i)
 		{
-			const int idx = x + y*w;
-			if (layer.areas[idx] == DT_TILECACHE_NULL_AREA) continue;
-			
-			unsigned char sid = 0xff;
-			
-			// -x
-			const int xidx = (x-1)+y*w;
-			if (x > 0 && isConnected(layer, idx, xidx, walkableClimb))
-			{
-				if (layer.regs[xidx] != 0xff)
-					sid = layer.regs[xidx];
-			}
-			
-			if (sid == 0xff)
+			for (unsigned int bits = walk[i]; bits; bits &= bits-1)
 			{
-				sid = sweepId++;
-				sweeps[sid].nei = 0xff;
-				sweeps[sid].ns = 0;
-			}
-			
-			// -y
-			const int yidx = x+(y-1)*w;
-			if (y > 0 && isConnected(layer, idx, yidx, walkableClimb))
-			{
-				const unsigned char nr = layer.regs[yidx];
-				if (nr != 0xff)
+				const int bit = lowestBit(bits);
+				const unsigned int mask = 1u << bit;
+				const int idx = i*32 + bit + y*w;
+				
+				// -x, continue the sweep of the connected neighbour or start a new one.
+				unsigned char sid;
+				if (xcon[i] & mask)
 				{
+					sid = layer.regs[idx-1];
+				}
+				else
+				{
+					sid = sweepId++;
+					sweeps[sid].nei = 0xff;
+					sweeps[sid].ns = 0;
+				}
+				
+				// -y
+				if (ycon[i] & mask)
+				{
+					const unsigned char nr = layer.regs[idx-w];
+					
 					// Set neighbour when first valid neighbour is encoutered.
 					if (sweeps[sid].ns == 0)
 						sweeps[sid].nei = nr;
@@ -256,9 +348,9 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 						sweeps[sid].nei = 0xff;
 					}
 				}
+				
+				layer.regs[idx] = sid;
 			}
-			
-			layer.regs[idx] = sid;
 		}
 		
 		// Create unique ID.
@@ -281,53 +373,37 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 			}
 		}
 		
-		// Remap local sweep ids to region ids.
-		for (int x = 0; x < w; ++x)
+		// Remap local sweep ids to region ids. The row above is final by now,
+		// so region areas and neighbours are gathered in the same pass.
+		for (int i = 0; i < nwords; ++i)
 		{
-			const int idx = x+y*w;
-			if (layer.regs[idx] != 0xff)
-				layer.regs[idx] = sweeps[layer.regs[idx]].id;
-		}
-	}
-	
-	// Allocate and init layer regions.
-	const int nregs = (int)regId;
-	dtFixedArray<dtLayerMonotoneRegion> regs(alloc, nregs);
-	if (!regs)
-		return DT_FAILURE | DT_OUT_OF_MEMORY;
-
-	memset(regs, 0, sizeof(dtLayerMonotoneRegion)*nregs);
-	for (int i = 0; i < nregs; ++i)
-		regs[i].regId = 0xff;
-	
-	// Find region neighbours.
-	for (int y = 0; y < h; ++y)
-	{
-		for (int x = 0; x < w; ++x)
-		{
-			const int idx = x+y*w;
-			const unsigned char ri = layer.regs[idx];
-			if (ri == 0xff)
-				continue;
-			
-			// Update area.
-			regs[ri].area++;
-			regs[ri].areaId = layer.areas[idx];
-			
-			// Update neighbours
-			const int ymi = x+(y-1)*w;
-			if (y > 0 && isConnected(layer, idx, ymi, walkableClimb))
+			for (unsigned int bits = walk[i]; bits; bits &= bits-1)
 			{
-				const unsigned char rai = layer.regs[ymi];
-				if (rai != 0xff && rai != ri)
+				const int bit = lowestBit(bits);
+				const int idx = i*32 + bit + y*w;
+				const unsigned char ri = sweeps[layer.regs[idx]].id;
+				layer.regs[idx] = ri;
+				
+				// Update area.
+				regs[ri].area++;
+				regs[ri].areaId = layer.areas[idx];
+				
+				// Update neighbours
+				if (ycon[i] & (1u << bit))
 				{
-					addUniqueLast(regs[ri].neis, regs[ri].nneis, rai);
-					addUniqueLast(regs[rai].neis, regs[rai].nneis, ri);
+					const unsigned char rai = layer.regs[idx-w];
+					if (rai != ri)
+					{
+						addUniqueLast(regs[ri].neis, regs[ri].nneis, rai);
+						addUniqueLast(regs[rai].neis, regs[rai].nneis, ri);
+					}
 				}
 			}
 		}
 	}
 	
+	const int nregs = (int)regId;
+	
 	for (int i = 0; i < nregs; ++i)
 		regs[i].regId = (unsigned char)i;
 	
@@ -432,29 +508,18 @@ static bool appendVertex(dtTempContour& cont, const int x, const int y, const in
 }
 
 
-static unsigned char getNeighbourReg(dtTileCacheLayer& layer,
-									 const int ax, const int ay, const int dir)
+// Returns the region across the edge of cell idx in direction dir, read from the packed
+// connection nibbles: low nibble connections, high nibble portals.
+inline unsigned char getNeighbourReg(const dtTileCacheLayer& layer, const int idx,
+									 const int dir, const int* dirOffset)
 {
-	const int w = (int)layer.header->width;
-	const int ia = ax + ay*w;
-	
-	const unsigned char con = layer.cons[ia] & 0xf;
-	const unsigned char portal = layer.cons[ia] >> 4;
+	const unsigned char cons = layer.cons[idx];
 	const unsigned char mask = (unsigned char)(1<<dir);
+	if (cons & mask)
+		return layer.regs[idx + dirOffset[dir]];
 	
-	if ((con & mask) == 0)
-	{
-		// No connection, return portal or hard edge.
-		if (portal & mask)
-			return 0xf8 + (unsigned char)dir;
-		return 0xff;
-	}
-	
-	const int bx = ax + getDirOffsetX(dir);
-	const int by = ay + getDirOffsetY(dir);
-	const int ib = bx + by*w;
-	
-	return layer.regs[ib];
+	// No connection, return portal or hard edge.
+	return (cons & (mask << 4)) ? (unsigned char)(0xf8 + dir) : 0xff;
 }
 
 static bool walkContour(dtTileCacheLayer& layer, int x, int y, dtTempContour& cont)
@@ -462,17 +527,22 @@ static bool walkContour(dtTileCacheLayer& layer, int x, int y, dtTempContour& co
 	const int w = (int)layer.header->width;
 	const int h = (int)layer.header->height;
 	
+	// Cell index offset of the neighbour in each direction.
+	const int dirOffset[4] = { -1, w, 1, -w };
+	
 	cont.nverts = 0;
 	
-	int startX = x;
-	int startY = y;
+	int idx = x+y*w;
+	const int startIdx = idx;
 	int startDir = -1;
 	
+	// The walk stays inside one region, so the region is fixed.
+	const unsigned char reg = layer.regs[idx];
+	
 	for (int i = 0; i < 4; ++i)
 	{
 		const int dir = (i+3)&3;
-		unsigned char rn = getNeighbourReg(layer, x, y, dir);
-		if (rn != layer.regs[x+y*w])
+		if (getNeighbourReg(layer, idx, dir, dirOffset) != reg)
 		{
 			startDir = dir;
 			break;
@@ -487,13 +557,12 @@ static bool walkContour(dtTileCacheLayer& layer, int x, int y, dtTempContour& co
 	int iter = 0;
 	while (iter < maxIter)
 	{
-		unsigned char rn = getNeighbourReg(layer, x, y, dir);
+		const unsigned char rn = getNeighbourReg(layer, idx, dir, dirOffset);
 		
-		int nx = x;
-		int ny = y;
+		int nidx = idx;
 		int ndir = dir;
 		
-		if (rn != layer.regs[x+y*w])
+		if (rn != reg)
 		{
 			// Solid edge.
 			int px = x;
@@ -506,7 +575,7 @@ static bool walkContour(dtTileCacheLayer& layer, int x, int y, dtTempContour& co
 			}
 			
 			// Try to merge with previous vertex.
-			if (!appendVertex(cont, px, (int)layer.heights[x+y*w], pz,rn))
+			if (!appendVertex(cont, px, (int)layer.heights[idx], pz,rn))
 				return false;
 			
 			ndir = (dir+1) & 0x3;  // Rotate CW
@@ -514,16 +583,16 @@ static bool walkContour(dtTileCacheLayer& layer, int x, int y, dtTempContour& co
 		else
 		{
 			// Move to next.
-			nx = x + getDirOffsetX(dir);
-			ny = y + getDirOffsetY(dir);
+			nidx = idx + dirOffset[dir];
+			x += getDirOffsetX(dir);
+			y += getDirOffsetY(dir);
 			ndir = (dir+3) & 0x3;	// Rotate CCW
 		}
 		
-		if (iter > 0 && x == startX && y == startY && dir == startDir)
+		if (iter > 0 && idx == startIdx && dir == startDir)
 			break;
 		
-		x = nx;
-		y = ny;
+		idx = nidx;
 		dir = ndir;
 		
 		iter++;
@@ -729,13 +798,11 @@ static unsigned char getCornerHeight(dtTileCacheLayer& layer,
 		}
 	}
 	
-	int portalCount = 0;
-	for (int dir = 0; dir < 4; ++dir)
-		if (portal & (1<<dir))
-			portalCount++;
+	// Exactly one portal direction.
+	const bool singlePortal = portal != 0 && (portal & (portal-1)) == 0;
 	
 	shouldRemove = false;
-	if (n > 1 && portalCount == 1 && allSameReg)
+	if (n > 1 && singlePortal && allSameReg)
 	{
 		shouldRemove = true;
 	}
@@ -1789,7 +1856,7 @@ dtStatus dtBuildTileCachePolyMesh(dtTileCacheAlloc* alloc,
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 
 	// Just allocate and clean the mesh flags array. The user is resposible for filling it.
-	memset(mesh.flags, 0, sizeof(unsigned short) * maxTris);
+	memset(mesh.flags, 0, sizeof(unsigned int) * maxTris);
 		
 	mesh.nverts = 0;
 	mesh.npolys = 0;
@@ -2102,6 +2169,59 @@ dtStatus dtMarkBoxArea(dtTileCacheLayer& layer, const float* orig, const float c
 	return DT_SUCCESS;
 }
 
+dtStatus dtMarkConvexArea(dtTileCacheLayer& layer, const float* orig, const float cs, const float ch,
+						  const float* verts, const int nverts, const float hmin, const float hmax,
+						  const unsigned char areaId)
+{
+	const int w = (int)layer.header->width;
+	const int h = (int)layer.header->height;
+	const float ics = 1.0f/cs;
+	const float ich = 1.0f/ch;
+
+	float bmin[3], bmax[3];
+	dtVcopy(bmin, verts);
+	dtVcopy(bmax, verts);
+	for (int i = 1; i < nverts; ++i)
+	{
+		dtVmin(bmin, &verts[i*3]);
+		dtVmax(bmax, &verts[i*3]);
+	}
+
+	int minx = (int)dtMathFloorf((bmin[0]-orig[0])*ics);
+	int miny = (int)dtMathFloorf((hmin-orig[1])*ich);
+	int minz = (int)dtMathFloorf((bmin[2]-orig[2])*ics);
+	int maxx = (int)dtMathFloorf((bmax[0]-orig[0])*ics);
+	int maxy = (int)dtMathFloorf((hmax-orig[1])*ich);
+	int maxz = (int)dtMathFloorf((bmax[2]-orig[2])*ics);
+
+	if (maxx < 0) return DT_SUCCESS;
+	if (minx >= w) return DT_SUCCESS;
+	if (maxz < 0) return DT_SUCCESS;
+	if (minz >= h) return DT_SUCCESS;
+
+	if (minx < 0) minx = 0;
+	if (maxx >= w) maxx = w-1;
+	if (minz < 0) minz = 0;
+	if (maxz >= h) maxz = h-1;
+
+	for (int z = minz; z <= maxz; ++z)
+	{
+		for (int x = minx; x <= maxx; ++x)
+		{
+			const int y = layer.heights[x+z*w];
+			if (y < miny || y > maxy)
+				continue;
+			// Test the cell center, like rcMarkConvexPolyArea.
+			const float pt[3] = { orig[0] + (x+0.5f)*cs, 0.0f, orig[2] + (z+0.5f)*cs };
+			if (!dtPointInPolygon(pt, verts, nverts))
+				continue;
+			layer.areas[x+z*w] = areaId;
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
 dtStatus dtBuildTileCacheLayer(dtTileCacheCompressor* comp,
 							   dtTileCacheLayerHeader* header,
 							   const unsigned char* heights,
@@ -875,6 +875,7 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 /// @param[in]		tris				The triangle vertex indices. [(vertA, vertB, vertC) * @p nt]
 /// @param[in]		numTris				The number of triangles.
 /// @param[out]		triAreaIDs			The triangle area ids. [Length: >= @p nt]
+/// @param[in]		surfTypes			The triangle surface types, or null to mark by slope only. [Length: >= @p nt] [opt]
 void rcMarkWalkableTriangles(rcContext* context, float walkableSlopeAngle, const float* verts, int numVerts,
 							 const int* tris, int numTris, unsigned char* triAreaIDs, const int* surfTypes);
 
@@ -1231,6 +1232,55 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf, int borderSi
 bool rcBuildRegionsMonotone(rcContext* ctx, rcCompactHeightfield& chf,
 							int borderSize, int minRegionArea, int mergeRegionArea);
 
+/// Region partitioning methods.
+/// @see rcChooseRegionPartition, rcBuildRegionsAdaptive
+enum rcRegionPartition
+{
+	RC_PARTITION_WATERSHED,		///< Watershed partitioning. (See: #rcBuildRegions)
+	RC_PARTITION_MONOTONE,		///< Monotone partitioning. (See: #rcBuildRegionsMonotone)
+	RC_PARTITION_LAYERS			///< Layer partitioning. (See: #rcBuildLayerRegions)
+};
+
+/// Measures of how hard a heightfield is to partition well.
+/// @see rcChooseRegionPartition
+struct rcRegionPartitionStats
+{
+	int spanCount;			///< The number of walkable spans inside the border.
+	int areaCount;			///< The number of distinct walkable area ids.
+	int overlapCount;		///< The number of cells with more than one walkable span.
+	int edgeCount;			///< The number of span edges facing a wall or another area.
+	float complexity;		///< edgeCount squared over 16 spanCount. About 1 for one square island.
+};
+
+/// Chooses the cheapest region partitioning that is expected to give good polygons.
+/// Heightfields with one area, no overlapping floors and a simple outline use monotone
+/// partitioning, moderately complex ones use layers, and the rest use watershed.
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in]		chf				A populated compact heightfield.
+/// @param[in]		borderSize		The size of the non-navigable border around the heightfield.
+///  								[Limit: >=0] [Units: vx]
+/// @param[out]		stats			The measures the choice was based on. [opt]
+/// @returns The partitioning to use.
+rcRegionPartition rcChooseRegionPartition(rcContext* ctx, const rcCompactHeightfield& chf, int borderSize,
+										  rcRegionPartitionStats* stats = 0);
+
+/// Builds region data for the heightfield with the partitioning picked by #rcChooseRegionPartition.
+/// The distance field is only built when watershed partitioning is picked.
+/// @ingroup recast
+/// @param[in,out]	ctx				The build context to use during the operation.
+/// @param[in,out]	chf				A populated compact heightfield.
+/// @param[in]		borderSize		The size of the non-navigable border around the heightfield.
+///  								[Limit: >=0] [Units: vx]
+/// @param[in]		minRegionArea	The minimum number of cells allowed to form isolated island areas.
+///  								[Limit: >=0] [Units: vx].
+/// @param[in]		mergeRegionArea	Any regions with a span count smaller than this value will, if possible,
+///  								be merged with larger regions. [Limit: >=0] [Units: vx]
+/// @param[out]		partition		The partitioning that was used. [opt]
+/// @returns True if the operation completed successfully.
+bool rcBuildRegionsAdaptive(rcContext* ctx, rcCompactHeightfield& chf, int borderSize,
+							int minRegionArea, int mergeRegionArea, rcRegionPartition* partition = 0);
+
 /// Sets the neighbor connection data for the specified direction.
 /// @param[in]		span			The span to update.
 /// @param[in]		direction		The direction to set. [Limits: 0 <= value < 4]
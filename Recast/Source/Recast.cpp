@@ -350,6 +350,14 @@ void rcMarkWalkableTriangles(rcContext* context, const float walkableSlopeAngle,
 		const int* tri = &tris[i * 3];
 		calcTriNormal(&verts[tri[0] * 3], &verts[tri[1] * 3], &verts[tri[2] * 3], norm);
 
+		// Without surface types fall back to plain slope based marking.
+		if (!surfTypes)
+		{
+			if (norm[1] > walkableThr)
+				triAreaIDs[i] = RC_WALKABLE_AREA;
+			continue;
+		}
+
 		if (surfTypes[i] == 62)
 		{ 
 			triAreaIDs[i] = RC_ILLUSIONARY_AREA;
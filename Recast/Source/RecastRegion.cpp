@@ -1814,3 +1814,106 @@ bool rcBuildLayerRegions(rcContext* ctx, rcCompactHeightfield& chf,
 	
 	return true;
 }
+
+/// @par
+///
+/// The choice looks at the walkable spans inside the border only. Span edges that face
+/// a wall, a hole or another area make up the outline of the walkable surface, edges
+/// towards the border are not counted, so an open tile has no outline at all.
+///
+/// Monotone partitioning turns long outlines and holes into thin sliver polygons, and
+/// layer partitioning leans on the triangulation to cope with holes, so they are only
+/// picked while the outline stays short compared to the walkable area.
+///
+/// @see rcCompactHeightfield, rcBuildRegionsAdaptive
+rcRegionPartition rcChooseRegionPartition(rcContext* ctx, const rcCompactHeightfield& chf, const int borderSize,
+										  rcRegionPartitionStats* stats)
+{
+	rcIgnoreUnused(ctx);
+
+	// Outline complexity limits, in units of one square island.
+	static const float MAX_MONOTONE_COMPLEXITY = 0.25f;
+	static const float MAX_LAYERS_COMPLEXITY = 2.0f;
+
+	const int w = chf.width;
+	const int h = chf.height;
+
+	bool seenArea[256];
+	memset(seenArea, 0, sizeof(seenArea));
+	rcRegionPartitionStats st;
+	memset(&st, 0, sizeof(st));
+
+	for (int y = borderSize; y < h - borderSize; ++y)
+	{
+		for (int x = borderSize; x < w - borderSize; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x + y * w];
+			int nwalkable = 0;
+			for (int i = (int)c.index, ni = (int)(c.index + c.count); i < ni; ++i)
+			{
+				const unsigned char area = chf.areas[i];
+				if (area == RC_NULL_AREA)
+					continue;
+				nwalkable++;
+				if (!seenArea[area])
+				{
+					seenArea[area] = true;
+					st.areaCount++;
+				}
+
+				const rcCompactSpan& s = chf.spans[i];
+				for (int dir = 0; dir < 4; ++dir)
+				{
+					const int ax = x + rcGetDirOffsetX(dir);
+					const int ay = y + rcGetDirOffsetY(dir);
+					if (ax < borderSize || ay < borderSize || ax >= w - borderSize || ay >= h - borderSize)
+						continue;
+					const int con = rcGetCon(s, dir);
+					if (con == RC_NOT_CONNECTED)
+					{
+						st.edgeCount++;
+						continue;
+					}
+					const int ai = (int)chf.cells[ax + ay * w].index + con;
+					if (chf.areas[ai] != area)
+						st.edgeCount++;
+				}
+			}
+			st.spanCount += nwalkable;
+			if (nwalkable > 1)
+				st.overlapCount++;
+		}
+	}
+
+	st.complexity = st.spanCount > 0 ? (float)st.edgeCount * (float)st.edgeCount / (16.0f * (float)st.spanCount) : 0.0f;
+	if (stats)
+		*stats = st;
+
+	if (st.areaCount <= 1 && st.overlapCount == 0 && st.complexity <= MAX_MONOTONE_COMPLEXITY)
+		return RC_PARTITION_MONOTONE;
+	if (st.complexity <= MAX_LAYERS_COMPLEXITY)
+		return RC_PARTITION_LAYERS;
+	return RC_PARTITION_WATERSHED;
+}
+
+bool rcBuildRegionsAdaptive(rcContext* ctx, rcCompactHeightfield& chf, const int borderSize,
+							const int minRegionArea, const int mergeRegionArea, rcRegionPartition* partition)
+{
+	rcAssert(ctx);
+
+	const rcRegionPartition choice = rcChooseRegionPartition(ctx, chf, borderSize);
+	if (partition)
+		*partition = choice;
+
+	switch (choice)
+	{
+	case RC_PARTITION_MONOTONE:
+		return rcBuildRegionsMonotone(ctx, chf, borderSize, minRegionArea, mergeRegionArea);
+	case RC_PARTITION_LAYERS:
+		return rcBuildLayerRegions(ctx, chf, borderSize, minRegionArea);
+	default:
+		if (!rcBuildDistanceField(ctx, chf))
+			return false;
+		return rcBuildRegions(ctx, chf, borderSize, minRegionArea, mergeRegionArea);
+	}
+}
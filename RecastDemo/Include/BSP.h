@@ -64,6 +64,13 @@
 #define PLANE_ANYY 4
 #define PLANE_ANYZ 5
 
+#define CONTENTS_EMPTY -1  // Leaf contents, see BSPLEAF
+#define CONTENTS_SOLID -2
+#define CONTENTS_WATER -3
+#define CONTENTS_SLIME -4
+#define CONTENTS_LAVA  -5
+#define CONTENTS_SKY   -6
+
 #define MT_MODEL_SOLID 61
 #define MT_MODEL_ILLUSIONARY 62
 
@@ -100,6 +107,23 @@ typedef struct _BSPPLANE
 	int32_t nType;    // Plane type, see #defines
 } BSPPLANE;
 
+typedef struct _BSPNODE
+{
+	uint32_t iPlane;            // Index into planes lump
+	int16_t iChildren[2];       // If > 0, then indices into nodes, otherwise bitwise inverse indices into leafs
+	int16_t nMins[3], nMaxs[3]; // Defines bounding box
+	uint16_t firstFace, nFaces; // Index and count into faces
+} BSPNODE;
+
+typedef struct _BSPLEAF
+{
+	int32_t nContents;                          // Contents enumeration, see #defines
+	int32_t nVisOffset;                         // Offset into the visibility lump
+	int16_t nMins[3], nMaxs[3];                 // Defines bounding box
+	uint16_t iFirstMarkSurface, nMarkSurfaces;  // Index and count into marksurfaces array
+	uint8_t nAmbientLevels[4];                  // Ambient sound levels
+} BSPLEAF;
+
 typedef int32_t BSPSURFEDGE;
 
 typedef struct _BSPEDGE
@@ -29,13 +29,14 @@ struct rcChunkyTriMeshNode
 
 struct rcChunkyTriMesh
 {
-	inline rcChunkyTriMesh() : nodes(0), nnodes(0), tris(0), ntris(0), maxTrisPerChunk(0) {}
-	inline ~rcChunkyTriMesh() { delete [] nodes; delete [] tris; }
+	inline rcChunkyTriMesh() : nodes(0), nnodes(0), tris(0), surfTypes(0), triMap(0), ntris(0), maxTrisPerChunk(0) {}
+	inline ~rcChunkyTriMesh() { delete [] nodes; delete [] tris; delete [] surfTypes; delete [] triMap; }
 
 	rcChunkyTriMeshNode* nodes;
 	int nnodes;
 	int* tris;
 	int* surfTypes;
+	int* triMap;	///< Index of every input triangle in tris and surfTypes, which also places it in its leaf.
 	int ntris;
 	int maxTrisPerChunk;
 
@@ -50,6 +51,9 @@ private:
 bool rcCreateChunkyTriMesh(const float* verts, const int* tris, int ntris,
 	int trisPerChunk, rcChunkyTriMesh* cm, const int* surfTypes);
 
+/// Writes the surface type of an input triangle into the mesh in place.
+void rcSetChunkyTriMeshSurfaceType(rcChunkyTriMesh* cm, const int tri, const int surfType);
+
 /// Returns the chunk indices which overlap the input rectable.
 int rcGetChunksOverlappingRect(const rcChunkyTriMesh* cm, float bmin[2], float bmax[2], int* ids, const int maxIds);
 
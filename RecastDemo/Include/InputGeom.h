@@ -75,6 +75,8 @@ struct BuildSettings
 	float navMeshBMax[3];
 	// Size of the tiles in voxels
 	float tileSize;
+	// Expected number of layers per tile, 0 when unset
+	int expectedLayersPerTile;
 };
 
 class InputGeom
@@ -108,6 +110,10 @@ class InputGeom
 	static const int MAX_NAV_HINTS = 1024;
 	NavHint NavHints[MAX_NAV_HINTS];
 	int m_HintCount;
+
+	bool m_mergeBSPFaces;
+	bool m_cullBSPVoidFaces;
+	bool m_useBSPGeometryCache;
 	
 	bool loadMesh(class rcContext* ctx, const std::string& filepath);
 	bool loadBSP(class rcContext* ctx, const std::string& filepath);
@@ -118,6 +124,17 @@ public:
 		
 	bool load(class rcContext* ctx, const std::string& filepath);
 	bool saveGeomSet(const BuildSettings* settings);
+
+	/// Merges coplanar BSP faces on load to cut the triangle count, set before load.
+	void setMergeBSPFaces(const bool merge) { m_mergeBSPFaces = merge; }
+	bool getMergeBSPFaces() const { return m_mergeBSPFaces; }
+	/// Drops BSP faces that face solid or sky on load, set before load.
+	void setCullBSPVoidFaces(const bool cull) { m_cullBSPVoidFaces = cull; }
+	bool getCullBSPVoidFaces() const { return m_cullBSPVoidFaces; }
+	/// Loads BSP geometry from a .bspcache file next to the BSP when it is up to date, and writes one
+	/// when it is not, set before load.
+	void setUseBSPGeometryCache(const bool use) { m_useBSPGeometryCache = use; }
+	bool getUseBSPGeometryCache() const { return m_useBSPGeometryCache; }
 	
 	/// Method to return static mesh data.
 	const rcMeshLoaderObj* getMesh() const { return m_mesh; }
@@ -131,8 +148,6 @@ public:
 	const BuildSettings* getBuildSettings() const { return m_hasBuildSettings ? &m_buildSettings : 0; }
 	bool raycastMesh(float* src, float* dst, float& tmin, const bool bIncludeIllusionary = true);
 
-	void rebuildChunkyTriMesh();
-
 	/// @name Off-Mesh connections.
 	///@{
 	int getOffMeshConnectionCount() const { return m_offMeshConCount; }
@@ -165,6 +180,7 @@ public:
 	NavHint* getNavHints() { return &NavHints[0]; }
 	NavHint* getNavHint(int index);
 
+	/// Sets the surface type of a triangle, or of every triangle of its brush model, in both the mesh and the chunky mesh.
 	void SetTriangleArea(int TriNum, const int NewAreaType);
 	void SetModelArea(int ModelNum, const int NewAreaType);
 
@@ -19,7 +19,27 @@
 #ifndef MESHLOADER_OBJ
 #define MESHLOADER_OBJ
 
+#include <stdint.h>
 #include <string>
+#include <vector>
+
+struct rcChunkyTriMesh;
+
+/// An info_landmark entity of a BSP, in Recast coordinates.
+struct BSPLandmark
+{
+	char name[64];
+	float pos[3];
+};
+
+/// A trigger_changelevel entity of a BSP, the volume that takes players to another map, in Recast coordinates.
+struct BSPLevelTransition
+{
+	char mapName[64];		// The map the transition leads to.
+	char landmarkName[64];	// The landmark that both maps have, positions are carried over relative to it.
+	float bmin[3];
+	float bmax[3];
+};
 
 class rcMeshLoaderObj
 {
@@ -38,10 +58,43 @@ public:
 	inline const int* getSurfaceTypes() const { return m_surfTypes; }
 	inline const int getSurfaceTypeCount() const { return m_surfTypeCount; }
 	const std::string& getFileName() const { return m_filename; }
+	const std::string& getMapName() const { return m_mapname; }
+
+	/// Merges coplanar BSP face fragments before triangulating them, set before loadBSP.
+	void setMergeCoplanarFaces(const bool merge) { m_mergeCoplanarFaces = merge; }
+	bool getMergeCoplanarFaces() const { return m_mergeCoplanarFaces; }
+	/// Number of faces read from the last BSP, and the number of polygons left after merging.
+	int getBSPFaceCount() const { return m_bspFaceCount; }
+	int getBSPPolyCount() const { return m_bspPolyCount; }
+	/// Number of triangles the BSP faces would have produced without merging.
+	int getBSPUnmergedTriCount() const { return m_bspUnmergedTriCount; }
+	/// Drops BSP faces whose front lies in solid or sky according to the world BSP leaves, set before loadBSP.
+	void setCullVoidFaces(const bool cull) { m_cullVoidFaces = cull; }
+	bool getCullVoidFaces() const { return m_cullVoidFaces; }
+	/// Number of faces and triangles dropped from the last BSP as facing the void.
+	int getBSPCulledFaceCount() const { return m_bspCulledFaceCount; }
+	int getBSPCulledTriCount() const { return m_bspCulledTriCount; }
+
+	/// Landmarks and level transitions of the last BSP, used to stitch campaign maps together.
+	const std::vector<BSPLandmark>& getLandmarks() const { return m_landmarks; }
+	const std::vector<BSPLevelTransition>& getLevelTransitions() const { return m_levelTransitions; }
 
 	void SetTriangleSurfaceType(const int TriNum, const int NewSurfaceType);
+	/// Sets the surface type of every triangle of the brush model the triangle belongs to.
+	/// Triangles of the world model are left alone.
 	void SetModelSurfaceType(const int ModelNum, const int NewSurfaceType);
 
+	/// Loads the geometry of a BSP and its chunky mesh from a cache file written by saveBSPCache.
+	/// Fails if the cache was written for other BSP content, other entity rules or other load settings.
+	bool loadBSPCache(const std::string& filename, const std::string& cacheFilename, rcChunkyTriMesh* chunkyMesh);
+	/// Writes the geometry of the loaded BSP and its chunky mesh to a cache file.
+	bool saveBSPCache(const std::string& cacheFilename, const rcChunkyTriMesh* chunkyMesh) const;
+
+	/// The brush model of a triangle, 0 for the world and for meshes without models.
+	int getTriModel(const int tri) const { return m_triModels && tri >= 0 && tri < m_triCount ? m_triModels[tri] : 0; }
+	/// The triangles of a brush model.
+	const int* getModelTris(const int model, int* count) const;
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	rcMeshLoaderObj(const rcMeshLoaderObj&);
@@ -49,6 +102,9 @@ private:
 	
 	void addVertex(float x, float y, float z, int& cap);
 	void addTriangle(int a, int b, int c, int& cap, int surfaceType);
+	void buildModelTriIndex();
+	/// Hashes the BSP content together with the rules and settings its geometry is built with.
+	bool calcBSPCacheKey(const std::string& filename, uint64_t* key) const;
 	
 	std::string m_filename;
 	std::string m_mapname;
@@ -61,7 +117,18 @@ private:
 	int m_triCount;
 	int m_surfTypeCount;
 	int m_modelCount;
+	std::vector<int> m_modelTriStart;	// Start of the triangles of every model in m_modelTris, plus the end. [Size: m_modelCount+1]
+	std::vector<int> m_modelTris;		// Triangle indices grouped by model.
 	int* m_surfTypes;
+	bool m_mergeCoplanarFaces;
+	int m_bspFaceCount;
+	int m_bspPolyCount;
+	int m_bspUnmergedTriCount;
+	bool m_cullVoidFaces;
+	int m_bspCulledFaceCount;
+	int m_bspCulledTriCount;
+	std::vector<BSPLandmark> m_landmarks;
+	std::vector<BSPLevelTransition> m_levelTransitions;
 };
 
 #endif // MESHLOADER_OBJ
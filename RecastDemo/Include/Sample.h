@@ -72,7 +72,8 @@ enum SamplePartitionType
 {
 	SAMPLE_PARTITION_WATERSHED,
 	SAMPLE_PARTITION_MONOTONE,
-	SAMPLE_PARTITION_LAYERS
+	SAMPLE_PARTITION_LAYERS,
+	SAMPLE_PARTITION_ADAPTIVE
 };
 
 struct SampleTool
@@ -140,6 +141,9 @@ protected:
 	bool m_filterWalkableLowHeightSpans;
 
 	bool m_drawIllusionary;
+
+	/// Write the build input of every tile to ExportFolder for offline replay.
+	bool m_captureTiles;
 	
 	SampleTool* m_tool;
 	SampleToolState* m_toolStates[MAX_TOOLS];
@@ -153,6 +157,10 @@ protected:
 	dtNavMesh* loadAll(const char* path);
 	void saveAll(const char* path, const dtNavMesh* mesh);
 
+	void saveTileCapture(const struct duTileCapture& capture, const int navMeshIndex);
+	void replayTileCaptures();
+	int getTileCaptureFlags() const;
+
 public:
 	Sample();
 	virtual ~Sample();
@@ -21,7 +21,9 @@
 
 #include "DebugDraw.h"
 #include "Recast.h"
+#include "RecastAlloc.h"
 #include "RecastDump.h"
+#include "DetourAlloc.h"
 #include "PerfTimer.h"
 
 // These are example implementations of various interfaces used in Recast and Detour.
@@ -95,5 +97,19 @@ private:
 	FileIO& operator=(const FileIO&);
 };
 
+/// Live and peak bytes of one kind of allocation.
+struct AllocCounter
+{
+	size_t current;
+	size_t peak;
+};
+
+/// Installs allocators for Recast and Detour that count the bytes allocated
+/// under each allocation hint. Must be called before anything is allocated
+/// through rcAlloc or dtAlloc. Safe to use from the build threads.
+void initAllocTracking();
+AllocCounter getRecastAllocCounter(const rcAllocHint hint);
+AllocCounter getDetourAllocCounter(const dtAllocHint hint);
+
 #endif // SAMPLEINTERFACES_H
 
@@ -23,6 +23,7 @@
 #include "DetourNavMesh.h"
 #include "Recast.h"
 #include "ChunkyTriMesh.h"
+#include "NavProfiles.h"
 
 
 class Sample_TempObstacles : public Sample
@@ -35,12 +36,15 @@ protected:
 	struct MeshProcess* m_tmproc;
 
 	class dtTileCache* m_tileCache;
+	/// Shares the temp obstacles between the tile caches of all nav mesh profiles.
+	class dtObstacleRegistry* m_obstacleRegistry;
 	
 	float m_cacheBuildTimeMs;
 	int m_cacheCompressedSize;
 	int m_cacheRawSize;
 	int m_cacheLayerCount;
 	unsigned int m_cacheBuildMemUsage;
+	size_t m_navMeshMemUsage;
 	
 	enum DrawMode
 	{
@@ -60,6 +64,8 @@ protected:
 	int m_maxTiles;
 	int m_maxPolysPerTile;
 	float m_tileSize;
+	/// How many layers (or "floors") each navmesh tile is expected to have.
+	float m_expectedLayersPerTile;
 	
 public:
 	Sample_TempObstacles();
@@ -73,6 +79,7 @@ public:
 	virtual void handleMeshChanged(class InputGeom* geom);
 	virtual bool handleBuild();
 	virtual void handleUpdate(const float dt);
+	virtual void collectSettings(struct BuildSettings& settings);
 
 	virtual void addOffMeshConnection(const float* spos, const float* epos, const float rad, const unsigned char area, const unsigned int flags, const bool bBiDirectional);
 	virtual void drawOffMeshConnections(duDebugDraw* dd);
@@ -93,12 +100,21 @@ public:
 
 	void SaveData(const char* path);
 
+	/// Builds the first nav mesh profile over a grid of tile and cell sizes, picks the
+	/// best trade-off and writes it to the .gset build settings.
+	void tuneTileSettings();
+
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
 	Sample_TempObstacles(const Sample_TempObstacles&);
 	Sample_TempObstacles& operator=(const Sample_TempObstacles&);
 
-	int rasterizeTileLayers(const unsigned int NavMeshIndex, const int tx, const int ty, const rcConfig& cfg, struct TileCacheData* tiles, const int maxTiles);
+	int rasterizeTileLayers(rcContext* ctx, const unsigned int NavMeshIndex, const int tx, const int ty, const rcConfig& cfg, struct TileCacheData* tiles, const int maxTiles);
+
+	void initBuildConfig(const NavMeshDefinition& def, const float cellSize, const int tileSize,
+						 rcConfig& cfg, struct dtTileCacheParams& tcparams) const;
+	void buildTuningCandidate(struct TileCacheTuningJob* job);
+	void runTuningJobs(struct TileCacheTuningJob* jobs, const int njobs);
 };
 
 
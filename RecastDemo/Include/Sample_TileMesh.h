@@ -29,6 +29,7 @@ class Sample_TileMesh : public Sample
 protected:
 	bool m_keepInterResults;
 	bool m_buildAll;
+	float m_polyGridResolution;
 	float m_totalBuildTimeMs;
 
 	unsigned char* m_triareas;
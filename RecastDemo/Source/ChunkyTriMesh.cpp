@@ -19,7 +19,12 @@
 #include "ChunkyTriMesh.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 struct BoundsItem
 {
@@ -28,27 +33,11 @@ struct BoundsItem
 	int i;
 };
 
-static int compareItemX(const void* va, const void* vb)
+struct CompareItemMin
 {
-	const BoundsItem* a = (const BoundsItem*)va;
-	const BoundsItem* b = (const BoundsItem*)vb;
-	if (a->bmin[0] < b->bmin[0])
-		return -1;
-	if (a->bmin[0] > b->bmin[0])
-		return 1;
-	return 0;
-}
-
-static int compareItemY(const void* va, const void* vb)
-{
-	const BoundsItem* a = (const BoundsItem*)va;
-	const BoundsItem* b = (const BoundsItem*)vb;
-	if (a->bmin[1] < b->bmin[1])
-		return -1;
-	if (a->bmin[1] > b->bmin[1])
-		return 1;
-	return 0;
-}
+	int axis;
+	inline bool operator()(const BoundsItem& a, const BoundsItem& b) const { return a.bmin[axis] < b.bmin[axis]; }
+};
 
 static void calcExtends(const BoundsItem* items, const int /*nitems*/,
 						const int imin, const int imax,
@@ -76,83 +65,153 @@ inline int longestAxis(float x, float y)
 	return y > x ? 1 : 0;
 }
 
-static void subdivide(BoundsItem* items, int nitems, int imin, int imax, int trisPerChunk,
-					  int& curNode, rcChunkyTriMeshNode* nodes, const int maxNodes,
-					  int& curTri, int* outTris, const int* inTris, int* outSurfTypes, const int* inSurfTypes)
+// Number of nodes in the subtree of a node with n triangles. Nodes are split in half until they
+// hold at most trisPerChunk triangles, so the sizes of the nodes on one level of the tree differ
+// by at most one and the tree can be counted a level at a time.
+static int calcNodeCount(const int n, const int trisPerChunk)
 {
-	int inum = imax - imin;
-	int icur = curNode;
-	
-	if (curNode >= maxNodes)
-		return;
+	int size = n;		// The smaller node size on the current level.
+	int nsmall = 1;		// Number of nodes of size.
+	int nlarge = 0;		// Number of nodes of size+1.
+	int count = 0;
+	while (nsmall + nlarge > 0)
+	{
+		count += nsmall + nlarge;
+		
+		const int half = size/2;
+		int nextSmall = 0, nextLarge = 0;
+		if (nsmall > 0 && size > trisPerChunk)
+		{
+			if (size & 1) { nextSmall += nsmall; nextLarge += nsmall; }
+			else nextSmall += nsmall*2;
+		}
+		if (nlarge > 0 && size+1 > trisPerChunk)
+		{
+			if (size & 1) nextLarge += nlarge*2;
+			else { nextSmall += nlarge; nextLarge += nlarge; }
+		}
+		size = half;
+		nsmall = nextSmall;
+		nlarge = nextLarge;
+	}
+	return count;
+}
+
+struct ChunkyBuildTask
+{
+	int imin;
+	int imax;
+	int node;
+};
+
+struct ChunkyBuildContext
+{
+	BoundsItem* items;
+	int trisPerChunk;
+	rcChunkyTriMesh* cm;
+	const int* inTris;
+	const int* inSurfTypes;
+};
 
-	rcChunkyTriMeshNode& node = nodes[curNode++];
+// Builds one node of the tree. The node and triangle positions of every subtree follow from
+// the triangle counts alone, so subtrees can be built in any order. Returns the number of
+// child tasks written to children, zero for a leaf.
+static int buildChunkyNode(const ChunkyBuildContext& ctx, const ChunkyBuildTask& task, ChunkyBuildTask* children)
+{
+	BoundsItem* items = ctx.items;
+	rcChunkyTriMesh* cm = ctx.cm;
+	const int inum = task.imax - task.imin;
+	rcChunkyTriMeshNode& node = cm->nodes[task.node];
+	calcExtends(items, cm->ntris, task.imin, task.imax, node.bmin, node.bmax);
 	
-	if (inum <= trisPerChunk)
+	if (inum <= ctx.trisPerChunk)
 	{
-		// Leaf
-		calcExtends(items, nitems, imin, imax, node.bmin, node.bmax);
-		
-		// Copy triangles.
-		node.i = curTri;
+		// Leaf, its triangles are stored in item order.
+		node.i = task.imin;
 		node.n = inum;
 		
-		for (int i = imin; i < imax; ++i)
+		for (int i = task.imin; i < task.imax; ++i)
 		{
-			const int* src = &inTris[items[i].i*3];
-			int* dst = &outTris[curTri*3];
-			outSurfTypes[curTri] = inSurfTypes[items[i].i];
-
-			curTri++;
+			const int tri = items[i].i;
+			const int* src = &ctx.inTris[tri*3];
+			int* dst = &cm->tris[i*3];
 			dst[0] = src[0];
 			dst[1] = src[1];
 			dst[2] = src[2];
+			cm->surfTypes[i] = ctx.inSurfTypes ? ctx.inSurfTypes[tri] : 0;
+			cm->triMap[tri] = i;
 		}
+		return 0;
 	}
-	else
+	
+	// Split at the median along the longest axis.
+	CompareItemMin cmp;
+	cmp.axis = longestAxis(node.bmax[0] - node.bmin[0], node.bmax[1] - node.bmin[1]);
+	const int isplit = task.imin + inum/2;
+	std::nth_element(items + task.imin, items + isplit, items + task.imax, cmp);
+	
+	// Negative index means escape.
+	node.i = -calcNodeCount(inum, ctx.trisPerChunk);
+	node.n = 0;
+	
+	children[0].imin = task.imin;
+	children[0].imax = isplit;
+	children[0].node = task.node + 1;
+	children[1].imin = isplit;
+	children[1].imax = task.imax;
+	children[1].node = task.node + 1 + calcNodeCount(isplit - task.imin, ctx.trisPerChunk);
+	return 2;
+}
+
+static void buildChunkySubtree(const ChunkyBuildContext& ctx, const ChunkyBuildTask& root)
+{
+	std::vector<ChunkyBuildTask> stack;
+	stack.push_back(root);
+	while (!stack.empty())
 	{
-		// Split
-		calcExtends(items, nitems, imin, imax, node.bmin, node.bmax);
-		
-		int	axis = longestAxis(node.bmax[0] - node.bmin[0],
-							   node.bmax[1] - node.bmin[1]);
-		
-		if (axis == 0)
-		{
-			// Sort along x-axis
-			qsort(items+imin, static_cast<size_t>(inum), sizeof(BoundsItem), compareItemX);
-		}
-		else if (axis == 1)
-		{
-			// Sort along y-axis
-			qsort(items+imin, static_cast<size_t>(inum), sizeof(BoundsItem), compareItemY);
-		}
-		
-		int isplit = imin+inum/2;
-		
-		// Left
-		subdivide(items, nitems, imin, isplit, trisPerChunk, curNode, nodes, maxNodes, curTri, outTris, inTris, outSurfTypes, inSurfTypes);
-		// Right
-		subdivide(items, nitems, isplit, imax, trisPerChunk, curNode, nodes, maxNodes, curTri, outTris, inTris, outSurfTypes, inSurfTypes);
-		
-		int iescape = curNode - icur;
-		// Negative index means escape.
-		node.i = -iescape;
+		const ChunkyBuildTask task = stack.back();
+		stack.pop_back();
+		ChunkyBuildTask children[2];
+		const int nchildren = buildChunkyNode(ctx, task, children);
+		// Right first so the left subtree is built first.
+		for (int i = nchildren-1; i >= 0; --i)
+			stack.push_back(children[i]);
 	}
 }
 
+// Meshes smaller than this are built on the calling thread.
+static const int PARALLEL_CHUNKY_MIN_TRIS = 32768;
+
 bool rcCreateChunkyTriMesh(const float* verts, const int* tris, int ntris,
 						   int trisPerChunk, rcChunkyTriMesh* cm, const int* surfTypes)
 {
-	int nchunks = (ntris + trisPerChunk-1) / trisPerChunk;
+	if (ntris < 0 || trisPerChunk <= 0)
+		return false;
+
+	// An empty mesh gets a single empty leaf, so it can still be queried.
+	if (ntris == 0)
+	{
+		cm->nodes = new rcChunkyTriMeshNode[1];
+		memset(cm->nodes, 0, sizeof(rcChunkyTriMeshNode));
+		cm->nnodes = 1;
+		cm->tris = new int[1];
+		cm->surfTypes = new int[1];
+		cm->triMap = new int[1];
+		cm->ntris = 0;
+		cm->maxTrisPerChunk = 0;
+		return true;
+	}
+
+	const int nnodes = calcNodeCount(ntris, trisPerChunk);
 
-	cm->nodes = new rcChunkyTriMeshNode[nchunks*4];
+	cm->nodes = new rcChunkyTriMeshNode[nnodes];
 	if (!cm->nodes)
 		return false;
 		
 	cm->tris = new int[ntris*3];
 	cm->surfTypes = new int[ntris];
-	if (!cm->tris)
+	cm->triMap = new int[ntris];
+	if (!cm->tris || !cm->surfTypes || !cm->triMap)
 		return false;
 		
 	cm->ntris = ntris;
@@ -181,13 +240,55 @@ bool rcCreateChunkyTriMesh(const float* verts, const int* tris, int ntris,
 		}
 	}
 
-	int curTri = 0;
-	int curNode = 0;
-	subdivide(items, ntris, 0, ntris, trisPerChunk, curNode, cm->nodes, nchunks*4, curTri, cm->tris, tris, cm->surfTypes, surfTypes);
+	ChunkyBuildContext ctx;
+	ctx.items = items;
+	ctx.trisPerChunk = trisPerChunk;
+	ctx.cm = cm;
+	ctx.inTris = tris;
+	ctx.inSurfTypes = surfTypes;
+
+	ChunkyBuildTask root;
+	root.imin = 0;
+	root.imax = ntris;
+	root.node = 0;
+
+	const int nthreads = ntris >= PARALLEL_CHUNKY_MIN_TRIS ? (int)std::thread::hardware_concurrency() : 1;
+	if (nthreads <= 1)
+	{
+		buildChunkySubtree(ctx, root);
+	}
+	else
+	{
+		// Split the top of the tree on this thread until there are enough subtrees to keep every
+		// thread busy, then build the subtrees in parallel.
+		std::vector<ChunkyBuildTask> tasks;
+		tasks.push_back(root);
+		size_t first = 0;
+		while (first < tasks.size() && (int)(tasks.size() - first) < nthreads*4)
+		{
+			ChunkyBuildTask children[2];
+			const int nchildren = buildChunkyNode(ctx, tasks[first++], children);
+			for (int i = 0; i < nchildren; ++i)
+				tasks.push_back(children[i]);
+		}
+
+		std::atomic<size_t> next(first);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < nthreads; ++i)
+		{
+			threads.push_back(std::thread([&ctx, &tasks, &next]()
+			{
+				for (size_t j = next++; j < tasks.size(); j = next++)
+					buildChunkySubtree(ctx, tasks[j]);
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); ++i)
+			threads[i].join();
+	}
 	
 	delete [] items;
 	
-	cm->nnodes = curNode;
+	cm->nnodes = nnodes;
 	
 	// Calc max tris per node.
 	cm->maxTrisPerChunk = 0;
@@ -203,6 +304,13 @@ bool rcCreateChunkyTriMesh(const float* verts, const int* tris, int ntris,
 	return true;
 }
 
+void rcSetChunkyTriMeshSurfaceType(rcChunkyTriMesh* cm, const int tri, const int surfType)
+{
+	if (!cm || !cm->triMap || tri < 0 || tri >= cm->ntris)
+		return;
+	cm->surfTypes[cm->triMap[tri]] = surfType;
+}
+
 
 inline bool checkOverlapRect(const float amin[2], const float amax[2],
 							 const float bmin[2], const float bmax[2])
@@ -29,6 +29,7 @@
 #include "RecastDebugDraw.h"
 #include "DetourNavMesh.h"
 #include "Sample.h"
+#include "PerfTimer.h"
 
 static bool intersectSegmentTriangle(const float* sp, const float* sq,
 									 const float* a, const float* b, const float* c,
@@ -112,7 +113,10 @@ InputGeom::InputGeom() :
 	m_hasBuildSettings(false),
 	m_offMeshConCount(0),
 	m_volumeCount(0),
-	m_HintCount(0)
+	m_HintCount(0),
+	m_mergeBSPFaces(true),
+	m_cullBSPVoidFaces(true),
+	m_useBSPGeometryCache(true)
 {
 	memset(&NavHints, 0, sizeof(NavHints));
 }
@@ -184,11 +188,70 @@ bool InputGeom::loadBSP(rcContext* ctx, const std::string& filepath)
 		ctx->log(RC_LOG_ERROR, "loadMesh: Out of memory 'm_mesh'.");
 		return false;
 	}
+	m_mesh->setMergeCoplanarFaces(m_mergeBSPFaces);
+	m_mesh->setCullVoidFaces(m_cullBSPVoidFaces);
+
+	// The cache sits next to the BSP and is rebuilt whenever the BSP or the loader rules change.
+	std::string cachePath = filepath;
+	const size_t extPos = cachePath.find_last_of('.');
+	if (extPos != std::string::npos)
+		cachePath = cachePath.substr(0, extPos);
+	cachePath += ".bspcache";
+
+	if (m_useBSPGeometryCache)
+	{
+		const TimeVal cacheStart = getPerfTime();
+		m_chunkyMesh = new rcChunkyTriMesh;
+		if (m_mesh->loadBSPCache(filepath, cachePath, m_chunkyMesh))
+		{
+			ctx->log(RC_LOG_PROGRESS, "loadBSP: Loaded %d triangles from the geometry cache '%s' in %.1f ms, %d triangles were culled.",
+					 m_mesh->getTriCount(), cachePath.c_str(), getPerfTimeUsec(getPerfTime() - cacheStart) / 1000.0f,
+					 m_mesh->getBSPCulledTriCount());
+			rcCalcBounds(m_mesh->getVerts(), m_mesh->getVertCount(), m_meshBMin, m_meshBMax);
+			return true;
+		}
+		delete m_chunkyMesh;
+		m_chunkyMesh = 0;
+	}
+
+	const TimeVal loadStart = getPerfTime();
 	if (!m_mesh->loadBSP(filepath))
 	{
 		ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not load '%s'", filepath.c_str());
 		return false;
 	}
+	const float loadMs = getPerfTimeUsec(getPerfTime() - loadStart) / 1000.0f;
+
+	if (!m_mesh->getLevelTransitions().empty())
+	{
+		ctx->log(RC_LOG_PROGRESS, "loadBSP: %d landmarks, %d level transitions.",
+				 (int)m_mesh->getLandmarks().size(), (int)m_mesh->getLevelTransitions().size());
+	}
+
+	if (m_cullBSPVoidFaces)
+	{
+		const int ntris = m_mesh->getTriCount();
+		const int nculled = m_mesh->getBSPCulledTriCount();
+		ctx->log(RC_LOG_PROGRESS, "loadBSP: '%s' culled %d faces facing solid or sky, %d of %d triangles (%.1f%%), loaded in %.1f ms.",
+				 m_mesh->getMapName().c_str(), m_mesh->getBSPCulledFaceCount(), nculled, ntris + nculled,
+				 100.0f * nculled / rcMax(ntris + nculled, 1), loadMs);
+	}
+	else
+	{
+		ctx->log(RC_LOG_PROGRESS, "loadBSP: '%s' loaded in %.1f ms, face culling disabled.", m_mesh->getMapName().c_str(), loadMs);
+	}
+
+	if (m_mergeBSPFaces)
+	{
+		ctx->log(RC_LOG_PROGRESS, "loadBSP: Merged %d faces into %d polygons, %d triangles instead of %d.",
+				 m_mesh->getBSPFaceCount(), m_mesh->getBSPPolyCount(), m_mesh->getTriCount(),
+				 m_mesh->getBSPUnmergedTriCount());
+	}
+	else
+	{
+		ctx->log(RC_LOG_PROGRESS, "loadBSP: %d faces, %d triangles, face merging disabled.",
+				 m_mesh->getBSPFaceCount(), m_mesh->getTriCount());
+	}
 
 	rcCalcBounds(m_mesh->getVerts(), m_mesh->getVertCount(), m_meshBMin, m_meshBMax);
 
@@ -204,6 +267,11 @@ bool InputGeom::loadBSP(rcContext* ctx, const std::string& filepath)
 		return false;
 	}
 
+	if (m_useBSPGeometryCache && !m_mesh->saveBSPCache(cachePath, m_chunkyMesh))
+	{
+		ctx->log(RC_LOG_WARNING, "loadBSP: Could not write the geometry cache '%s'.", cachePath.c_str());
+	}
+
 	return true;
 }
 
@@ -312,7 +380,8 @@ bool InputGeom::loadGeomSet(rcContext* ctx, const std::string& filepath)
 		{
 			// Settings
 			m_hasBuildSettings = true;
-			sscanf(row + 1, "%f %f %f %f %f %f %f %f %f %f %f %f %f %d %f %f %f %f %f %f %f",
+			m_buildSettings.expectedLayersPerTile = 0;
+			sscanf(row + 1, "%f %f %f %f %f %f %f %f %f %f %f %f %f %d %f %f %f %f %f %f %f %d",
 							&m_buildSettings.cellSize,
 							&m_buildSettings.cellHeight,
 							&m_buildSettings.agentHeight,
@@ -333,7 +402,8 @@ bool InputGeom::loadGeomSet(rcContext* ctx, const std::string& filepath)
 							&m_buildSettings.navMeshBMax[0],
 							&m_buildSettings.navMeshBMax[1],
 							&m_buildSettings.navMeshBMax[2],
-							&m_buildSettings.tileSize);
+							&m_buildSettings.tileSize,
+							&m_buildSettings.expectedLayersPerTile);
 		}
 	}
 	
@@ -383,7 +453,7 @@ bool InputGeom::saveGeomSet(const BuildSettings* settings)
 	if (settings)
 	{
 		fprintf(fp,
-			"s %f %f %f %f %f %f %f %f %f %f %f %f %f %d %f %f %f %f %f %f %f\n",
+			"s %f %f %f %f %f %f %f %f %f %f %f %f %f %d %f %f %f %f %f %f %f %d\n",
 			settings->cellSize,
 			settings->cellHeight,
 			settings->agentHeight,
@@ -404,7 +474,8 @@ bool InputGeom::saveGeomSet(const BuildSettings* settings)
 			settings->navMeshBMax[0],
 			settings->navMeshBMax[1],
 			settings->navMeshBMax[2],
-			settings->tileSize);
+			settings->tileSize,
+			settings->expectedLayersPerTile);
 	}
 	
 	// Store off-mesh links.
@@ -522,18 +593,6 @@ bool InputGeom::raycastMesh(float* src, float* dst, float& tmin, const bool bInc
 	return hit;
 }
 
-void InputGeom::rebuildChunkyTriMesh()
-{
-	if (m_chunkyMesh) { delete m_chunkyMesh; }
-
-	m_chunkyMesh = new rcChunkyTriMesh;
-	if (!m_chunkyMesh)
-	{
-		return;
-	}
-	rcCreateChunkyTriMesh(m_mesh->getVerts(), m_mesh->getTris(), m_mesh->getTriCount(), 256, m_chunkyMesh, m_mesh->getSurfaceTypes());
-}
-
 void InputGeom::addOffMeshConnection(const float* spos, const float* epos, const float rad,
 									 unsigned char bidir, unsigned char area, unsigned int flags)
 {
@@ -710,8 +769,8 @@ void InputGeom::SetTriangleArea(int TriNum, const int NewAreaType)
 {
 	if (m_mesh)
 	{
-
 		m_mesh->SetTriangleSurfaceType(TriNum, NewAreaType);
+		rcSetChunkyTriMeshSurfaceType(m_chunkyMesh, TriNum, NewAreaType);
 	}
 }
 
@@ -720,6 +779,16 @@ void InputGeom::SetModelArea(int ModelNum, const int NewAreaType)
 	if (m_mesh)
 	{
 		m_mesh->SetModelSurfaceType(ModelNum, NewAreaType);
+
+		const int model = m_mesh->getTriModel(ModelNum);
+		if (model <= 0) { return; }
+
+		int ntris = 0;
+		const int* tris = m_mesh->getModelTris(model, &ntris);
+		for (int i = 0; i < ntris; i++)
+		{
+			rcSetChunkyTriMeshSurfaceType(m_chunkyMesh, tris[i], NewAreaType);
+		}
 	}
 }
 
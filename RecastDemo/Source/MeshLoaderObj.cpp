@@ -17,10 +17,14 @@
 //
 
 #include "MeshLoaderObj.h"
+#include "ChunkyTriMesh.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <cstring>
 #include <math.h>
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
 
 #include "BSP.h"
 
@@ -28,11 +32,20 @@ rcMeshLoaderObj::rcMeshLoaderObj() :
 	m_scale(1.0f),
 	m_verts(0),
 	m_tris(0),
+	m_triModels(0),
 	m_normals(0),
 	m_vertCount(0),
 	m_triCount(0),
 	m_surfTypeCount(0),
-	m_surfTypes(0)
+	m_modelCount(0),
+	m_surfTypes(0),
+	m_mergeCoplanarFaces(true),
+	m_bspFaceCount(0),
+	m_bspPolyCount(0),
+	m_bspUnmergedTriCount(0),
+	m_cullVoidFaces(true),
+	m_bspCulledFaceCount(0),
+	m_bspCulledTriCount(0)
 {
 }
 
@@ -42,6 +55,7 @@ rcMeshLoaderObj::~rcMeshLoaderObj()
 	delete[] m_normals;
 	delete[] m_tris;
 	delete[] m_surfTypes;
+	free(m_triModels);
 }
 		
 void rcMeshLoaderObj::addVertex(float x, float y, float z, int& cap)
@@ -260,6 +274,308 @@ bool rcMeshLoaderObj::load(const std::string& filename)
 	return true;
 }
 
+// Brush entities whose models become part of the geometry, and the surface type their faces get.
+struct BSPEntityModelRule
+{
+	const char* classname;
+	int modelType;
+};
+
+static const BSPEntityModelRule BSP_ENTITY_MODEL_RULES[] =
+{
+	{ "func_wall", MT_MODEL_SOLID },
+	{ "func_ladder", MT_MODEL_SOLID },
+	{ "func_seethrough", MT_MODEL_SOLID },
+	{ "func_conveyor", MT_MODEL_SOLID },
+	{ "func_illusionary", MT_MODEL_ILLUSIONARY },
+	{ "func_water", MT_MODEL_ILLUSIONARY },
+	{ "func_door", MT_MODEL_ILLUSIONARY },
+	{ "func_door_rotating", MT_MODEL_ILLUSIONARY },
+	{ "func_seethroughdoor", MT_MODEL_ILLUSIONARY },
+	{ "func_button", MT_MODEL_ILLUSIONARY },
+	{ "func_breakable", MT_MODEL_ILLUSIONARY },
+	{ "func_train", MT_MODEL_ILLUSIONARY },
+};
+
+static const int BSP_NUM_ENTITY_MODEL_RULES = (int)(sizeof(BSP_ENTITY_MODEL_RULES) / sizeof(BSP_ENTITY_MODEL_RULES[0]));
+
+// A convex BSP face, or several coplanar faces merged into one.
+struct BSPMergePoly
+{
+	std::vector<int> verts;
+	int plane;			// Plane index times two plus the plane side.
+	int surfaceType;
+	int model;
+	bool alive;
+};
+
+static inline uint64_t bspEdgeKey(const int a, const int b)
+{
+	return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+}
+
+static void bspPolyNormal(const float* verts, const std::vector<int>& poly, float* n)
+{
+	// Newell's method, robust against collinear vertices.
+	n[0] = n[1] = n[2] = 0.0f;
+	const int nv = (int)poly.size();
+	for (int i = 0, j = nv - 1; i < nv; j = i++)
+	{
+		const float* a = &verts[poly[j] * 3];
+		const float* b = &verts[poly[i] * 3];
+		n[0] += (a[1] - b[1]) * (a[2] + b[2]);
+		n[1] += (a[2] - b[2]) * (a[0] + b[0]);
+		n[2] += (a[0] - b[0]) * (a[1] + b[1]);
+	}
+}
+
+// Returns the signed turn at vertex i, positive for convex corners, zero for collinear ones.
+static float bspPolyTurn(const float* verts, const std::vector<int>& poly, const int i, const float* n)
+{
+	const int nv = (int)poly.size();
+	const float* va = &verts[poly[(i + nv - 1) % nv] * 3];
+	const float* vb = &verts[poly[i] * 3];
+	const float* vc = &verts[poly[(i + 1) % nv] * 3];
+	const float e0[3] = { vb[0] - va[0], vb[1] - va[1], vb[2] - va[2] };
+	const float e1[3] = { vc[0] - vb[0], vc[1] - vb[1], vc[2] - vb[2] };
+	const float c[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+	const float len = sqrtf((e0[0] * e0[0] + e0[1] * e0[1] + e0[2] * e0[2]) * (e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]));
+	if (len <= 0.0f)
+		return 0.0f;
+	return (c[0] * n[0] + c[1] * n[1] + c[2] * n[2]) / len;
+}
+
+// Joins q into p across the edge p[i] -> p[i+1], which q has reversed at q[j] -> q[j+1].
+// Fragments of one face often share a chain of edges split at T-vertices, the whole
+// chain is merged away. Returns false if the result would not be a simple convex polygon.
+static bool bspMergePolys(const float* verts, const std::vector<int>& p, const int i,
+						  const std::vector<int>& q, const int j, std::vector<int>& out)
+{
+	static const float COLLINEAR_EPS = 1e-3f;
+
+	const int np = (int)p.size();
+	const int nq = (int)q.size();
+
+	// The shared chain runs p[ps] .. p[ps+len] forwards and q[qs] .. q[qs+len] backwards.
+	int ps = i;
+	int qs = j;
+	int len = 1;
+	const int maxLen = (np < nq ? np : nq) - 1;
+	while (len < maxLen && p[(ps + len + 1) % np] == q[(qs + nq - 1) % nq])
+	{
+		qs = (qs + nq - 1) % nq;
+		len++;
+	}
+	while (len < maxLen && p[(ps + np - 1) % np] == q[(qs + len + 1) % nq])
+	{
+		ps = (ps + np - 1) % np;
+		len++;
+	}
+
+	out.clear();
+	for (int k = 0; k <= np - len; ++k)
+		out.push_back(p[(ps + len + k) % np]);
+	for (int k = len + 1; k < nq; ++k)
+		out.push_back(q[(qs + k) % nq]);
+
+	// Faces touching along more than one edge would repeat a vertex.
+	for (int a = 0; a < (int)out.size(); ++a)
+		for (int b = a + 1; b < (int)out.size(); ++b)
+			if (out[a] == out[b])
+				return false;
+
+	float n[3];
+	bspPolyNormal(verts, out, n);
+	const float nlen = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (nlen <= 0.0f)
+		return false;
+	n[0] /= nlen; n[1] /= nlen; n[2] /= nlen;
+
+	for (int k = 0; k < (int)out.size(); ++k)
+	{
+		if (bspPolyTurn(verts, out, k, n) < -COLLINEAR_EPS)
+			return false;
+	}
+	return true;
+}
+
+// Drops vertices that lie on a straight edge, they only add sliver triangles to the fan.
+static void bspRemoveCollinearVerts(const float* verts, std::vector<int>& poly)
+{
+	static const float COLLINEAR_EPS = 1e-3f;
+
+	float n[3];
+	bspPolyNormal(verts, poly, n);
+	const float nlen = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+	if (nlen <= 0.0f)
+		return;
+	n[0] /= nlen; n[1] /= nlen; n[2] /= nlen;
+
+	for (int k = 0; k < (int)poly.size() && poly.size() > 3; )
+	{
+		if (fabsf(bspPolyTurn(verts, poly, k, n)) <= COLLINEAR_EPS)
+			poly.erase(poly.begin() + k);
+		else
+			++k;
+	}
+}
+
+// Merges adjacent convex faces that share a plane, surface type and model into larger
+// convex polygons. BSP compilation splits faces along the BSP planes and lightmap extents,
+// the fragments share edges through the vertex lump so they can be found by edge.
+// Returns the number of polygons left.
+static int bspMergeCoplanarFaces(const float* verts, std::vector<BSPMergePoly>& polys)
+{
+	// Directed edge to the polygon using it.
+	std::unordered_map<uint64_t, int> edgeMap;
+	for (int pi = 0; pi < (int)polys.size(); ++pi)
+	{
+		const std::vector<int>& pv = polys[pi].verts;
+		for (int k = 0, nv = (int)pv.size(); k < nv; ++k)
+			edgeMap[bspEdgeKey(pv[k], pv[(k + 1) % nv])] = pi;
+	}
+
+	std::vector<int> merged;
+	for (int pi = 0; pi < (int)polys.size(); ++pi)
+	{
+		BSPMergePoly& p = polys[pi];
+		if (!p.alive)
+			continue;
+
+		// Keep growing p until none of its edges can be merged across.
+		for (int k = 0; k < (int)p.verts.size(); )
+		{
+			const int nv = (int)p.verts.size();
+			const int a = p.verts[k];
+			const int b = p.verts[(k + 1) % nv];
+			std::unordered_map<uint64_t, int>::iterator it = edgeMap.find(bspEdgeKey(b, a));
+			if (it == edgeMap.end() || it->second == pi)
+			{
+				++k;
+				continue;
+			}
+
+			BSPMergePoly& q = polys[it->second];
+			if (!q.alive || q.plane != p.plane || q.surfaceType != p.surfaceType || q.model != p.model)
+			{
+				++k;
+				continue;
+			}
+
+			int j = 0;
+			const int nq = (int)q.verts.size();
+			while (j < nq && !(q.verts[j] == b && q.verts[(j + 1) % nq] == a))
+				++j;
+			if (j == nq || !bspMergePolys(verts, p.verts, k, q.verts, j, merged))
+			{
+				++k;
+				continue;
+			}
+
+			for (int e = 0; e < nv; ++e)
+				edgeMap.erase(bspEdgeKey(p.verts[e], p.verts[(e + 1) % nv]));
+			for (int e = 0; e < nq; ++e)
+				edgeMap.erase(bspEdgeKey(q.verts[e], q.verts[(e + 1) % nq]));
+			for (int e = 0, nm = (int)merged.size(); e < nm; ++e)
+				edgeMap[bspEdgeKey(merged[e], merged[(e + 1) % nm])] = pi;
+
+			p.verts.swap(merged);
+			q.alive = false;
+			q.verts.clear();
+			k = 0;
+		}
+	}
+
+	int npolys = 0;
+	for (int pi = 0; pi < (int)polys.size(); ++pi)
+	{
+		if (!polys[pi].alive)
+			continue;
+		bspRemoveCollinearVerts(verts, polys[pi].verts);
+		npolys++;
+	}
+	return npolys;
+}
+
+// The world BSP tree, used to find the contents of points in the map.
+struct BSPHull
+{
+	const BSPPLANE* planes;
+	int numPlanes;
+	const BSPNODE* nodes;
+	int numNodes;
+	const BSPLEAF* leaves;
+	int numLeaves;
+	int headNode;
+};
+
+static int bspPointContents(const BSPHull& hull, const float* pos)
+{
+	int n = hull.headNode;
+	while (n >= 0)
+	{
+		if (n >= hull.numNodes || hull.nodes[n].iPlane >= (uint32_t)hull.numPlanes)
+			return CONTENTS_EMPTY;
+		const BSPNODE& node = hull.nodes[n];
+		const BSPPLANE& plane = hull.planes[node.iPlane];
+		const float d = plane.vNormal.x * pos[0] + plane.vNormal.y * pos[1] + plane.vNormal.z * pos[2] - plane.fDist;
+		n = d >= 0.0f ? node.iChildren[0] : node.iChildren[1];
+	}
+	const int leaf = ~n;
+	if (leaf >= hull.numLeaves)
+		return CONTENTS_EMPTY;
+	return hull.leaves[leaf].nContents;
+}
+
+// Returns true if the space in front of the face is solid or sky everywhere it is sampled,
+// such faces only face the void outside the map or the inside of brushes and nothing can stand on them.
+// The vertices have already been swapped to Recast coordinates, the hull is in BSP coordinates.
+static bool bspFaceFacesVoid(const BSPHull& hull, const float* verts, const uint16_t* indices, const int nverts,
+							 const BSPPLANE& plane, const bool planeSide)
+{
+	// Distance in front of the face to sample at, in GoldSrc units.
+	static const float SAMPLE_OFFSET = 1.0f;
+	// Samples are pulled this far from the vertices towards the center.
+	static const float SAMPLE_INSET = 0.1f;
+
+	if (nverts < 3)
+		return false;
+
+	const float side = planeSide ? -1.0f : 1.0f;
+	const float off[3] = { plane.vNormal.x * side * SAMPLE_OFFSET, plane.vNormal.y * side * SAMPLE_OFFSET, plane.vNormal.z * side * SAMPLE_OFFSET };
+
+	float center[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < nverts; ++i)
+	{
+		const float* v = &verts[indices[i] * 3];
+		center[0] += v[0];
+		center[1] -= v[2];
+		center[2] += v[1];
+	}
+	center[0] /= nverts;
+	center[1] /= nverts;
+	center[2] /= nverts;
+
+	for (int i = -1; i < nverts; ++i)
+	{
+		float pos[3] = { center[0], center[1], center[2] };
+		if (i >= 0)
+		{
+			const float* v = &verts[indices[i] * 3];
+			const float bv[3] = { v[0], -v[2], v[1] };
+			for (int j = 0; j < 3; ++j)
+				pos[j] = bv[j] + (center[j] - bv[j]) * SAMPLE_INSET;
+		}
+		for (int j = 0; j < 3; ++j)
+			pos[j] += off[j];
+
+		const int contents = bspPointContents(hull, pos);
+		if (contents != CONTENTS_SOLID && contents != CONTENTS_SKY)
+			return false;
+	}
+	return true;
+}
+
 char* GetEntityDefClassName(BSPENTITYDEF* entity)
 {
 	return entity->properties[entity->numProperties].propertyValue;
@@ -406,6 +722,30 @@ bool rcMeshLoaderObj::loadBSP(const std::string& filename)
 		fseek(bspfile, fileHeader.lump[LUMP_ENTITIES].nOffset, SEEK_SET);
 		fread(entitiesText, entitiesLength, 1, bspfile);
 
+		// Read the world BSP tree to find faces that face the void
+		BSPHull hull;
+		hull.numPlanes = fileHeader.lump[LUMP_PLANES].nLength / sizeof(BSPPLANE);
+		hull.numNodes = fileHeader.lump[LUMP_NODES].nLength / sizeof(BSPNODE);
+		hull.numLeaves = fileHeader.lump[LUMP_LEAVES].nLength / sizeof(BSPLEAF);
+		hull.headNode = numModels > 0 ? models[0].iHeadnodes[0] : 0;
+
+		BSPPLANE* planes = (BSPPLANE*)malloc(hull.numPlanes * sizeof(BSPPLANE) + 1);
+		BSPNODE* nodes = (BSPNODE*)malloc(hull.numNodes * sizeof(BSPNODE) + 1);
+		BSPLEAF* leaves = (BSPLEAF*)malloc(hull.numLeaves * sizeof(BSPLEAF) + 1);
+
+		fseek(bspfile, fileHeader.lump[LUMP_PLANES].nOffset, SEEK_SET);
+		fread(planes, hull.numPlanes * sizeof(BSPPLANE), 1, bspfile);
+
+		fseek(bspfile, fileHeader.lump[LUMP_NODES].nOffset, SEEK_SET);
+		fread(nodes, hull.numNodes * sizeof(BSPNODE), 1, bspfile);
+
+		fseek(bspfile, fileHeader.lump[LUMP_LEAVES].nOffset, SEEK_SET);
+		fread(leaves, hull.numLeaves * sizeof(BSPLEAF), 1, bspfile);
+
+		hull.planes = planes;
+		hull.nodes = nodes;
+		hull.leaves = leaves;
+
 		// First count how many entities we have
 		int nEntities = 0;
 
@@ -476,71 +816,66 @@ bool rcMeshLoaderObj::loadBSP(const std::string& filename)
 
 		for (int i = 0; i < nEntities; i++)
 		{
-
-			if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_wall"))
+			const char* classname = GetEntityDefClassname(&entityDefs[i]);
+			for (int r = 0; r < BSP_NUM_ENTITY_MODEL_RULES; r++)
 			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_SOLID;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_ladder"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_SOLID;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_seethrough"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_SOLID;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_conveyor"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_SOLID;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_illusionary"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_ILLUSIONARY;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_water"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_ILLUSIONARY;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_door"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_ILLUSIONARY;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_door_rotating"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_ILLUSIONARY;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_seethroughdoor"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_ILLUSIONARY;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_button"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_ILLUSIONARY;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_breakable"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_ILLUSIONARY;
-			}
-			else if (FStrEq(GetEntityDefClassname(&entityDefs[i]), "func_train"))
-			{
-				validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
-				validModels[modelCounter++].modelType = MT_MODEL_ILLUSIONARY;
+				if (FStrEq(classname, BSP_ENTITY_MODEL_RULES[r].classname))
+				{
+					validModels[modelCounter].model = models[GetEntityModelRef(&entityDefs[i])];
+					validModels[modelCounter++].modelType = BSP_ENTITY_MODEL_RULES[r].modelType;
+					break;
+				}
 			}
 		}
 
 		m_modelCount = modelCounter;
 
+		// Record the landmarks and level transitions so the nav data of campaign maps can be stitched together
+		m_landmarks.clear();
+		m_levelTransitions.clear();
+
+		for (int i = 0; i < nEntities; i++)
+		{
+			if (!FStrEq(GetEntityDefClassname(&entityDefs[i]), "info_landmark"))
+				continue;
+
+			float origin[3] = { 0.0f, 0.0f, 0.0f };
+			sscanf(GetEntityPropertyValueByName(&entityDefs[i], "origin"), "%f %f %f", &origin[0], &origin[1], &origin[2]);
+
+			BSPLandmark landmark;
+			memset(&landmark, 0, sizeof(landmark));
+			strncpy(landmark.name, GetEntityPropertyValueByName(&entityDefs[i], "targetname"), sizeof(landmark.name) - 1);
+			landmark.pos[0] = origin[0] * m_scale;
+			landmark.pos[1] = origin[2] * m_scale;
+			landmark.pos[2] = -origin[1] * m_scale;
+			m_landmarks.push_back(landmark);
+		}
+
+		for (int i = 0; i < nEntities; i++)
+		{
+			if (!FStrEq(GetEntityDefClassname(&entityDefs[i]), "trigger_changelevel"))
+				continue;
+
+			const int modelRef = GetEntityModelRef(&entityDefs[i]);
+			if (modelRef <= 0 || modelRef >= numModels)
+				continue;
+
+			// Swap the Y and Z axis and mirror the Z axis of the trigger bounds, like the vertices
+			const BSPMODEL& model = models[modelRef];
+
+			BSPLevelTransition transition;
+			memset(&transition, 0, sizeof(transition));
+			strncpy(transition.mapName, GetEntityPropertyValueByName(&entityDefs[i], "map"), sizeof(transition.mapName) - 1);
+			strncpy(transition.landmarkName, GetEntityPropertyValueByName(&entityDefs[i], "landmark"), sizeof(transition.landmarkName) - 1);
+			transition.bmin[0] = model.nMins[0] * m_scale;
+			transition.bmin[1] = model.nMins[2] * m_scale;
+			transition.bmin[2] = -model.nMaxs[1] * m_scale;
+			transition.bmax[0] = model.nMaxs[0] * m_scale;
+			transition.bmax[1] = model.nMaxs[2] * m_scale;
+			transition.bmax[2] = -model.nMins[1] * m_scale;
+			m_levelTransitions.push_back(transition);
+		}
+
 		for (int x = 0; x < modelCounter; x++)
 		{
 			for (int i = 0; i < validModels[x].model.nFaces; i++)
@@ -556,6 +891,12 @@ bool rcMeshLoaderObj::loadBSP(const std::string& filename)
 		int triCounter = 0;
 		int surftypeCounter = 0;
 
+		std::vector<BSPMergePoly> facePolys;
+		facePolys.reserve(solidFaceCounter);
+		m_bspUnmergedTriCount = 0;
+		m_bspCulledFaceCount = 0;
+		m_bspCulledTriCount = 0;
+
 		// Loop through faces
 		for (int i = 0; i < solidFaceCounter; i++)
 		{
@@ -633,30 +974,67 @@ bool rcMeshLoaderObj::loadBSP(const std::string& filename)
 			}
 
 
-			// Thankfully all faces in a HL BSP are convex, so triangulate by fanning out from the first vertex
-			int indexCounter = 1;
-			int totalIndices = (nEdges - 2);
-
-			numTris += totalIndices;
+			// Faces of brush models with an origin are not placed in world space, leave them be
+			const VECTOR3D& modelOrigin = validModels[modelIndex].model.vOrigin;
+			const bool inWorldSpace = modelOrigin.x == 0.0f && modelOrigin.y == 0.0f && modelOrigin.z == 0.0f;
 
-			for (int x = 0; x < totalIndices; x++)
+			if (m_cullVoidFaces && inWorldSpace && hull.numNodes > 0 && ThisFace->iPlane < hull.numPlanes &&
+				bspFaceFacesVoid(hull, triData->verts, sIndices, counter, planes[ThisFace->iPlane], ThisFace->nPlaneSide != 0))
 			{
-				triData->surfaceType[surftypeCounter] = faceType;
+				m_bspCulledFaceCount++;
+				m_bspCulledTriCount += nEdges - 2;
 
-				m_triModels[surftypeCounter] = modelIndex;
-				triData->tris[triCounter++] = sIndices[0];
-				triData->tris[triCounter++] = sIndices[++indexCounter];
-				triData->tris[triCounter++] = sIndices[indexCounter - 1];
+				free(sIndices);
+				free(sEdges);
+				continue;
+			}
 
-				surftypeCounter++;
+			BSPMergePoly poly;
+			poly.verts.assign(sIndices, sIndices + counter);
+			poly.plane = ThisFace->iPlane * 2 + (ThisFace->nPlaneSide ? 1 : 0);
+			poly.surfaceType = faceType;
+			poly.model = modelIndex;
+			poly.alive = true;
+			facePolys.push_back(poly);
 
-			}
+			m_bspUnmergedTriCount += nEdges - 2;
 
 			// Clean up
 			free(sIndices);
 			free(sEdges);
 		}
 
+		m_bspFaceCount = (int)facePolys.size();
+		m_bspPolyCount = m_bspFaceCount;
+		if (m_mergeCoplanarFaces)
+			m_bspPolyCount = bspMergeCoplanarFaces(triData->verts, facePolys);
+
+		// Thankfully all faces in a HL BSP are convex, and so are the merged ones, so triangulate by fanning out from the first vertex
+		for (int i = 0; i < (int)facePolys.size(); i++)
+		{
+			const BSPMergePoly& poly = facePolys[i];
+			if (!poly.alive)
+				continue;
+
+			const int totalIndices = (int)poly.verts.size() - 2;
+			if (numTris + totalIndices > MAX_MAP_TRIS)
+				break;
+
+			numTris += totalIndices;
+
+			for (int x = 0; x < totalIndices; x++)
+			{
+				triData->surfaceType[surftypeCounter] = poly.surfaceType;
+
+				m_triModels[surftypeCounter] = poly.model;
+				triData->tris[triCounter++] = poly.verts[0];
+				triData->tris[triCounter++] = poly.verts[x + 2];
+				triData->tris[triCounter++] = poly.verts[x + 1];
+
+				surftypeCounter++;
+			}
+		}
+
 		triData->ntris = numTris;
 
 		int vcap = 0;
@@ -674,6 +1052,8 @@ bool rcMeshLoaderObj::loadBSP(const std::string& filename)
 			addTriangle(triData->tris[(i * 3)], triData->tris[(i * 3) + 1], triData->tris[(i * 3) + 2], tcap, triData->surfaceType[i]);
 		}
 
+		buildModelTriIndex();
+
 		// Calculate normals.
 		m_normals = new float[m_triCount * 3];
 		for (int i = 0; i < m_triCount * 3; i += 3)
@@ -708,6 +1088,9 @@ bool rcMeshLoaderObj::loadBSP(const std::string& filename)
 		m_mapname = base_filename.substr(0, p);
 
 		fclose(bspfile);
+		free(planes);
+		free(nodes);
+		free(leaves);
 		free(faces);
 		free(edges);
 		free(surfedges);
@@ -731,18 +1114,394 @@ void rcMeshLoaderObj::SetTriangleSurfaceType(const int TriNum, const int NewSurf
 
 void rcMeshLoaderObj::SetModelSurfaceType(const int ModelNum, const int NewSurfaceType)
 {
-	if (m_triModels)
+	const int modelNum = getTriModel(ModelNum);
+
+	if (modelNum <= 0) { return; }
+
+	int ntris = 0;
+	const int* tris = getModelTris(modelNum, &ntris);
+
+	for (int i = 0; i < ntris; i++)
+	{
+		SetTriangleSurfaceType(tris[i], NewSurfaceType);
+	}
+}
+
+const int* rcMeshLoaderObj::getModelTris(const int model, int* count) const
+{
+	*count = 0;
+	if (model < 0 || model >= m_modelCount || m_modelTriStart.empty())
+		return 0;
+
+	*count = m_modelTriStart[model + 1] - m_modelTriStart[model];
+	return *count > 0 ? &m_modelTris[m_modelTriStart[model]] : 0;
+}
+
+// Groups the triangles by brush model, so the triangles of a model can be found without scanning the mesh.
+void rcMeshLoaderObj::buildModelTriIndex()
+{
+	m_modelTriStart.assign(m_modelCount + 1, 0);
+	m_modelTris.clear();
+	if (!m_triModels)
+		return;
+
+	for (int i = 0; i < m_triCount; i++)
+	{
+		if (m_triModels[i] >= 0 && m_triModels[i] < m_modelCount)
+			m_modelTriStart[m_triModels[i] + 1]++;
+	}
+	for (int i = 0; i < m_modelCount; i++)
+		m_modelTriStart[i + 1] += m_modelTriStart[i];
+
+	m_modelTris.resize(m_modelTriStart[m_modelCount]);
+	std::vector<int> next(m_modelTriStart.begin(), m_modelTriStart.end() - 1);
+	for (int i = 0; i < m_triCount; i++)
+	{
+		if (m_triModels[i] >= 0 && m_triModels[i] < m_modelCount)
+			m_modelTris[next[m_triModels[i]]++] = i;
+	}
+}
+static const int BSP_CACHE_MAGIC = 'B'<<24 | 'S'<<16 | 'P'<<8 | 'C'; //'BSPC';
+static const int BSP_CACHE_VERSION = 1;
+// Bump when loadBSP turns the faces of a BSP into triangles differently, so old caches are rebuilt.
+static const int BSP_GEOMETRY_VERSION = 1;
+// Sections of the cache file start at this alignment, so they can be used in place when the file is mapped.
+static const int BSP_CACHE_ALIGN = 16;
+
+struct BSPCacheHeader
+{
+	int magic;
+	int version;
+	uint64_t key;
+
+	int vertCount;
+	int triCount;
+	int modelCount;
+	int bspFaceCount;
+	int bspPolyCount;
+	int bspUnmergedTriCount;
+	int bspCulledFaceCount;
+	int bspCulledTriCount;
+	int landmarkCount;
+	int levelTransitionCount;
+	int chunkyNodeCount;
+	int chunkyMaxTrisPerChunk;
+
+	int vertsOffset;
+	int normalsOffset;
+	int trisOffset;
+	int surfTypesOffset;
+	int triModelsOffset;
+	int landmarksOffset;
+	int levelTransitionsOffset;
+	int chunkyNodesOffset;
+	int chunkyTrisOffset;
+	int chunkySurfTypesOffset;
+	int chunkyTriMapOffset;
+};
+
+static inline uint64_t fnv1a64(uint64_t hash, const void* data, const size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool rcMeshLoaderObj::calcBSPCacheKey(const std::string& filename, uint64_t* key) const
+{
+	FILE* fp = fopen(filename.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	uint64_t hash = 14695981039346656037ULL;
+	unsigned char buf[65536];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		hash = fnv1a64(hash, buf, n);
+	fclose(fp);
+
+	// The rules the faces are turned into triangles with.
+	for (int i = 0; i < BSP_NUM_ENTITY_MODEL_RULES; i++)
 	{
-		int modelNum = m_triModels[ModelNum];
+		const BSPEntityModelRule& rule = BSP_ENTITY_MODEL_RULES[i];
+		hash = fnv1a64(hash, rule.classname, strlen(rule.classname) + 1);
+		hash = fnv1a64(hash, &rule.modelType, sizeof(rule.modelType));
+	}
+	const int settings[4] = { BSP_GEOMETRY_VERSION, m_mergeCoplanarFaces ? 1 : 0, m_cullVoidFaces ? 1 : 0, MAX_MAP_TRIS };
+	hash = fnv1a64(hash, settings, sizeof(settings));
+	hash = fnv1a64(hash, &m_scale, sizeof(m_scale));
+
+	*key = hash;
+	return true;
+}
 
-		if (modelNum <= 0) { return; }
+static int writeCacheSection(FILE* fp, const void* data, const size_t size)
+{
+	static const unsigned char zeros[BSP_CACHE_ALIGN] = { 0 };
+	const long offset = ftell(fp);
+	const long padding = (BSP_CACHE_ALIGN - offset % BSP_CACHE_ALIGN) % BSP_CACHE_ALIGN;
+	if (padding > 0)
+		fwrite(zeros, (size_t)padding, 1, fp);
+	if (size > 0)
+		fwrite(data, size, 1, fp);
+	return (int)(offset + padding);
+}
 
-		for (int i = 0; i < m_triCount; i++)
+static bool readCacheSection(FILE* fp, const int offset, void* data, const size_t size)
+{
+	if (size == 0)
+		return true;
+	if (fseek(fp, offset, SEEK_SET) != 0)
+		return false;
+	return fread(data, size, 1, fp) == 1;
+}
+
+bool rcMeshLoaderObj::saveBSPCache(const std::string& cacheFilename, const rcChunkyTriMesh* chunkyMesh) const
+{
+	if (!chunkyMesh || !chunkyMesh->triMap || chunkyMesh->ntris != m_triCount)
+		return false;
+
+	BSPCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = BSP_CACHE_MAGIC;
+	header.version = BSP_CACHE_VERSION;
+	if (!calcBSPCacheKey(m_filename, &header.key))
+		return false;
+
+	// Written to a temporary file that only replaces the cache once complete, with a zeroed
+	// header until the end, so an interrupted write never leaves a cache that loads.
+	const std::string tempFilename = cacheFilename + ".tmp";
+	FILE* fp = fopen(tempFilename.c_str(), "wb");
+	if (!fp)
+		return false;
+
+	BSPCacheHeader emptyHeader;
+	memset(&emptyHeader, 0, sizeof(emptyHeader));
+	fwrite(&emptyHeader, sizeof(emptyHeader), 1, fp);
+
+	header.vertCount = m_vertCount;
+	header.triCount = m_triCount;
+	header.modelCount = m_modelCount;
+	header.bspFaceCount = m_bspFaceCount;
+	header.bspPolyCount = m_bspPolyCount;
+	header.bspUnmergedTriCount = m_bspUnmergedTriCount;
+	header.bspCulledFaceCount = m_bspCulledFaceCount;
+	header.bspCulledTriCount = m_bspCulledTriCount;
+	header.landmarkCount = (int)m_landmarks.size();
+	header.levelTransitionCount = (int)m_levelTransitions.size();
+	header.chunkyNodeCount = chunkyMesh->nnodes;
+	header.chunkyMaxTrisPerChunk = chunkyMesh->maxTrisPerChunk;
+
+	header.vertsOffset = writeCacheSection(fp, m_verts, sizeof(float) * 3 * m_vertCount);
+	header.normalsOffset = writeCacheSection(fp, m_normals, sizeof(float) * 3 * m_triCount);
+	header.trisOffset = writeCacheSection(fp, m_tris, sizeof(int) * 3 * m_triCount);
+	header.surfTypesOffset = writeCacheSection(fp, m_surfTypes, sizeof(int) * m_triCount);
+	// Meshes without brush models store every triangle in the world model.
+	std::vector<int> worldModels;
+	if (!m_triModels)
+		worldModels.assign(m_triCount, 0);
+	header.triModelsOffset = writeCacheSection(fp, m_triModels ? m_triModels : &worldModels[0], sizeof(int) * m_triCount);
+	header.landmarksOffset = writeCacheSection(fp, m_landmarks.empty() ? 0 : &m_landmarks[0], sizeof(BSPLandmark) * m_landmarks.size());
+	header.levelTransitionsOffset = writeCacheSection(fp, m_levelTransitions.empty() ? 0 : &m_levelTransitions[0],
+													  sizeof(BSPLevelTransition) * m_levelTransitions.size());
+	header.chunkyNodesOffset = writeCacheSection(fp, chunkyMesh->nodes, sizeof(rcChunkyTriMeshNode) * chunkyMesh->nnodes);
+	header.chunkyTrisOffset = writeCacheSection(fp, chunkyMesh->tris, sizeof(int) * 3 * chunkyMesh->ntris);
+	header.chunkySurfTypesOffset = writeCacheSection(fp, chunkyMesh->surfTypes, sizeof(int) * chunkyMesh->ntris);
+	header.chunkyTriMapOffset = writeCacheSection(fp, chunkyMesh->triMap, sizeof(int) * chunkyMesh->ntris);
+
+	fflush(fp);
+	fseek(fp, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, fp);
+	bool ok = ferror(fp) == 0;
+	if (fclose(fp) != 0)
+		ok = false;
+
+	// rename does not replace an existing file on every platform.
+	if (ok)
+	{
+		remove(cacheFilename.c_str());
+		ok = rename(tempFilename.c_str(), cacheFilename.c_str()) == 0;
+	}
+	if (!ok)
+		remove(tempFilename.c_str());
+	return ok;
+}
+
+static bool isValidBSPCacheHeader(const BSPCacheHeader& header, const long fileSize)
+{
+	if (header.vertCount <= 0 || header.triCount <= 0 || header.chunkyNodeCount <= 0 || header.chunkyMaxTrisPerChunk <= 0 ||
+		header.modelCount < 0 || header.landmarkCount < 0 || header.levelTransitionCount < 0)
+		return false;
+
+	// Every section follows the header and ends inside the file.
+	const long long nverts = header.vertCount;
+	const long long ntris = header.triCount;
+	const struct { int offset; long long size; } sections[] = {
+		{ header.vertsOffset, nverts * 3 * (long long)sizeof(float) },
+		{ header.normalsOffset, ntris * 3 * (long long)sizeof(float) },
+		{ header.trisOffset, ntris * 3 * (long long)sizeof(int) },
+		{ header.surfTypesOffset, ntris * (long long)sizeof(int) },
+		{ header.triModelsOffset, ntris * (long long)sizeof(int) },
+		{ header.landmarksOffset, header.landmarkCount * (long long)sizeof(BSPLandmark) },
+		{ header.levelTransitionsOffset, header.levelTransitionCount * (long long)sizeof(BSPLevelTransition) },
+		{ header.chunkyNodesOffset, header.chunkyNodeCount * (long long)sizeof(rcChunkyTriMeshNode) },
+		{ header.chunkyTrisOffset, ntris * 3 * (long long)sizeof(int) },
+		{ header.chunkySurfTypesOffset, ntris * (long long)sizeof(int) },
+		{ header.chunkyTriMapOffset, ntris * (long long)sizeof(int) },
+	};
+	for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++)
+	{
+		if (sections[i].size == 0)
+			continue;
+		if (sections[i].offset < (int)sizeof(BSPCacheHeader) || (long long)sections[i].offset + sections[i].size > (long long)fileSize)
+			return false;
+	}
+
+	return true;
+}
+
+// Checks the indices the chunky mesh is traversed with, so a damaged cache can not send
+// rcGetChunksOverlappingRect or the tile builds out of bounds.
+static bool isValidBSPCacheMesh(const int nverts, const int ntris, const int* tris,
+								const rcChunkyTriMeshNode* nodes, const int nnodes, const int maxTrisPerChunk,
+								const int* chunkyTris, const int* chunkyTriMap)
+{
+	for (int i = 0; i < ntris * 3; i++)
+	{
+		if (tris[i] < 0 || tris[i] >= nverts || chunkyTris[i] < 0 || chunkyTris[i] >= nverts)
+			return false;
+	}
+	for (int i = 0; i < ntris; i++)
+	{
+		if (chunkyTriMap[i] < 0 || chunkyTriMap[i] >= ntris)
+			return false;
+	}
+	for (int i = 0; i < nnodes; i++)
+	{
+		const rcChunkyTriMeshNode& node = nodes[i];
+		if (node.i >= 0)
 		{
-			if (m_triModels[i] == modelNum)
-			{
-				SetTriangleSurfaceType(i, NewSurfaceType);
-			}
+			if (node.n < 0 || node.n > maxTrisPerChunk || node.i > ntris - node.n)
+				return false;
+		}
+		else if (node.i < -(nnodes - i))
+		{
+			// Escape index past the end of the tree.
+			return false;
 		}
 	}
-}
\ No newline at end of file
+	return true;
+}
+
+bool rcMeshLoaderObj::loadBSPCache(const std::string& filename, const std::string& cacheFilename, rcChunkyTriMesh* chunkyMesh)
+{
+	if (!chunkyMesh || m_verts || m_tris)
+		return false;
+
+	FILE* fp = fopen(cacheFilename.c_str(), "rb");
+	if (!fp)
+		return false;
+
+	fseek(fp, 0, SEEK_END);
+	const long fileSize = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+
+	BSPCacheHeader header;
+	uint64_t key = 0;
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+		header.magic != BSP_CACHE_MAGIC || header.version != BSP_CACHE_VERSION ||
+		!isValidBSPCacheHeader(header, fileSize) ||
+		!calcBSPCacheKey(filename, &key) || key != header.key)
+	{
+		fclose(fp);
+		return false;
+	}
+
+	const int nverts = header.vertCount;
+	const int ntris = header.triCount;
+
+	float* verts = new float[nverts * 3];
+	float* normals = new float[ntris * 3];
+	int* tris = new int[ntris * 3];
+	int* surfTypes = new int[ntris];
+	int* triModels = (int*)malloc(sizeof(int) * ntris);
+	std::vector<BSPLandmark> landmarks(header.landmarkCount);
+	std::vector<BSPLevelTransition> transitions(header.levelTransitionCount);
+	rcChunkyTriMeshNode* nodes = new rcChunkyTriMeshNode[header.chunkyNodeCount];
+	int* chunkyTris = new int[ntris * 3];
+	int* chunkySurfTypes = new int[ntris];
+	int* chunkyTriMap = new int[ntris];
+
+	bool ok = triModels != 0;
+	ok = ok && readCacheSection(fp, header.vertsOffset, verts, sizeof(float) * 3 * nverts);
+	ok = ok && readCacheSection(fp, header.normalsOffset, normals, sizeof(float) * 3 * ntris);
+	ok = ok && readCacheSection(fp, header.trisOffset, tris, sizeof(int) * 3 * ntris);
+	ok = ok && readCacheSection(fp, header.surfTypesOffset, surfTypes, sizeof(int) * ntris);
+	ok = ok && readCacheSection(fp, header.triModelsOffset, triModels, sizeof(int) * ntris);
+	ok = ok && readCacheSection(fp, header.landmarksOffset, landmarks.empty() ? 0 : &landmarks[0], sizeof(BSPLandmark) * landmarks.size());
+	ok = ok && readCacheSection(fp, header.levelTransitionsOffset, transitions.empty() ? 0 : &transitions[0],
+								sizeof(BSPLevelTransition) * transitions.size());
+	ok = ok && readCacheSection(fp, header.chunkyNodesOffset, nodes, sizeof(rcChunkyTriMeshNode) * header.chunkyNodeCount);
+	ok = ok && readCacheSection(fp, header.chunkyTrisOffset, chunkyTris, sizeof(int) * 3 * ntris);
+	ok = ok && readCacheSection(fp, header.chunkySurfTypesOffset, chunkySurfTypes, sizeof(int) * ntris);
+	ok = ok && readCacheSection(fp, header.chunkyTriMapOffset, chunkyTriMap, sizeof(int) * ntris);
+	fclose(fp);
+
+	ok = ok && isValidBSPCacheMesh(nverts, ntris, tris, nodes, header.chunkyNodeCount, header.chunkyMaxTrisPerChunk,
+								   chunkyTris, chunkyTriMap);
+
+	if (!ok)
+	{
+		delete[] verts;
+		delete[] normals;
+		delete[] tris;
+		delete[] surfTypes;
+		free(triModels);
+		delete[] nodes;
+		delete[] chunkyTris;
+		delete[] chunkySurfTypes;
+		delete[] chunkyTriMap;
+		return false;
+	}
+
+	m_verts = verts;
+	m_normals = normals;
+	m_tris = tris;
+	m_surfTypes = surfTypes;
+	m_triModels = triModels;
+	m_vertCount = nverts;
+	m_triCount = ntris;
+	m_surfTypeCount = ntris;
+	m_modelCount = header.modelCount;
+	m_bspFaceCount = header.bspFaceCount;
+	m_bspPolyCount = header.bspPolyCount;
+	m_bspUnmergedTriCount = header.bspUnmergedTriCount;
+	m_bspCulledFaceCount = header.bspCulledFaceCount;
+	m_bspCulledTriCount = header.bspCulledTriCount;
+	m_landmarks.swap(landmarks);
+	m_levelTransitions.swap(transitions);
+	buildModelTriIndex();
+
+	m_filename = filename;
+	std::string base_filename = m_filename.substr(m_filename.find_last_of("/\\") + 1);
+	std::string::size_type const p(base_filename.find_last_of('.'));
+	m_mapname = base_filename.substr(0, p);
+
+	delete[] chunkyMesh->nodes;
+	delete[] chunkyMesh->tris;
+	delete[] chunkyMesh->surfTypes;
+	delete[] chunkyMesh->triMap;
+	chunkyMesh->nodes = nodes;
+	chunkyMesh->nnodes = header.chunkyNodeCount;
+	chunkyMesh->tris = chunkyTris;
+	chunkyMesh->surfTypes = chunkySurfTypes;
+	chunkyMesh->triMap = chunkyTriMap;
+	chunkyMesh->ntris = ntris;
+	chunkyMesh->maxTrisPerChunk = header.chunkyMaxTrisPerChunk;
+
+	return true;
+}
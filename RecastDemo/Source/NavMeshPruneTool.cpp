@@ -152,9 +152,9 @@ static void floodNavmesh(dtNavMesh* nav, NavmeshFlags* flags, dtPolyRef start, u
 		nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
 
 		// Visit linked polygons.
-		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = nav->getLink(tile, i)->next)
 		{
-			const dtPolyRef neiRef = tile->links[i].ref;
+			const dtPolyRef neiRef = nav->getLink(tile, i)->ref;
 			// Skip invalid and already visited.
 			if (!neiRef || flags->getFlags(neiRef))
 				continue;
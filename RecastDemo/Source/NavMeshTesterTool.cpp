@@ -83,14 +83,15 @@ static int fixupShortcuts(dtPolyRef* path, int npath, dtNavMeshQuery* navQuery)
 	dtPolyRef neis[maxNeis];
 	int nneis = 0;
 
+	const dtNavMesh* nav = navQuery->getAttachedNavMesh();
 	const dtMeshTile* tile = 0;
 	const dtPoly* poly = 0;
-	if (dtStatusFailed(navQuery->getAttachedNavMesh()->getTileAndPolyByRef(path[0], &tile, &poly)))
+	if (dtStatusFailed(nav->getTileAndPolyByRef(path[0], &tile, &poly)))
 		return npath;
 	
-	for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+	for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = nav->getLink(tile, k)->next)
 	{
-		const dtLink* link = &tile->links[k];
+		const dtLink* link = nav->getLink(tile, k);
 		if (link->ref != 0)
 		{
 			if (nneis < maxNeis)
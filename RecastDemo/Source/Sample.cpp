@@ -32,6 +32,7 @@
 #include "SDL_opengl.h"
 
 #include "NavProfiles.h"
+#include "Filelist.h"
 
 #ifdef WIN32
 #	define snprintf _snprintf
@@ -79,6 +80,7 @@ Sample::Sample() :
 	m_filterLedgeSpans(false),
 	m_filterWalkableLowHeightSpans(true),
 	m_drawIllusionary(true),
+	m_captureTiles(false),
 	m_tool(0),
 	m_ctx(0)
 {
@@ -280,6 +282,8 @@ void Sample::handleCommonSettings()
 		m_partitionType = SAMPLE_PARTITION_MONOTONE;
 	if (imguiCheck("Layers", m_partitionType == SAMPLE_PARTITION_LAYERS))
 		m_partitionType = SAMPLE_PARTITION_LAYERS;
+	if (imguiCheck("Adaptive", m_partitionType == SAMPLE_PARTITION_ADAPTIVE))
+		m_partitionType = SAMPLE_PARTITION_ADAPTIVE;
 	
 	imguiSeparator();
 	imguiLabel("Filtering");
@@ -506,6 +510,105 @@ void Sample::saveAll(const char* path, const dtNavMesh* mesh)
 	fclose(fp);
 }
 
+static string getCaptureFolder(const string& exportFolder)
+{
+	if (exportFolder.empty() || exportFolder[exportFolder.size()-1] == '/')
+		return exportFolder;
+	return exportFolder + "/";
+}
+
+void Sample::saveTileCapture(const duTileCapture& capture, const int navMeshIndex)
+{
+	char path[512];
+	snprintf(path, sizeof(path), "%s%s_%d_%d_%d.tcap", getCaptureFolder(ExportFolder).c_str(),
+			 CurrentMapName.c_str(), navMeshIndex, capture.tx, capture.ty);
+
+	FileIO io;
+	if (!io.openForWrite(path))
+	{
+		m_ctx->log(RC_LOG_WARNING, "saveTileCapture: Could not open '%s' for writing.", path);
+		return;
+	}
+	duDumpTileCapture(capture, &io);
+}
+
+int Sample::getTileCaptureFlags() const
+{
+	int flags = 0;
+	if (m_filterLowHangingObstacles)
+		flags |= DU_TILECAPTURE_FILTER_LOW_HANGING;
+	if (m_filterLedgeSpans)
+		flags |= DU_TILECAPTURE_FILTER_LEDGE_SPANS;
+	if (m_filterWalkableLowHeightSpans)
+		flags |= DU_TILECAPTURE_FILTER_LOW_HEIGHT;
+	return flags;
+}
+
+void Sample::replayTileCaptures()
+{
+	const string folder = getCaptureFolder(ExportFolder);
+
+	vector<string> files;
+	scanDirectory(folder, ".tcap", files);
+	if (files.empty())
+	{
+		m_ctx->log(RC_LOG_WARNING, "replayTileCaptures: No captures found in '%s'.", folder.c_str());
+		return;
+	}
+
+	int replayed = 0;
+	int totalUsec = 0;
+	int slowestUsec = 0;
+	string slowest;
+
+	for (size_t i = 0; i < files.size(); ++i)
+	{
+		const string path = folder + files[i];
+
+		FileIO io;
+		duTileCapture capture;
+		duInitTileCapture(capture);
+		if (!io.openForRead(path.c_str()) || !duReadTileCapture(capture, &io))
+		{
+			m_ctx->log(RC_LOG_WARNING, "replayTileCaptures: Could not read '%s'.", path.c_str());
+			continue;
+		}
+
+		rcHeightfieldLayerSet* lset = rcAllocHeightfieldLayerSet();
+		rcPolyMesh* pmesh = rcAllocPolyMesh();
+		rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+
+		const TimeVal startTime = getPerfTime();
+		const bool ok = duReplayTileCapture(m_ctx, capture, lset, pmesh, dmesh);
+		const int usec = getPerfTimeUsec(getPerfTime() - startTime);
+
+		rcFreeHeightfieldLayerSet(lset);
+		rcFreePolyMesh(pmesh);
+		rcFreePolyMeshDetail(dmesh);
+		duFreeTileCapture(capture);
+
+		if (!ok)
+		{
+			m_ctx->log(RC_LOG_WARNING, "replayTileCaptures: Failed to rebuild '%s'.", files[i].c_str());
+			continue;
+		}
+
+		replayed++;
+		totalUsec += usec;
+		if (usec > slowestUsec)
+		{
+			slowestUsec = usec;
+			slowest = files[i];
+		}
+	}
+
+	if (!replayed)
+		return;
+
+	m_ctx->log(RC_LOG_PROGRESS, "Replayed %d tiles in %.1f ms (%.2f ms/tile)", replayed, totalUsec/1000.0f, totalUsec/1000.0f/replayed);
+	m_ctx->log(RC_LOG_PROGRESS, "Slowest tile %s: %.2f ms", slowest.c_str(), slowestUsec/1000.0f);
+}
+
 void Sample::SetTriangleSurfaceType(const int TriNum, const int NewAreaType)
 {
 	if (m_geom)
@@ -1,6 +1,8 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <atomic>
 #include "SampleInterfaces.h"
 #include "Recast.h"
 #include "RecastDebugDraw.h"
@@ -314,3 +316,85 @@ bool FileIO::read(void* ptr, const size_t size)
 }
 
 
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Each tracked allocation is prefixed with its size and counter, padded to keep the
+// returned memory aligned like malloc's.
+struct TrackedAllocHeader
+{
+	size_t size;
+	int counter;
+};
+static const size_t TRACKED_HEADER_SIZE = 16;
+
+struct AtomicAllocCounter
+{
+	std::atomic<size_t> current;
+	std::atomic<size_t> peak;
+};
+
+// Recast hints first, then Detour hints.
+static const int NUM_ALLOC_COUNTERS = 4;
+static AtomicAllocCounter s_allocCounters[NUM_ALLOC_COUNTERS];
+
+static void* trackedAlloc(size_t size, int counter)
+{
+	unsigned char* mem = (unsigned char*)malloc(size + TRACKED_HEADER_SIZE);
+	if (!mem)
+		return 0;
+	TrackedAllocHeader* header = (TrackedAllocHeader*)mem;
+	header->size = size;
+	header->counter = counter;
+
+	AtomicAllocCounter& c = s_allocCounters[counter];
+	const size_t current = c.current.fetch_add(size) + size;
+	size_t peak = c.peak.load();
+	while (current > peak && !c.peak.compare_exchange_weak(peak, current)) {}
+
+	return mem + TRACKED_HEADER_SIZE;
+}
+
+static void trackedFree(void* ptr)
+{
+	if (!ptr)
+		return;
+	unsigned char* mem = (unsigned char*)ptr - TRACKED_HEADER_SIZE;
+	const TrackedAllocHeader* header = (const TrackedAllocHeader*)mem;
+	s_allocCounters[header->counter].current.fetch_sub(header->size);
+	free(mem);
+}
+
+static void* trackedRecastAlloc(size_t size, rcAllocHint hint)
+{
+	return trackedAlloc(size, hint == RC_ALLOC_TEMP ? 1 : 0);
+}
+
+static void* trackedDetourAlloc(size_t size, dtAllocHint hint)
+{
+	return trackedAlloc(size, hint == DT_ALLOC_TEMP ? 3 : 2);
+}
+
+void initAllocTracking()
+{
+	rcAllocSetCustom(trackedRecastAlloc, trackedFree);
+	dtAllocSetCustom(trackedDetourAlloc, trackedFree);
+}
+
+static AllocCounter readAllocCounter(const int counter)
+{
+	AllocCounter c;
+	c.current = s_allocCounters[counter].current.load();
+	c.peak = s_allocCounters[counter].peak.load();
+	return c;
+}
+
+AllocCounter getRecastAllocCounter(const rcAllocHint hint)
+{
+	return readAllocCounter(hint == RC_ALLOC_TEMP ? 1 : 0);
+}
+
+AllocCounter getDetourAllocCounter(const dtAllocHint hint)
+{
+	return readAllocCounter(hint == DT_ALLOC_TEMP ? 3 : 2);
+}
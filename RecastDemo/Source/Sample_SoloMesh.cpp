@@ -576,6 +576,10 @@ bool Sample_SoloMesh::handleBuild()
 		//   - can be slow and create a bit ugly tessellation (still better than monotone)
 		//     if you have large open areas with small obstacles (not a problem if you use tiles)
 		//   * good choice to use for tiled navmesh with medium and small sized tiles
+		// 4) Adaptive partitioning
+		//   - chooses one of the above per tile from its span count, area count and border complexity
+		//   - uses monotone or layers on simple tiles and watershed only where it is needed
+		//   * good choice for large tiled worlds which are mostly open
 
 		if (m_partitionType == SAMPLE_PARTITION_WATERSHED)
 		{
@@ -603,6 +607,15 @@ bool Sample_SoloMesh::handleBuild()
 				return false;
 			}
 		}
+		else if (m_partitionType == SAMPLE_PARTITION_ADAPTIVE)
+		{
+			// Pick monotone, layer or watershed partitioning per tile based on how cluttered it is.
+			if (!rcBuildRegionsAdaptive(m_ctx, *m_chf, 0, m_cfg.minRegionArea, m_cfg.mergeRegionArea))
+			{
+				m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build adaptive regions.");
+				return false;
+			}
+		}
 		else // SAMPLE_PARTITION_LAYERS
 		{
 			// Partition the walkable surface into simple regions without holes.
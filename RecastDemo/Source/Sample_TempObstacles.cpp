@@ -21,6 +21,10 @@
 #include <string.h>
 #include <float.h>
 #include <new>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
 #include "SDL.h"
 #include "SDL_opengl.h"
 #ifdef __APPLE__
@@ -39,7 +43,9 @@
 #include "DetourNavMeshBuilder.h"
 #include "DetourDebugDraw.h"
 #include "DetourCommon.h"
+#include "DetourNavMeshQuery.h"
 #include "DetourTileCache.h"
+#include "DetourObstacleRegistry.h"
 #include "NavMeshTesterTool.h"
 #include "OffMeshConnectionTool.h"
 #include "ConvexVolumeTool.h"
@@ -51,14 +57,22 @@
 
 #include "NavProfiles.h"
 #include "MeshEditorTool.h"
+#include "PerfTimer.h"
 
 #ifdef WIN32
 #	define snprintf _snprintf
 #endif
 
 
-// This value specifies how many layers (or "floors") each navmesh tile is expected to have.
-static const int EXPECTED_LAYERS_PER_TILE = 4;
+// Max tiles and max polys affect how the tile IDs are caculated.
+// There are 22 bits available for identifying a tile and a polygon.
+static void calcTileBits(const int tileCount, int& maxTiles, int& maxPolysPerTile)
+{
+	const int tileBits = rcMin((int)dtIlog2(dtNextPow2(tileCount)), 14);
+	const int polyBits = 22 - tileBits;
+	maxTiles = 1 << tileBits;
+	maxPolysPerTile = 1 << polyBits;
+}
 
 
 static bool isectSegAABB(const float* sp, const float* sq,
@@ -139,54 +153,202 @@ FastLZCompressor::~FastLZCompressor()
 	// Defined out of line to fix the weak v-tables warning
 }
 
-struct LinearAllocator : public dtTileCacheAlloc
+// Bump allocator for the scratch memory of one build thread. When the current block
+// runs out another one is chained after it, so a build never fails because the
+// arena was sized too small. Reset rewinds to the first block; if the last build
+// needed more than one block, the chain is replaced by a single block that fits
+// the high-water mark so later builds stay in one block.
+struct LinearArena
 {
-	unsigned char* buffer;
-	size_t capacity;
-	size_t top;
-	size_t high;
+	struct Block
+	{
+		Block* next;
+		size_t capacity;
+		size_t top;
+	};
+	
+	// Keeps the returned memory aligned for any of the builder's arrays.
+	static const size_t ALIGN = 16;
+	static const size_t HEADER_SIZE = (sizeof(Block) + ALIGN-1) & ~(ALIGN-1);
 	
-	LinearAllocator(const size_t cap) : buffer(0), capacity(0), top(0), high(0)
+	Block* first;
+	Block* current;
+	size_t used;		///< Bytes used in the blocks before current.
+	size_t high;		///< Most bytes used by a single build.
+	size_t blockSize;
+	
+	explicit LinearArena(const size_t size) : first(0), current(0), used(0), high(0), blockSize(size)
 	{
-		resize(cap);
 	}
 	
-	virtual ~LinearAllocator();
+	~LinearArena()
+	{
+		freeBlocks();
+	}
+	
+	void freeBlocks()
+	{
+		Block* block = first;
+		while (block)
+		{
+			Block* next = block->next;
+			dtFree(block);
+			block = next;
+		}
+		first = current = 0;
+	}
+	
+	Block* allocBlock(const size_t capacity)
+	{
+		Block* block = (Block*)dtAlloc(HEADER_SIZE + capacity, DT_ALLOC_PERM);
+		if (!block)
+			return 0;
+		block->next = 0;
+		block->capacity = capacity;
+		block->top = 0;
+		return block;
+	}
+	
+	void reset()
+	{
+		if (current)
+			high = dtMax(high, used + current->top);
+		if (first && first->next)
+		{
+			freeBlocks();
+			blockSize = dtMax(blockSize, high);
+		}
+		current = first;
+		if (current)
+			current->top = 0;
+		used = 0;
+	}
+	
+	void* alloc(const size_t size)
+	{
+		const size_t alignedSize = (size + ALIGN-1) & ~(ALIGN-1);
+		if (!first)
+		{
+			first = current = allocBlock(dtMax(blockSize, alignedSize));
+			if (!first)
+				return 0;
+		}
+		while (current->top + alignedSize > current->capacity)
+		{
+			used += current->top;
+			if (!current->next)
+			{
+				current->next = allocBlock(dtMax(blockSize, alignedSize));
+				if (!current->next)
+					return 0;
+			}
+			current = current->next;
+			current->top = 0;
+		}
+		unsigned char* mem = (unsigned char*)current + HEADER_SIZE + current->top;
+		current->top += alignedSize;
+		high = dtMax(high, used + current->top);
+		return mem;
+	}
+};
 
-	void resize(const size_t cap)
+// Tile cache allocator that hands every build thread its own arena, so tiles of
+// different caches can be built in parallel through one allocator without locking.
+// Only the first allocation of a new thread takes the lock.
+struct LinearAllocator : public dtTileCacheAlloc
+{
+	LinearAllocator(const size_t blockSize) : m_blockSize(blockSize), m_id(s_nextId.fetch_add(1) + 1)
 	{
-		if (buffer) dtFree(buffer);
-		buffer = (unsigned char*)dtAlloc(cap, DT_ALLOC_PERM);
-		capacity = cap;
 	}
 	
+	virtual ~LinearAllocator();
+	
 	virtual void reset()
 	{
-		high = dtMax(high, top);
-		top = 0;
+		getArena()->reset();
 	}
 	
 	virtual void* alloc(const size_t size)
 	{
-		if (!buffer)
-			return 0;
-		if (top+size > capacity)
-			return 0;
-		unsigned char* mem = &buffer[top];
-		top += size;
-		return mem;
+		return getArena()->alloc(size);
 	}
 	
 	virtual void free(void* /*ptr*/)
 	{
 		// Empty
 	}
+	
+	/// Most scratch memory a single build needed, over all threads.
+	size_t getHighWaterMark()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		size_t high = 0;
+		for (size_t i = 0; i < m_arenas.size(); ++i)
+			high = dtMax(high, m_arenas[i].arena->high);
+		return high;
+	}
+	
+	int getArenaCount()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return (int)m_arenas.size();
+	}
+	
+private:
+	struct ThreadArena
+	{
+		std::thread::id thread;
+		LinearArena* arena;
+	};
+	
+	LinearArena* getArena()
+	{
+		// Allocator ids are never reused, so a stale cache entry can not match a new allocator.
+		static thread_local unsigned int cachedId = 0;
+		static thread_local LinearArena* cachedArena = 0;
+		if (cachedId == m_id)
+			return cachedArena;
+		
+		const std::thread::id thread = std::this_thread::get_id();
+		std::lock_guard<std::mutex> lock(m_lock);
+		LinearArena* arena = 0;
+		for (size_t i = 0; i < m_arenas.size() && !arena; ++i)
+		{
+			if (m_arenas[i].thread == thread)
+				arena = m_arenas[i].arena;
+		}
+		if (!arena)
+		{
+			ThreadArena ta;
+			ta.thread = thread;
+			ta.arena = new LinearArena(m_blockSize);
+			m_arenas.push_back(ta);
+			arena = ta.arena;
+		}
+		cachedId = m_id;
+		cachedArena = arena;
+		return arena;
+	}
+	
+	size_t m_blockSize;
+	unsigned int m_id;
+	std::mutex m_lock;
+	std::vector<ThreadArena> m_arenas;
+	
+	static std::atomic<unsigned int> s_nextId;
+	
+	// Explicitly disabled copy constructor and copy assignment operator.
+	LinearAllocator(const LinearAllocator&);
+	LinearAllocator& operator=(const LinearAllocator&);
 };
 
+std::atomic<unsigned int> LinearAllocator::s_nextId(0);
+
 LinearAllocator::~LinearAllocator()
 {
 	// Defined out of line to fix the weak v-tables warning
-	dtFree(buffer);
+	for (size_t i = 0; i < m_arenas.size(); ++i)
+		delete m_arenas[i].arena;
 }
 
 struct MeshProcess : public dtTileCacheMeshProcess
@@ -248,6 +410,66 @@ MeshProcess::~MeshProcess()
 
 static const int MAX_LAYERS = 32;
 
+static const int MAX_SHARED_OBSTACLES = 128;
+/// Time the obstacle registry may spend rebuilding tiles each frame.
+static const long long OBSTACLE_UPDATE_BUDGET_USEC = 4000;
+
+// Microseconds since the clock was created, for budgeting the work of one frame.
+struct FrameClock : public dtQueryClock
+{
+	TimeVal start;
+
+	FrameClock() : start(getPerfTime()) {}
+	virtual ~FrameClock();
+
+	virtual long long getTicks() const
+	{
+		return getPerfTimeUsec(getPerfTime() - start);
+	}
+};
+
+FrameClock::~FrameClock()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+// Logs where the memory of one profile's tile cache, navmesh and query goes, and returns the total.
+static size_t logMeshMemoryUsage(rcContext* ctx, const char* name, const NavMeshEntry& mesh)
+{
+	size_t total = 0;
+	
+	if (mesh.m_tileCache)
+	{
+		dtTileCacheMemoryUsage tc;
+		mesh.m_tileCache->getMemoryUsage(&tc);
+		ctx->log(RC_LOG_PROGRESS, "%s tile cache: %.1f kB (table %.1f, layers %.1f, obstacles %.1f, off-mesh %.1f)",
+				 name, tc.total/1024.0f, tc.tileTable/1024.0f, tc.compressedLayers/1024.0f,
+				 tc.obstacles/1024.0f, tc.offMeshCons/1024.0f);
+		total += tc.total;
+	}
+	
+	if (mesh.m_navMesh)
+	{
+		dtNavMeshMemoryUsage nm;
+		mesh.m_navMesh->getMemoryUsage(&nm);
+		ctx->log(RC_LOG_PROGRESS, "%s navmesh: %.1f kB (table %.1f, polys %.1f, links %.1f+%.1f, detail %.1f, bvtree %.1f)",
+				 name, nm.total/1024.0f, nm.tileTable/1024.0f, (nm.headers + nm.verts + nm.polys)/1024.0f,
+				 nm.links/1024.0f, nm.overflowLinks/1024.0f,
+				 (nm.detailMeshes + nm.detailVerts + nm.detailTris)/1024.0f, nm.bvTree/1024.0f);
+		total += nm.total;
+	}
+	
+	if (mesh.m_navQuery)
+	{
+		dtNavMeshQueryMemoryUsage q;
+		mesh.m_navQuery->getMemoryUsage(&q);
+		ctx->log(RC_LOG_PROGRESS, "%s query: %.1f kB", name, q.total/1024.0f);
+		total += q.total;
+	}
+	
+	return total;
+}
+
 struct TileCacheData
 {
 	unsigned char* data;
@@ -288,6 +510,7 @@ struct RasterizationContext
 };
 
 int Sample_TempObstacles::rasterizeTileLayers(
+								rcContext* ctx,
 								const unsigned int NavMeshIndex,
 								const int tx, const int ty,
 								const rcConfig& cfg,
@@ -296,7 +519,7 @@ int Sample_TempObstacles::rasterizeTileLayers(
 {
 	if (!m_geom || !m_geom->getMesh() || !m_geom->getChunkyMesh())
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildTile: Input mesh is not specified.");
+		ctx->log(RC_LOG_ERROR, "buildTile: Input mesh is not specified.");
 		return 0;
 	}
 	
@@ -328,12 +551,12 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	rc.solid = rcAllocHeightfield();
 	if (!rc.solid)
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'solid'.");
 		return 0;
 	}
-	if (!rcCreateHeightfield(m_ctx, *rc.solid, tcfg.width, tcfg.height, tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch))
+	if (!rcCreateHeightfield(ctx, *rc.solid, tcfg.width, tcfg.height, tcfg.bmin, tcfg.bmax, tcfg.cs, tcfg.ch))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not create solid heightfield.");
 		return 0;
 	}
 	
@@ -343,7 +566,7 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	rc.triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
 	if (!rc.triareas)
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'm_triareas' (%d).", chunkyMesh->maxTrisPerChunk);
 		return 0;
 	}
 	
@@ -358,6 +581,36 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	{
 		return 0; // empty
 	}
+
+	// Tuning builds run with their own context and are never captured.
+	if (m_captureTiles && ctx == m_ctx)
+	{
+		duTileCapture capture;
+		duInitTileCapture(capture);
+		memcpy(&capture.cfg, &tcfg, sizeof(tcfg));
+		capture.tx = tx;
+		capture.ty = ty;
+		capture.mode = DU_TILECAPTURE_LAYERS;
+		capture.flags = getTileCaptureFlags();
+		capture.compactHeight = 13;
+
+		for (int i = 0; i < ncid; ++i)
+		{
+			const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
+			duAppendTileCaptureTris(capture, verts, &chunkyMesh->tris[node.i*3], &chunkyMesh->surfTypes[node.i], node.n);
+		}
+
+		const ConvexVolume* vols = m_geom->getConvexVolumes();
+		for (int i = 0; i < m_geom->getConvexVolumeCount(); ++i)
+		{
+			if (vols[i].NavMeshIndex != NavMeshIndex) { continue; }
+
+			duAppendTileCaptureVolume(capture, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, vols[i].area);
+		}
+
+		saveTileCapture(capture, NavMeshIndex);
+		duFreeTileCapture(capture);
+	}
 	
 	for (int i = 0; i < ncid; ++i)
 	{
@@ -368,9 +621,9 @@ int Sample_TempObstacles::rasterizeTileLayers(
 		
 		memset(rc.triareas, 0, ntris*sizeof(unsigned char));
 
-		rcMarkWalkableTriangles(m_ctx, tcfg.walkableSlopeAngle,	verts, nverts, tris, ntris, rc.triareas, surfTypes);
+		rcMarkWalkableTriangles(ctx, tcfg.walkableSlopeAngle,	verts, nverts, tris, ntris, rc.triareas, surfTypes);
 		
-		if (!rcRasterizeTriangles(m_ctx, verts, nverts, tris, rc.triareas, ntris, *rc.solid, tcfg.walkableClimb))
+		if (!rcRasterizeTriangles(ctx, verts, nverts, tris, rc.triareas, ntris, *rc.solid, tcfg.walkableClimb))
 			return 0;
 	}
 	
@@ -378,29 +631,29 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	// remove unwanted overhangs caused by the conservative rasterization
 	// as well as filter spans where the character cannot possibly stand.
 	if (m_filterLowHangingObstacles)
-		rcFilterLowHangingWalkableObstacles(m_ctx, tcfg.walkableClimb, *rc.solid);
+		rcFilterLowHangingWalkableObstacles(ctx, tcfg.walkableClimb, *rc.solid);
 	if (m_filterLedgeSpans)
-		rcFilterLedgeSpans(m_ctx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid);
+		rcFilterLedgeSpans(ctx, tcfg.walkableHeight, tcfg.walkableClimb, *rc.solid);
 	if (m_filterWalkableLowHeightSpans)
-		rcFilterWalkableLowHeightSpans(m_ctx, tcfg.walkableHeight, cfg.crouchHeight, *rc.solid);
+		rcFilterWalkableLowHeightSpans(ctx, tcfg.walkableHeight, cfg.crouchHeight, *rc.solid);
 	
 	
 	rc.chf = rcAllocCompactHeightfield();
 	if (!rc.chf)
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'chf'.");
 		return 0;
 	}
-	if (!rcBuildCompactHeightfield(m_ctx, 13, tcfg.walkableClimb, *rc.solid, *rc.chf))
+	if (!rcBuildCompactHeightfield(ctx, 13, tcfg.walkableClimb, *rc.solid, *rc.chf))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build compact data.");
 		return 0;
 	}
 	
 	// Erode the walkable area by agent radius.
-	if (!rcErodeWalkableArea(m_ctx, tcfg.walkableRadius, *rc.chf))
+	if (!rcErodeWalkableArea(ctx, tcfg.walkableRadius, *rc.chf))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not erode.");
 		return 0;
 	}
 	
@@ -410,7 +663,7 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	{
 		if (vols[i].NavMeshIndex != NavMeshIndex) { continue; }
 
-		rcMarkConvexPolyArea(m_ctx, vols[i].verts, vols[i].nverts,
+		rcMarkConvexPolyArea(ctx, vols[i].verts, vols[i].nverts,
 							 vols[i].hmin, vols[i].hmax,
 							 (unsigned char)vols[i].area, *rc.chf);
 	}
@@ -418,12 +671,12 @@ int Sample_TempObstacles::rasterizeTileLayers(
 	rc.lset = rcAllocHeightfieldLayerSet();
 	if (!rc.lset)
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'lset'.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Out of memory 'lset'.");
 		return 0;
 	}
-	if (!rcBuildHeightfieldLayers(m_ctx, *rc.chf, tcfg.borderSize, cfg.crouchHeight, *rc.lset))
+	if (!rcBuildHeightfieldLayers(ctx, *rc.chf, tcfg.borderSize, cfg.crouchHeight, *rc.lset))
 	{
-		m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build heighfield layers.");
+		ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build heighfield layers.");
 		return 0;
 	}
 	
@@ -859,15 +1112,18 @@ TempObstacleCreateTool::~TempObstacleCreateTool()
 Sample_TempObstacles::Sample_TempObstacles() :
 	m_keepInterResults(false),
 	m_tileCache(0),
+	m_obstacleRegistry(0),
 	m_cacheBuildTimeMs(0),
 	m_cacheCompressedSize(0),
 	m_cacheRawSize(0),
 	m_cacheLayerCount(0),
 	m_cacheBuildMemUsage(0),
+	m_navMeshMemUsage(0),
 	m_drawMode(DRAWMODE_NAVMESH),
 	m_maxTiles(0),
 	m_maxPolysPerTile(0),
-	m_tileSize(48)
+	m_tileSize(48),
+	m_expectedLayersPerTile(4)
 {
 	resetCommonSettings();
 	
@@ -875,6 +1131,9 @@ Sample_TempObstacles::Sample_TempObstacles() :
 	m_tcomp = new FastLZCompressor;
 	m_tmproc = new MeshProcess;
 	
+	m_obstacleRegistry = new dtObstacleRegistry;
+	m_obstacleRegistry->init(MAX_SHARED_OBSTACLES);
+	
 	setTool(new TempObstacleCreateTool);
 }
 
@@ -883,6 +1142,7 @@ Sample_TempObstacles::~Sample_TempObstacles()
 	dtFreeNavMesh(m_navMesh);
 	m_navMesh = 0;
 	dtFreeTileCache(m_tileCache);
+	delete m_obstacleRegistry;
 }
 
 void Sample_TempObstacles::handleSettings()
@@ -891,9 +1151,14 @@ void Sample_TempObstacles::handleSettings()
 
 	if (imguiCheck("Keep Intermediate Results", m_keepInterResults))
 		m_keepInterResults = !m_keepInterResults;
+	if (imguiCheck("Capture Tile Inputs", m_captureTiles))
+		m_captureTiles = !m_captureTiles;
+	if (imguiButton("Replay Tile Captures"))
+		replayTileCaptures();
 
 	imguiLabel("Tiling");
 	imguiSlider("TileSize", &m_tileSize, 16.0f, 128.0f, 8.0f);
+	imguiSlider("Layers Per Tile", &m_expectedLayersPerTile, 1.0f, 32.0f, 1.0f);
 	
 	int gridSize = 1;
 	if (m_geom)
@@ -909,13 +1174,7 @@ void Sample_TempObstacles::handleSettings()
 		snprintf(text, 64, "Tiles  %d x %d", tw, th);
 		imguiValue(text);
 
-		// Max tiles and max polys affect how the tile IDs are caculated.
-		// There are 22 bits available for identifying a tile and a polygon.
-		int tileBits = rcMin((int)dtIlog2(dtNextPow2(tw*th*EXPECTED_LAYERS_PER_TILE)), 14);
-		if (tileBits > 14) tileBits = 14;
-		int polyBits = 22 - tileBits;
-		m_maxTiles = 1 << tileBits;
-		m_maxPolysPerTile = 1 << polyBits;
+		calcTileBits(tw*th*(int)m_expectedLayersPerTile, m_maxTiles, m_maxPolysPerTile);
 		snprintf(text, 64, "Max Tiles  %d", m_maxTiles);
 		imguiValue(text);
 		snprintf(text, 64, "Max Polys  %d", m_maxPolysPerTile);
@@ -946,6 +1205,21 @@ void Sample_TempObstacles::handleSettings()
 	imguiValue(msg);
 	snprintf(msg, 64, "Build Peak Mem Usage  %.1f kB", m_cacheBuildMemUsage/1024.0f);
 	imguiValue(msg);
+	snprintf(msg, 64, "Navmesh Mem Usage  %.1f kB", m_navMeshMemUsage/1024.0f);
+	imguiValue(msg);
+	unsigned int skippedRebuilds = 0;
+	for (int i = 0; i < GetNumNavMeshes(); i++)
+	{
+		if (m_NavMeshArray[i].m_tileCache)
+			skippedRebuilds += m_NavMeshArray[i].m_tileCache->getSkippedRebuildCount();
+	}
+	snprintf(msg, 64, "Skipped Rebuilds  %u", skippedRebuilds);
+	imguiValue(msg);
+
+	imguiSeparator();
+
+	if (imguiButton("Tune Tile Settings", m_geom != 0))
+		tuneTileSettings();
 
 	imguiSeparator();
 
@@ -1196,9 +1470,18 @@ void Sample_TempObstacles::handleMeshChanged(class InputGeom* geom)
 {
 	Sample::handleMeshChanged(geom);
 
+	const BuildSettings* buildSettings = geom->getBuildSettings();
+	if (buildSettings && buildSettings->tileSize > 0)
+		m_tileSize = buildSettings->tileSize;
+	if (buildSettings && buildSettings->expectedLayersPerTile > 0)
+		m_expectedLayersPerTile = (float)buildSettings->expectedLayersPerTile;
+
 	dtFreeTileCache(m_tileCache);
 	m_tileCache = 0;
 	
+	// The obstacles belong to the old level.
+	m_obstacleRegistry->removeAllObstacles();
+	
 	dtFreeNavMesh(m_navMesh);
 	m_navMesh = 0;
 
@@ -1214,14 +1497,16 @@ void Sample_TempObstacles::handleMeshChanged(class InputGeom* geom)
 
 void Sample_TempObstacles::addTempObstacle(const float* pos, const unsigned char Area)
 {
-	dtTileCache* CurrentTileCache = m_NavMeshArray[m_SelectedNavMeshIndex].m_tileCache;
-
-	if (!CurrentTileCache)
-		return;
-	float p[3];
-	dtVcopy(p, pos);
-	p[1] -= 0.5f;
-	CurrentTileCache->addObstacle(p, 32.0f, 100.0f, Area, 0);
+	// The obstacle goes to every profile, not only the selected one.
+	dtObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_CYLINDER;
+	dtVcopy(desc.cylinder.pos, pos);
+	desc.cylinder.pos[1] -= 0.5f;
+	desc.cylinder.radius = 32.0f;
+	desc.cylinder.height = 100.0f;
+	desc.cylinder.area = Area;
+	m_obstacleRegistry->addObstacle(&desc, 0);
 }
 
 void Sample_TempObstacles::removeTempObstacle(const float* sp, const float* sq)
@@ -1231,11 +1516,17 @@ void Sample_TempObstacles::removeTempObstacle(const float* sp, const float* sq)
 	if (!CurrentTileCache)
 		return;
 	dtObstacleRef ref = hitTestObstacle(CurrentTileCache, sp, sq);
-	CurrentTileCache->removeObstacle(ref);
+	dtSharedObstacleRef sharedRef = m_obstacleRegistry->findObstacle(CurrentTileCache, ref);
+	if (sharedRef)
+		m_obstacleRegistry->removeObstacle(sharedRef);
+	else
+		CurrentTileCache->removeObstacle(ref);
 }
 
 void Sample_TempObstacles::clearAllTempObstacles()
 {
+	m_obstacleRegistry->removeAllObstacles();
+
 	if (!m_tileCache)
 		return;
 	for (int i = 0; i < m_tileCache->getObstacleCount(); ++i)
@@ -1246,6 +1537,56 @@ void Sample_TempObstacles::clearAllTempObstacles()
 	}
 }
 
+void Sample_TempObstacles::initBuildConfig(const NavMeshDefinition& def, const float cellSize, const int tileSize,
+										   rcConfig& cfg, dtTileCacheParams& tcparams) const
+{
+	const float* bmin = m_geom->getNavMeshBoundsMin();
+	const float* bmax = m_geom->getNavMeshBoundsMax();
+	int gw = 0, gh = 0;
+	rcCalcGridSize(bmin, bmax, cellSize, &gw, &gh);
+	const int tw = (gw + tileSize - 1) / tileSize;
+	const int th = (gh + tileSize - 1) / tileSize;
+
+	// Generation params.
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = cellSize;
+	cfg.ch = m_cellHeight;
+	cfg.walkableSlopeAngle = def.MaxSlope;
+	cfg.walkableHeight = (int)ceilf(def.AgentStandingHeight / cfg.ch);
+	cfg.crouchHeight = (int)ceilf(def.AgentCrouchingHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(def.MaxStep / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(def.AgentRadius / cfg.cs);
+	cfg.maxEdgeLen = (int)(m_edgeMaxLen / cellSize);
+	cfg.maxSimplificationError = m_edgeMaxError;
+	cfg.minRegionArea = (int)rcSqr(m_regionMinSize);		// Note: area = size*size
+	cfg.mergeRegionArea = (int)rcSqr(m_regionMergeSize);	// Note: area = size*size
+	cfg.maxVertsPerPoly = (int)m_vertsPerPoly;
+	cfg.tileSize = tileSize;
+	cfg.borderSize = cfg.walkableRadius + 3; // Reserve enough padding.
+	cfg.width = cfg.tileSize + cfg.borderSize * 2;
+	cfg.height = cfg.tileSize + cfg.borderSize * 2;
+	cfg.detailSampleDist = m_detailSampleDist < 0.9f ? 0 : cellSize * m_detailSampleDist;
+	cfg.detailSampleMaxError = m_cellHeight * m_detailSampleMaxError;
+	rcVcopy(cfg.bmin, bmin);
+	rcVcopy(cfg.bmax, bmax);
+
+	// Tile cache params.
+	memset(&tcparams, 0, sizeof(tcparams));
+	rcVcopy(tcparams.orig, bmin);
+	tcparams.cs = cellSize;
+	tcparams.ch = m_cellHeight;
+	tcparams.width = tileSize;
+	tcparams.height = tileSize;
+	tcparams.walkableHeight = def.AgentStandingHeight;
+	tcparams.crouchHeight = def.AgentCrouchingHeight;
+	tcparams.walkableRadius = def.AgentRadius;
+	tcparams.walkableClimb = def.MaxStep;
+	tcparams.maxSimplificationError = m_edgeMaxError;
+	tcparams.maxTiles = tw * th * (int)m_expectedLayersPerTile;
+	tcparams.maxObstacles = 128;
+	tcparams.maxOffMeshConnections = 512;
+}
+
 bool Sample_TempObstacles::handleBuild()
 {
 	dtStatus status;
@@ -1256,8 +1597,6 @@ bool Sample_TempObstacles::handleBuild()
 		return false;
 	}
 
-	m_geom->rebuildChunkyTriMesh();
-
 	m_tmproc->init(m_geom);
 
 	// Init cache
@@ -1269,7 +1608,7 @@ bool Sample_TempObstacles::handleBuild()
 	const int tw = (gw + ts - 1) / ts;
 	const int th = (gh + ts - 1) / ts;
 
-	int navmeshMemUsage = 0;
+	m_navMeshMemUsage = 0;
 
 	vector<NavMeshDefinition> AllNavMeshes = GetAllMeshDefinitions();
 	unsigned int MeshIndex = 0;
@@ -1297,47 +1636,11 @@ bool Sample_TempObstacles::handleBuild()
 			}
 		}
 
-		// Generation params.
 		rcConfig cfg;
-		memset(&cfg, 0, sizeof(cfg));
-		cfg.cs = m_cellSize;
-		cfg.ch = m_cellHeight;
-		cfg.walkableSlopeAngle = it->MaxSlope;
-		cfg.walkableHeight = (int)ceilf(it->AgentStandingHeight / cfg.ch);
-		cfg.crouchHeight = (int)ceilf(it->AgentCrouchingHeight / cfg.ch);
-		cfg.walkableClimb = (int)floorf(it->MaxStep / cfg.ch);
-		cfg.walkableRadius = (int)ceilf(it->AgentRadius / cfg.cs);
-		cfg.maxEdgeLen = (int)(m_edgeMaxLen / m_cellSize);
-		cfg.maxSimplificationError = m_edgeMaxError;
-		cfg.minRegionArea = (int)rcSqr(m_regionMinSize);		// Note: area = size*size
-		cfg.mergeRegionArea = (int)rcSqr(m_regionMergeSize);	// Note: area = size*size
-		cfg.maxVertsPerPoly = (int)m_vertsPerPoly;
-		cfg.tileSize = (int)m_tileSize;
-		cfg.borderSize = cfg.walkableRadius + 3; // Reserve enough padding.
-		cfg.width = cfg.tileSize + cfg.borderSize * 2;
-		cfg.height = cfg.tileSize + cfg.borderSize * 2;
-		cfg.detailSampleDist = m_detailSampleDist < 0.9f ? 0 : m_cellSize * m_detailSampleDist;
-		cfg.detailSampleMaxError = m_cellHeight * m_detailSampleMaxError;
-		rcVcopy(cfg.bmin, bmin);
-		rcVcopy(cfg.bmax, bmax);
-
-		// Tile cache params.
 		dtTileCacheParams tcparams;
-		memset(&tcparams, 0, sizeof(tcparams));
-		rcVcopy(tcparams.orig, bmin);
-		tcparams.cs = m_cellSize;
-		tcparams.ch = m_cellHeight;
-		tcparams.width = (int)m_tileSize;
-		tcparams.height = (int)m_tileSize;
-		tcparams.walkableHeight = it->AgentStandingHeight;
-		tcparams.crouchHeight = it->AgentCrouchingHeight;
-		tcparams.walkableRadius = it->AgentRadius;
-		tcparams.walkableClimb = it->MaxStep;
-		tcparams.maxSimplificationError = m_edgeMaxError;
-		tcparams.maxTiles = tw * th * EXPECTED_LAYERS_PER_TILE;
-		tcparams.maxObstacles = 128;
-		tcparams.maxOffMeshConnections = 512;
+		initBuildConfig(*it, m_cellSize, (int)m_tileSize, cfg, tcparams);
 
+		m_obstacleRegistry->removeTileCache(meshDefinition->m_tileCache);
 		dtFreeTileCache(meshDefinition->m_tileCache);
 
 		meshDefinition->m_tileCache = dtAllocTileCache();
@@ -1399,7 +1702,7 @@ bool Sample_TempObstacles::handleBuild()
 			{
 				TileCacheData tiles[MAX_LAYERS];
 				memset(tiles, 0, sizeof(tiles));
-				int ntiles = rasterizeTileLayers(MeshIndex, x, y, cfg, tiles, MAX_LAYERS);
+				int ntiles = rasterizeTileLayers(m_ctx, MeshIndex, x, y, cfg, tiles, MAX_LAYERS);
 
 				for (int i = 0; i < ntiles; ++i)
 				{
@@ -1432,27 +1735,32 @@ bool Sample_TempObstacles::handleBuild()
 			{
 				meshDefinition->m_tileCache->addOffMeshConnection(&it->pos[0], &it->pos[3], it->rad, it->area, it->flags, it->bBiDir, 0);
 			}
-		}
-
-		if (meshDefinition->m_navMesh)
-		{
-			const dtNavMesh* cNavMesh = meshDefinition->m_navMesh;
 
-			for (int i = 0; i < cNavMesh->getMaxTiles(); ++i)
-			{
-				const dtMeshTile* tile = cNavMesh->getTile(i);
-				if (tile->header)
-					navmeshMemUsage += tile->dataSize;
-			}
+			// Obstacles placed before the rebuild are added back to the new cache.
+			m_obstacleRegistry->addTileCache(meshDefinition->m_tileCache, meshDefinition->m_navMesh);
 		}
 
+		m_navMeshMemUsage += logMeshMemoryUsage(m_ctx, it->NavMeshName.c_str(), *meshDefinition);
+
 		MeshIndex++;
 	}
 		
 	m_cacheBuildTimeMs = m_ctx->getAccumulatedTime(RC_TIMER_TOTAL)/1000.0f;
-	m_cacheBuildMemUsage = static_cast<unsigned int>(m_talloc->high);	
-
-	printf("navmeshMemUsage = %.1f kB", navmeshMemUsage/1024.0f);
+	m_cacheBuildMemUsage = static_cast<unsigned int>(m_talloc->getHighWaterMark());	
+
+	m_ctx->log(RC_LOG_PROGRESS, "Built '%s' from %d triangles (%d culled) in %.1f ms.",
+			   m_geom->getMesh()->getMapName().c_str(), m_geom->getMesh()->getTriCount(),
+			   m_geom->getMesh()->getBSPCulledTriCount(), m_cacheBuildTimeMs);
+
+	const AllocCounter rcPerm = getRecastAllocCounter(RC_ALLOC_PERM);
+	const AllocCounter rcTemp = getRecastAllocCounter(RC_ALLOC_TEMP);
+	const AllocCounter dtPerm = getDetourAllocCounter(DT_ALLOC_PERM);
+	const AllocCounter dtTemp = getDetourAllocCounter(DT_ALLOC_TEMP);
+	m_ctx->log(RC_LOG_PROGRESS, "Navigation memory: %.1f kB", m_navMeshMemUsage/1024.0f);
+	m_ctx->log(RC_LOG_PROGRESS, "Recast allocs: perm %.1f kB (peak %.1f), temp %.1f kB (peak %.1f)",
+			   rcPerm.current/1024.0f, rcPerm.peak/1024.0f, rcTemp.current/1024.0f, rcTemp.peak/1024.0f);
+	m_ctx->log(RC_LOG_PROGRESS, "Detour allocs: perm %.1f kB (peak %.1f), temp %.1f kB (peak %.1f)",
+			   dtPerm.current/1024.0f, dtPerm.peak/1024.0f, dtTemp.current/1024.0f, dtTemp.peak/1024.0f);
 		
 	
 	if (m_tool)
@@ -1464,24 +1772,340 @@ bool Sample_TempObstacles::handleBuild()
 	return true;
 }
 
-void Sample_TempObstacles::handleUpdate(const float dt)
+void Sample_TempObstacles::collectSettings(BuildSettings& settings)
 {
-	Sample::handleUpdate(dt);
-	
-	int NumMeshes = GetNumNavMeshes();
+	Sample::collectSettings(settings);
 
-	for (int i = 0; i < NumMeshes; i++)
+	settings.tileSize = m_tileSize;
+	settings.expectedLayersPerTile = (int)m_expectedLayersPerTile;
+}
+
+static const int MAX_TUNING_POINTS = 128;
+static const int MAX_TUNING_OBSTACLES = 16;
+
+// One tile/cell size combination of the tuning grid and what it measured.
+struct TileCacheTuningJob
+{
+	NavMeshDefinition def;
+	const vector<float>* points;
+	float cellSize;
+	int tileSize;
+
+	bool ok;
+	int layerCount;			// Total tile cache layers built.
+	int layersPerTile;		// Recommended EXPECTED_LAYERS_PER_TILE.
+	int compressedSize;		// Tile cache size.
+	int navMeshSize;		// Resident nav mesh tile data.
+	float buildMs;
+	float obstacleMs;		// Average latency of adding or removing an obstacle.
+	float queryMs;			// Time of the standard path query workload.
+	int pathCount;
+	float score;
+};
+
+// Deterministic sample positions on walkable input triangles. The same points are
+// used for every candidate so the query and obstacle workloads stay comparable.
+static void collectTuningPoints(const InputGeom* geom, const float walkableSlopeAngle, vector<float>& points)
+{
+	const rcMeshLoaderObj* mesh = geom->getMesh();
+	const float* verts = mesh->getVerts();
+	const float* normals = mesh->getNormals();
+	const int* tris = mesh->getTris();
+	const int ntris = mesh->getTriCount();
+	const float walkableThr = cosf(walkableSlopeAngle/180.0f*RC_PI);
+
+	int nwalkable = 0;
+	for (int i = 0; i < ntris; ++i)
 	{
-		
-		if (!m_NavMeshArray[i].m_navMesh)
-			return;
-		if (!m_NavMeshArray[i].m_tileCache)
-			return;
+		if (normals[i*3+1] > walkableThr)
+			nwalkable++;
+	}
+	const int stride = rcMax(1, nwalkable / MAX_TUNING_POINTS);
 
-		m_NavMeshArray[i].m_tileCache->update(dt, m_NavMeshArray[i].m_navMesh);
+	points.clear();
+	for (int i = 0, n = 0; i < ntris; ++i)
+	{
+		if (normals[i*3+1] <= walkableThr)
+			continue;
+		if ((n++ % stride) != 0)
+			continue;
+		const float* va = &verts[tris[i*3+0]*3];
+		const float* vb = &verts[tris[i*3+1]*3];
+		const float* vc = &verts[tris[i*3+2]*3];
+		points.push_back((va[0]+vb[0]+vc[0])/3.0f);
+		points.push_back((va[1]+vb[1]+vc[1])/3.0f);
+		points.push_back((va[2]+vb[2]+vc[2])/3.0f);
+		if ((int)points.size()/3 >= MAX_TUNING_POINTS)
+			break;
 	}
 }
 
+static float getElapsedMs(const TimeVal startTime)
+{
+	return getPerfTimeUsec(getPerfTime() - startTime) / 1000.0f;
+}
+
+void Sample_TempObstacles::buildTuningCandidate(TileCacheTuningJob* job)
+{
+	job->ok = false;
+
+	// Every candidate owns its build state so the candidates can run in parallel.
+	rcContext ctx(false);
+	FastLZCompressor tcomp;
+	MeshProcess tmproc;
+	tmproc.init(m_geom);
+	LinearAllocator talloc(32000);
+
+	rcConfig cfg;
+	dtTileCacheParams tcparams;
+	initBuildConfig(job->def, job->cellSize, job->tileSize, cfg, tcparams);
+
+	int gw = 0, gh = 0;
+	rcCalcGridSize(cfg.bmin, cfg.bmax, job->cellSize, &gw, &gh);
+	const int tw = (gw + job->tileSize - 1) / job->tileSize;
+	const int th = (gh + job->tileSize - 1) / job->tileSize;
+
+	// Rasterize first so the layer count is known before sizing the caches.
+	vector<TileCacheData> layers;
+	for (int y = 0; y < th; ++y)
+	{
+		for (int x = 0; x < tw; ++x)
+		{
+			TileCacheData tiles[MAX_LAYERS];
+			memset(tiles, 0, sizeof(tiles));
+			const int ntiles = rasterizeTileLayers(&ctx, 0, x, y, cfg, tiles, MAX_LAYERS);
+			for (int i = 0; i < ntiles; ++i)
+				layers.push_back(tiles[i]);
+		}
+	}
+
+	job->layerCount = (int)layers.size();
+	job->layersPerTile = (int)dtNextPow2((unsigned int)rcMax(1, (job->layerCount + tw*th - 1) / (tw*th)));
+	tcparams.maxTiles = rcMax(1, job->layerCount);
+
+	int maxTiles = 0, maxPolysPerTile = 0;
+	calcTileBits(tw*th*job->layersPerTile, maxTiles, maxPolysPerTile);
+
+	dtTileCache* tileCache = dtAllocTileCache();
+	dtNavMesh* navMesh = dtAllocNavMesh();
+	dtNavMeshQuery* navQuery = dtAllocNavMeshQuery();
+
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	rcVcopy(params.orig, cfg.bmin);
+	params.tileWidth = job->tileSize * job->cellSize;
+	params.tileHeight = job->tileSize * job->cellSize;
+	params.maxTiles = maxTiles;
+	params.maxPolys = maxPolysPerTile;
+
+	bool ok = tileCache && navMesh && navQuery;
+	ok = ok && dtStatusSucceed(tileCache->init(&tcparams, &talloc, &tcomp, &tmproc));
+	ok = ok && dtStatusSucceed(navMesh->init(&params));
+	ok = ok && dtStatusSucceed(navQuery->init(navMesh, 2048));
+
+	job->compressedSize = 0;
+	for (size_t i = 0; i < layers.size(); ++i)
+	{
+		if (ok && dtStatusSucceed(tileCache->addTile(layers[i].data, layers[i].dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0)))
+			job->compressedSize += layers[i].dataSize;
+		else
+			dtFree(layers[i].data);
+	}
+
+	if (ok)
+	{
+		TimeVal startTime = getPerfTime();
+		for (int y = 0; y < th; ++y)
+			for (int x = 0; x < tw; ++x)
+				tileCache->buildNavMeshTilesAt(x, y, navMesh);
+		job->buildMs = getElapsedMs(startTime);
+
+		job->navMeshSize = 0;
+		for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+		{
+			const dtMeshTile* tile = ((const dtNavMesh*)navMesh)->getTile(i);
+			if (tile->header)
+				job->navMeshSize += tile->dataSize;
+		}
+
+		// Standard query workload: paths between consecutive sample points.
+		const vector<float>& points = *job->points;
+		const int npoints = (int)points.size() / 3;
+		const float halfExtents[3] = { job->def.AgentRadius*2.0f, job->def.AgentStandingHeight, job->def.AgentRadius*2.0f };
+		dtQueryFilter filter;
+		dtPolyRef path[256];
+		int npath = 0;
+
+		job->pathCount = 0;
+		startTime = getPerfTime();
+		for (int i = 0; i + 1 < npoints; ++i)
+		{
+			dtPolyRef startRef = 0, endRef = 0;
+			float startPos[3], endPos[3];
+			navQuery->findNearestPoly(&points[i*3], halfExtents, &filter, &startRef, startPos);
+			navQuery->findNearestPoly(&points[(npoints-1-i)*3], halfExtents, &filter, &endRef, endPos);
+			if (!startRef || !endRef)
+				continue;
+			if (dtStatusSucceed(navQuery->findPath(startRef, endRef, startPos, endPos, &filter, path, &npath, 256)))
+				job->pathCount++;
+		}
+		job->queryMs = getElapsedMs(startTime);
+
+		// Obstacle rebuild latency: add and remove one obstacle at a time and
+		// update the cache until all affected tiles are rebuilt.
+		int nchanges = 0;
+		startTime = getPerfTime();
+		for (int i = 0; i < rcMin(npoints, MAX_TUNING_OBSTACLES); ++i)
+		{
+			const int pi = (i * npoints) / MAX_TUNING_OBSTACLES;
+			dtObstacleRef ref = 0;
+			if (dtStatusFailed(tileCache->addObstacle(&points[pi*3], job->def.AgentRadius*2.0f, job->def.AgentStandingHeight, RC_NULL_AREA, &ref)))
+				continue;
+
+			bool upToDate = false;
+			while (!upToDate && dtStatusSucceed(tileCache->update(0, navMesh, &upToDate))) {}
+			tileCache->removeObstacle(ref);
+			upToDate = false;
+			while (!upToDate && dtStatusSucceed(tileCache->update(0, navMesh, &upToDate))) {}
+			nchanges += 2;
+		}
+		job->obstacleMs = nchanges ? getElapsedMs(startTime) / nchanges : 0.0f;
+
+		job->ok = job->pathCount > 0;
+	}
+
+	dtFreeNavMeshQuery(navQuery);
+	dtFreeNavMesh(navMesh);
+	dtFreeTileCache(tileCache);
+}
+
+void Sample_TempObstacles::runTuningJobs(TileCacheTuningJob* jobs, const int njobs)
+{
+	std::atomic<int> next(0);
+
+	struct Worker
+	{
+		static void run(Sample_TempObstacles* sample, TileCacheTuningJob* jobs, const int njobs, std::atomic<int>* next)
+		{
+			for (int i = (*next)++; i < njobs; i = (*next)++)
+				sample->buildTuningCandidate(&jobs[i]);
+		}
+	};
+
+	const int nthreads = rcClamp((int)std::thread::hardware_concurrency(), 1, njobs);
+	vector<std::thread> threads;
+	for (int i = 0; i < nthreads; ++i)
+		threads.push_back(std::thread(&Worker::run, this, jobs, njobs, &next));
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+}
+
+void Sample_TempObstacles::tuneTileSettings()
+{
+	if (!m_geom || !m_geom->getMesh())
+	{
+		m_ctx->log(RC_LOG_ERROR, "tuneTileSettings: No vertices and triangles.");
+		return;
+	}
+
+	vector<NavMeshDefinition> AllNavMeshes = GetAllMeshDefinitions();
+	if (AllNavMeshes.empty())
+		return;
+
+	vector<float> points;
+	collectTuningPoints(m_geom, AllNavMeshes[0].MaxSlope, points);
+
+	static const float cellScales[] = { 0.75f, 1.0f, 1.5f };
+	static const int tileSizes[] = { 32, 48, 64, 96, 128 };
+	static const int ncellScales = sizeof(cellScales)/sizeof(cellScales[0]);
+	static const int ntileSizes = sizeof(tileSizes)/sizeof(tileSizes[0]);
+
+	vector<TileCacheTuningJob> jobs(ncellScales*ntileSizes);
+	for (int i = 0; i < ncellScales; ++i)
+	{
+		for (int j = 0; j < ntileSizes; ++j)
+		{
+			TileCacheTuningJob& job = jobs[i*ntileSizes + j];
+			job.def = AllNavMeshes[0];
+			job.points = &points;
+			job.cellSize = m_cellSize * cellScales[i];
+			job.tileSize = tileSizes[j];
+		}
+	}
+
+	const TimeVal startTime = getPerfTime();
+	runTuningJobs(&jobs[0], (int)jobs.size());
+	const float totalMs = getElapsedMs(startTime);
+
+	// Score every candidate relative to the best value seen for each metric.
+	// Cell size stands in for quality: coarser cells lose off-mesh link and wall precision.
+	float bestCompressed = FLT_MAX, bestNavMesh = FLT_MAX, bestObstacle = FLT_MAX, bestQuery = FLT_MAX, bestCell = FLT_MAX;
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		const TileCacheTuningJob& job = jobs[i];
+		if (!job.ok) continue;
+		bestCompressed = rcMin(bestCompressed, (float)job.compressedSize);
+		bestNavMesh = rcMin(bestNavMesh, (float)job.navMeshSize);
+		bestObstacle = rcMin(bestObstacle, job.obstacleMs);
+		bestQuery = rcMin(bestQuery, job.queryMs);
+		bestCell = rcMin(bestCell, job.cellSize);
+	}
+
+	const TileCacheTuningJob* best = 0;
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		TileCacheTuningJob& job = jobs[i];
+		if (!job.ok)
+		{
+			m_ctx->log(RC_LOG_WARNING, "Tuning: cs %.2f ts %d failed.", job.cellSize, job.tileSize);
+			continue;
+		}
+		job.score = job.compressedSize / rcMax(bestCompressed, 1.0f) +
+					job.navMeshSize / rcMax(bestNavMesh, 1.0f) +
+					job.obstacleMs / rcMax(bestObstacle, 0.001f) +
+					job.queryMs / rcMax(bestQuery, 0.001f) +
+					job.cellSize / bestCell;
+
+		m_ctx->log(RC_LOG_PROGRESS, "Tuning: cs %.2f ts %3d  layers %d (%d/tile)  cache %.1f kB  mesh %.1f kB  build %.1f ms  obstacle %.2f ms  query %.2f ms (%d paths)  score %.2f",
+				   job.cellSize, job.tileSize, job.layerCount, job.layersPerTile, job.compressedSize/1024.0f, job.navMeshSize/1024.0f,
+				   job.buildMs, job.obstacleMs, job.queryMs, job.pathCount, job.score);
+
+		if (!best || job.score < best->score)
+			best = &job;
+	}
+
+	if (!best)
+	{
+		m_ctx->log(RC_LOG_ERROR, "tuneTileSettings: No candidate could be built.");
+		return;
+	}
+
+	m_ctx->log(RC_LOG_PROGRESS, "Tuning took %.1f ms, recommended cell size %.2f, tile size %d, %d layers per tile.",
+			   totalMs, best->cellSize, best->tileSize, best->layersPerTile);
+
+	m_cellSize = best->cellSize;
+	m_tileSize = (float)best->tileSize;
+	m_expectedLayersPerTile = (float)best->layersPerTile;
+
+	BuildSettings settings;
+	memset(&settings, 0, sizeof(settings));
+	rcVcopy(settings.navMeshBMin, m_geom->getNavMeshBoundsMin());
+	rcVcopy(settings.navMeshBMax, m_geom->getNavMeshBoundsMax());
+	collectSettings(settings);
+
+	if (!m_geom->saveGeomSet(&settings))
+		m_ctx->log(RC_LOG_WARNING, "tuneTileSettings: Could not write build settings.");
+}
+
+void Sample_TempObstacles::handleUpdate(const float dt)
+{
+	Sample::handleUpdate(dt);
+	
+	// All profiles share one rebuild budget per frame.
+	FrameClock clock;
+	m_obstacleRegistry->update(&clock, OBSTACLE_UPDATE_BUDGET_USEC);
+}
+
 void Sample_TempObstacles::getTilePos(const float* pos, int& tx, int& ty)
 {
 	if (!m_geom) return;
@@ -1494,7 +2118,7 @@ void Sample_TempObstacles::getTilePos(const float* pos, int& tx, int& ty)
 }
 
 static const int TILECACHESET_MAGIC = 'T'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'TSET';
-static const int TILECACHESET_VERSION = 4;
+static const int TILECACHESET_VERSION = 6;
 
 struct TileCacheSetHeader
 {
@@ -1512,6 +2136,10 @@ struct TileCacheSetHeader
 
 	int NumNavHints = 0;
 	int NavHintsOffset = 0;
+
+	// Finished nav mesh tiles of the no-obstacle state, so loading does not have to rebuild them
+	int NumNavTiles = 0;
+	int NavTilesOffset = 0;
 };
 
 struct TileCacheExportHeader
@@ -1526,6 +2154,13 @@ struct TileCacheExportHeader
 
 	int NumSurfTypes;
 	int SurfTypesOffset;
+
+	// Landmarks and level transitions of the map, so routes can be planned across campaign maps
+	int NumLandmarks = 0;
+	int LandmarksOffset = 0;
+
+	int NumLevelTransitions = 0;
+	int LevelTransitionsOffset = 0;
 };
 
 struct TileCacheTileHeader
@@ -1534,6 +2169,71 @@ struct TileCacheTileHeader
 	int dataSize;
 };
 
+struct TileCacheNavTileHeader
+{
+	dtTileRef tileRef;
+	int dataSize;
+};
+
+// Nav tile data is stored at this alignment in the file, so it can be used in place when the file is mapped.
+static const int TILECACHESET_NAVTILE_ALIGN = 16;
+
+static long alignedFileOffset(const long offset)
+{
+	return (offset + TILECACHESET_NAVTILE_ALIGN - 1) & ~(long)(TILECACHESET_NAVTILE_ALIGN - 1);
+}
+
+static void padFileToAlignment(FILE* fp)
+{
+	static const unsigned char zeros[TILECACHESET_NAVTILE_ALIGN] = { 0 };
+	const long offset = ftell(fp);
+	const long padding = alignedFileOffset(offset) - offset;
+	if (padding > 0)
+		fwrite(zeros, (size_t)padding, 1, fp);
+}
+
+static bool isTileTouchedByObstacle(const dtTileCache* tileCache, const dtCompressedTileRef ref)
+{
+	for (int i = 0; i < tileCache->getObstacleCount(); ++i)
+	{
+		const dtTileCacheObstacle* ob = tileCache->getObstacle(i);
+		if (ob->state == DT_OBSTACLE_EMPTY)
+			continue;
+
+		for (int j = 0; j < ob->ntouched; ++j)
+		{
+			if (ob->touched[j] == ref)
+				return true;
+		}
+
+		for (int j = 0; j < ob->npending; ++j)
+		{
+			if (ob->pending[j] == ref)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+// Gets the nav mesh tile that can be stored as is for a compressed tile. Tiles changed by obstacles
+// are left out as they do not match the no-obstacle state, as are tiles with off-mesh connections
+// as these point into the tile cache and are rebuilt when the connections are added back.
+static const dtMeshTile* getStorableNavTile(const dtTileCache* tileCache, const dtNavMesh* navMesh, const dtCompressedTile* tile)
+{
+	if (isTileTouchedByObstacle(tileCache, tileCache->getTileRef(tile)))
+		return 0;
+
+	const dtMeshTile* navTile = navMesh->getTileAt(tile->header->tx, tile->header->ty, tile->header->tlayer);
+	if (!navTile || !navTile->header || !navTile->dataSize)
+		return 0;
+
+	if (navTile->header->offMeshConCount > 0)
+		return 0;
+
+	return navTile;
+}
+
 void Sample_TempObstacles::saveAll(const char* path)
 {
 	if (!m_NavMeshArray[0].m_tileCache) return;
@@ -1567,6 +2267,18 @@ void Sample_TempObstacles::SaveData(const char* path)
 
 	fwrite(surfTypes, surfTypesSize, 1, fp);
 
+	const std::vector<BSPLandmark>& landmarks = m_geom->getMesh()->getLandmarks();
+	NewFileHeader.NumLandmarks = (int)landmarks.size();
+	NewFileHeader.LandmarksOffset = ftell(fp);
+	if (!landmarks.empty())
+		fwrite(&landmarks[0], sizeof(BSPLandmark), landmarks.size(), fp);
+
+	const std::vector<BSPLevelTransition>& transitions = m_geom->getMesh()->getLevelTransitions();
+	NewFileHeader.NumLevelTransitions = (int)transitions.size();
+	NewFileHeader.LevelTransitionsOffset = ftell(fp);
+	if (!transitions.empty())
+		fwrite(&transitions[0], sizeof(BSPLevelTransition), transitions.size(), fp);
+
 	NewFileHeader.tileCacheDataOffset = ftell(fp);
 
 	for (int i = 0; i < NumMeshes; i++)
@@ -1578,6 +2290,10 @@ void Sample_TempObstacles::SaveData(const char* path)
 		tcHeader.version = TILECACHESET_VERSION;
 		tcHeader.NumOffMeshCons = 0;
 
+		// Finish queued rebuilds so tiles of removed obstacles are back to their no-obstacle state before they are stored.
+		bool upToDate = false;
+		while (!upToDate && dtStatusSucceed(m_NavMeshArray[i].m_tileCache->update(0, m_NavMeshArray[i].m_navMesh, &upToDate))) {}
+
 		// First remove all the connections so they don't get persisted. These are meant to be dynamic and not baked into the saved data
 		for (int ii = 0; ii < m_NavMeshArray[i].m_tileCache->getOffMeshCount(); ii++)
 		{
@@ -1614,6 +2330,9 @@ void Sample_TempObstacles::SaveData(const char* path)
 			const dtCompressedTile* tile = m_NavMeshArray[i].m_tileCache->getTile(ii);
 			if (!tile || !tile->header || !tile->dataSize) continue;
 			tcHeader.numTiles++;
+
+			if (getStorableNavTile(m_NavMeshArray[i].m_tileCache, m_NavMeshArray[i].m_navMesh, tile))
+				tcHeader.NumNavTiles++;
 		}
 
 		memcpy(&tcHeader.cacheParams, m_NavMeshArray[i].m_tileCache->getParams(), sizeof(dtTileCacheParams));
@@ -1635,6 +2354,26 @@ void Sample_TempObstacles::SaveData(const char* path)
 			fwrite(tile->data, tile->dataSize, 1, fp);
 		}
 
+		tcHeader.NavTilesOffset = ftell(fp);
+
+		// Store the finished nav mesh tiles, each one aligned after its header.
+		for (int ii = 0; ii < m_NavMeshArray[i].m_tileCache->getTileCount(); ++ii)
+		{
+			const dtCompressedTile* tile = m_NavMeshArray[i].m_tileCache->getTile(ii);
+			if (!tile || !tile->header || !tile->dataSize) continue;
+
+			const dtMeshTile* navTile = getStorableNavTile(m_NavMeshArray[i].m_tileCache, m_NavMeshArray[i].m_navMesh, tile);
+			if (!navTile) continue;
+
+			TileCacheNavTileHeader tileHeader;
+			tileHeader.tileRef = m_NavMeshArray[i].m_navMesh->getTileRef(navTile);
+			tileHeader.dataSize = navTile->dataSize;
+			fwrite(&tileHeader, sizeof(tileHeader), 1, fp);
+
+			padFileToAlignment(fp);
+			fwrite(navTile->data, navTile->dataSize, 1, fp);
+		}
+
 		tcHeader.OffMeshConsOffset = ftell(fp);
 
 		// First remove all the connections so they don't get persisted. These are meant to be dynamic and not baked into the saved data
@@ -1679,6 +2418,48 @@ void Sample_TempObstacles::SaveData(const char* path)
 	fclose(fp);
 }
 
+// A compressed tile that is built into nav mesh tile data while loading.
+struct TileCacheLoadJob
+{
+	int meshIndex;
+	dtCompressedTileRef ref;
+	unsigned char* data = 0;
+	int dataSize = 0;
+};
+
+// Builds the tile data of the jobs on a worker pool. Every worker has its own allocator and
+// compressor, the tile caches are only read. Returns the number of threads used.
+static int runTileCacheLoadJobs(NavMeshEntry* meshes, TileCacheLoadJob* jobs, const int njobs)
+{
+	if (njobs <= 0)
+		return 0;
+
+	std::atomic<int> next(0);
+
+	struct Worker
+	{
+		static void run(NavMeshEntry* meshes, TileCacheLoadJob* jobs, const int njobs, std::atomic<int>* next)
+		{
+			LinearAllocator talloc(32000);
+			FastLZCompressor tcomp;
+			for (int i = (*next)++; i < njobs; i = (*next)++)
+			{
+				TileCacheLoadJob& job = jobs[i];
+				meshes[job.meshIndex].m_tileCache->buildNavMeshTileData(job.ref, &talloc, &tcomp, &job.data, &job.dataSize);
+			}
+		}
+	};
+
+	const int nthreads = rcClamp((int)std::thread::hardware_concurrency(), 1, njobs);
+	vector<std::thread> threads;
+	for (int i = 0; i < nthreads; ++i)
+		threads.push_back(std::thread(&Worker::run, meshes, jobs, njobs, &next));
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	return nthreads;
+}
+
 void Sample_TempObstacles::loadAll(const char* path)
 {
 	FILE* fp = fopen(path, "rb");
@@ -1718,10 +2499,18 @@ void Sample_TempObstacles::loadAll(const char* path)
 		m_geom->SetTriangleArea(i, surfTypes[i]);
 	}
 
+	// Dynamic content of every profile, restored once its tiles are in the nav mesh.
+	vector<vector<dtOffMeshConnection> > offMeshCons(fileHeader.numTileCaches);
+	vector<vector<ConvexVolume> > convexVols(fileHeader.numTileCaches);
+	vector<vector<NavHint> > navHints(fileHeader.numTileCaches);
+	vector<TileCacheLoadJob> jobs;
+	int numStoredTiles = 0;
+
 	for (int i = 0; i < fileHeader.numTileCaches; i++)
 	{
 		fseek(fp, fileHeader.tileCacheOffsets[i], SEEK_SET);
 
+		m_obstacleRegistry->removeTileCache(m_NavMeshArray[i].m_tileCache);
 		dtFreeNavMesh(m_NavMeshArray[i].m_navMesh);
 		dtFreeTileCache(m_NavMeshArray[i].m_tileCache);
 		dtFreeNavMeshQuery(m_NavMeshArray[i].m_navQuery);
@@ -1778,12 +2567,59 @@ void Sample_TempObstacles::loadAll(const char* path)
 			{
 				dtFree(data);
 			}
+		}
+
+		// Add the finished nav mesh tiles as they are, the compressed tiles are only needed for later rebuilds.
+		fseek(fp, tcHeader.NavTilesOffset, SEEK_SET);
+
+		for (int ii = 0; ii < tcHeader.NumNavTiles; ++ii)
+		{
+			TileCacheNavTileHeader tileHeader;
+			size_t tileHeaderReadReturnCode = fread(&tileHeader, sizeof(tileHeader), 1, fp);
+			if (tileHeaderReadReturnCode != 1) { break; }
+
+			if (!tileHeader.tileRef || !tileHeader.dataSize)
+				break;
+
+			fseek(fp, alignedFileOffset(ftell(fp)), SEEK_SET);
+
+			unsigned char* data = (unsigned char*)dtAlloc(tileHeader.dataSize, DT_ALLOC_PERM);
+			if (!data) break;
+			size_t tileDataReadReturnCode = fread(data, tileHeader.dataSize, 1, fp);
+			if (tileDataReadReturnCode != 1)
+			{
+				dtFree(data);
+				break;
+			}
+
+			// Restore the tile at its saved ref so poly refs stay valid across save and load.
+			dtStatus addTileStatus = m_NavMeshArray[i].m_navMesh->addTile(data, tileHeader.dataSize, DT_TILE_FREE_DATA, tileHeader.tileRef, 0);
+			if (dtStatusFailed(addTileStatus))
+			{
+				dtFree(data);
+			}
+			else
+			{
+				numStoredTiles++;
+			}
+		}
+
+		// Queue the tiles that were not stored finished.
+		for (int ii = 0; ii < m_NavMeshArray[i].m_tileCache->getTileCount(); ++ii)
+		{
+			const dtCompressedTile* tile = m_NavMeshArray[i].m_tileCache->getTile(ii);
+			if (!tile || !tile->header || !tile->dataSize) continue;
+
+			if (m_NavMeshArray[i].m_navMesh->getTileAt(tile->header->tx, tile->header->ty, tile->header->tlayer))
+				continue;
 
-			if (tile)
-				m_NavMeshArray[i].m_tileCache->buildNavMeshTile(tile, m_NavMeshArray[i].m_navMesh);
+			TileCacheLoadJob job;
+			job.meshIndex = i;
+			job.ref = m_NavMeshArray[i].m_tileCache->getTileRef(tile);
+			jobs.push_back(job);
 		}
 
-		m_NavMeshArray[i].m_navQuery->init(m_NavMeshArray[i].m_navMesh, 2048);
+		fseek(fp, tcHeader.OffMeshConsOffset, SEEK_SET);
 
 		for (int ii = 0; ii < tcHeader.NumOffMeshCons; ii++)
 		{
@@ -1791,7 +2627,7 @@ void Sample_TempObstacles::loadAll(const char* path)
 
 			fread(&def, sizeof(dtOffMeshConnection), 1, fp);
 
-			m_NavMeshArray[i].m_tileCache->addOffMeshConnection(&def.pos[0], &def.pos[3], 10.0f, def.area, def.flags, def.bBiDir, 0);
+			offMeshCons[i].push_back(def);
 		}
 
 		for (int ii = 0; ii < tcHeader.NumConvexVols; ii++)
@@ -1800,7 +2636,7 @@ void Sample_TempObstacles::loadAll(const char* path)
 
 			fread(&def, sizeof(ConvexVolume), 1, fp);
 
-			m_geom->addConvexVolume(i, def.verts, def.nverts, def.hmin, def.hmax, def.area);
+			convexVols[i].push_back(def);
 		}
 
 		for (int ii = 0; ii < tcHeader.NumNavHints; ii++)
@@ -1809,14 +2645,63 @@ void Sample_TempObstacles::loadAll(const char* path)
 
 			fread(&def, sizeof(NavHint), 1, fp);
 
-			m_geom->addNavHint(i, def.position, def.hintType);
+			navHints[i].push_back(def);
 		}
 
 	}	
 	
 	fclose(fp);
+
+	// Build the queued tiles of all profiles in parallel. Only the tile data is built here,
+	// the nav meshes are not touched until every build is done.
+	TimeVal startTime = getPerfTime();
+	const int nthreads = runTileCacheLoadJobs(m_NavMeshArray, jobs.empty() ? 0 : &jobs[0], (int)jobs.size());
+	const float buildMs = getElapsedMs(startTime);
+
+	// Add the built tiles in order, then restore the dynamic content on top of them.
+	for (size_t ii = 0; ii < jobs.size(); ++ii)
+	{
+		TileCacheLoadJob& job = jobs[ii];
+		if (!job.data)
+			continue;
+
+		dtStatus status = m_NavMeshArray[job.meshIndex].m_navMesh->replaceTile(job.data, job.dataSize, DT_TILE_FREE_DATA, 0);
+		if (dtStatusFailed(status))
+			dtFree(job.data);
+	}
+
+	for (int i = 0; i < fileHeader.numTileCaches; i++)
+	{
+		if (!m_NavMeshArray[i].m_navMesh || !m_NavMeshArray[i].m_tileCache || !m_NavMeshArray[i].m_navQuery)
+			continue;
+
+		m_NavMeshArray[i].m_navQuery->init(m_NavMeshArray[i].m_navMesh, 2048);
+		m_obstacleRegistry->addTileCache(m_NavMeshArray[i].m_tileCache, m_NavMeshArray[i].m_navMesh);
+
+		for (size_t ii = 0; ii < offMeshCons[i].size(); ii++)
+		{
+			const dtOffMeshConnection& def = offMeshCons[i][ii];
+			m_NavMeshArray[i].m_tileCache->addOffMeshConnection(&def.pos[0], &def.pos[3], 10.0f, def.area, def.flags, def.bBiDir, 0);
+		}
+
+		for (size_t ii = 0; ii < convexVols[i].size(); ii++)
+		{
+			const ConvexVolume& def = convexVols[i][ii];
+			m_geom->addConvexVolume(i, def.verts, def.nverts, def.hmin, def.hmax, def.area);
+		}
+
+		for (size_t ii = 0; ii < navHints[i].size(); ii++)
+		{
+			const NavHint& def = navHints[i][ii];
+			m_geom->addNavHint(i, def.position, def.hintType);
+		}
+	}
+
+	m_ctx->log(RC_LOG_PROGRESS, "loadAll: %d stored tiles, %d tiles built on %d threads in %.1f ms",
+			   numStoredTiles, (int)jobs.size(), nthreads, buildMs);
 }
 
+
 void Sample_TempObstacles::addOffMeshConnection(const float* spos, const float* epos, const float rad, const unsigned char area, const unsigned int flags, const bool bBiDirectional)
 {
 	dtTileCache* CurrentTileCache = getTileCache();
@@ -177,6 +177,7 @@ NavMeshTileTool::~NavMeshTileTool()
 Sample_TileMesh::Sample_TileMesh() :
 	m_keepInterResults(false),
 	m_buildAll(true),
+	m_polyGridResolution(8),
 	m_totalBuildTimeMs(0),
 	m_triareas(0),
 	m_solid(0),
@@ -229,12 +230,17 @@ void Sample_TileMesh::handleSettings()
 
 	if (imguiCheck("Keep Intermediate Results", m_keepInterResults))
 		m_keepInterResults = !m_keepInterResults;
+	if (imguiCheck("Capture Tile Inputs", m_captureTiles))
+		m_captureTiles = !m_captureTiles;
+	if (imguiButton("Replay Tile Captures"))
+		replayTileCaptures();
 
 	if (imguiCheck("Build All Tiles", m_buildAll))
 		m_buildAll = !m_buildAll;
 	
 	imguiLabel("Tiling");
 	imguiSlider("TileSize", &m_tileSize, 16.0f, 1024.0f, 16.0f);
+	imguiSlider("Poly Grid Cells", &m_polyGridResolution, 0.0f, 64.0f, 4.0f);
 	
 	if (m_geom)
 	{
@@ -620,6 +626,8 @@ bool Sample_TileMesh::handleBuild()
 		m_ctx->log(RC_LOG_ERROR, "buildTiledNavigation: Could not init navmesh.");
 		return false;
 	}
+	// Point location grids speed up findNearestPoly for the tools and the crowd.
+	m_navMesh->setPolyGridResolution((int)m_polyGridResolution);
 	
 	status = m_navQuery->init(m_navMesh, 2048);
 	if (dtStatusFailed(status))
@@ -771,7 +779,10 @@ void Sample_TileMesh::buildAllTiles()
 	m_ctx->stopTimer(RC_TIMER_TEMP);
 
 	m_totalBuildTimeMs = m_ctx->getAccumulatedTime(RC_TIMER_TEMP)/1000.0f;
-	
+
+	m_ctx->log(RC_LOG_PROGRESS, "Built '%s' from %d triangles (%d culled) in %.1f ms.",
+			   m_geom->getMesh()->getMapName().c_str(), m_geom->getMesh()->getTriCount(),
+			   m_geom->getMesh()->getBSPCulledTriCount(), m_totalBuildTimeMs);
 }
 
 void Sample_TileMesh::removeAllTiles()
@@ -902,6 +913,39 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	const int ncid = rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, cid, 512);
 	if (!ncid)
 		return 0;
+
+	if (m_captureTiles)
+	{
+		duTileCapture capture;
+		duInitTileCapture(capture);
+		memcpy(&capture.cfg, &m_cfg, sizeof(m_cfg));
+		capture.cfg.crouchHeight = 13;
+		capture.tx = tx;
+		capture.ty = ty;
+		if (m_partitionType == SAMPLE_PARTITION_WATERSHED)
+			capture.mode = DU_TILECAPTURE_WATERSHED;
+		else if (m_partitionType == SAMPLE_PARTITION_MONOTONE)
+			capture.mode = DU_TILECAPTURE_MONOTONE;
+		else if (m_partitionType == SAMPLE_PARTITION_LAYERS)
+			capture.mode = DU_TILECAPTURE_LAYER_REGIONS;
+		else
+			capture.mode = DU_TILECAPTURE_ADAPTIVE;
+		capture.flags = getTileCaptureFlags();
+		capture.compactHeight = 13;
+
+		for (int i = 0; i < ncid; ++i)
+		{
+			const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
+			duAppendTileCaptureTris(capture, verts, &chunkyMesh->tris[node.i*3], surfTypes, node.n);
+		}
+
+		const ConvexVolume* vols = m_geom->getConvexVolumes();
+		for (int i = 0; i < m_geom->getConvexVolumeCount(); ++i)
+			duAppendTileCaptureVolume(capture, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, vols[i].area);
+
+		saveTileCapture(capture, 0);
+		duFreeTileCapture(capture);
+	}
 	
 	m_tileTriCount = 0;
 	
@@ -996,6 +1040,10 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 	//   - can be slow and create a bit ugly tessellation (still better than monotone)
 	//     if you have large open areas with small obstacles (not a problem if you use tiles)
 	//   * good choice to use for tiled navmesh with medium and small sized tiles
+	// 4) Adaptive partitioning
+	//   - chooses one of the above per tile from its span count, area count and border complexity
+	//   - uses monotone or layers on simple tiles and watershed only where it is needed
+	//   * good choice for large tiled worlds which are mostly open
 	
 	if (m_partitionType == SAMPLE_PARTITION_WATERSHED)
 	{
@@ -1023,6 +1071,15 @@ unsigned char* Sample_TileMesh::buildTileMesh(const int tx, const int ty, const
 			return 0;
 		}
 	}
+	else if (m_partitionType == SAMPLE_PARTITION_ADAPTIVE)
+	{
+		// Pick monotone, layer or watershed partitioning per tile based on how cluttered it is.
+		if (!rcBuildRegionsAdaptive(m_ctx, *m_chf, m_cfg.borderSize, m_cfg.minRegionArea, m_cfg.mergeRegionArea))
+		{
+			m_ctx->log(RC_LOG_ERROR, "buildNavigation: Could not build adaptive regions.");
+			return 0;
+		}
+	}
 	else // SAMPLE_PARTITION_LAYERS
 	{
 		// Partition the walkable surface into simple regions without holes.
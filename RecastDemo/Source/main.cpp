@@ -71,6 +71,9 @@ static const int g_nsamples = sizeof(g_samples) / sizeof(SampleItem);
 
 int main(int /*argc*/, char** /*argv*/)
 {
+	// Count Recast and Detour allocations for the memory reports.
+	initAllocTracking();
+
 	// Init SDL
 	if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
 	{
@@ -159,6 +162,9 @@ int main(int /*argc*/, char** /*argv*/)
 	bool showMenu = !presentationMode;
 	bool showLog = false;
 	bool showTools = true;
+	bool mergeBSPFaces = true;
+	bool cullBSPVoidFaces = true;
+	bool useBSPGeometryCache = true;
 	bool showLevels = false;
 	bool showSample = false;
 	bool showTestCases = false;
@@ -967,6 +973,13 @@ int main(int /*argc*/, char** /*argv*/)
 						 geom->getMesh()->getTriCount()/1000.0f);
 				imguiValue(text);
 			}
+			// These apply to the next map load, compare the triangle counts and build times in the logs.
+			if (imguiCheck("Merge Coplanar Faces", mergeBSPFaces))
+				mergeBSPFaces = !mergeBSPFaces;
+			if (imguiCheck("Cull Void Faces", cullBSPVoidFaces))
+				cullBSPVoidFaces = !cullBSPVoidFaces;
+			if (imguiCheck("Geometry Cache", useBSPGeometryCache))
+				useBSPGeometryCache = !useBSPGeometryCache;
 			imguiSeparator();
 
 			if (geom && sample)
@@ -1109,6 +1122,9 @@ int main(int /*argc*/, char** /*argv*/)
 				}
 				
 				geom = new InputGeom;
+				geom->setMergeBSPFaces(mergeBSPFaces);
+				geom->setCullBSPVoidFaces(cullBSPVoidFaces);
+				geom->setUseBSPGeometryCache(useBSPGeometryCache);
 				if (!geom->load(&ctx, path))
 				{
 					delete geom;
@@ -161,7 +161,8 @@ project "RecastDemo"
 		linkoptions { 
 			"`pkg-config --libs sdl2`",
 			"`pkg-config --libs gl`",
-			"`pkg-config --libs glu`" 
+			"`pkg-config --libs glu`",
+			"-pthread"
 		}
 
 	filter { "system:linux", "toolset:gcc", "files:*.c" }
@@ -224,6 +225,8 @@ project "Tests"
 		"../Tests/Detour/*.h",
 		"../Tests/Detour/*.cpp",
 		"../Tests/DetourCrowd/*.cpp",
+		"../Tests/DetourTileCache/*.h",
+		"../Tests/DetourTileCache/*.cpp",
 		"../Tests/Contrib/catch2/*.cpp"
 	}
 
@@ -250,13 +253,14 @@ project "Tests"
 			"`pkg-config --cflags sdl2`",
 			"`pkg-config --cflags gl`",
 			"`pkg-config --cflags glu`",
-			"-Wno-parentheses" -- Disable parentheses warning for the Tests target, as Catch's macros generate this everywhere.
+			"-Wno-parentheses", -- Disable parentheses warning for the Tests target, as Catch's macros generate this everywhere.
+			"-pthread" -- The tile cache tests build tiles on several threads.
 		}
 		linkoptions { 
 			"`pkg-config --libs sdl2`",
 			"`pkg-config --libs gl`",
 			"`pkg-config --libs glu`",
-			"-lpthread"
+			"-pthread"
 		}
 
 	-- windows library cflags and libs
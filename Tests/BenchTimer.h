@@ -0,0 +1,25 @@
+#ifndef BENCHTIMER_H
+#define BENCHTIMER_H
+
+// Benchmarks are compiled only where BENCH_TIMER_AVAILABLE is defined.
+// TODO: Implement benchmarking for platforms other than posix.
+#ifdef __unix__
+#include <unistd.h>
+#ifdef _POSIX_TIMERS
+#include <time.h>
+#include <stdint.h>
+
+#define BENCH_TIMER_AVAILABLE
+
+/// Process CPU time in nanoseconds.
+inline int64_t NowNanos()
+{
+	struct timespec tp;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
+	return tp.tv_nsec + 1000000000LL * tp.tv_sec;
+}
+
+#endif // _POSIX_TIMERS
+#endif // __unix__
+
+#endif // BENCHTIMER_H
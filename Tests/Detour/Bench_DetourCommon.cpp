@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "BenchTimer.h"
+#include "DetourCommon.h"
+#include "PolygonTestUtils.h"
+#include <vector>
+
+#ifdef BENCH_TIMER_AVAILABLE
+
+// Navmesh sized polygons stored the way a tile stores them, so the gathered versions
+// pay for the gather like the query does.
+struct BenchPolys
+{
+	static const int NVP = 6;
+	std::vector<float> verts;
+	std::vector<unsigned short> indices;
+	std::vector<int> counts;
+	std::vector<float> points;
+
+	explicit BenchPolys(const int npolys)
+	{
+		TestRandom rnd(42);
+		for (int p = 0; p < npolys; ++p)
+		{
+			float poly[NVP*3];
+			// Close together, so that the overlap tests often have to try every axis.
+			const int nverts = makeTestPoly(rnd, poly, NVP, false, 3.0f);
+			for (int i = 0; i < NVP; ++i)
+				indices.push_back((unsigned short)(verts.size()/3 + (i < nverts ? i : 0)));
+			verts.insert(verts.end(), poly, poly + nverts*3);
+			counts.push_back(nverts);
+			float pt[3];
+			makeTestPoint(rnd, poly, nverts, pt);
+			points.insert(points.end(), pt, pt + 3);
+		}
+	}
+
+	int size() const { return (int)counts.size(); }
+
+	void gather(const int i, float* out) const
+	{
+		for (int k = 0; k < counts[i]; ++k)
+			dtVcopy(&out[k*3], &verts[indices[i*NVP+k]*3]);
+	}
+};
+
+static void reportBench(const char* name, const int iterations, const int64_t scalarNanos, const int64_t soaNanos)
+{
+	printf("BM_%-35s %d iterations, scalar %10.2f nanos/it, gathered %10.2f nanos/it\n",
+		   name, iterations, double(scalarNanos) / iterations, double(soaNanos) / iterations);
+}
+
+TEST_CASE("DetourCommonPolygonKernels")
+{
+	static const int NUM_POLYS = 4096;
+	static const int ROUNDS = 50;
+	const BenchPolys polys(NUM_POLYS);
+	const int iterations = NUM_POLYS * ROUNDS;
+	float verts[DT_SOA_MAX_VERTS*3];
+	dtPolySoA soa;
+	int checksum = 0, checksumSoA = 0;
+
+	{
+		int64_t begin = NowNanos();
+		for (int r = 0; r < ROUNDS; ++r)
+			for (int i = 0; i < NUM_POLYS; ++i)
+			{
+				polys.gather(i, verts);
+				checksum += dtPointInPolygon(&polys.points[i*3], verts, polys.counts[i]) ? 1 : 0;
+			}
+		const int64_t scalarNanos = NowNanos() - begin;
+		begin = NowNanos();
+		for (int r = 0; r < ROUNDS; ++r)
+			for (int i = 0; i < NUM_POLYS; ++i)
+			{
+				dtGatherPolySoAIndexed(soa, &polys.indices[i*BenchPolys::NVP], polys.counts[i], &polys.verts[0]);
+				checksumSoA += dtPointInPolygonSoA(&polys.points[i*3], soa) ? 1 : 0;
+			}
+		reportBench("PointInPolygon:", iterations, scalarNanos, NowNanos() - begin);
+	}
+
+	{
+		float ed[DT_SOA_MAX_VERTS], et[DT_SOA_MAX_VERTS];
+		int64_t begin = NowNanos();
+		for (int r = 0; r < ROUNDS; ++r)
+			for (int i = 0; i < NUM_POLYS; ++i)
+			{
+				polys.gather(i, verts);
+				checksum += dtDistancePtPolyEdgesSqr(&polys.points[i*3], verts, polys.counts[i], ed, et) ? 1 : 0;
+				checksum += ed[0] < 1.0f ? 1 : 0;
+			}
+		const int64_t scalarNanos = NowNanos() - begin;
+		begin = NowNanos();
+		for (int r = 0; r < ROUNDS; ++r)
+			for (int i = 0; i < NUM_POLYS; ++i)
+			{
+				dtGatherPolySoAIndexed(soa, &polys.indices[i*BenchPolys::NVP], polys.counts[i], &polys.verts[0]);
+				checksumSoA += dtDistancePtPolyEdgesSqrSoA(&polys.points[i*3], soa, ed, et) ? 1 : 0;
+				checksumSoA += ed[0] < 1.0f ? 1 : 0;
+			}
+		reportBench("DistancePtPolyEdgesSqr:", iterations, scalarNanos, NowNanos() - begin);
+	}
+
+	{
+		const float end[3] = { 0.0f, 0.0f, 0.0f };
+		float tmin, tmax;
+		int segMin, segMax;
+		int64_t begin = NowNanos();
+		for (int r = 0; r < ROUNDS; ++r)
+			for (int i = 0; i < NUM_POLYS; ++i)
+			{
+				polys.gather(i, verts);
+				checksum += dtIntersectSegmentPoly2D(&polys.points[i*3], end, verts, polys.counts[i], tmin, tmax, segMin, segMax) ? segMax : 0;
+			}
+		const int64_t scalarNanos = NowNanos() - begin;
+		begin = NowNanos();
+		for (int r = 0; r < ROUNDS; ++r)
+			for (int i = 0; i < NUM_POLYS; ++i)
+			{
+				dtGatherPolySoAIndexed(soa, &polys.indices[i*BenchPolys::NVP], polys.counts[i], &polys.verts[0]);
+				checksumSoA += dtIntersectSegmentPoly2DSoA(&polys.points[i*3], end, soa, tmin, tmax, segMin, segMax) ? segMax : 0;
+			}
+		reportBench("IntersectSegmentPoly2D:", iterations, scalarNanos, NowNanos() - begin);
+	}
+
+	{
+		float other[DT_SOA_MAX_VERTS*3];
+		dtPolySoA otherSoA;
+		int64_t begin = NowNanos();
+		for (int r = 0; r < ROUNDS; ++r)
+			for (int i = 1; i < NUM_POLYS; ++i)
+			{
+				polys.gather(i, verts);
+				polys.gather(i-1, other);
+				checksum += dtOverlapPolyPoly2D(verts, polys.counts[i], other, polys.counts[i-1]) ? 1 : 0;
+			}
+		const int64_t scalarNanos = NowNanos() - begin;
+		begin = NowNanos();
+		for (int r = 0; r < ROUNDS; ++r)
+			for (int i = 1; i < NUM_POLYS; ++i)
+			{
+				dtGatherPolySoAIndexed(soa, &polys.indices[i*BenchPolys::NVP], polys.counts[i], &polys.verts[0]);
+				dtGatherPolySoAIndexed(otherSoA, &polys.indices[(i-1)*BenchPolys::NVP], polys.counts[i-1], &polys.verts[0]);
+				checksumSoA += dtOverlapPolyPoly2DSoA(soa, otherSoA) ? 1 : 0;
+			}
+		reportBench("OverlapPolyPoly2D:", iterations, scalarNanos, NowNanos() - begin);
+	}
+
+	REQUIRE(checksum == checksumSoA);
+}
+
+#endif // BENCH_TIMER_AVAILABLE
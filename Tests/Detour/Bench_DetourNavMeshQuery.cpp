@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "BenchTimer.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourAlloc.h"
+#include "NavMeshTestUtils.h"
+#include <vector>
+
+static const int QUADS_PER_SIDE = 32;
+static const float QUAD_SIZE = 1.0f;
+
+static float terrainHeight(const int x, const int z)
+{
+	return 0.1f * (float)((x * 7 + z * 13) % 5);
+}
+
+// Builds a tile of QUADS_PER_SIDE x QUADS_PER_SIDE quads over uneven ground.
+static unsigned char* buildTerrainTile(int* dataSize)
+{
+	static const float CS = 0.5f;
+	static const float CH = 0.1f;
+	const int nv = QUADS_PER_SIDE + 1;
+	TestTileBuilder builder;
+	for (int z = 0; z < nv; ++z)
+	{
+		for (int x = 0; x < nv; ++x)
+			builder.addVert((int)(x * QUAD_SIZE / CS), (int)(terrainHeight(x, z) / CH + 0.5f), (int)(z * QUAD_SIZE / CS));
+	}
+
+	for (int z = 0; z < QUADS_PER_SIDE; ++z)
+	{
+		for (int x = 0; x < QUADS_PER_SIDE; ++x)
+		{
+			const int poly = builder.addQuad((unsigned short)(x + z*nv), (unsigned short)(x + (z+1)*nv),
+											 (unsigned short)(x+1 + (z+1)*nv), (unsigned short)(x+1 + z*nv));
+			// Edges: -x, +z, +x, -z.
+			if (x > 0)
+				builder.setNeighbour(poly, 0, poly - 1);
+			if (z < QUADS_PER_SIDE-1)
+				builder.setNeighbour(poly, 1, poly + QUADS_PER_SIDE);
+			if (x < QUADS_PER_SIDE-1)
+				builder.setNeighbour(poly, 2, poly + 1);
+			if (z > 0)
+				builder.setNeighbour(poly, 3, poly - QUADS_PER_SIDE);
+		}
+	}
+
+	builder.params.bmax[0] = QUADS_PER_SIDE * QUAD_SIZE;
+	builder.params.bmax[2] = QUADS_PER_SIDE * QUAD_SIZE;
+	builder.params.cs = CS;
+	builder.params.ch = CH;
+	builder.params.buildBvTree = true;
+	return builder.build(dataSize);
+}
+
+static dtNavMesh* createTerrainMesh(const int gridResolution, const size_t memoryBudget = 0)
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = QUADS_PER_SIDE * QUAD_SIZE;
+	params.tileHeight = QUADS_PER_SIDE * QUAD_SIZE;
+	params.maxTiles = 1;
+	params.maxPolys = QUADS_PER_SIDE*QUADS_PER_SIDE;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(dtStatusSucceed(nav->init(&params)));
+	nav->setPolyGridResolution(gridResolution);
+	nav->setMemoryBudget(memoryBudget);
+	int dataSize = 0;
+	unsigned char* data = buildTerrainTile(&dataSize);
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+	return nav;
+}
+
+// Query points over the tile, most of them close to the ground.
+static void makeQueryPoints(std::vector<float>& points, const int count)
+{
+	unsigned int state = 1234u;
+	for (int i = 0; i < count * 3; ++i)
+	{
+		state = state * 1664525u + 1013904223u;
+		const float r = (state >> 8) * (1.0f / 16777216.0f);
+		if (i % 3 == 1)
+			points.push_back(r < 0.8f ? r * 0.8f : 1.0f + r * 3.0f);
+		else
+			points.push_back(-1.0f + r * (QUADS_PER_SIDE * QUAD_SIZE + 2.0f));
+	}
+}
+
+TEST_CASE("dtNavMesh point location grid")
+{
+	dtNavMesh* bvNav = createTerrainMesh(0);
+	dtNavMesh* gridNav = createTerrainMesh(16);
+	dtNavMeshQuery* bvQuery = dtAllocNavMeshQuery();
+	dtNavMeshQuery* gridQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(bvQuery->init(bvNav, 16)));
+	REQUIRE(dtStatusSucceed(gridQuery->init(gridNav, 16)));
+
+	SECTION("Grids are opt-in and accounted for")
+	{
+		dtNavMeshMemoryUsage bvUsage, gridUsage;
+		bvNav->getMemoryUsage(&bvUsage);
+		gridNav->getMemoryUsage(&gridUsage);
+		REQUIRE(bvUsage.polyGrids == 0);
+		REQUIRE(gridUsage.polyGrids > 0);
+		REQUIRE(gridUsage.total == bvUsage.total + gridUsage.polyGrids);
+		REQUIRE(gridNav->getTileDataSize() == bvNav->getTileDataSize() + gridUsage.polyGrids);
+		REQUIRE(static_cast<const dtNavMesh*>(bvNav)->getTile(0)->polyGrid == 0);
+		REQUIRE(static_cast<const dtNavMesh*>(gridNav)->getTile(0)->polyGrid != 0);
+	}
+
+	SECTION("Grid lookups match the bounding volume tree")
+	{
+		std::vector<float> points;
+		makeQueryPoints(points, 2000);
+		const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+		dtQueryFilter filter;
+		for (int i = 0; i < (int)points.size() / 3; ++i)
+		{
+			const float* pt = &points[i*3];
+			dtPolyRef bvRef = 0, gridRef = 0;
+			float bvPt[3], gridPt[3];
+			bool bvOver = false, gridOver = false;
+			REQUIRE(dtStatusSucceed(bvQuery->findNearestPoly(pt, halfExtents, &filter, &bvRef, bvPt, &bvOver)));
+			REQUIRE(dtStatusSucceed(gridQuery->findNearestPoly(pt, halfExtents, &filter, &gridRef, gridPt, &gridOver)));
+			REQUIRE(bvRef == gridRef);
+			REQUIRE(bvOver == gridOver);
+			for (int k = 0; k < 3; ++k)
+				REQUIRE(bvPt[k] == Catch::Approx(gridPt[k]).margin(1e-4));
+		}
+	}
+
+	SECTION("Removing the tile frees the grid")
+	{
+		REQUIRE(dtStatusSucceed(gridNav->removeTile(gridNav->getTileRefAt(0, 0, 0), 0, 0)));
+		dtNavMeshMemoryUsage usage;
+		gridNav->getMemoryUsage(&usage);
+		REQUIRE(usage.polyGrids == 0);
+		REQUIRE(gridNav->getTileDataSize() == 0);
+	}
+
+	SECTION("Tiles that only fit the memory budget without a grid get none")
+	{
+		dtNavMesh* nav = createTerrainMesh(16, bvNav->getTileDataSize());
+		REQUIRE(static_cast<const dtNavMesh*>(nav)->getTile(0)->polyGrid == 0);
+		REQUIRE(nav->getTileDataSize() == bvNav->getTileDataSize());
+		dtFreeNavMesh(nav);
+	}
+
+	dtFreeNavMeshQuery(gridQuery);
+	dtFreeNavMeshQuery(bvQuery);
+	dtFreeNavMesh(gridNav);
+	dtFreeNavMesh(bvNav);
+}
+
+TEST_CASE("dtNavMesh point location grid with stacked polygons")
+{
+	// Smaller quads a little above a floor, all within climb height of a point between
+	// them, so both searches have to break the tie the same way. The floor comes last
+	// in polygon order but not in bounding volume tree order.
+	TestTileBuilder builder;
+	builder.params.ch = 0.1f;
+	builder.params.bmax[0] = 10.0f;
+	builder.params.bmax[2] = 10.0f;
+	builder.params.buildBvTree = true;
+	for (int i = 0; i < 4; ++i)
+	{
+		const int x = (i % 2) * 5;
+		const int z = (i / 2) * 5;
+		const unsigned short v = builder.addVert(x + 1, 3, z + 1);
+		builder.addVert(x + 1, 3, z + 4);
+		builder.addVert(x + 4, 3, z + 4);
+		builder.addVert(x + 4, 3, z + 1);
+		builder.addQuad(v, (unsigned short)(v+1), (unsigned short)(v+2), (unsigned short)(v+3));
+	}
+	const unsigned short base = builder.addVert(0, 0, 0);
+	builder.addVert(0, 0, 10);
+	builder.addVert(10, 0, 10);
+	builder.addVert(10, 0, 0);
+	builder.addQuad(base, (unsigned short)(base+1), (unsigned short)(base+2), (unsigned short)(base+3));
+
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = 10.0f;
+	params.tileHeight = 10.0f;
+	params.maxTiles = 1;
+	params.maxPolys = 8;
+
+	dtNavMesh* navs[2];
+	dtNavMeshQuery* queries[2];
+	for (int i = 0; i < 2; ++i)
+	{
+		navs[i] = dtAllocNavMesh();
+		REQUIRE(dtStatusSucceed(navs[i]->init(&params)));
+		navs[i]->setPolyGridResolution(i * 4);
+		int dataSize = 0;
+		unsigned char* data = builder.build(&dataSize);
+		REQUIRE(dtStatusSucceed(navs[i]->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0)));
+		queries[i] = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(queries[i]->init(navs[i], 16)));
+	}
+	REQUIRE(static_cast<const dtNavMesh*>(navs[1])->getTile(0)->polyGrid != 0);
+
+	const float halfExtents[3] = { 1.0f, 1.0f, 1.0f };
+	dtQueryFilter filter;
+	for (int z = 0; z < 20; ++z)
+	{
+		for (int x = 0; x < 20; ++x)
+		{
+			const float pt[3] = { x * 0.5f + 0.25f, 0.15f, z * 0.5f + 0.25f };
+			dtPolyRef refs[2];
+			float heights[2];
+			for (int i = 0; i < 2; ++i)
+			{
+				float nearest[3];
+				REQUIRE(dtStatusSucceed(queries[i]->findNearestPoly(pt, halfExtents, &filter, &refs[i], nearest, 0)));
+				heights[i] = nearest[1];
+			}
+			REQUIRE(refs[0] == refs[1]);
+			REQUIRE(heights[0] == Catch::Approx(heights[1]).margin(1e-4));
+		}
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		dtFreeNavMeshQuery(queries[i]);
+		dtFreeNavMesh(navs[i]);
+	}
+}
+
+// Agents taking short steps in random directions, one step per frame.
+struct TrackedAgents
+{
+	std::vector<float> positions;
+	std::vector<float> headings;
+	unsigned int state;
+
+	explicit TrackedAgents(const int count) : state(99u)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			positions.push_back(1.0f + next() * (QUADS_PER_SIDE * QUAD_SIZE - 2.0f));
+			positions.push_back(0.0f);
+			positions.push_back(1.0f + next() * (QUADS_PER_SIDE * QUAD_SIZE - 2.0f));
+			headings.push_back(next() * 6.2831853f);
+		}
+	}
+
+	float next()
+	{
+		state = state * 1664525u + 1013904223u;
+		return (state >> 8) * (1.0f / 16777216.0f);
+	}
+
+	int size() const { return (int)headings.size(); }
+
+	void step(const float len)
+	{
+		const float extent = QUADS_PER_SIDE * QUAD_SIZE;
+		for (int i = 0; i < size(); ++i)
+		{
+			float* p = &positions[i*3];
+			headings[i] += (next() - 0.5f) * 0.5f;
+			p[0] += cosf(headings[i]) * len;
+			p[2] += sinf(headings[i]) * len;
+			// Turn around at the tile border.
+			if (p[0] < 0.5f || p[0] > extent - 0.5f || p[2] < 0.5f || p[2] > extent - 0.5f)
+			{
+				p[0] = dtClamp(p[0], 0.5f, extent - 0.5f);
+				p[2] = dtClamp(p[2], 0.5f, extent - 0.5f);
+				headings[i] += 3.1415926f;
+			}
+			p[1] = 0.2f;
+		}
+	}
+};
+
+TEST_CASE("dtNavMeshQuery poly tracker")
+{
+	dtNavMesh* nav = createTerrainMesh(0);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 16)));
+	const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+	dtQueryFilter filter;
+
+	TrackedAgents agents(64);
+	std::vector<dtPolyTracker> trackers(agents.size());
+	memset(&trackers[0], 0, sizeof(dtPolyTracker) * trackers.size());
+
+	SECTION("Tracked polygons match findNearestPoly")
+	{
+		int searchCount = 0;
+		REQUIRE(dtStatusSucceed(query->updatePolyTrackers(&trackers[0], &agents.positions[0], agents.size(),
+														  halfExtents, &filter, &searchCount)));
+		REQUIRE(searchCount == agents.size());
+
+		int totalSearches = 0;
+		for (int frame = 0; frame < 100; ++frame)
+		{
+			agents.step(0.3f);
+			REQUIRE(dtStatusSucceed(query->updatePolyTrackers(&trackers[0], &agents.positions[0], agents.size(),
+															  halfExtents, &filter, &searchCount)));
+			totalSearches += searchCount;
+			for (int i = 0; i < agents.size(); ++i)
+			{
+				dtPolyRef ref = 0;
+				float nearest[3];
+				REQUIRE(dtStatusSucceed(query->findNearestPoly(&agents.positions[i*3], halfExtents, &filter, &ref, nearest)));
+				REQUIRE(trackers[i].ref == ref);
+				for (int k = 0; k < 3; ++k)
+					REQUIRE(trackers[i].pos[k] == Catch::Approx(nearest[k]).margin(1e-4));
+			}
+		}
+		REQUIRE(totalSearches == 0);
+	}
+
+	SECTION("Long moves and stale polygons are searched")
+	{
+		dtPolyTracker tracker;
+		tracker.ref = 0;
+		const float start[3] = { 1.5f, 0.2f, 1.5f };
+		REQUIRE(dtStatusSucceed(query->updatePolyTracker(&tracker, start, halfExtents, &filter)));
+		REQUIRE(tracker.ref != 0);
+
+		const float teleport[3] = { 20.5f, 0.2f, 20.5f };
+		int searchCount = 0;
+		REQUIRE(dtStatusSucceed(query->updatePolyTrackers(&tracker, teleport, 1, halfExtents, &filter, &searchCount)));
+		REQUIRE(searchCount == 1);
+		dtPolyRef ref = 0;
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(teleport, halfExtents, &filter, &ref, 0)));
+		REQUIRE(tracker.ref == ref);
+
+		const float off[3] = { 100.0f, 0.2f, 100.0f };
+		REQUIRE(dtStatusSucceed(query->updatePolyTracker(&tracker, off, halfExtents, &filter)));
+		REQUIRE(tracker.ref == 0);
+		REQUIRE(dtStatusSucceed(query->updatePolyTrackers(&tracker, teleport, 1, halfExtents, &filter, &searchCount)));
+		REQUIRE(searchCount == 1);
+		REQUIRE(tracker.ref == ref);
+
+		// A reference from an older version of the tile.
+		unsigned int salt, it, ip;
+		nav->decodePolyId(tracker.ref, salt, it, ip);
+		tracker.ref = nav->encodePolyId(salt + 1, it, ip);
+		REQUIRE(dtStatusSucceed(query->updatePolyTrackers(&tracker, teleport, 1, halfExtents, &filter, &searchCount)));
+		REQUIRE(searchCount == 1);
+		REQUIRE(tracker.ref == ref);
+	}
+
+	SECTION("Invalid input")
+	{
+		REQUIRE(dtStatusFailed(query->updatePolyTracker(0, &agents.positions[0], halfExtents, &filter)));
+		REQUIRE(dtStatusFailed(query->updatePolyTrackers(&trackers[0], &agents.positions[0], -1, halfExtents, &filter)));
+		const float nan[3] = { 0.0f, NAN, 0.0f };
+		REQUIRE(dtStatusDetail(query->updatePolyTrackers(&trackers[0], nan, 1, halfExtents, &filter), DT_INVALID_PARAM));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+#ifdef BENCH_TIMER_AVAILABLE
+
+static int64_t timeFindNearestPoly(const dtNavMeshQuery* query, const std::vector<float>& points, const int rounds, int& checksum)
+{
+	const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+	dtQueryFilter filter;
+	const int64_t begin = NowNanos();
+	for (int r = 0; r < rounds; ++r)
+	{
+		for (int i = 0; i < (int)points.size() / 3; ++i)
+		{
+			dtPolyRef ref = 0;
+			float nearest[3];
+			query->findNearestPoly(&points[i*3], halfExtents, &filter, &ref, nearest);
+			checksum += (int)(ref & 0xff);
+		}
+	}
+	return NowNanos() - begin;
+}
+
+TEST_CASE("DetourNavMeshQueryFindNearestPoly")
+{
+	static const int NUM_POINTS = 4096;
+	static const int ROUNDS = 20;
+	std::vector<float> points;
+	makeQueryPoints(points, NUM_POINTS);
+
+	dtNavMesh* bvNav = createTerrainMesh(0);
+	dtNavMesh* gridNav = createTerrainMesh(32);
+	dtNavMeshQuery* bvQuery = dtAllocNavMeshQuery();
+	dtNavMeshQuery* gridQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(bvQuery->init(bvNav, 16)));
+	REQUIRE(dtStatusSucceed(gridQuery->init(gridNav, 16)));
+
+	int checksum = 0, checksumGrid = 0;
+	const int64_t bvNanos = timeFindNearestPoly(bvQuery, points, ROUNDS, checksum);
+	const int64_t gridNanos = timeFindNearestPoly(gridQuery, points, ROUNDS, checksumGrid);
+	const int iterations = NUM_POINTS * ROUNDS;
+	printf("BM_%-35s %d iterations, bvtree %10.2f nanos/it, grid %10.2f nanos/it\n",
+		   "FindNearestPoly:", iterations, double(bvNanos) / iterations, double(gridNanos) / iterations);
+	REQUIRE(checksum == checksumGrid);
+
+	dtFreeNavMeshQuery(gridQuery);
+	dtFreeNavMeshQuery(bvQuery);
+	dtFreeNavMesh(gridNav);
+	dtFreeNavMesh(bvNav);
+}
+
+TEST_CASE("DetourNavMeshQueryPolyTracker")
+{
+	static const int NUM_AGENTS = 256;
+	static const int FRAMES = 100;
+	const float halfExtents[3] = { 2.0f, 4.0f, 2.0f };
+	dtQueryFilter filter;
+
+	dtNavMesh* nav = createTerrainMesh(0);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 16)));
+
+	TrackedAgents searched(NUM_AGENTS);
+	TrackedAgents tracked(NUM_AGENTS);
+	std::vector<dtPolyTracker> trackers(NUM_AGENTS);
+	memset(&trackers[0], 0, sizeof(dtPolyTracker) * trackers.size());
+
+	int checksum = 0, checksumTracked = 0;
+	int64_t searchNanos = 0, trackNanos = 0;
+	for (int frame = 0; frame < FRAMES; ++frame)
+	{
+		searched.step(0.3f);
+		tracked.step(0.3f);
+
+		int64_t begin = NowNanos();
+		for (int i = 0; i < NUM_AGENTS; ++i)
+		{
+			dtPolyRef ref = 0;
+			float nearest[3];
+			query->findNearestPoly(&searched.positions[i*3], halfExtents, &filter, &ref, nearest);
+			checksum += (int)(ref & 0xff);
+		}
+		searchNanos += NowNanos() - begin;
+
+		begin = NowNanos();
+		query->updatePolyTrackers(&trackers[0], &tracked.positions[0], NUM_AGENTS, halfExtents, &filter);
+		trackNanos += NowNanos() - begin;
+		for (int i = 0; i < NUM_AGENTS; ++i)
+			checksumTracked += (int)(trackers[i].ref & 0xff);
+	}
+
+	const int iterations = NUM_AGENTS * FRAMES;
+	printf("BM_%-35s %d iterations, search %10.2f nanos/it, tracker %10.2f nanos/it\n",
+		   "PolyTracker:", iterations, double(searchNanos) / iterations, double(trackNanos) / iterations);
+	REQUIRE(checksum == checksumTracked);
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+#endif // BENCH_TIMER_AVAILABLE
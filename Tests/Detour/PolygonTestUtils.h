@@ -0,0 +1,69 @@
+#ifndef POLYGONTESTUTILS_H
+#define POLYGONTESTUTILS_H
+
+#include <math.h>
+
+#include "DetourCommon.h"
+
+// Small deterministic generator, so failures can be reproduced.
+struct TestRandom
+{
+	unsigned int state;
+
+	explicit TestRandom(const unsigned int seed) : state(seed) {}
+
+	float next()
+	{
+		state = state * 1664525u + 1013904223u;
+		return (state >> 8) * (1.0f / 16777216.0f);
+	}
+};
+
+// Convex polygon centered within @p spread of the origin. Snapped polygons are rounded to
+// a coarse grid so that axis aligned and degenerate edges are covered as well.
+inline int makeTestPoly(TestRandom& rnd, float* verts, const int maxVerts, const bool snap, const float spread = 10.0f)
+{
+	const int nverts = 3 + (int)(rnd.next() * (maxVerts - 2));
+	const float cx = (rnd.next() * 2.0f - 1.0f) * spread;
+	const float cz = (rnd.next() * 2.0f - 1.0f) * spread;
+	const float rad = 0.5f + rnd.next() * 4.0f;
+	float angle = rnd.next();
+	for (int i = 0; i < nverts; ++i)
+	{
+		angle += (0.2f + rnd.next()) * (6.2831853f / (nverts + 1));
+		float* v = &verts[i*3];
+		v[0] = cx + cosf(-angle) * rad;
+		v[1] = rnd.next();
+		v[2] = cz + sinf(-angle) * rad;
+		if (snap)
+		{
+			v[0] = floorf(v[0] * 2.0f) * 0.5f;
+			v[2] = floorf(v[2] * 2.0f) * 0.5f;
+		}
+	}
+	return nverts;
+}
+
+inline void makeTestPoint(TestRandom& rnd, const float* verts, const int nverts, float* pt)
+{
+	const float r = rnd.next();
+	if (r < 0.2f)
+	{
+		// On a vertex.
+		dtVcopy(pt, &verts[(int)(rnd.next() * nverts) * 3]);
+	}
+	else if (r < 0.4f)
+	{
+		// On an edge.
+		const int i = (int)(rnd.next() * nverts);
+		dtVlerp(pt, &verts[i*3], &verts[((i+1) % nverts)*3], rnd.next());
+	}
+	else
+	{
+		pt[0] = verts[0] + rnd.next() * 12.0f - 6.0f;
+		pt[1] = 0.0f;
+		pt[2] = verts[2] + rnd.next() * 12.0f - 6.0f;
+	}
+}
+
+#endif // POLYGONTESTUTILS_H
@@ -1,6 +1,13 @@
 #include "catch2/catch_all.hpp"
 
+#include <math.h>
+#include <string.h>
+
 #include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+#include "NavMeshTestUtils.h"
 
 TEST_CASE("dtRandomPointInConvexPoly")
 {
@@ -31,3 +38,341 @@ TEST_CASE("dtRandomPointInConvexPoly")
 		REQUIRE(out[2] == Catch::Approx(0));
 	}
 }
+
+// Builds a single quad polygon tile covering [tx*10, tx*10+10] along x and [0, 10] along z.
+static unsigned char* buildQuadTile(const int tx, dtOffMeshConnection* cons, const int ncons, int* dataSize)
+{
+	TestTileBuilder builder;
+	builder.addVert(0, 0, 0);
+	builder.addVert(0, 0, 10);
+	builder.addVert(10, 0, 10);
+	builder.addVert(10, 0, 0);
+	builder.addQuad(0, 1, 2, 3);
+	builder.params.tileX = tx;
+	builder.params.bmin[0] = tx * 10.0f;
+	builder.params.bmax[0] = tx * 10.0f + 10.0f;
+	builder.params.bmax[2] = 10.0f;
+	builder.params.GlobalOffMeshConnections = cons;
+	builder.params.NumOffMeshConnections = ncons;
+	return builder.build(dataSize);
+}
+
+TEST_CASE("dtNavMesh overflow links")
+{
+	static const int NUM_CONS = 16;
+	dtOffMeshConnection cons[NUM_CONS];
+	for (int i = 0; i < NUM_CONS; ++i)
+	{
+		dtOffMeshConnection& con = cons[i];
+		const float spos[3] = { 2.0f + i * 0.25f, 0.0f, 5.0f };
+		const float epos[3] = { 15.0f, 0.0f, 2.0f + i * 0.25f };
+		dtVcopy(&con.pos[0], spos);
+		dtVcopy(&con.pos[3], epos);
+		con.rad = 1.0f;
+		con.flags = 1;
+		con.area = 1;
+		con.bBiDir = true;
+		con.userId = (unsigned int)i;
+		con.state = DT_OFFMESH_DIRTY;
+		con.FromTileX = 0;
+		con.FromTileY = 0;
+		con.FromTileLayer = 0;
+		con.ToTileX = 1;
+		con.ToTileY = 0;
+		con.ToTileLayer = 0;
+	}
+
+	dtNavMeshParams navParams;
+	memset(&navParams, 0, sizeof(navParams));
+	navParams.tileWidth = 10.0f;
+	navParams.tileHeight = 10.0f;
+	navParams.maxTiles = 4;
+	navParams.maxPolys = 64;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(nav);
+	REQUIRE(dtStatusSucceed(nav->init(&navParams)));
+
+	// The landing tile is built before the connections exist, so it reserves no links for them.
+	int dataSize = 0;
+	unsigned char* data = buildQuadTile(1, 0, 0, &dataSize);
+	dtTileRef landingRef = 0;
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &landingRef)));
+
+	data = buildQuadTile(0, cons, NUM_CONS, &dataSize);
+	dtTileRef startRef = 0;
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &startRef)));
+
+	for (int i = 0; i < NUM_CONS; ++i)
+	{
+		nav->baseOffMeshLinks(&cons[i]);
+		nav->GlobalOffMeshLinks(&cons[i]);
+	}
+
+	SECTION("Every connection links both ways once the tiles run out of links")
+	{
+		REQUIRE(nav->getOverflowLinkCount() > 0);
+
+		const dtMeshTile* landingTile = nav->getTileByRef(landingRef);
+		int landingLinks = 0;
+		for (unsigned int k = landingTile->polys[0].firstLink; k != DT_NULL_LINK; k = nav->getLink(landingTile, k)->next)
+			landingLinks++;
+		REQUIRE(landingLinks == NUM_CONS);
+
+		const dtMeshTile* startTile = nav->getTileByRef(startRef);
+		for (int i = 0; i < NUM_CONS; ++i)
+		{
+			const dtPoly* conPoly = &startTile->polys[cons[i].poly];
+			int conLinks = 0;
+			for (unsigned int k = conPoly->firstLink; k != DT_NULL_LINK; k = nav->getLink(startTile, k)->next)
+				conLinks++;
+			REQUIRE(conLinks == 2);
+		}
+	}
+
+	SECTION("Pathfinding crosses connections stored in overflow links")
+	{
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+
+		dtQueryFilter filter;
+		const float halfExtents[3] = { 1.0f, 1.0f, 1.0f };
+		const float startPos[3] = { 5.0f, 0.0f, 5.0f };
+		const float endPos[3] = { 15.0f, 0.0f, 5.0f };
+		dtPolyRef startPoly = 0, endPoly = 0;
+		float nearest[3];
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startPoly, nearest)));
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endPoly, nearest)));
+		REQUIRE(startPoly);
+		REQUIRE(endPoly);
+
+		dtPolyRef path[16];
+		int npath = 0;
+		dtStatus status = query->findPath(endPoly, startPoly, endPos, startPos, &filter, path, &npath, 16);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(!dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(npath == 3);
+
+		dtFreeNavMeshQuery(query);
+	}
+
+	SECTION("Removing tiles returns overflow links to the pool")
+	{
+		REQUIRE(dtStatusSucceed(nav->removeTile(startRef, 0, 0)));
+		REQUIRE(dtStatusSucceed(nav->removeTile(landingRef, 0, 0)));
+		REQUIRE(nav->getOverflowLinkCount() == 0);
+	}
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh tile grid")
+{
+	dtNavMeshParams navParams;
+	memset(&navParams, 0, sizeof(navParams));
+	navParams.tileWidth = 10.0f;
+	navParams.tileHeight = 10.0f;
+	navParams.maxTiles = 4;
+	navParams.maxPolys = 64;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(nav);
+	REQUIRE(dtStatusSucceed(nav->init(&navParams)));
+
+	const int tileXs[] = { 3, -2, 70000 };
+	dtTileRef refs[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		int dataSize = 0;
+		unsigned char* data = buildQuadTile(tileXs[i], 0, 0, &dataSize);
+		REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &refs[i])));
+
+		// The grid grows to cover nearby tiles, the far away tile moves everything to the hash.
+		REQUIRE(nav->hasTileGrid() == (i < 2));
+		for (int j = 0; j <= i; ++j)
+			REQUIRE(nav->getTileRefAt(tileXs[j], 0, 0) == refs[j]);
+		REQUIRE(nav->getTileRefAt(0, 0, 0) == 0);
+		REQUIRE(nav->getTileRefAt(3, 1, 0) == 0);
+	}
+
+	REQUIRE(dtStatusSucceed(nav->removeTile(refs[1], 0, 0)));
+	REQUIRE(nav->getTileRefAt(-2, 0, 0) == 0);
+	REQUIRE(nav->getTileRefAt(3, 0, 0) == refs[0]);
+	REQUIRE(nav->getTileRefAt(70000, 0, 0) == refs[2]);
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMesh memory budget")
+{
+	dtNavMeshParams navParams;
+	memset(&navParams, 0, sizeof(navParams));
+	navParams.tileWidth = 10.0f;
+	navParams.tileHeight = 10.0f;
+	navParams.maxTiles = 4;
+	navParams.maxPolys = 64;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(nav);
+	REQUIRE(dtStatusSucceed(nav->init(&navParams)));
+
+	int dataSize = 0;
+	unsigned char* data = buildQuadTile(0, 0, 0, &dataSize);
+	dtTileRef ref = 0;
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &ref)));
+	REQUIRE(nav->getTileDataSize() == (size_t)dataSize);
+
+	dtNavMeshMemoryUsage tileUsage;
+	nav->getTileMemoryUsage(nav->getTileByRef(ref), &tileUsage);
+	REQUIRE(tileUsage.total == (size_t)dataSize);
+
+	dtNavMeshMemoryUsage usage;
+	nav->getMemoryUsage(&usage);
+	REQUIRE(usage.total == usage.tileTable + usage.overflowLinks + (size_t)dataSize);
+
+	// A second tile does not fit once the budget only covers the first one.
+	nav->setMemoryBudget((size_t)dataSize + 1);
+	int secondSize = 0;
+	unsigned char* second = buildQuadTile(1, 0, 0, &secondSize);
+	const dtStatus status = nav->addTile(second, secondSize, DT_TILE_FREE_DATA, 0, 0);
+	REQUIRE(dtStatusFailed(status));
+	REQUIRE(dtStatusDetail(status, DT_OUT_OF_MEMORY));
+
+	// Removing the first tile frees room for the second.
+	REQUIRE(dtStatusSucceed(nav->removeTile(ref, 0, 0)));
+	REQUIRE(nav->getTileDataSize() == 0);
+	REQUIRE(dtStatusSucceed(nav->addTile(second, secondSize, DT_TILE_FREE_DATA, 0, 0)));
+
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshQuery raycast batch")
+{
+	static const int NUM_TILES = 3;
+	static const int NUM_RAYS = 64;
+
+	dtNavMeshParams navParams;
+	memset(&navParams, 0, sizeof(navParams));
+	navParams.tileWidth = 10.0f;
+	navParams.tileHeight = 10.0f;
+	navParams.maxTiles = 4;
+	navParams.maxPolys = 64;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(nav);
+	REQUIRE(dtStatusSucceed(nav->init(&navParams)));
+
+	dtPolyRef polyRefs[NUM_TILES];
+	for (int i = 0; i < NUM_TILES; ++i)
+	{
+		int dataSize = 0;
+		unsigned char* data = buildQuadTile(i, 0, 0, &dataSize);
+		dtTileRef ref = 0;
+		REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, &ref)));
+		polyRefs[i] = nav->getPolyRefBase(nav->getTileByRef(ref));
+	}
+
+	// Rays start in a random tile and head in a random direction, some of them leave the tile.
+	dtPolyRef startRefs[NUM_RAYS];
+	float startPos[NUM_RAYS*3];
+	float endPos[NUM_RAYS*3];
+	unsigned int seed = 12345;
+	for (int i = 0; i < NUM_RAYS; ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		const int tile = (int)((seed >> 16) % NUM_TILES);
+		seed = seed * 1103515245u + 12345u;
+		const float u = (float)((seed >> 16) & 0x3ff) / 1024.0f;
+		seed = seed * 1103515245u + 12345u;
+		const float v = (float)((seed >> 16) & 0x3ff) / 1024.0f;
+		seed = seed * 1103515245u + 12345u;
+		const float a = (float)((seed >> 16) & 0x3ff) / 1024.0f * 6.2831853f;
+		startRefs[i] = polyRefs[tile];
+		dtVset(&startPos[i*3], tile*10.0f + 1.0f + u*8.0f, 0.0f, 1.0f + v*8.0f);
+		dtVset(&endPos[i*3], startPos[i*3+0] + cosf(a)*4.0f, 0.0f, startPos[i*3+2] + sinf(a)*4.0f);
+	}
+	// An invalid start reference only fails its own ray.
+	startRefs[NUM_RAYS-1] = 0;
+
+	dtQueryFilter filter;
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(query);
+	REQUIRE(dtStatusSucceed(query->init(nav, 128)));
+
+	int order[NUM_RAYS];
+	REQUIRE(dtStatusSucceed(query->sortRaycastBatch(startRefs, NUM_RAYS, order)));
+	for (int i = 1; i < NUM_RAYS; ++i)
+	{
+		REQUIRE(startRefs[order[i-1]] <= startRefs[order[i]]);
+		if (startRefs[order[i-1]] == startRefs[order[i]])
+			REQUIRE(order[i-1] < order[i]);
+	}
+
+	float t[NUM_RAYS];
+	float hitNormals[NUM_RAYS*3];
+	int hitEdges[NUM_RAYS];
+	int pathCounts[NUM_RAYS];
+	dtStatus status[NUM_RAYS];
+
+	dtRaycastBatch batch;
+	memset(&batch, 0, sizeof(batch));
+	batch.count = NUM_RAYS;
+	batch.startRefs = startRefs;
+	batch.startPos = startPos;
+	batch.endPos = endPos;
+	batch.order = order;
+	batch.t = t;
+	batch.hitNormals = hitNormals;
+	batch.hitEdgeIndices = hitEdges;
+	batch.pathCounts = pathCounts;
+	batch.status = status;
+
+	REQUIRE(dtStatusFailed(query->raycastBatch(batch, &filter, 0, 0, NUM_RAYS + 1)));
+
+	// Cast the sorted batch in slices with a query object per slice, like worker threads would.
+	static const int NUM_SLICES = 3;
+	for (int s = 0; s < NUM_SLICES; ++s)
+	{
+		dtNavMeshQuery* worker = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(worker->init(nav, 128)));
+		const int first = NUM_RAYS * s / NUM_SLICES;
+		const int last = NUM_RAYS * (s + 1) / NUM_SLICES;
+		REQUIRE(dtStatusSucceed(worker->raycastBatch(batch, &filter, 0, first, last)));
+		dtFreeNavMeshQuery(worker);
+	}
+
+	for (int i = 0; i < NUM_RAYS; ++i)
+	{
+		dtPolyRef path[16];
+		dtRaycastHit hit;
+		memset(&hit, 0, sizeof(hit));
+		hit.path = path;
+		hit.maxPath = 16;
+		const dtStatus expected = query->raycast(startRefs[i], &startPos[i*3], &endPos[i*3], &filter, 0, &hit);
+
+		REQUIRE(status[i] == expected);
+		if (dtStatusFailed(expected))
+			continue;
+		REQUIRE(t[i] == hit.t);
+		REQUIRE(hitEdges[i] == hit.hitEdgeIndex);
+		REQUIRE(pathCounts[i] == hit.pathCount);
+		REQUIRE(memcmp(&hitNormals[i*3], hit.hitNormal, sizeof(float)*3) == 0);
+	}
+	REQUIRE(dtStatusFailed(status[NUM_RAYS-1]));
+
+	// Without the optional outputs only the hit parameter is written.
+	float unsortedT[NUM_RAYS];
+	dtRaycastBatch minimal;
+	memset(&minimal, 0, sizeof(minimal));
+	minimal.count = NUM_RAYS - 1;
+	minimal.startRefs = startRefs;
+	minimal.startPos = startPos;
+	minimal.endPos = endPos;
+	minimal.t = unsortedT;
+	REQUIRE(dtStatusSucceed(query->raycastBatch(minimal, &filter, 0, 0, minimal.count)));
+	for (int i = 0; i < NUM_RAYS - 1; ++i)
+		REQUIRE(unsortedT[i] == t[i]);
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,73 @@
+#include <string.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "PolygonTestUtils.h"
+
+TEST_CASE("Gathered polygon functions")
+{
+	static const int NUM_POLYS = 2000;
+	static const int NUM_POINTS = 16;
+
+	TestRandom rnd(1234);
+	float verts[DT_SOA_MAX_VERTS*3];
+	float other[DT_SOA_MAX_VERTS*3];
+
+	SECTION("Gathering repeats the first vertex")
+	{
+		const int nverts = makeTestPoly(rnd, verts, 6, false);
+		dtPolySoA soa;
+		dtGatherPolySoA(soa, verts, nverts);
+		REQUIRE(soa.nverts == nverts);
+		REQUIRE(soa.x[nverts] == verts[0]);
+		REQUIRE(soa.x[DT_SOA_MAX_VERTS] == verts[0]);
+		REQUIRE(soa.z[DT_SOA_MAX_VERTS] == verts[2]);
+
+		const unsigned short idx[] = { 2, 0, 1 };
+		dtGatherPolySoAIndexed(soa, idx, 3, verts);
+		REQUIRE(soa.x[0] == verts[6]);
+		REQUIRE(soa.z[3] == verts[8]);
+	}
+
+	SECTION("Results match the per-vertex versions exactly")
+	{
+		for (int p = 0; p < NUM_POLYS; ++p)
+		{
+			const int nverts = makeTestPoly(rnd, verts, DT_SOA_MAX_VERTS, (p & 1) != 0);
+			dtPolySoA soa;
+			dtGatherPolySoA(soa, verts, nverts);
+
+			for (int k = 0; k < NUM_POINTS; ++k)
+			{
+				float pt[3], pq[3];
+				makeTestPoint(rnd, verts, nverts, pt);
+				makeTestPoint(rnd, verts, nverts, pq);
+
+				REQUIRE(dtPointInPolygon(pt, verts, nverts) == dtPointInPolygonSoA(pt, soa));
+
+				float ed[DT_SOA_MAX_VERTS], et[DT_SOA_MAX_VERTS];
+				float edSoA[DT_SOA_MAX_VERTS], etSoA[DT_SOA_MAX_VERTS];
+				const bool inside = dtDistancePtPolyEdgesSqr(pt, verts, nverts, ed, et);
+				REQUIRE(inside == dtDistancePtPolyEdgesSqrSoA(pt, soa, edSoA, etSoA));
+				REQUIRE(memcmp(ed, edSoA, sizeof(float)*nverts) == 0);
+				REQUIRE(memcmp(et, etSoA, sizeof(float)*nverts) == 0);
+
+				float tmin, tmax, tminSoA, tmaxSoA;
+				int segMin, segMax, segMinSoA, segMaxSoA;
+				const bool hit = dtIntersectSegmentPoly2D(pt, pq, verts, nverts, tmin, tmax, segMin, segMax);
+				REQUIRE(hit == dtIntersectSegmentPoly2DSoA(pt, pq, soa, tminSoA, tmaxSoA, segMinSoA, segMaxSoA));
+				REQUIRE(memcmp(&tmin, &tminSoA, sizeof(float)) == 0);
+				REQUIRE(memcmp(&tmax, &tmaxSoA, sizeof(float)) == 0);
+				REQUIRE(segMin == segMinSoA);
+				REQUIRE(segMax == segMaxSoA);
+			}
+
+			const int nother = makeTestPoly(rnd, other, DT_SOA_MAX_VERTS, (p & 2) != 0);
+			dtPolySoA otherSoA;
+			dtGatherPolySoA(otherSoA, other, nother);
+			REQUIRE(dtOverlapPolyPoly2D(verts, nverts, other, nother) == dtOverlapPolyPoly2DSoA(soa, otherSoA));
+			REQUIRE(dtOverlapPolyPoly2D(verts, nverts, verts, nverts) == dtOverlapPolyPoly2DSoA(soa, soa));
+		}
+	}
+}
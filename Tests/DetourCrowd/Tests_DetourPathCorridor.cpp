@@ -1,6 +1,11 @@
 #include "catch2/catch_all.hpp"
 
+#include <string.h>
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
 #include "DetourPathCorridor.h"
+#include "NavMeshTestUtils.h"
 
 TEST_CASE("dtMergeCorridorStartMoved")
 {
@@ -117,3 +122,150 @@ TEST_CASE("dtMergeCorridorStartMoved")
         CHECK_THAT(path, Catch::Matchers::RangeEquals(expectedPath));
     }
 }
+
+static const int STRIP_TILE_SIZE = 8;
+
+// Builds a tile of quads along x, one per [x0, x1] span given in tile local units.
+// Spans that touch are connected, and spans at the tile edges connect to the neighbour tiles.
+static unsigned char* buildStripTile(const int tx, const int* spans, const int nspans, int* dataSize)
+{
+    TestTileBuilder builder;
+    for (int i = 0; i < nspans; ++i)
+    {
+        const int x0 = spans[i*2+0];
+        const int x1 = spans[i*2+1];
+        builder.addVert(x0, 0, 0);
+        builder.addVert(x0, 0, 1);
+        builder.addVert(x1, 0, 1);
+        builder.addVert(x1, 0, 0);
+        const int poly = builder.addQuad((unsigned short)(i*4+0), (unsigned short)(i*4+1),
+                                         (unsigned short)(i*4+2), (unsigned short)(i*4+3));
+        if (i > 0 && spans[i*2-1] == x0)
+            builder.setNeighbour(poly, 0, i-1);
+        else if (x0 == 0)
+            builder.setPortal(poly, 0, 0);
+        if (i < nspans-1 && spans[i*2+2] == x1)
+            builder.setNeighbour(poly, 2, i+1);
+        else if (x1 == STRIP_TILE_SIZE)
+            builder.setPortal(poly, 2, 2);
+    }
+
+    builder.params.tileX = tx;
+    builder.params.bmin[0] = (float)(tx * STRIP_TILE_SIZE);
+    builder.params.bmax[0] = (float)(tx * STRIP_TILE_SIZE + STRIP_TILE_SIZE);
+    builder.params.bmax[2] = 1.0f;
+    return builder.build(dataSize);
+}
+
+static dtTileRef replaceStripTile(dtNavMesh* nav, const int tx, const int* spans, const int nspans)
+{
+    int dataSize = 0;
+    unsigned char* data = buildStripTile(tx, spans, nspans, &dataSize);
+    dtTileRef ref = 0;
+    REQUIRE(dtStatusSucceed(nav->replaceTile(data, dataSize, DT_TILE_FREE_DATA, &ref)));
+    return ref;
+}
+
+static bool isCorridorConnected(const dtNavMesh* nav, const dtPathCorridor& corridor)
+{
+    const dtPolyRef* path = corridor.getPath();
+    for (int i = 0; i + 1 < corridor.getPathCount(); ++i)
+    {
+        const dtMeshTile* tile = 0;
+        const dtPoly* poly = 0;
+        if (dtStatusFailed(nav->getTileAndPolyByRef(path[i], &tile, &poly)))
+            return false;
+        bool linked = false;
+        for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = nav->getLink(tile, k)->next)
+            linked = linked || nav->getLink(tile, k)->ref == path[i+1];
+        if (!linked)
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE("dtPathCorridor repairPath")
+{
+    static const int COARSE[] = { 0,2, 2,4, 4,6, 6,8 };
+    static const int FINE[] = { 0,1, 1,2, 2,3, 3,4, 4,5, 5,6, 6,7, 7,8 };
+    static const int BLOCKED[] = { 0,2, 6,8 };
+
+    dtNavMeshParams navParams;
+    memset(&navParams, 0, sizeof(navParams));
+    navParams.tileWidth = (float)STRIP_TILE_SIZE;
+    navParams.tileHeight = 1.0f;
+    navParams.maxTiles = 4;
+    navParams.maxPolys = 16;
+
+    dtNavMesh* nav = dtAllocNavMesh();
+    REQUIRE(dtStatusSucceed(nav->init(&navParams)));
+    replaceStripTile(nav, 0, COARSE, 4);
+    replaceStripTile(nav, 1, COARSE, 4);
+
+    dtNavMeshQuery* query = dtAllocNavMeshQuery();
+    REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+    dtQueryFilter filter;
+
+    const float startPos[3] = { 1.0f, 0.0f, 0.5f };
+    const float endPos[3] = { 15.5f, 0.0f, 0.5f };
+    const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+    dtPolyRef startRef = 0, endRef = 0;
+    REQUIRE(dtStatusSucceed(query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0)));
+    REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0)));
+    dtPolyRef path[32];
+    int npath = 0;
+    REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, path, &npath, 32)));
+    REQUIRE(npath == 8);
+
+    dtPathCorridor corridor;
+    REQUIRE(corridor.init(32));
+    corridor.reset(startRef, startPos);
+    corridor.setCorridor(endPos, path, npath);
+
+    SECTION("Valid corridors are left alone")
+    {
+        REQUIRE(corridor.repairPath(query, &filter));
+        REQUIRE(corridor.getPathCount() == 8);
+    }
+
+    SECTION("Corridor follows a split tile")
+    {
+        replaceStripTile(nav, 1, FINE, 8);
+        REQUIRE_FALSE(corridor.isValid(corridor.getPathCount(), query, &filter));
+        REQUIRE(corridor.repairPath(query, &filter));
+        REQUIRE(corridor.isValid(corridor.getPathCount(), query, &filter));
+        REQUIRE(isCorridorConnected(nav, corridor));
+        REQUIRE(corridor.getPathCount() == 4 + 8);
+        REQUIRE(corridor.getFirstPoly() == startRef);
+
+        dtPolyRef lastRef = 0;
+        REQUIRE(dtStatusSucceed(query->findNearestPoly(endPos, halfExtents, &filter, &lastRef, 0)));
+        REQUIRE(corridor.getLastPoly() == lastRef);
+    }
+
+    SECTION("References follow several replacements")
+    {
+        replaceStripTile(nav, 1, FINE, 8);
+        replaceStripTile(nav, 1, COARSE, 4);
+        for (int i = 0; i < npath; ++i)
+        {
+            const dtPolyRef ref = nav->remapPolyRef(path[i]);
+            REQUIRE(nav->isValidPolyRef(ref));
+        }
+        REQUIRE(corridor.repairPath(query, &filter));
+        REQUIRE(isCorridorConnected(nav, corridor));
+        REQUIRE(corridor.getPathCount() == 8);
+    }
+
+    SECTION("Blocked corridors are left for replanning")
+    {
+        replaceStripTile(nav, 1, BLOCKED, 2);
+        REQUIRE_FALSE(corridor.repairPath(query, &filter));
+        REQUIRE(corridor.getPathCount() == 8);
+        REQUIRE(nav->remapPolyRef(path[5]) == 0);
+        REQUIRE(nav->remapPolyRef(path[4]) != 0);
+    }
+
+    dtFreeNavMeshQuery(query);
+    dtFreeNavMesh(nav);
+}
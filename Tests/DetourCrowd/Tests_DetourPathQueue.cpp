@@ -0,0 +1,167 @@
+#include "catch2/catch_all.hpp"
+
+#include <string.h>
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourPathQueue.h"
+#include "NavMeshTestUtils.h"
+
+// Clock that advances one tick every time it is read, so budgets are deterministic.
+struct CountingClock : public dtQueryClock
+{
+	mutable long long ticks = 0;
+	virtual long long getTicks() const { return ticks++; }
+};
+
+// Builds a tile with a strip of connected unit quads along x, so a search from one end
+// to the other takes one iteration per quad.
+static dtNavMesh* buildStripNavMesh(const int nquads, dtTileRef* tileRef)
+{
+	REQUIRE(nquads <= 64);
+
+	TestTileBuilder builder;
+	for (int i = 0; i <= nquads; ++i)
+	{
+		builder.addVert(i, 0, 0);
+		builder.addVert(i, 0, 1);
+	}
+	for (int i = 0; i < nquads; ++i)
+	{
+		const int poly = builder.addQuad((unsigned short)(i*2+0), (unsigned short)(i*2+1),
+										 (unsigned short)(i*2+3), (unsigned short)(i*2+2));
+		if (i > 0)
+			builder.setNeighbour(poly, 0, i-1);
+		if (i < nquads-1)
+			builder.setNeighbour(poly, 2, i+1);
+	}
+	builder.params.bmax[0] = (float)nquads;
+	builder.params.bmax[2] = 1.0f;
+
+	int dataSize = 0;
+	unsigned char* data = builder.build(&dataSize);
+
+	dtNavMeshParams navParams;
+	memset(&navParams, 0, sizeof(navParams));
+	navParams.tileWidth = (float)nquads;
+	navParams.tileHeight = 1.0f;
+	navParams.maxTiles = 1;
+	navParams.maxPolys = 64;
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	REQUIRE(nav);
+	REQUIRE(dtStatusSucceed(nav->init(&navParams)));
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, tileRef)));
+	return nav;
+}
+
+TEST_CASE("Time budgeted sliced pathfinding")
+{
+	static const int NUM_QUADS = 48;
+	static const int MAX_PATH = 64;
+
+	dtTileRef tileRef = 0;
+	dtNavMesh* nav = buildStripNavMesh(NUM_QUADS, &tileRef);
+	const dtPolyRef base = nav->getPolyRefBase(nav->getTileByRef(tileRef));
+	const dtPolyRef startRef = base;
+	const dtPolyRef endRef = base | (dtPolyRef)(NUM_QUADS-1);
+	const float startPos[3] = { 0.5f, 0.0f, 0.5f };
+	const float endPos[3] = { NUM_QUADS - 0.5f, 0.0f, 0.5f };
+
+	dtQueryFilter filter;
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+
+	dtPolyRef expected[MAX_PATH];
+	int nexpected = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, expected, &nexpected, MAX_PATH)));
+	REQUIRE(nexpected == NUM_QUADS);
+
+	CountingClock clock;
+
+	SECTION("Search stops at the deadline and resumes")
+	{
+		REQUIRE(dtStatusInProgress(query->initSlicedFindPath(startRef, endRef, startPos, endPos, &filter)));
+
+		int iters = 0;
+		dtStatus status = query->updateSlicedFindPathTimed(&clock, clock.getTicks() + 10, 2, &iters);
+		REQUIRE(dtStatusInProgress(status));
+		// The clock is read once every two iterations.
+		REQUIRE(iters == 20);
+
+		// Past the deadline the search still advances by one step.
+		status = query->updateSlicedFindPathTimed(&clock, 0, 2, &iters);
+		REQUIRE(iters == 2);
+
+		int frames = 0;
+		while (dtStatusInProgress(status))
+		{
+			status = query->updateSlicedFindPathTimed(&clock, clock.getTicks() + 10, 2, 0);
+			frames++;
+		}
+		REQUIRE(frames > 1);
+
+		dtPolyRef path[MAX_PATH];
+		int npath = 0;
+		REQUIRE(dtStatusSucceed(query->finalizeSlicedFindPath(path, &npath, MAX_PATH)));
+		REQUIRE(npath == nexpected);
+		REQUIRE(memcmp(path, expected, sizeof(dtPolyRef)*npath) == 0);
+
+		REQUIRE(dtStatusFailed(query->updateSlicedFindPathTimed(0, 0, 2, 0)));
+		REQUIRE(dtStatusFailed(query->updateSlicedFindPathTimed(&clock, 0, 0, 0)));
+	}
+
+	SECTION("Scheduler shares the budget between queues")
+	{
+		dtPathQueue queues[2];
+		dtPathScheduler scheduler;
+		dtPathQueueRef refs[2][2];
+		for (int i = 0; i < 2; ++i)
+		{
+			REQUIRE(queues[i].init(MAX_PATH, 256, nav));
+			REQUIRE(scheduler.addQueue(&queues[i]));
+			for (int j = 0; j < 2; ++j)
+			{
+				refs[i][j] = queues[i].request(startRef, endRef, startPos, endPos, &filter);
+				REQUIRE(refs[i][j] != DT_PATHQ_INVALID);
+			}
+		}
+		REQUIRE_FALSE(scheduler.addQueue(&queues[0]));
+		REQUIRE(scheduler.getQueueCount() == 2);
+
+		// The first update starts a search on both queues.
+		const long long start = clock.ticks;
+		scheduler.update(&clock, 40, 1);
+		REQUIRE(clock.ticks - start <= 48);
+		for (int i = 0; i < 2; ++i)
+			REQUIRE(dtStatusInProgress(queues[i].getRequestStatus(refs[i][0])));
+
+		int frames = 1;
+		while ((queues[0].hasPendingRequests() || queues[1].hasPendingRequests()) && frames < 100)
+		{
+			scheduler.update(&clock, 40, 1);
+			frames++;
+		}
+		REQUIRE(frames < 100);
+
+		for (int i = 0; i < 2; ++i)
+		{
+			for (int j = 0; j < 2; ++j)
+			{
+				dtPolyRef path[MAX_PATH];
+				int npath = 0;
+				REQUIRE(dtStatusSucceed(queues[i].getPathResult(refs[i][j], path, &npath, MAX_PATH)));
+				REQUIRE(npath == nexpected);
+				REQUIRE(memcmp(path, expected, sizeof(dtPolyRef)*npath) == 0);
+			}
+		}
+
+		scheduler.removeQueue(&queues[0]);
+		REQUIRE(scheduler.getQueueCount() == 1);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
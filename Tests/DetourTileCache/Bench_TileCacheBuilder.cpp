@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "BenchTimer.h"
+#include "DetourCommon.h"
+#include "DetourTileCacheBuilder.h"
+#include "TileCacheTestUtils.h"
+
+// Runs the same steps as dtTileCache::buildNavMeshTile after decompression.
+static dtStatus buildLayerMesh(dtTileCacheAlloc* alloc, dtTileCacheLayer& layer, const int walkableClimb,
+							   int* npolys)
+{
+	dtStatus status = dtBuildTileCacheRegions(alloc, layer, walkableClimb);
+	if (dtStatusFailed(status))
+		return status;
+
+	dtTileCacheContourSet* lcset = dtAllocTileCacheContourSet(alloc);
+	dtTileCachePolyMesh* lmesh = dtAllocTileCachePolyMesh(alloc);
+	status = DT_FAILURE | DT_OUT_OF_MEMORY;
+	if (lcset && lmesh)
+	{
+		status = dtBuildTileCacheContours(alloc, layer, walkableClimb, 1.3f, *lcset);
+		if (dtStatusSucceed(status))
+			status = dtBuildTileCachePolyMesh(alloc, *lcset, *lmesh);
+		if (npolys)
+			*npolys = lmesh->npolys;
+	}
+	dtFreeTileCachePolyMesh(alloc, lmesh);
+	dtFreeTileCacheContourSet(alloc, lcset);
+	return status;
+}
+
+TEST_CASE("dtBuildTileCacheRegions")
+{
+	dtTileCacheAlloc alloc;
+
+	// Two 8x8 shelves: the right one is higher than the agent can climb.
+	TestLayer test(16, 8);
+	for (int y = 0; y < 8; ++y)
+	{
+		for (int x = 0; x < 16; ++x)
+		{
+			test.areas[x + y*16] = 1;
+			test.heights[x + y*16] = x < 8 ? 0 : 5;
+		}
+	}
+	test.buildCons(1);
+
+	SECTION("Unconnected shelves get their own region")
+	{
+		REQUIRE(dtStatusSucceed(dtBuildTileCacheRegions(&alloc, test.layer, 1)));
+		REQUIRE(test.layer.regCount == 2);
+		REQUIRE(test.regs[0] != test.regs[15]);
+		for (int y = 0; y < 8; ++y)
+		{
+			REQUIRE(test.regs[y*16] == test.regs[0]);
+			REQUIRE(test.regs[15 + y*16] == test.regs[15]);
+		}
+	}
+
+	SECTION("Null area cells are left without a region")
+	{
+		for (int y = 0; y < 8; ++y)
+			test.areas[3 + y*16] = DT_TILECACHE_NULL_AREA;
+		test.buildCons(1);
+		REQUIRE(dtStatusSucceed(dtBuildTileCacheRegions(&alloc, test.layer, 1)));
+		REQUIRE(test.layer.regCount == 3);
+		REQUIRE(test.regs[3] == 0xff);
+	}
+
+	SECTION("Each region becomes a polygon")
+	{
+		int npolys = 0;
+		REQUIRE(dtStatusSucceed(buildLayerMesh(&alloc, test.layer, 1, &npolys)));
+		REQUIRE(npolys == 2);
+	}
+}
+
+TEST_CASE("dtMarkConvexArea")
+{
+	TestLayer test(16, 16);
+	for (int i = 0; i < 16*16; ++i)
+	{
+		test.areas[i] = 1;
+		test.heights[i] = i < 8*16 ? 0 : 10;
+	}
+
+	// Triangle over the whole layer, from z = 0 at the bottom to a point at z = 16.
+	const float orig[3] = { 0.0f, 0.0f, 0.0f };
+	const float verts[3*3] = { 0.0f, 0.0f, 0.0f,  8.0f, 0.0f, 16.0f,  16.0f, 0.0f, 0.0f };
+	REQUIRE(dtStatusSucceed(dtMarkConvexArea(test.layer, orig, 1.0f, 0.5f, verts, 3, -1.0f, 2.0f, 5)));
+
+	// Inside the polygon and the height range.
+	REQUIRE(test.areas[8 + 1*16] == 5);
+	REQUIRE(test.areas[8 + 7*16] == 5);
+	// Outside the polygon.
+	REQUIRE(test.areas[0 + 7*16] == 1);
+	REQUIRE(test.areas[15 + 7*16] == 1);
+	// Inside the polygon, but above the height range.
+	REQUIRE(test.areas[8 + 9*16] == 1);
+}
+
+#ifdef BENCH_TIMER_AVAILABLE
+
+// Builds a walkable layer of rolling terrain with a few obstacles cut out. Sparse layers
+// only keep scattered platforms, like the upper layers of a multi storey tile.
+static void initBenchLayer(TestLayer& test, const bool sparse)
+{
+	const int w = test.header.width, h = test.header.height;
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const int idx = x + y*w;
+			test.heights[idx] = (unsigned char)((x/5 + y/7) % 6);
+			test.areas[idx] = 1;
+			if (sparse && ((x/16 + y/16) % 3 != 0 || x % 16 < 3 || y % 16 < 4))
+				test.areas[idx] = DT_TILECACHE_NULL_AREA;
+			else if (!sparse && x % 20 >= 8 && x % 20 < 11 && y % 20 >= 8 && y % 20 < 11)
+				test.areas[idx] = DT_TILECACHE_NULL_AREA;
+		}
+	}
+	test.buildCons(1);
+}
+
+static void benchLayerRebuild(const char* name, const bool sparse)
+{
+	const int iterations = 50;
+	dtTileCacheAlloc alloc;
+	TestLayer test(64, 64);
+	initBenchLayer(test, sparse);
+
+	int64_t regionNanos = 0, totalNanos = 0;
+	for (int i = 0; i < iterations; ++i)
+	{
+		const int64_t begin = NowNanos();
+		REQUIRE(dtStatusSucceed(dtBuildTileCacheRegions(&alloc, test.layer, 1)));
+		regionNanos += NowNanos() - begin;
+		REQUIRE(dtStatusSucceed(buildLayerMesh(&alloc, test.layer, 1, 0)));
+		totalNanos += NowNanos() - begin;
+	}
+	printf("BM_%-35s %d iterations, regions %10.2f nanos/it, rebuild %10.2f nanos/it\n",
+		   name, iterations, double(regionNanos) / iterations, double(totalNanos) / iterations);
+}
+
+TEST_CASE("TileCacheLayerRebuild")
+{
+	benchLayerRebuild("TileCacheLayerRebuild_Dense:", false);
+	benchLayerRebuild("TileCacheLayerRebuild_Sparse:", true);
+}
+
+#endif // BENCH_TIMER_AVAILABLE
@@ -0,0 +1,337 @@
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+#include "DetourLevelGraph.h"
+#include "TileCacheTestUtils.h"
+
+static const int LEVEL_SIZE = 32;
+static const int LEVEL_TILE_SIZE = 8;
+
+// Makes every polygon walkable for the default query filter.
+struct LevelMeshProcess : public dtTileCacheMeshProcess
+{
+	virtual void process(struct dtNavMeshCreateParams* params, unsigned char* /*polyAreas*/, unsigned int* polyFlags)
+	{
+		for (int i = 0; i < params->polyCount; ++i)
+			polyFlags[i] = 1;
+	}
+};
+
+// Level 1 has a walled off corner around (31, 8), the rest is open ground.
+static bool isLevelCellBlocked(const int level, const int x, const int z)
+{
+	if (level != 1)
+		return false;
+	return (x == 26 && z < 16) || (z == 16 && x >= 26);
+}
+
+// Builds the tile caches of flat 32x32 levels, with only the tiles overlapping the requested area.
+struct TestLevelLoader : public dtLevelMeshLoader
+{
+	struct LoadedMesh
+	{
+		dtNavMesh* nav;
+		dtTileCache* tc;
+	};
+
+	dtTileCacheAlloc alloc;
+	CopyCompressor comp;
+	LevelMeshProcess proc;
+	std::vector<LoadedMesh> meshes;
+	int loads = 0;
+	int lastTileCount = 0;
+
+	virtual ~TestLevelLoader()
+	{
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			dtFreeTileCache(meshes[i].tc);
+			dtFreeNavMesh(meshes[i].nav);
+		}
+	}
+
+	virtual dtNavMesh* loadLevelMesh(const int level, const float* bmin, const float* bmax)
+	{
+		const int ntiles = LEVEL_SIZE / LEVEL_TILE_SIZE;
+		const int ts = LEVEL_TILE_SIZE;
+
+		dtTileCacheParams tcparams;
+		memset(&tcparams, 0, sizeof(tcparams));
+		tcparams.cs = 1.0f;
+		tcparams.ch = 0.5f;
+		tcparams.width = ts;
+		tcparams.height = ts;
+		tcparams.walkableHeight = 2.0f;
+		tcparams.crouchHeight = 2.0f;
+		tcparams.walkableRadius = 0.5f;
+		tcparams.walkableClimb = 0.5f;
+		tcparams.maxSimplificationError = 1.3f;
+		tcparams.maxTiles = ntiles*ntiles;
+		tcparams.maxObstacles = 16;
+
+		dtNavMeshParams navParams;
+		memset(&navParams, 0, sizeof(navParams));
+		navParams.tileWidth = (float)ts;
+		navParams.tileHeight = (float)ts;
+		navParams.maxTiles = ntiles*ntiles;
+		navParams.maxPolys = 256;
+
+		LoadedMesh mesh;
+		mesh.tc = dtAllocTileCache();
+		mesh.nav = dtAllocNavMesh();
+		REQUIRE(dtStatusSucceed(mesh.tc->init(&tcparams, &alloc, &comp, &proc)));
+		REQUIRE(dtStatusSucceed(mesh.nav->init(&navParams)));
+
+		std::vector<unsigned char> heights(ts*ts, 0);
+		std::vector<unsigned char> areas(ts*ts);
+		std::vector<unsigned char> cons(ts*ts);
+
+		lastTileCount = 0;
+		for (int ty = 0; ty < ntiles; ++ty)
+		{
+			for (int tx = 0; tx < ntiles; ++tx)
+			{
+				const float tmin[3] = { (float)(tx*ts), 0.0f, (float)(ty*ts) };
+				const float tmax[3] = { (float)((tx+1)*ts), 2.0f, (float)((ty+1)*ts) };
+				if (tmin[0] > bmax[0] || tmax[0] < bmin[0] || tmin[2] > bmax[2] || tmax[2] < bmin[2])
+					continue;
+
+				for (int y = 0; y < ts; ++y)
+				{
+					for (int x = 0; x < ts; ++x)
+					{
+						const bool blocked = isLevelCellBlocked(level, tx*ts + x, ty*ts + y);
+						areas[x + y*ts] = blocked ? DT_TILECACHE_NULL_AREA : DT_TILECACHE_WALKABLE_AREA;
+					}
+				}
+				for (int y = 0; y < ts; ++y)
+				{
+					for (int x = 0; x < ts; ++x)
+					{
+						unsigned char con = 0, portal = 0;
+						const int nx[4] = { x-1, x, x+1, x };
+						const int ny[4] = { y, y+1, y, y-1 };
+						for (int dir = 0; dir < 4; ++dir)
+						{
+							if (nx[dir] < 0 || ny[dir] < 0 || nx[dir] >= ts || ny[dir] >= ts)
+								portal |= (unsigned char)(1 << dir);
+							else if (areas[nx[dir] + ny[dir]*ts] != DT_TILECACHE_NULL_AREA)
+								con |= (unsigned char)(1 << dir);
+						}
+						cons[x + y*ts] = (unsigned char)((portal << 4) | con);
+					}
+				}
+
+				dtTileCacheLayerHeader header;
+				memset(&header, 0, sizeof(header));
+				header.magic = DT_TILECACHE_MAGIC;
+				header.version = DT_TILECACHE_VERSION;
+				header.tx = tx;
+				header.ty = ty;
+				dtVcopy(header.bmin, tmin);
+				dtVcopy(header.bmax, tmax);
+				header.width = (unsigned char)ts;
+				header.height = (unsigned char)ts;
+				header.maxx = (unsigned char)(ts-1);
+				header.maxy = (unsigned char)(ts-1);
+
+				unsigned char* data = 0;
+				int dataSize = 0;
+				REQUIRE(dtStatusSucceed(dtBuildTileCacheLayer(&comp, &header, &heights[0], &areas[0], &cons[0], &data, &dataSize)));
+				REQUIRE(dtStatusSucceed(mesh.tc->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0)));
+				REQUIRE(dtStatusSucceed(mesh.tc->buildNavMeshTilesAt(tx, ty, mesh.nav)));
+				lastTileCount++;
+			}
+		}
+
+		loads++;
+		meshes.push_back(mesh);
+		return mesh.nav;
+	}
+
+	virtual void freeLevelMesh(const int /*level*/, dtNavMesh* nav)
+	{
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			if (meshes[i].nav != nav)
+				continue;
+			dtFreeTileCache(meshes[i].tc);
+			dtFreeNavMesh(meshes[i].nav);
+			meshes.erase(meshes.begin() + i);
+			return;
+		}
+	}
+};
+
+// Three levels in a row. Level 0 leads to level 1 through the landmark "ab", level 1 leads
+// back to level 0, and to level 2 through "bc1" at (31, 8), which is walled off, and "bc2" at (31, 28).
+static void addTestLevels(dtLevelGraph& graph, int* portalToB, int* portalBlocked, int* portalOpen)
+{
+	const float lmin[3] = { 0.0f, -1.0f, 0.0f };
+	const float lmax[3] = { (float)LEVEL_SIZE, 3.0f, (float)LEVEL_SIZE };
+	int a = -1, b = -1, c = -1;
+	REQUIRE(dtStatusSucceed(graph.addLevel(lmin, lmax, &a)));
+	REQUIRE(dtStatusSucceed(graph.addLevel(lmin, lmax, &b)));
+	REQUIRE(dtStatusSucceed(graph.addLevel(lmin, lmax, &c)));
+
+	const unsigned int ab = dtHashLandmarkName("ab");
+	const unsigned int bc1 = dtHashLandmarkName("bc1");
+	const unsigned int bc2 = dtHashLandmarkName("bc2");
+
+	const float abA[3] = { 31.0f, 0.0f, 16.0f };
+	const float abB[3] = { 1.0f, 0.0f, 16.0f };
+	REQUIRE(dtStatusSucceed(graph.addLandmark(a, ab, abA)));
+	REQUIRE(dtStatusSucceed(graph.addLandmark(b, ab, abB)));
+
+	const float bc1B[3] = { 31.0f, 0.0f, 8.0f };
+	const float bc1C[3] = { 1.0f, 0.0f, 8.0f };
+	REQUIRE(dtStatusSucceed(graph.addLandmark(b, bc1, bc1B)));
+	REQUIRE(dtStatusSucceed(graph.addLandmark(c, bc1, bc1C)));
+
+	const float bc2B[3] = { 31.0f, 0.0f, 28.0f };
+	const float bc2C[3] = { 1.0f, 0.0f, 28.0f };
+	REQUIRE(dtStatusSucceed(graph.addLandmark(b, bc2, bc2B)));
+	REQUIRE(dtStatusSucceed(graph.addLandmark(c, bc2, bc2C)));
+
+	const float abMin[3] = { 30.0f, 0.0f, 14.0f }, abMax[3] = { 32.0f, 2.0f, 18.0f };
+	const float baMin[3] = { 0.0f, 0.0f, 14.0f }, baMax[3] = { 2.0f, 2.0f, 18.0f };
+	const float bc1Min[3] = { 30.0f, 0.0f, 6.0f }, bc1Max[3] = { 32.0f, 2.0f, 10.0f };
+	const float bc2Min[3] = { 30.0f, 0.0f, 26.0f }, bc2Max[3] = { 32.0f, 2.0f, 30.0f };
+	REQUIRE(dtStatusSucceed(graph.addPortal(a, b, ab, abMin, abMax, portalToB)));
+	REQUIRE(dtStatusSucceed(graph.addPortal(b, a, ab, baMin, baMax)));
+	REQUIRE(dtStatusSucceed(graph.addPortal(b, c, bc1, bc1Min, bc1Max, portalBlocked)));
+	REQUIRE(dtStatusSucceed(graph.addPortal(b, c, bc2, bc2Min, bc2Max, portalOpen)));
+}
+
+TEST_CASE("dtLevelGraph")
+{
+	TestLevelLoader loader;
+
+	dtLevelGraphParams params;
+	memset(&params, 0, sizeof(params));
+	params.maxLevels = 4;
+	params.maxLandmarks = 8;
+	params.maxPortals = 8;
+	params.maxLoadedLevels = 2;
+	params.maxNodes = 512;
+	params.loadPadding = 2.0f;
+
+	dtLevelGraph graph;
+	REQUIRE(dtStatusSucceed(graph.init(&params, &loader)));
+
+	int portalToB = -1, portalBlocked = -1, portalOpen = -1;
+	addTestLevels(graph, &portalToB, &portalBlocked, &portalOpen);
+
+	const float startPos[3] = { 5.0f, 0.0f, 16.0f };
+	const float endPos[3] = { 20.0f, 0.0f, 16.0f };
+	const float halfExtents[3] = { 1.0f, 1.0f, 1.0f };
+	dtQueryFilter filter;
+
+	dtLevelLeg legs[8];
+	int nlegs = 0;
+
+	SECTION("Routes pass through the portals and carry positions over the landmarks")
+	{
+		REQUIRE(dtStatusSucceed(graph.findRoute(0, startPos, 2, endPos, legs, &nlegs, 8)));
+		REQUIRE(nlegs == 3);
+
+		REQUIRE(legs[0].level == 0);
+		REQUIRE(legs[0].entryPortal == -1);
+		REQUIRE(legs[0].exitPortal == portalToB);
+		REQUIRE(dtVequal(legs[0].startPos, startPos));
+
+		const float entryB[3] = { 1.0f, 0.0f, 16.0f };
+		REQUIRE(legs[1].level == 1);
+		REQUIRE(legs[1].entryPortal == portalToB);
+		REQUIRE(dtVequal(legs[1].startPos, entryB));
+
+		REQUIRE(legs[2].level == 2);
+		REQUIRE(legs[2].exitPortal == -1);
+		REQUIRE(dtVequal(legs[2].endPos, endPos));
+
+		// The route within one level is a single leg.
+		REQUIRE(dtStatusSucceed(graph.findRoute(0, startPos, 0, endPos, legs, &nlegs, 8)));
+		REQUIRE(nlegs == 1);
+
+		// A short buffer gets the start of the route.
+		const dtStatus status = graph.findRoute(0, startPos, 2, endPos, legs, &nlegs, 2);
+		REQUIRE(dtStatusSucceed(status));
+		REQUIRE(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+		REQUIRE(nlegs == 2);
+		REQUIRE(legs[1].level == 1);
+	}
+
+	SECTION("Levels are loaded around the legs and bounded in number")
+	{
+		REQUIRE(dtStatusSucceed(graph.findRoute(0, startPos, 2, endPos, legs, &nlegs, 8)));
+		REQUIRE(loader.loads == 0);
+
+		dtPolyRef path[256];
+		int npath = 0;
+		REQUIRE(dtStatusSucceed(graph.findLegPath(legs[0], halfExtents, &filter, path, &npath, 256)));
+		REQUIRE(npath > 0);
+		REQUIRE(graph.getLevelMesh(0));
+		REQUIRE(loader.lastTileCount < (LEVEL_SIZE / LEVEL_TILE_SIZE) * (LEVEL_SIZE / LEVEL_TILE_SIZE));
+
+		for (int i = 0; i < nlegs; ++i)
+			graph.findLegPath(legs[i], halfExtents, &filter, path, &npath, 256);
+		REQUIRE(graph.getLoadedLevelCount() == 2);
+		REQUIRE(!graph.getLevelMesh(0));
+		REQUIRE((int)loader.meshes.size() == 2);
+
+		graph.unloadAllLevels();
+		REQUIRE(graph.getLoadedLevelCount() == 0);
+		REQUIRE(loader.meshes.empty());
+	}
+
+	SECTION("Blocked legs are routed around")
+	{
+		REQUIRE(dtStatusSucceed(graph.findRoute(0, startPos, 2, endPos, legs, &nlegs, 8)));
+		REQUIRE(nlegs == 3);
+		REQUIRE(legs[1].exitPortal == portalBlocked);
+
+		// Failing to find the exit poly does not prove the leg blocked.
+		dtPolyRef path[256];
+		int npath = 0;
+		dtLevelLeg offMesh = legs[1];
+		offMesh.endPos[1] += 100.0f;
+		REQUIRE(dtStatusFailed(graph.findLegPath(offMesh, halfExtents, &filter, path, &npath, 256)));
+		REQUIRE(dtStatusSucceed(graph.findRoute(0, startPos, 2, endPos, legs, &nlegs, 8)));
+		REQUIRE(legs[1].exitPortal == portalBlocked);
+
+		// The exit can not be reached in the whole level, the next route avoids it.
+		const dtStatus status = graph.findLegPath(legs[1], halfExtents, &filter, path, &npath, 256);
+		REQUIRE(dtStatusDetail(status, DT_PARTIAL_RESULT));
+
+		REQUIRE(dtStatusSucceed(graph.findRoute(0, startPos, 2, endPos, legs, &nlegs, 8)));
+		REQUIRE(nlegs == 3);
+		REQUIRE(legs[1].exitPortal == portalOpen);
+
+		const dtStatus openStatus = graph.findLegPath(legs[1], halfExtents, &filter, path, &npath, 256);
+		REQUIRE(dtStatusSucceed(openStatus));
+		REQUIRE(!dtStatusDetail(openStatus, DT_PARTIAL_RESULT));
+	}
+
+	SECTION("Portals without a landmark on the other side are not used")
+	{
+		int d = -1;
+		const float lmin[3] = { 0.0f, -1.0f, 0.0f };
+		const float lmax[3] = { (float)LEVEL_SIZE, 3.0f, (float)LEVEL_SIZE };
+		REQUIRE(dtStatusSucceed(graph.addLevel(lmin, lmax, &d)));
+		const float pmin[3] = { 0.0f, 0.0f, 0.0f }, pmax[3] = { 2.0f, 2.0f, 2.0f };
+		REQUIRE(dtStatusSucceed(graph.addPortal(2, d, dtHashLandmarkName("cd"), pmin, pmax)));
+
+		float pos[3];
+		REQUIRE(!graph.getPortalEntry(graph.getPortalCount() - 1, pos));
+		REQUIRE(dtStatusFailed(graph.findRoute(0, startPos, d, endPos, legs, &nlegs, 8)));
+		REQUIRE(nlegs == 0);
+	}
+}
@@ -0,0 +1,152 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourTileCache.h"
+#include "DetourObstacleRegistry.h"
+#include "TileCacheTestUtils.h"
+
+// Clock that advances one tick every time it is read.
+struct StepClock : public dtQueryClock
+{
+	mutable long long ticks = 0;
+	virtual long long getTicks() const { return ticks++; }
+};
+
+// Finds the obstacle a shared obstacle became in the tile cache of the profile.
+static const dtTileCacheObstacle* getObstacle(const TestProfile& profile, const dtObstacleRegistry& registry,
+											  const dtSharedObstacleRef ref)
+{
+	return profile.tc->getObstacleByRef(registry.getTileCacheObstacle(ref, profile.tc));
+}
+
+static void updateUntilDone(dtObstacleRegistry& registry)
+{
+	bool upToDate = false;
+	for (int i = 0; i < 1000 && !upToDate; ++i)
+		REQUIRE(dtStatusSucceed(registry.update(0, 0, &upToDate)));
+	REQUIRE(upToDate);
+}
+
+TEST_CASE("dtObstacleRegistry")
+{
+	TestProfile small(16), large(16), fine(8);
+
+	REQUIRE(small.tc->hasSameTileGrid(large.tc));
+	REQUIRE_FALSE(small.tc->hasSameTileGrid(fine.tc));
+
+	dtObstacleRegistry registry;
+	REQUIRE(dtStatusSucceed(registry.init(128)));
+	REQUIRE(dtStatusSucceed(registry.addTileCache(small.tc, small.nav)));
+	REQUIRE(dtStatusSucceed(registry.addTileCache(fine.tc, fine.nav)));
+	REQUIRE(dtStatusFailed(registry.addTileCache(small.tc, small.nav)));
+	REQUIRE(registry.getTileCacheCount() == 2);
+
+	SECTION("Obstacles reach every cache")
+	{
+		// Sits on the corner shared by four tiles of both grids.
+		const dtObstacleDesc desc = makeCylinder(16.0f, 16.0f, 2.0f);
+		dtSharedObstacleRef ref = 0;
+		REQUIRE(dtStatusSucceed(registry.addObstacle(&desc, &ref)));
+		REQUIRE(ref != 0);
+		updateUntilDone(registry);
+
+		for (const TestProfile* p : { &small, &fine })
+		{
+			const dtTileCacheObstacle* ob = getObstacle(*p, registry, ref);
+			REQUIRE(ob);
+			REQUIRE(ob->state == DT_OBSTACLE_PROCESSED);
+			REQUIRE(ob->ntouched == 4);
+			REQUIRE(registry.findObstacle(p->tc, p->tc->getObstacleRef(ob)) == ref);
+		}
+
+		// A cache added later gets the existing obstacles.
+		REQUIRE(dtStatusSucceed(registry.addTileCache(large.tc, large.nav)));
+		updateUntilDone(registry);
+		const dtTileCacheObstacle* ob = getObstacle(large, registry, ref);
+		REQUIRE(ob);
+		REQUIRE(ob->state == DT_OBSTACLE_PROCESSED);
+
+		const dtObstacleRef fineRef = registry.getTileCacheObstacle(ref, fine.tc);
+		REQUIRE(dtStatusSucceed(registry.removeObstacle(ref)));
+		REQUIRE(registry.getObstacleDesc(ref) == 0);
+		REQUIRE(dtStatusFailed(registry.removeObstacle(ref)));
+		updateUntilDone(registry);
+		REQUIRE(fine.tc->getObstacleByRef(fineRef) == 0);
+	}
+
+	SECTION("Changes that do not fit are retried")
+	{
+		// More obstacles than a tile cache takes requests for between updates.
+		static const int NUM_OBSTACLES = 80;
+		dtSharedObstacleRef refs[NUM_OBSTACLES];
+		bool deferred = false;
+		for (int i = 0; i < NUM_OBSTACLES; ++i)
+		{
+			const dtObstacleDesc desc = makeCylinder(2.0f + (i % 8) * 4.0f, 2.0f + (i / 8) * 3.0f, 1.0f);
+			const dtStatus status = registry.addObstacle(&desc, &refs[i]);
+			REQUIRE(dtStatusSucceed(status));
+			deferred |= dtStatusDetail(status, DT_BUFFER_TOO_SMALL);
+		}
+		REQUIRE(deferred);
+		updateUntilDone(registry);
+
+		for (int i = 0; i < NUM_OBSTACLES; ++i)
+		{
+			REQUIRE(getObstacle(small, registry, refs[i])->state == DT_OBSTACLE_PROCESSED);
+			REQUIRE(getObstacle(fine, registry, refs[i])->state == DT_OBSTACLE_PROCESSED);
+		}
+
+		registry.removeAllObstacles();
+		updateUntilDone(registry);
+		for (int i = 0; i < NUM_OBSTACLES; ++i)
+			REQUIRE(registry.getObstacleDesc(refs[i]) == 0);
+	}
+
+	SECTION("Rebuilds share the time budget")
+	{
+		const dtObstacleDesc desc = makeCylinder(16.0f, 16.0f, 2.0f);
+		dtSharedObstacleRef ref = 0;
+		REQUIRE(dtStatusSucceed(registry.addObstacle(&desc, &ref)));
+
+		// The smallest budget rebuilds one tile per update, taking turns between the caches.
+		StepClock clock;
+		bool upToDate = false;
+		int updates = 0;
+		while (!upToDate && updates < 100)
+		{
+			REQUIRE(dtStatusSucceed(registry.update(&clock, 1, &upToDate)));
+			updates++;
+		}
+		REQUIRE(upToDate);
+		REQUIRE(updates >= 8);
+		REQUIRE(getObstacle(small, registry, ref)->state == DT_OBSTACLE_PROCESSED);
+		REQUIRE(getObstacle(fine, registry, ref)->state == DT_OBSTACLE_PROCESSED);
+	}
+
+	SECTION("Moves reach every cache")
+	{
+		dtObstacleDesc desc = makeCylinder(4.0f, 4.0f, 1.0f);
+		dtSharedObstacleRef ref = 0;
+		REQUIRE(dtStatusSucceed(registry.addObstacle(&desc, &ref)));
+		updateUntilDone(registry);
+
+		desc = makeCylinder(28.0f, 28.0f, 1.0f);
+		REQUIRE(dtStatusSucceed(registry.moveObstacle(ref, &desc)));
+		REQUIRE(registry.getObstacleDesc(ref)->cylinder.pos[0] == 28.0f);
+		updateUntilDone(registry);
+
+		for (const TestProfile* p : { &small, &fine })
+		{
+			const dtTileCacheObstacle* ob = getObstacle(*p, registry, ref);
+			REQUIRE(ob->state == DT_OBSTACLE_PROCESSED);
+			REQUIRE(ob->cylinder.pos[0] == 28.0f);
+			REQUIRE(ob->ntouched == 1);
+		}
+	}
+
+	const int ncaches = registry.getTileCacheCount();
+	registry.removeTileCache(fine.tc);
+	REQUIRE(registry.getTileCacheCount() == ncaches - 1);
+}
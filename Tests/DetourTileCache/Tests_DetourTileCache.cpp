@@ -0,0 +1,247 @@
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+#include "TileCacheTestUtils.h"
+
+TEST_CASE("dtTileCache moveObstacle")
+{
+	TestProfile profile(16);
+	dtTileCache* tc = profile.tc;
+
+	dtObstacleDesc desc = makeCylinder(4.0f, 4.0f, 1.0f);
+	dtObstacleRef ref = 0;
+
+	SECTION("Moves before the add is processed change the added shape")
+	{
+		REQUIRE(dtStatusSucceed(tc->addObstacle(&desc, 0, &ref)));
+		desc = makeCylinder(20.0f, 4.0f, 1.0f);
+		REQUIRE(dtStatusSucceed(tc->moveObstacle(ref, &desc)));
+		REQUIRE(updateTileCache(profile) == 1);
+
+		const dtTileCacheObstacle* ob = tc->getObstacleByRef(ref);
+		REQUIRE(ob->state == DT_OBSTACLE_PROCESSED);
+		REQUIRE(ob->ntouched == 1);
+		REQUIRE(tc->getTileByRef(ob->touched[0])->header->tx == 1);
+	}
+
+	SECTION("Only tiles where the marked cells change are rebuilt")
+	{
+		REQUIRE(dtStatusSucceed(tc->addObstacle(&desc, 0, &ref)));
+		updateTileCache(profile);
+		const dtTileCacheObstacle* ob = tc->getObstacleByRef(ref);
+
+		// Rebuilt tiles are replaced in the nav mesh with a new salt.
+		const dtNavMesh* nav = profile.nav;
+		dtTileRef left = nav->getTileRefAt(0, 0, 0);
+		dtTileRef right = nav->getTileRefAt(1, 0, 0);
+
+		// Repeated moves are coalesced, the old and the new tile are rebuilt once.
+		for (int i = 0; i < 10; ++i)
+		{
+			desc = makeCylinder(4.0f + i * 2.0f, 4.0f, 1.0f);
+			REQUIRE(dtStatusSucceed(tc->moveObstacle(ref, &desc)));
+		}
+		REQUIRE(updateTileCache(profile) == 2);
+		REQUIRE(ob->state == DT_OBSTACLE_PROCESSED);
+		REQUIRE(ob->cylinder.pos[0] == 22.0f);
+		REQUIRE(tc->getTileByRef(ob->touched[0])->header->tx == 1);
+		REQUIRE(nav->getTileRefAt(0, 0, 0) != left);
+		REQUIRE(nav->getTileRefAt(1, 0, 0) != right);
+		left = nav->getTileRefAt(0, 0, 0);
+		right = nav->getTileRefAt(1, 0, 0);
+
+		// A move within the same cells needs no rebuild.
+		desc.cylinder.pos[0] += 0.01f;
+		REQUIRE(dtStatusSucceed(tc->moveObstacle(ref, &desc)));
+		updateTileCache(profile);
+		REQUIRE(ob->state == DT_OBSTACLE_PROCESSED);
+		REQUIRE(ob->cylinder.pos[0] == desc.cylinder.pos[0]);
+		REQUIRE(nav->getTileRefAt(1, 0, 0) == right);
+
+		// Lifting the obstacle above the floor clears its cells.
+		desc = makeCylinder(22.0f, 4.0f, 1.0f);
+		desc.cylinder.pos[1] = 10.0f;
+		REQUIRE(dtStatusSucceed(tc->moveObstacle(ref, &desc)));
+		updateTileCache(profile);
+		REQUIRE(nav->getTileRefAt(1, 0, 0) != right);
+		right = nav->getTileRefAt(1, 0, 0);
+
+		// Moving it through the air to another tile marks no walkable cells on either side.
+		desc.cylinder.pos[0] = 4.0f;
+		desc.cylinder.pos[1] = 1.5f;
+		REQUIRE(dtStatusSucceed(tc->moveObstacle(ref, &desc)));
+		updateTileCache(profile);
+		REQUIRE(ob->ntouched == 1);
+		REQUIRE(tc->getTileByRef(ob->touched[0])->header->tx == 0);
+		REQUIRE(nav->getTileRefAt(0, 0, 0) == left);
+		REQUIRE(nav->getTileRefAt(1, 0, 0) == right);
+	}
+
+	SECTION("Removed obstacles can not be moved")
+	{
+		REQUIRE(dtStatusSucceed(tc->addObstacle(&desc, 0, &ref)));
+		updateTileCache(profile);
+		REQUIRE(dtStatusSucceed(tc->removeObstacle(ref)));
+		REQUIRE(dtStatusFailed(tc->moveObstacle(ref, &desc)));
+		updateTileCache(profile);
+		REQUIRE(dtStatusFailed(tc->moveObstacle(ref, &desc)));
+	}
+}
+
+TEST_CASE("dtTileCache convex obstacle")
+{
+	TestProfile profile(16);
+	dtTileCache* tc = profile.tc;
+
+	// A quad across the two tiles of the first row.
+	const float verts[4*3] = { 12.0f, 0.0f, 2.0f,  12.0f, 0.0f, 6.0f,  20.0f, 0.0f, 6.0f,  20.0f, 0.0f, 2.0f };
+	dtObstacleRef ref = 0;
+	REQUIRE(dtStatusFailed(tc->addConvexObstacle(verts, 2, -1.0f, 1.0f, 5, &ref)));
+	REQUIRE(dtStatusSucceed(tc->addConvexObstacle(verts, 4, -1.0f, 1.0f, 5, &ref)));
+	updateTileCache(profile);
+
+	const dtTileCacheObstacle* ob = tc->getObstacleByRef(ref);
+	REQUIRE(ob->state == DT_OBSTACLE_PROCESSED);
+	REQUIRE(ob->ntouched == 2);
+
+	float bmin[3], bmax[3];
+	tc->getObstacleBounds(ob, bmin, bmax);
+	REQUIRE(bmin[0] == 12.0f);
+	REQUIRE(bmax[2] == 6.0f);
+	REQUIRE(bmax[1] == 1.0f);
+
+	// The marked cells become polygons with the obstacle area.
+	dtNavMeshQuery query;
+	REQUIRE(dtStatusSucceed(query.init(profile.nav, 64)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.1f, 1.0f, 0.1f };
+	for (const float x : { 14.0f, 18.0f })
+	{
+		const float pos[3] = { x, 0.0f, 4.0f };
+		dtPolyRef poly = 0;
+		REQUIRE(dtStatusSucceed(query.findNearestPoly(pos, halfExtents, &filter, &poly, 0)));
+		REQUIRE(poly != 0);
+		unsigned char area = 0;
+		REQUIRE(dtStatusSucceed(profile.nav->getPolyArea(poly, &area)));
+		REQUIRE(area == 5);
+	}
+}
+
+TEST_CASE("dtTileCache skips rebuilds of unchanged tiles")
+{
+	TestProfile profile(16);
+	dtTileCache* tc = profile.tc;
+	const dtNavMesh* nav = profile.nav;
+	const dtTileRef tileRef = nav->getTileRefAt(0, 0, 0);
+
+	// Hovers over the floor, inside the tile bounds but above every cell.
+	dtObstacleDesc desc = makeCylinder(4.0f, 4.0f, 1.0f);
+	desc.cylinder.pos[1] = 1.5f;
+	dtObstacleRef ref = 0;
+	REQUIRE(dtStatusSucceed(tc->addObstacle(&desc, 0, &ref)));
+	REQUIRE(updateTileCache(profile) == 1);
+	REQUIRE(tc->getObstacleByRef(ref)->state == DT_OBSTACLE_PROCESSED);
+	REQUIRE(tc->getObstacleByRef(ref)->ntouched == 1);
+	REQUIRE(tc->getSkippedRebuildCount() == 1);
+	REQUIRE(nav->getTileRefAt(0, 0, 0) == tileRef);
+
+	// Removing it frees the obstacle without a rebuild either.
+	REQUIRE(dtStatusSucceed(tc->removeObstacle(ref)));
+	REQUIRE(updateTileCache(profile) == 1);
+	REQUIRE(tc->getObstacleByRef(ref) == 0);
+	REQUIRE(tc->getSkippedRebuildCount() == 2);
+	REQUIRE(nav->getTileRefAt(0, 0, 0) == tileRef);
+
+	// An obstacle on the floor rebuilds the tile.
+	desc = makeCylinder(4.0f, 4.0f, 1.0f);
+	REQUIRE(dtStatusSucceed(tc->addObstacle(&desc, 0, &ref)));
+	updateTileCache(profile);
+	REQUIRE(tc->getSkippedRebuildCount() == 2);
+	REQUIRE(nav->getTileRefAt(0, 0, 0) != tileRef);
+}
+
+// Compares tile data byte for byte with the data of a tile built in place. The links,
+// and the first link of each polygon, are filled in by dtNavMesh::addTile and skipped.
+static void requireSameTileData(const unsigned char* data, const dtMeshTile* tile)
+{
+	const dtMeshHeader* header = tile->header;
+	const int headerSize = dtAlign4(sizeof(dtMeshHeader));
+	const int vertsSize = dtAlign4(sizeof(float)*3*header->vertCount);
+	const int polysSize = dtAlign4(sizeof(dtPoly)*header->polyCount);
+	const int linksSize = dtAlign4(sizeof(dtLink)*header->maxLinkCount);
+
+	REQUIRE(memcmp(data, tile->data, headerSize + vertsSize) == 0);
+
+	const dtPoly* polys = (const dtPoly*)(data + headerSize + vertsSize);
+	for (int i = 0; i < header->polyCount; ++i)
+	{
+		dtPoly a = polys[i];
+		dtPoly b = tile->polys[i];
+		a.firstLink = b.firstLink = 0;
+		REQUIRE(memcmp(&a, &b, sizeof(dtPoly)) == 0);
+	}
+
+	const int rest = headerSize + vertsSize + polysSize + linksSize;
+	REQUIRE(memcmp(data + rest, tile->data + rest, tile->dataSize - rest) == 0);
+}
+
+TEST_CASE("dtTileCache builds tile data on several threads")
+{
+	TestProfile profile(8);
+	dtTileCache* tc = profile.tc;
+
+	dtObstacleDesc desc = makeCylinder(12.0f, 12.0f, 2.0f);
+	REQUIRE(dtStatusSucceed(tc->addObstacle(&desc, 0, 0)));
+	updateTileCache(profile);
+
+	std::vector<dtCompressedTileRef> refs;
+	for (int i = 0; i < tc->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = tc->getTile(i);
+		if (tile->header)
+			refs.push_back(tc->getTileRef(tile));
+	}
+	REQUIRE(refs.size() == 16);
+
+	// Every thread builds every other tile with its own allocator and compressor.
+	static const int NUM_THREADS = 2;
+	std::vector<unsigned char*> datas(refs.size(), 0);
+	std::vector<int> dataSizes(refs.size(), 0);
+	std::vector<dtStatus> statuses(refs.size(), DT_FAILURE);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < NUM_THREADS; ++t)
+	{
+		threads.push_back(std::thread([&, t]()
+		{
+			dtTileCacheAlloc alloc;
+			CopyCompressor comp;
+			for (size_t i = t; i < refs.size(); i += NUM_THREADS)
+				statuses[i] = tc->buildNavMeshTileData(refs[i], &alloc, &comp, &datas[i], &dataSizes[i]);
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	// The data matches the tiles built in place, obstacle included.
+	for (size_t i = 0; i < refs.size(); ++i)
+	{
+		REQUIRE(dtStatusSucceed(statuses[i]));
+		REQUIRE(datas[i] != 0);
+
+		const dtCompressedTile* tile = tc->getTileByRef(refs[i]);
+		const dtMeshTile* built = profile.nav->getTileAt(tile->header->tx, tile->header->ty, tile->header->tlayer);
+		REQUIRE(built != 0);
+		REQUIRE(dataSizes[i] == built->dataSize);
+		requireSameTileData(datas[i], built);
+		dtFree(datas[i]);
+	}
+}
@@ -0,0 +1,289 @@
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourTileCacheBuilder.h"
+#include "TileCacheTestUtils.h"
+
+// The region builder as it was before it swept rows as bitmasks, visiting every cell.
+// Kept as the reference the swept builder has to match.
+namespace ReferenceRegions
+{
+	static const int MAX_NEIS = 16;
+
+	struct SweepSpan
+	{
+		unsigned short ns;
+		unsigned char id;
+		unsigned char nei;
+	};
+
+	struct MonotoneRegion
+	{
+		int area;
+		unsigned char neis[MAX_NEIS];
+		unsigned char nneis;
+		unsigned char regId;
+		unsigned char areaId;
+	};
+
+	static void addUniqueLast(unsigned char* a, unsigned char& an, unsigned char v)
+	{
+		const int n = (int)an;
+		if (n > 0 && a[n-1] == v) return;
+		a[an] = v;
+		an++;
+	}
+
+	static bool isConnected(const dtTileCacheLayer& layer, const int ia, const int ib, const int walkableClimb)
+	{
+		if (layer.areas[ia] != layer.areas[ib]) return false;
+		if (dtAbs((int)layer.heights[ia] - (int)layer.heights[ib]) > walkableClimb) return false;
+		return true;
+	}
+
+	static bool canMerge(unsigned char oldRegId, unsigned char newRegId, const MonotoneRegion* regs, const int nregs)
+	{
+		int count = 0;
+		for (int i = 0; i < nregs; ++i)
+		{
+			const MonotoneRegion& reg = regs[i];
+			if (reg.regId != oldRegId) continue;
+			for (int j = 0; j < (int)reg.nneis; ++j)
+			{
+				if (regs[reg.neis[j]].regId == newRegId)
+					count++;
+			}
+		}
+		return count == 1;
+	}
+
+	static dtStatus build(dtTileCacheLayer& layer, const int walkableClimb)
+	{
+		const int w = (int)layer.header->width;
+		const int h = (int)layer.header->height;
+
+		memset(layer.regs, 0xff, sizeof(unsigned char)*w*h);
+
+		std::vector<SweepSpan> sweeps(w);
+		unsigned char prevCount[256];
+		unsigned char regId = 0;
+
+		for (int y = 0; y < h; ++y)
+		{
+			if (regId > 0)
+				memset(prevCount, 0, sizeof(unsigned char)*regId);
+			unsigned char sweepId = 0;
+
+			for (int x = 0; x < w; ++x)
+			{
+				const int idx = x + y*w;
+				if (layer.areas[idx] == DT_TILECACHE_NULL_AREA) continue;
+
+				unsigned char sid = 0xff;
+				const int xidx = (x-1) + y*w;
+				if (x > 0 && isConnected(layer, idx, xidx, walkableClimb))
+				{
+					if (layer.regs[xidx] != 0xff)
+						sid = layer.regs[xidx];
+				}
+				if (sid == 0xff)
+				{
+					sid = sweepId++;
+					sweeps[sid].nei = 0xff;
+					sweeps[sid].ns = 0;
+				}
+
+				const int yidx = x + (y-1)*w;
+				if (y > 0 && isConnected(layer, idx, yidx, walkableClimb))
+				{
+					const unsigned char nr = layer.regs[yidx];
+					if (nr != 0xff)
+					{
+						if (sweeps[sid].ns == 0)
+							sweeps[sid].nei = nr;
+						if (sweeps[sid].nei == nr)
+						{
+							sweeps[sid].ns++;
+							prevCount[nr]++;
+						}
+						else
+						{
+							sweeps[sid].nei = 0xff;
+						}
+					}
+				}
+
+				layer.regs[idx] = sid;
+			}
+
+			for (int i = 0; i < sweepId; ++i)
+			{
+				if (sweeps[i].nei != 0xff && (unsigned short)prevCount[sweeps[i].nei] == sweeps[i].ns)
+				{
+					sweeps[i].id = sweeps[i].nei;
+				}
+				else
+				{
+					if (regId == 255)
+						return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+					sweeps[i].id = regId++;
+				}
+			}
+
+			for (int x = 0; x < w; ++x)
+			{
+				const int idx = x + y*w;
+				if (layer.regs[idx] != 0xff)
+					layer.regs[idx] = sweeps[layer.regs[idx]].id;
+			}
+		}
+
+		const int nregs = (int)regId;
+		std::vector<MonotoneRegion> regs(dtMax(nregs, 1));
+		memset(&regs[0], 0, sizeof(MonotoneRegion)*regs.size());
+
+		for (int y = 0; y < h; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				const int idx = x + y*w;
+				const unsigned char ri = layer.regs[idx];
+				if (ri == 0xff)
+					continue;
+
+				regs[ri].area++;
+				regs[ri].areaId = layer.areas[idx];
+
+				const int ymi = x + (y-1)*w;
+				if (y > 0 && isConnected(layer, idx, ymi, walkableClimb))
+				{
+					const unsigned char rai = layer.regs[ymi];
+					if (rai != 0xff && rai != ri)
+					{
+						addUniqueLast(regs[ri].neis, regs[ri].nneis, rai);
+						addUniqueLast(regs[rai].neis, regs[rai].nneis, ri);
+					}
+				}
+			}
+		}
+
+		for (int i = 0; i < nregs; ++i)
+			regs[i].regId = (unsigned char)i;
+
+		for (int i = 0; i < nregs; ++i)
+		{
+			MonotoneRegion& reg = regs[i];
+			int merge = -1;
+			int mergea = 0;
+			for (int j = 0; j < (int)reg.nneis; ++j)
+			{
+				const unsigned char nei = reg.neis[j];
+				MonotoneRegion& regn = regs[nei];
+				if (reg.regId == regn.regId)
+					continue;
+				if (reg.areaId != regn.areaId)
+					continue;
+				if (regn.area > mergea && canMerge(reg.regId, regn.regId, &regs[0], nregs))
+				{
+					mergea = regn.area;
+					merge = (int)nei;
+				}
+			}
+			if (merge != -1)
+			{
+				const unsigned char oldId = reg.regId;
+				const unsigned char newId = regs[merge].regId;
+				for (int j = 0; j < nregs; ++j)
+					if (regs[j].regId == oldId)
+						regs[j].regId = newId;
+			}
+		}
+
+		unsigned char remap[256];
+		memset(remap, 0, 256);
+		regId = 0;
+		for (int i = 0; i < nregs; ++i)
+			remap[regs[i].regId] = 1;
+		for (int i = 0; i < 256; ++i)
+			if (remap[i])
+				remap[i] = regId++;
+		for (int i = 0; i < nregs; ++i)
+			regs[i].regId = remap[regs[i].regId];
+
+		layer.regCount = regId;
+
+		for (int i = 0; i < w*h; ++i)
+		{
+			if (layer.regs[i] != 0xff)
+				layer.regs[i] = regs[layer.regs[i]].regId;
+		}
+
+		return DT_SUCCESS;
+	}
+}
+
+// Fills the layer with blocks of random area and height, broken up by single cells
+// that differ, so that regions meet, merge and split in many ways.
+static void initRandomLayer(TestLayer& test, unsigned int& state, const int walkableClimb)
+{
+	const int w = test.header.width, h = test.header.height;
+	const unsigned int seed = state;
+	const int block = 2 + (int)(seed % 6);
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const int idx = x + y*w;
+			unsigned int r = (unsigned int)(x/block) * 0x8da6b343u + (unsigned int)(y/block) * 0xd8163841u + seed;
+			r ^= r >> 13;
+			r *= 0x5bd1e995u;
+			r ^= r >> 15;
+			state = state * 1664525u + 1013904223u;
+			const bool noise = (state >> 24) < 16;
+			const unsigned int n = noise ? state >> 8 : r;
+			test.areas[idx] = (n % 5) == 0 ? DT_TILECACHE_NULL_AREA : (unsigned char)(1 + (n >> 4) % 2);
+			test.heights[idx] = (unsigned char)((n >> 8) % 5);
+		}
+	}
+	test.buildCons(walkableClimb);
+}
+
+TEST_CASE("dtBuildTileCacheRegions matches the per-cell builder")
+{
+	static const int SIZES[][2] = {
+		{ 1, 1 }, { 7, 5 }, { 16, 16 }, { 17, 9 }, { 31, 33 }, { 32, 32 }, { 48, 20 }, { 64, 64 }, { 100, 12 }, { 255, 6 },
+	};
+	static const int NUM_SIZES = (int)(sizeof(SIZES) / sizeof(SIZES[0]));
+
+	dtTileCacheAlloc alloc;
+	unsigned int state = 42u;
+	int compared = 0;
+	for (int i = 0; i < 400; ++i)
+	{
+		const int w = SIZES[i % NUM_SIZES][0];
+		const int h = SIZES[i % NUM_SIZES][1];
+		const int walkableClimb = 1 + i % 2;
+		TestLayer test(w, h);
+		initRandomLayer(test, state, walkableClimb);
+
+		TestLayer reference(w, h);
+		reference.heights = test.heights;
+		reference.areas = test.areas;
+		reference.cons = test.cons;
+
+		const dtStatus status = dtBuildTileCacheRegions(&alloc, test.layer, walkableClimb);
+		const dtStatus referenceStatus = ReferenceRegions::build(reference.layer, walkableClimb);
+		REQUIRE(dtStatusFailed(status) == dtStatusFailed(referenceStatus));
+		if (dtStatusFailed(status))
+			continue;
+
+		REQUIRE(test.layer.regCount == reference.layer.regCount);
+		REQUIRE(test.regs == reference.regs);
+		compared++;
+	}
+	// Most layers stay under the region limit.
+	REQUIRE(compared > 300);
+}
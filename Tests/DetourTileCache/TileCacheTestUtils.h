@@ -0,0 +1,212 @@
+#ifndef TILECACHETESTUTILS_H
+#define TILECACHETESTUTILS_H
+
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+
+// Stores the layers uncompressed.
+struct CopyCompressor : public dtTileCacheCompressor
+{
+	virtual int maxCompressedSize(const int bufferSize) { return bufferSize; }
+	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
+							  unsigned char* compressed, const int /*maxCompressedSize*/, int* compressedSize)
+	{
+		memcpy(compressed, buffer, bufferSize);
+		*compressedSize = bufferSize;
+		return DT_SUCCESS;
+	}
+	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
+								unsigned char* buffer, const int /*maxBufferSize*/, int* bufferSize)
+	{
+		memcpy(buffer, compressed, compressedSize);
+		*bufferSize = compressedSize;
+		return DT_SUCCESS;
+	}
+};
+
+// Layer with its own storage, filled with a height ramp. Connections and portals
+// are derived the same way the layer builder does.
+struct TestLayer
+{
+	dtTileCacheLayerHeader header;
+	std::vector<unsigned char> heights, areas, cons, regs;
+	dtTileCacheLayer layer;
+
+	TestLayer(const int w, const int h) : heights(w*h), areas(w*h), cons(w*h), regs(w*h)
+	{
+		memset(&header, 0, sizeof(header));
+		header.width = (unsigned char)w;
+		header.height = (unsigned char)h;
+		header.maxx = (unsigned char)(w-1);
+		header.maxy = (unsigned char)(h-1);
+		layer.header = &header;
+		layer.regCount = 0;
+		layer.heights = &heights[0];
+		layer.areas = &areas[0];
+		layer.cons = &cons[0];
+		layer.regs = &regs[0];
+	}
+
+	void buildCons(const int walkableClimb)
+	{
+		const int w = header.width, h = header.height;
+		const int offsetX[4] = { -1, 0, 1, 0 };
+		const int offsetY[4] = { 0, 1, 0, -1 };
+		for (int y = 0; y < h; ++y)
+		{
+			for (int x = 0; x < w; ++x)
+			{
+				const int idx = x + y*w;
+				unsigned char con = 0, portal = 0;
+				for (int dir = 0; dir < 4 && areas[idx] != DT_TILECACHE_NULL_AREA; ++dir)
+				{
+					const int nx = x + offsetX[dir], ny = y + offsetY[dir];
+					if (nx < 0 || ny < 0 || nx >= w || ny >= h)
+					{
+						portal |= (unsigned char)(1 << dir);
+						continue;
+					}
+					const int nidx = nx + ny*w;
+					if (areas[nidx] != DT_TILECACHE_NULL_AREA && dtAbs((int)heights[idx] - (int)heights[nidx]) <= walkableClimb)
+						con |= (unsigned char)(1 << dir);
+				}
+				cons[idx] = (unsigned char)((portal << 4) | con);
+			}
+		}
+	}
+};
+
+// Marks every polygon walkable with flag 1, so the default query filter finds it.
+struct WalkableMeshProcess : public dtTileCacheMeshProcess
+{
+	virtual void process(struct dtNavMeshCreateParams* params, unsigned char* /*polyAreas*/, unsigned int* polyFlags)
+	{
+		for (int i = 0; i < params->polyCount; ++i)
+			polyFlags[i] = 1;
+	}
+};
+
+// A tile cache covering 32x32 world units with flat layers, and the nav mesh built from it.
+struct TestProfile
+{
+	dtTileCacheAlloc alloc;
+	CopyCompressor comp;
+	WalkableMeshProcess proc;
+	dtTileCache* tc;
+	dtNavMesh* nav;
+
+	explicit TestProfile(const int tileSize) : tc(dtAllocTileCache()), nav(dtAllocNavMesh())
+	{
+		const int ntiles = 32 / tileSize;
+
+		dtTileCacheParams tcparams;
+		memset(&tcparams, 0, sizeof(tcparams));
+		tcparams.cs = 1.0f;
+		tcparams.ch = 0.5f;
+		tcparams.width = tileSize;
+		tcparams.height = tileSize;
+		tcparams.walkableHeight = 2.0f;
+		tcparams.crouchHeight = 2.0f;
+		tcparams.walkableRadius = 0.5f;
+		tcparams.walkableClimb = 0.5f;
+		tcparams.maxSimplificationError = 1.3f;
+		tcparams.maxTiles = ntiles*ntiles;
+		tcparams.maxObstacles = 128;
+		REQUIRE(dtStatusSucceed(tc->init(&tcparams, &alloc, &comp, &proc)));
+
+		dtNavMeshParams navParams;
+		memset(&navParams, 0, sizeof(navParams));
+		navParams.tileWidth = (float)tileSize;
+		navParams.tileHeight = (float)tileSize;
+		navParams.maxTiles = ntiles*ntiles;
+		navParams.maxPolys = 256;
+		REQUIRE(dtStatusSucceed(nav->init(&navParams)));
+
+		std::vector<unsigned char> heights(tileSize*tileSize, 0);
+		std::vector<unsigned char> areas(tileSize*tileSize, DT_TILECACHE_WALKABLE_AREA);
+		std::vector<unsigned char> cons(tileSize*tileSize, 0);
+		for (int y = 0; y < tileSize; ++y)
+		{
+			for (int x = 0; x < tileSize; ++x)
+			{
+				unsigned char con = 0, portal = 0;
+				const int nx[4] = { x-1, x, x+1, x };
+				const int ny[4] = { y, y+1, y, y-1 };
+				for (int dir = 0; dir < 4; ++dir)
+				{
+					if (nx[dir] < 0 || ny[dir] < 0 || nx[dir] >= tileSize || ny[dir] >= tileSize)
+						portal |= (unsigned char)(1 << dir);
+					else
+						con |= (unsigned char)(1 << dir);
+				}
+				cons[x + y*tileSize] = (unsigned char)((portal << 4) | con);
+			}
+		}
+
+		for (int ty = 0; ty < ntiles; ++ty)
+		{
+			for (int tx = 0; tx < ntiles; ++tx)
+			{
+				dtTileCacheLayerHeader header;
+				memset(&header, 0, sizeof(header));
+				header.magic = DT_TILECACHE_MAGIC;
+				header.version = DT_TILECACHE_VERSION;
+				header.tx = tx;
+				header.ty = ty;
+				dtVset(header.bmin, (float)(tx*tileSize), 0.0f, (float)(ty*tileSize));
+				dtVset(header.bmax, (float)((tx+1)*tileSize), 2.0f, (float)((ty+1)*tileSize));
+				header.width = (unsigned char)tileSize;
+				header.height = (unsigned char)tileSize;
+				header.maxx = (unsigned char)(tileSize-1);
+				header.maxy = (unsigned char)(tileSize-1);
+
+				unsigned char* data = 0;
+				int dataSize = 0;
+				REQUIRE(dtStatusSucceed(dtBuildTileCacheLayer(&comp, &header, &heights[0], &areas[0], &cons[0], &data, &dataSize)));
+				REQUIRE(dtStatusSucceed(tc->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0)));
+				REQUIRE(dtStatusSucceed(tc->buildNavMeshTilesAt(tx, ty, nav)));
+			}
+		}
+	}
+
+	~TestProfile()
+	{
+		dtFreeTileCache(tc);
+		dtFreeNavMesh(nav);
+	}
+};
+
+inline dtObstacleDesc makeCylinder(const float x, const float z, const float radius)
+{
+	dtObstacleDesc desc;
+	memset(&desc, 0, sizeof(desc));
+	desc.type = DT_OBSTACLE_CYLINDER;
+	dtVset(desc.cylinder.pos, x, -1.0f, z);
+	desc.cylinder.radius = radius;
+	desc.cylinder.height = 4.0f;
+	return desc;
+}
+
+// Returns the number of updates it took to bring the tile cache up to date.
+inline int updateTileCache(TestProfile& profile)
+{
+	bool upToDate = false;
+	int updates = 0;
+	while (!upToDate && updates < 100)
+	{
+		REQUIRE(dtStatusSucceed(profile.tc->update(0, profile.nav, &upToDate)));
+		updates++;
+	}
+	REQUIRE(upToDate);
+	return updates;
+}
+
+#endif // TILECACHETESTUTILS_H
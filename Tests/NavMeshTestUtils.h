@@ -0,0 +1,87 @@
+#ifndef NAVMESHTESTUTILS_H
+#define NAVMESHTESTUTILS_H
+
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+
+/// Builds small hand made tiles for tests. Vertices are in cells of params.cs and params.ch,
+/// every polygon gets flag 1 and area 1, and polygon edges are borders until connected.
+/// Bounds, tile coordinates and off-mesh connections are set on params before build.
+struct TestTileBuilder
+{
+	dtNavMeshCreateParams params;
+	std::vector<unsigned short> verts;
+	std::vector<unsigned short> polys;
+
+	TestTileBuilder()
+	{
+		memset(&params, 0, sizeof(params));
+		params.nvp = DT_VERTS_PER_POLYGON;
+		params.bmax[1] = 1.0f;
+		params.walkableHeight = 2.0f;
+		params.walkableRadius = 0.5f;
+		params.walkableClimb = 0.5f;
+		params.cs = 1.0f;
+		params.ch = 1.0f;
+	}
+
+	unsigned short addVert(const int x, const int y, const int z)
+	{
+		verts.push_back((unsigned short)x);
+		verts.push_back((unsigned short)y);
+		verts.push_back((unsigned short)z);
+		return (unsigned short)(verts.size()/3 - 1);
+	}
+
+	/// Adds a quad, edge i runs from vertex i to vertex i+1. Returns the polygon index.
+	int addQuad(const unsigned short a, const unsigned short b, const unsigned short c, const unsigned short d)
+	{
+		const unsigned short v[4] = { a, b, c, d };
+		for (int i = 0; i < DT_VERTS_PER_POLYGON; ++i)
+			polys.push_back(i < 4 ? v[i] : 0xffff);
+		for (int i = 0; i < DT_VERTS_PER_POLYGON; ++i)
+			polys.push_back(i < 4 ? 0x800f : 0);
+		return getPolyCount() - 1;
+	}
+
+	/// Connects an edge to another polygon of the tile.
+	void setNeighbour(const int poly, const int edge, const int other)
+	{
+		polys[poly*DT_VERTS_PER_POLYGON*2 + DT_VERTS_PER_POLYGON + edge] = (unsigned short)other;
+	}
+
+	/// Marks an edge as a portal to the neighbour tile on @p side: 0 is -x, 1 is +z, 2 is +x and 3 is -z.
+	void setPortal(const int poly, const int edge, const int side)
+	{
+		polys[poly*DT_VERTS_PER_POLYGON*2 + DT_VERTS_PER_POLYGON + edge] = (unsigned short)(0x8000 | side);
+	}
+
+	int getPolyCount() const { return (int)polys.size() / (DT_VERTS_PER_POLYGON*2); }
+
+	unsigned char* build(int* dataSize)
+	{
+		const int npolys = getPolyCount();
+		std::vector<unsigned int> polyFlags(npolys, 1);
+		std::vector<unsigned char> polyAreas(npolys, 1);
+		params.verts = &verts[0];
+		params.vertCount = (int)verts.size() / 3;
+		params.polys = &polys[0];
+		params.polyFlags = &polyFlags[0];
+		params.polyAreas = &polyAreas[0];
+		params.polyCount = npolys;
+
+		unsigned char* data = 0;
+		const bool ok = dtCreateNavMeshData(&params, &data, dataSize);
+		params.polyFlags = 0;
+		params.polyAreas = 0;
+		REQUIRE(ok);
+		return data;
+	}
+};
+
+#endif // NAVMESHTESTUTILS_H
@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "catch2/catch_all.hpp"
+
+#include "BenchTimer.h"
+#include "Recast.h"
+
+static const int TILE_CELLS = 64;
+static const int TILE_BORDER = 3;
+static const float TILE_CS = 0.3f;
+static const float TILE_CH = 0.2f;
+
+enum TestTileKind
+{
+	TILE_OPEN,			///< Flat open ground.
+	TILE_PILLARS,		///< Ground with a few large pillars.
+	TILE_CLUTTER,		///< Ground with many small obstacles.
+	TILE_AREAS			///< Open ground with a strip of another area.
+};
+
+// Builds the compact heightfield of a tile of flat ground with obstacles marked as null area.
+static rcCompactHeightfield* buildTestTile(rcContext* ctx, const TestTileKind kind)
+{
+	const int size = TILE_CELLS + TILE_BORDER*2;
+	const float ext = size * TILE_CS;
+	const float bmin[3] = { 0.0f, 0.0f, 0.0f };
+	const float bmax[3] = { ext, 4.0f, ext };
+
+	rcHeightfield* hf = rcAllocHeightfield();
+	REQUIRE(hf);
+	REQUIRE(rcCreateHeightfield(ctx, *hf, size, size, bmin, bmax, TILE_CS, TILE_CH));
+	const float verts[] = { 0,0.5f,0, 0,0.5f,ext, ext,0.5f,ext, ext,0.5f,0 };
+	const int tris[] = { 0,1,2, 0,2,3 };
+	const unsigned char areas[] = { RC_WALKABLE_AREA, RC_WALKABLE_AREA };
+	REQUIRE(rcRasterizeTriangles(ctx, verts, 4, tris, areas, 2, *hf));
+
+	rcCompactHeightfield* chf = rcAllocCompactHeightfield();
+	REQUIRE(chf);
+	REQUIRE(rcBuildCompactHeightfield(ctx, 10, 4, *hf, *chf));
+	rcFreeHeightField(hf);
+
+	const float o = TILE_BORDER * TILE_CS;
+	const float in = TILE_CELLS * TILE_CS;
+	if (kind == TILE_PILLARS || kind == TILE_CLUTTER)
+	{
+		const int n = kind == TILE_PILLARS ? 2 : 5;
+		const float step = in / n;
+		const float half = kind == TILE_PILLARS ? step * 0.15f : step * 0.25f;
+		for (int y = 0; y < n; ++y)
+		{
+			for (int x = 0; x < n; ++x)
+			{
+				const float cx = o + (x + 0.5f) * step;
+				const float cz = o + (y + 0.5f) * step;
+				const float omin[3] = { cx - half, 0.0f, cz - half };
+				const float omax[3] = { cx + half, 4.0f, cz + half };
+				rcMarkBoxArea(ctx, omin, omax, RC_NULL_AREA, *chf);
+			}
+		}
+	}
+	else if (kind == TILE_AREAS)
+	{
+		const float smin[3] = { o + in * 0.4f, 0.0f, o };
+		const float smax[3] = { o + in * 0.6f, 4.0f, o + in };
+		rcMarkBoxArea(ctx, smin, smax, 2, *chf);
+	}
+
+	return chf;
+}
+
+// Builds the polygons of a tile, returns the polygon count.
+static int buildTestTilePolys(rcContext* ctx, rcCompactHeightfield& chf, const bool adaptive)
+{
+	if (adaptive)
+	{
+		REQUIRE(rcBuildRegionsAdaptive(ctx, chf, TILE_BORDER, 8, 20));
+	}
+	else
+	{
+		REQUIRE(rcBuildDistanceField(ctx, chf));
+		REQUIRE(rcBuildRegions(ctx, chf, TILE_BORDER, 8, 20));
+	}
+
+	rcContourSet* cset = rcAllocContourSet();
+	REQUIRE(cset);
+	REQUIRE(rcBuildContours(ctx, chf, 1.3f, 40, *cset));
+	rcPolyMesh* pmesh = rcAllocPolyMesh();
+	REQUIRE(pmesh);
+	REQUIRE(rcBuildPolyMesh(ctx, *cset, 6, *pmesh));
+	const int npolys = pmesh->npolys;
+	rcFreePolyMesh(pmesh);
+	rcFreeContourSet(cset);
+	return npolys;
+}
+
+TEST_CASE("rcChooseRegionPartition", "[recast, region]")
+{
+	rcContext ctx(false);
+
+	SECTION("Open ground is partitioned monotone")
+	{
+		rcCompactHeightfield* chf = buildTestTile(&ctx, TILE_OPEN);
+		rcRegionPartitionStats stats;
+		REQUIRE(rcChooseRegionPartition(&ctx, *chf, TILE_BORDER, &stats) == RC_PARTITION_MONOTONE);
+		REQUIRE(stats.spanCount == TILE_CELLS * TILE_CELLS);
+		REQUIRE(stats.areaCount == 1);
+		REQUIRE(stats.overlapCount == 0);
+		REQUIRE(stats.edgeCount == 0);
+		rcFreeCompactHeightfield(chf);
+	}
+
+	SECTION("A few obstacles are partitioned in layers")
+	{
+		rcCompactHeightfield* chf = buildTestTile(&ctx, TILE_PILLARS);
+		REQUIRE(rcChooseRegionPartition(&ctx, *chf, TILE_BORDER) == RC_PARTITION_LAYERS);
+		rcFreeCompactHeightfield(chf);
+	}
+
+	SECTION("Several areas are not partitioned monotone")
+	{
+		rcCompactHeightfield* chf = buildTestTile(&ctx, TILE_AREAS);
+		rcRegionPartitionStats stats;
+		REQUIRE(rcChooseRegionPartition(&ctx, *chf, TILE_BORDER, &stats) == RC_PARTITION_LAYERS);
+		REQUIRE(stats.areaCount == 2);
+		rcFreeCompactHeightfield(chf);
+	}
+
+	SECTION("Clutter is partitioned with watershed")
+	{
+		rcCompactHeightfield* chf = buildTestTile(&ctx, TILE_CLUTTER);
+		REQUIRE(rcChooseRegionPartition(&ctx, *chf, TILE_BORDER) == RC_PARTITION_WATERSHED);
+
+		rcRegionPartition partition = RC_PARTITION_MONOTONE;
+		REQUIRE(rcBuildRegionsAdaptive(&ctx, *chf, TILE_BORDER, 8, 20, &partition));
+		REQUIRE(partition == RC_PARTITION_WATERSHED);
+		REQUIRE(chf->maxRegions > 0);
+		rcFreeCompactHeightfield(chf);
+	}
+}
+
+#ifdef BENCH_TIMER_AVAILABLE
+
+TEST_CASE("RecastAdaptivePartition")
+{
+	// A level where most tiles are open and a few are cluttered.
+	static const TestTileKind LEVEL[] = {
+		TILE_OPEN, TILE_OPEN, TILE_OPEN, TILE_PILLARS, TILE_OPEN, TILE_AREAS, TILE_OPEN, TILE_CLUTTER,
+	};
+	static const int NUM_TILES = (int)(sizeof(LEVEL) / sizeof(LEVEL[0]));
+	static const int ROUNDS = 10;
+	rcContext ctx(false);
+
+	int64_t nanos[2] = { 0, 0 };
+	int npolys[2] = { 0, 0 };
+	for (int mode = 0; mode < 2; ++mode)
+	{
+		for (int r = 0; r < ROUNDS; ++r)
+		{
+			for (int i = 0; i < NUM_TILES; ++i)
+			{
+				rcCompactHeightfield* chf = buildTestTile(&ctx, LEVEL[i]);
+				const int64_t begin = NowNanos();
+				const int n = buildTestTilePolys(&ctx, *chf, mode == 1);
+				nanos[mode] += NowNanos() - begin;
+				if (r == 0)
+					npolys[mode] += n;
+				rcFreeCompactHeightfield(chf);
+			}
+		}
+	}
+
+	const int iterations = NUM_TILES * ROUNDS;
+	printf("BM_%-35s %d tiles, watershed %10.2f nanos/tile %d polys, adaptive %10.2f nanos/tile %d polys\n",
+		   "AdaptivePartition:", iterations, double(nanos[0]) / iterations, npolys[0],
+		   double(nanos[1]) / iterations, npolys[1]);
+	REQUIRE(npolys[1] > 0);
+}
+
+#endif // BENCH_TIMER_AVAILABLE
@@ -3,23 +3,13 @@
 
 #include "catch2/catch_all.hpp"
 
+#include "BenchTimer.h"
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
 #include <vector>
 
-// TODO: Implement benchmarking for platforms other than posix.
-#ifdef __unix__
-#include <unistd.h>
-#ifdef _POSIX_TIMERS
-#include <time.h>
-#include <stdint.h>
-
-int64_t NowNanos() {
-	struct timespec tp;
-	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tp);
-	return tp.tv_nsec + 1000000000LL * tp.tv_sec;
-}
+#ifdef BENCH_TIMER_AVAILABLE
 
 #define BM(name, iterations) \
 	struct BM_ ## name { \
@@ -164,5 +154,4 @@ BM(stdvector_Resize, kNumLoops)
 }
 
 #undef BM
-#endif  // _POSIX_TIMERS
-#endif  // __unix__
+#endif // BENCH_TIMER_AVAILABLE
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastDump.h"
+
+// In-memory duFileIO, so captures can be round tripped without touching the disk.
+struct MemoryIO : public duFileIO
+{
+	std::vector<unsigned char> buffer;
+	size_t readPos = 0;
+	bool writing = true;
+
+	virtual bool isWriting() const { return writing; }
+	virtual bool isReading() const { return !writing; }
+	virtual bool write(const void* ptr, const size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)ptr;
+		buffer.insert(buffer.end(), bytes, bytes + size);
+		return true;
+	}
+	virtual bool read(void* ptr, const size_t size)
+	{
+		if (readPos + size > buffer.size())
+			return false;
+		memcpy(ptr, &buffer[readPos], size);
+		readPos += size;
+		return true;
+	}
+};
+
+static void initCaptureConfig(rcConfig& cfg)
+{
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = 0.5f;
+	cfg.ch = 0.5f;
+	cfg.walkableSlopeAngle = 45.0f;
+	cfg.walkableHeight = 4;
+	cfg.walkableClimb = 2;
+	cfg.walkableRadius = 1;
+	cfg.crouchHeight = 4;
+	cfg.maxEdgeLen = 24;
+	cfg.maxSimplificationError = 1.3f;
+	cfg.minRegionArea = 4;
+	cfg.mergeRegionArea = 16;
+	cfg.maxVertsPerPoly = 6;
+	cfg.tileSize = 16;
+	cfg.borderSize = cfg.walkableRadius + 3;
+	cfg.width = cfg.tileSize + cfg.borderSize*2;
+	cfg.height = cfg.tileSize + cfg.borderSize*2;
+	cfg.detailSampleDist = 3.0f;
+	cfg.detailSampleMaxError = 0.5f;
+	cfg.bmin[0] = -cfg.borderSize*cfg.cs;
+	cfg.bmin[1] = -1.0f;
+	cfg.bmin[2] = -cfg.borderSize*cfg.cs;
+	cfg.bmax[0] = (cfg.tileSize + cfg.borderSize)*cfg.cs;
+	cfg.bmax[1] = 1.0f;
+	cfg.bmax[2] = (cfg.tileSize + cfg.borderSize)*cfg.cs;
+}
+
+TEST_CASE("Tile capture", "[recastdump]")
+{
+	// Flat quad covering the tile, with a sloped wall triangle that must stay unwalkable.
+	const float verts[] = {
+		-4, 0, -4,
+		 12, 0, -4,
+		 12, 0, 12,
+		-4, 0, 12,
+		 4, 8, -4,
+	};
+	const int tris[] = {
+		0, 3, 2,
+		0, 2, 1,
+		0, 1, 4,
+	};
+	const int surfTypes[] = { RC_AUTOMATIC_AREA, RC_AUTOMATIC_AREA, RC_AUTOMATIC_AREA };
+
+	duTileCapture capture;
+	duInitTileCapture(capture);
+	initCaptureConfig(capture.cfg);
+	capture.tx = 3;
+	capture.ty = 7;
+	capture.mode = DU_TILECAPTURE_WATERSHED;
+	capture.flags = DU_TILECAPTURE_FILTER_LOW_HANGING | DU_TILECAPTURE_FILTER_LOW_HEIGHT;
+	capture.compactHeight = 13;
+
+	SECTION("Appended triangles share vertices")
+	{
+		REQUIRE(duAppendTileCaptureTris(capture, verts, tris, surfTypes, 2));
+		REQUIRE(capture.ntris == 2);
+		REQUIRE(capture.nverts == 4);
+
+		REQUIRE(duAppendTileCaptureTris(capture, verts, &tris[6], &surfTypes[2], 1));
+		REQUIRE(capture.ntris == 3);
+		REQUIRE(capture.surfTypes[2] == RC_AUTOMATIC_AREA);
+
+		const float* v = &capture.verts[capture.tris[6+2]*3];
+		REQUIRE(v[1] == 8.0f);
+	}
+
+	SECTION("Null surface types bake the slope marking")
+	{
+		REQUIRE(duAppendTileCaptureTris(capture, verts, tris, 0, 3));
+		REQUIRE(capture.surfTypes[0] == RC_WALKABLE_AREA);
+		REQUIRE(capture.surfTypes[1] == RC_WALKABLE_AREA);
+		REQUIRE(capture.surfTypes[2] == RC_NULL_AREA);
+	}
+
+	SECTION("Round trip and replay")
+	{
+		const float vol[] = { 2, 0, 2,  6, 0, 2,  6, 0, 6,  2, 0, 6 };
+		REQUIRE(duAppendTileCaptureTris(capture, verts, tris, surfTypes, 3));
+		REQUIRE(duAppendTileCaptureVolume(capture, vol, 4, -1.0f, 1.0f, RC_NULL_AREA));
+
+		MemoryIO io;
+		REQUIRE(duDumpTileCapture(capture, &io));
+		io.writing = false;
+
+		duTileCapture loaded;
+		REQUIRE(duReadTileCapture(loaded, &io));
+		REQUIRE(loaded.tx == 3);
+		REQUIRE(loaded.ty == 7);
+		REQUIRE(loaded.mode == DU_TILECAPTURE_WATERSHED);
+		REQUIRE(loaded.flags == capture.flags);
+		REQUIRE(loaded.nverts == capture.nverts);
+		REQUIRE(loaded.ntris == capture.ntris);
+		REQUIRE(loaded.nvols == 1);
+		REQUIRE(memcmp(&loaded.cfg, &capture.cfg, sizeof(rcConfig)) == 0);
+		REQUIRE(memcmp(loaded.verts, capture.verts, sizeof(float)*3*capture.nverts) == 0);
+		REQUIRE(memcmp(loaded.tris, capture.tris, sizeof(int)*3*capture.ntris) == 0);
+		REQUIRE(memcmp(loaded.surfTypes, capture.surfTypes, sizeof(int)*capture.ntris) == 0);
+
+		rcContext ctx(false);
+
+		rcPolyMesh* pmeshA = rcAllocPolyMesh();
+		rcPolyMesh* pmeshB = rcAllocPolyMesh();
+		rcPolyMeshDetail* dmesh = rcAllocPolyMeshDetail();
+		REQUIRE(duReplayTileCapture(&ctx, capture, 0, pmeshA, dmesh));
+		REQUIRE(duReplayTileCapture(&ctx, loaded, 0, pmeshB, 0));
+		REQUIRE(pmeshA->npolys > 0);
+		REQUIRE(pmeshA->npolys == pmeshB->npolys);
+		REQUIRE(pmeshA->nverts == pmeshB->nverts);
+		REQUIRE(memcmp(pmeshA->verts, pmeshB->verts, sizeof(unsigned short)*3*pmeshA->nverts) == 0);
+		REQUIRE(dmesh->nmeshes == pmeshA->npolys);
+		rcFreePolyMesh(pmeshA);
+		rcFreePolyMesh(pmeshB);
+		rcFreePolyMeshDetail(dmesh);
+
+		// Replaying without the matching output fails instead of crashing.
+		REQUIRE_FALSE(duReplayTileCapture(&ctx, loaded, 0, 0, 0));
+
+		// Adaptive captures replay with the partitioning rcChooseRegionPartition picks.
+		loaded.mode = DU_TILECAPTURE_ADAPTIVE;
+		rcPolyMesh* pmeshC = rcAllocPolyMesh();
+		REQUIRE(duReplayTileCapture(&ctx, loaded, 0, pmeshC, 0));
+		REQUIRE(pmeshC->npolys > 0);
+		rcFreePolyMesh(pmeshC);
+
+		loaded.mode = DU_TILECAPTURE_LAYERS;
+		rcHeightfieldLayerSet* lset = rcAllocHeightfieldLayerSet();
+		REQUIRE(duReplayTileCapture(&ctx, loaded, lset, 0, 0));
+		REQUIRE(lset->nlayers == 1);
+		rcFreeHeightfieldLayerSet(lset);
+
+		duFreeTileCapture(loaded);
+	}
+
+	duFreeTileCapture(capture);
+}